@@ -244,11 +244,12 @@ INCLUDEPATH += $$BIM_CORE
 
 #core
 SOURCES += $$BIM_CORE/xstring.cpp $$BIM_CORE/xtypes.cpp \
-           $$BIM_CORE/tag_map.cpp $$BIM_CORE/xpointer.cpp $$BIM_CORE/xconf.cpp
+           $$BIM_CORE/tag_map.cpp $$BIM_CORE/xpointer.cpp $$BIM_CORE/xconf.cpp \
+           $$BIM_CORE/xtiming.cpp
 
 HEADERS += $$BIM_CORE/blob_manager.h $$BIM_CORE/tag_map.h \
            $$BIM_CORE/xconf.h $$BIM_CORE/xpointer.h \
-           $$BIM_CORE/xstring.h $$BIM_CORE/xtypes.h
+           $$BIM_CORE/xstring.h $$BIM_CORE/xtypes.h $$BIM_CORE/xtiming.h
 
 #Formats API
 SOURCES += $$BIM_FMTS_API/bim_img_format_utils.cpp \
@@ -285,6 +286,7 @@ SOURCES += $$BIM_FMTS/bim_format_manager.cpp \
            $$BIM_FMTS/meta_format_manager.cpp \
            $$BIM_FMTS/bim_exiv_parse.cpp \
            $$BIM_FMTS/bim_lcms_parse.cpp \
+           $$BIM_FMTS/bim_format_misc.cpp \
            $$BIM_FMTS/tiff/bim_tiny_tiff.cpp \
            $$BIM_FMTS/tiff/bim_tiff_format.cpp \
            $$BIM_FMTS/tiff/bim_tiff_format_io.cpp \
@@ -386,6 +388,7 @@ libbioimage_transforms {
              $$BIM_TRANSFORMS/wavelet/convolution.cpp \
              $$BIM_TRANSFORMS/wavelet/DataGrid2D.cpp \
              $$BIM_TRANSFORMS/wavelet/DataGrid3D.cpp \
+             $$BIM_TRANSFORMS/wavelet/dwt.cpp \
              $$BIM_TRANSFORMS/wavelet/Filter.cpp \
              $$BIM_TRANSFORMS/wavelet/FilterSet.cpp \
              $$BIM_TRANSFORMS/wavelet/Symlet5.cpp \
@@ -397,6 +400,7 @@ libbioimage_transforms {
 
   HEADERS += $$BIM_FMTS/wavelet/DataGrid.h $$BIM_FMTS/wavelet/wt.h \
              $$BIM_FMTS/wavelet/DataGrid3D.h $$BIM_FMTS/wavelet/WaveletLow.h \
+             $$BIM_FMTS/wavelet/dwt.h \
              $$BIM_FMTS/wavelet/Common.h $$BIM_FMTS/wavelet/convolution.h \
              $$BIM_FMTS/wavelet/WaveletHigh.h $$BIM_FMTS/wavelet/FilterSet.h \
              $$BIM_FMTS/wavelet/DataGrid2D.h $$BIM_FMTS/wavelet/Symlet5.h \
@@ -8,8 +8,9 @@
   2008-03-18 17:13 - First creation
   2009-07-08 19:24 - INI parsing, setting values, iterative removing
   2015-07-28 15:44 - Extended values to variants and added types
+  2026-10-19 12:00 - Shared variant payloads and copy-on-write SharedTagMap
 
-  ver: 4
+  ver: 5
 
   *******************************************************************************/
 
@@ -39,19 +40,24 @@ namespace bim {
 // Variant
 //******************************************************************************
 
+const TagContainer &Variant::data() const {
+    static const TagContainer empty;
+    return this->v ? *this->v : empty;
+}
+
 std::vector<char> Variant::as_vector() const {
-    return v;
+    return this->data();
 }
 
 const char * Variant::as_binary() const {
-    return &this->v[0];
+    return this->data().size() > 0 ? &this->data()[0] : NULL;
 }
 
 xstring Variant::as_string(const std::string &def) const {
     xstring tt = this->t;
-    size_t sz = this->v.size();
+    size_t sz = this->data().size();
     if (tt.startsWith("string") && sz>0) {
-        const char *cc = &this->v[0];
+        const char *cc = &this->data()[0];
         if (cc[sz - 1] == 0) return xstring(cc);
         xstring str(sz+1, 0);
         memcpy(&str[0], cc, sz);
@@ -69,7 +75,7 @@ xstring Variant::as_string(const std::string &def) const {
     } else {
         std::vector<xstring> o;
         for (int i = 0; i < sz; ++i) {
-            o.push_back(xstring::xprintf("%X", this->v[i]));
+            o.push_back(xstring::xprintf("%X", this->data()[i]));
         }
         return xstring::join(o, ",");
     }
@@ -79,13 +85,13 @@ xstring Variant::as_string(const std::string &def) const {
 
 int Variant::as_int(const int &def) const {
     xstring tt = this->t;
-    size_t sz = this->v.size();
+    size_t sz = this->data().size();
 
     if (tt.startsWith("int") && sz >= sizeof(int)) {
-        int *v = (int *)&this->v[0];
+        int *v = (int *)&this->data()[0];
         return *v;
     } else if (tt.startsWith("unsigned") && sz >= sizeof(unsigned int)) {
-        unsigned int *v = (unsigned int *)&this->v[0];
+        unsigned int *v = (unsigned int *)&this->data()[0];
         return (int) *v;
     } else if (sz < VariantLimits::max_int_string_sz) {
         xstring str = this->as_string("");
@@ -96,12 +102,12 @@ int Variant::as_int(const int &def) const {
 
 unsigned int Variant::as_unsigned(const unsigned int &def) const {
     xstring tt = this->t;
-    size_t sz = this->v.size();
+    size_t sz = this->data().size();
     if (tt.startsWith("unsigned") && sz >= sizeof(unsigned int)) {
-        unsigned int *v = (unsigned int *)&this->v[0];
+        unsigned int *v = (unsigned int *)&this->data()[0];
         return *v;
     } else if (tt.startsWith("int") && sz >= sizeof(int)) {
-        int *v = (int *)&this->v[0];
+        int *v = (int *)&this->data()[0];
         return (unsigned int) *v;
     } else if (sz < VariantLimits::max_int_string_sz) {
         xstring str = this->as_string("");
@@ -112,12 +118,12 @@ unsigned int Variant::as_unsigned(const unsigned int &def) const {
 
 double Variant::as_double(const double &def) const {
     xstring tt = this->t;
-    size_t sz = this->v.size();
+    size_t sz = this->data().size();
     if (tt.startsWith("double") && sz >= sizeof(double)) {
-        double *v = (double *)&this->v[0];
+        double *v = (double *)&this->data()[0];
         return *v;
     } else if (tt.startsWith("float") && sz >= sizeof(float)) {
-        float *v = (float *)&this->v[0];
+        float *v = (float *)&this->data()[0];
         return (double) *v;
     } else if (sz < VariantLimits::max_float_string_sz) {
         xstring str = this->as_string("");
@@ -128,12 +134,12 @@ double Variant::as_double(const double &def) const {
 
 float Variant::as_float(const float &def) const {
     xstring tt = this->t;
-    size_t sz = this->v.size();
+    size_t sz = this->data().size();
     if (tt.startsWith("float") && sz >= sizeof(float)) {
-        float *v = (float *)&this->v[0];
+        float *v = (float *)&this->data()[0];
         return *v;
     } else if (tt.startsWith("double") && sz >= sizeof(double)) {
-        double *v = (double *)&this->v[0];
+        double *v = (double *)&this->data()[0];
         return (float) *v;
     } else if (sz < VariantLimits::max_float_string_sz) {
         xstring str = this->as_string("");
@@ -144,9 +150,9 @@ float Variant::as_float(const float &def) const {
 
 bool Variant::as_boolean(const bool &def) const {
     xstring tt = this->t;
-    size_t sz = this->v.size();
+    size_t sz = this->data().size();
     if (tt.startsWith("boolean") && sz >= sizeof(bool)) {
-        bool *v = (bool *)&this->v[0];
+        bool *v = (bool *)&this->data()[0];
         return *v;
     } else if (sz < VariantLimits::max_bool_string_sz) {
         xstring str = this->as_string("");
@@ -160,58 +166,57 @@ TagType Variant::type() const {
 }
 
 unsigned int Variant::size() const {
-    return this->v.size();
+    return this->data().size();
 }
 
 void Variant::set(const TagContainer &value, const TagType &type) {
-    this->v = value;
+    this->v = std::make_shared<const TagContainer>(value);
     this->t = type;
 }
 
 void Variant::set(const char *value, unsigned int size, const TagType &type) {
     if (!value || size < 1) return;
-    this->v.resize(size);
+    this->v = std::make_shared<const TagContainer>(value, value + size);
     this->t = type;
-    memcpy(&this->v[0], value, size);
 }
 
 void Variant::set(const std::string &value, const TagType &type) {
     this->t = type;
     if (value.size() > 0) {
-        this->v.resize(value.size()+1);
-        this->v[value.size()] = 0;
-        memcpy(&this->v[0], value.c_str(), value.size());
+        // stored with the terminating zero
+        this->v = std::make_shared<const TagContainer>(value.c_str(), value.c_str() + value.size() + 1);
     }
 }
 
+template <typename T>
+inline std::shared_ptr<const TagContainer> variant_pod(const T &value) {
+    const char *p = (const char *) &value;
+    return std::make_shared<const TagContainer>(p, p + sizeof(value));
+}
+
 void Variant::set(const int &value, const TagType &type) {
     this->t = type;
-    this->v.resize(sizeof(value));
-    memcpy(&this->v[0], &value, sizeof(value));
+    this->v = variant_pod(value);
 }
 
 void Variant::set(const unsigned int &value, const TagType &type) {
     this->t = type;
-    this->v.resize(sizeof(value));
-    memcpy(&this->v[0], &value, sizeof(value));
+    this->v = variant_pod(value);
 }
 
 void Variant::set(const double &value, const TagType &type) {
     this->t = type;
-    this->v.resize(sizeof(value));
-    memcpy(&this->v[0], &value, sizeof(value));
+    this->v = variant_pod(value);
 }
 
 void Variant::set(const float &value, const TagType &type) {
     this->t = type;
-    this->v.resize(sizeof(value));
-    memcpy(&this->v[0], &value, sizeof(value));
+    this->v = variant_pod(value);
 }
 
 void Variant::set(const bool &value, const TagType &type) {
     this->t = type;
-    this->v.resize(sizeof(value));
-    memcpy(&this->v[0], &value, sizeof(value));
+    this->v = variant_pod(value);
 }
 
 
@@ -596,3 +601,21 @@ bool TagMap::fromString(const std::string &str, const std::string &seplines, con
     }
     return true;
 }
+
+
+//******************************************************************************
+// SharedTagMap
+//******************************************************************************
+
+const TagMap &SharedTagMap::empty() {
+    static const TagMap m;
+    return m;
+}
+
+TagMap &SharedTagMap::edit() {
+    if (!this->p)
+        this->p = std::make_shared<TagMap>();
+    else if (this->p.use_count() > 1)
+        this->p = std::make_shared<TagMap>(*this->p);
+    return *this->p;
+}
@@ -21,8 +21,9 @@
   2008-03-18 17:13 - First creation
   2009-07-08 19:24 - INI parsing, setting values, iterative removing
   2015-07-28 15:44 - Extended values to variants and added types
+  2026-10-19 12:00 - Shared variant payloads and copy-on-write SharedTagMap
 
-  ver: 4
+  ver: 5
 
   *******************************************************************************/
 
@@ -32,6 +33,8 @@
 #include <string>
 #include <map>
 #include <deque>
+#include <vector>
+#include <memory>
 
 #include "xstring.h"
 
@@ -40,6 +43,8 @@ namespace bim {
     typedef std::vector<char> TagContainer;
     typedef std::string TagType;
 
+    // values are immutable once set and their payloads are shared between copies,
+    // copying a variant or a whole TagMap never duplicates the stored bytes
     class Variant {
     public:
         explicit Variant() { }
@@ -76,8 +81,10 @@ namespace bim {
         void set( const bool &value, const TagType &type = "boolean");
 
     private:
-        TagContainer v;
+        std::shared_ptr<const TagContainer> v;
         TagType t;
+
+        const TagContainer &data() const;
     };
 
 
@@ -180,6 +187,34 @@ namespace bim {
         static std::string readline(const std::string &str, int &pos);
     };
 
+    //--------------------------------------------------------------------------
+    // SharedTagMap - copy-on-write handle to a TagMap
+    // copies of the handle point to the same map, reading never copies and
+    // the first modification through edit() clones the map if it is shared
+    //--------------------------------------------------------------------------
+
+    class SharedTagMap {
+    public:
+        SharedTagMap() {}
+        SharedTagMap(const TagMap &m) { if (m.size() > 0) p = std::make_shared<TagMap>(m); }
+
+        const TagMap &get() const { return p ? *p : empty(); }
+        const TagMap *operator->() const { return &get(); }
+        const TagMap &operator*() const { return get(); }
+        operator const TagMap &() const { return get(); }
+
+        // returns a map owned exclusively by this handle, safe to modify
+        TagMap &edit();
+
+        void clear() { p.reset(); }
+        size_t size() const { return p ? p->size() : 0; }
+        bool isShared() const { return p && p.use_count() > 1; }
+
+    private:
+        std::shared_ptr<TagMap> p;
+        static const TagMap &empty();
+    };
+
 } // namespace bim
 
 #endif // BIM_TAG_MAP_H
@@ -5,8 +5,9 @@
 
  History:
    08/08/2001 21:53:31 - First creation
+   10/19/2026 12:00:00 - Timer measures wall-clock time
 
- Ver : 1
+ Ver : 2
 *******************************************************************************/
 
 #include <cstring>
@@ -163,8 +164,7 @@ void XConf::error(const std::string &s) const {
     std::cerr << s << std::endl;
 }
 void XConf::printElapsed(const std::string &s, int verbose_level) const {
-    clock_t t = timerElapsed();
-    print(xstring::xprintf("%s %f seconds", s.c_str(), (float)t / CLOCKS_PER_SEC), verbose_level);
+    print(xstring::xprintf("%s %f seconds", s.c_str(), timerElapsed()), verbose_level);
 }
 
 //--------------------------------------------------------------------------------------
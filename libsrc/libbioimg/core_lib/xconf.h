@@ -5,14 +5,16 @@
 
  History:
    08/08/2001 21:53:31 - First creation
+   10/19/2026 12:00:00 - Timer measures wall-clock time
 
- Ver : 1
+ Ver : 2
 *******************************************************************************/
 
 #ifndef XCONF_H
 #define XCONF_H
 
 #include <ctime>
+#include <chrono>
 
 #include <string>
 #include <vector>
@@ -48,8 +50,8 @@ public:
 class XConf {
 
 public:
-  XConf() {}
-  XConf(int argc, char** argv) { readParams( argc, argv ); }
+  XConf(): verbose(0) { timerStart(); }
+  XConf(int argc, char** argv): verbose(0) { timerStart(); readParams( argc, argv ); }
   ~XConf() {}
 
   int readParams( int argc, char** argv );
@@ -65,8 +67,9 @@ public:
     void print( const std::string &s, int verbose_level = 1 ) const;
     void error(const std::string &s) const;
 
-    void timerStart() { this->timer = clock(); }
-    inline clock_t timerElapsed() const { return clock() - timer; }
+    // wall-clock time, clock() would sum CPU time over all OpenMP threads
+    void timerStart() { this->timer = std::chrono::steady_clock::now(); }
+    inline double timerElapsed() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - timer).count(); }
     void printElapsed(const std::string &s, int verbose_level = 1) const;
 
 public:
@@ -92,7 +95,7 @@ protected:
     // defines unique argument names and a number of values in each, 0 - no vals, -1 - comma separated list of values 
     std::map<xstring, int> arguments_defs;
     std::map<xstring, xstring> arguments_descr;
-    clock_t timer;
+    std::chrono::steady_clock::time_point timer;
 
     int verbose;
 
@@ -0,0 +1,165 @@
+/*******************************************************************************
+ Wall-clock instrumentation of the processing pipeline
+
+ History:
+   10/19/2026 12:00:00 - First creation
+
+ Ver : 1
+*******************************************************************************/
+
+#include <cstdio>
+
+#include <string>
+#include <map>
+#include <fstream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "xstring.h"
+#include "xtiming.h"
+
+using namespace bim;
+
+bool Timing::is_enabled = false;
+std::chrono::steady_clock::time_point Timing::started = std::chrono::steady_clock::now();
+std::map<std::string, Timing::ThreadEntries> Timing::entries;
+
+//--------------------------------------------------------------------------------------
+// Timing::Entry
+//--------------------------------------------------------------------------------------
+
+void Timing::Entry::add(double s, bim::uint64 b, bim::uint64 p) {
+    this->min_seconds = this->count == 0 ? s : bim::min<double>(this->min_seconds, s);
+    this->max_seconds = bim::max<double>(this->max_seconds, s);
+    this->seconds += s;
+    this->bytes += b;
+    this->pixels += p;
+    ++this->count;
+}
+
+void Timing::Entry::add(const Entry &e) {
+    if (e.count == 0) return;
+    this->min_seconds = this->count == 0 ? e.min_seconds : bim::min<double>(this->min_seconds, e.min_seconds);
+    this->max_seconds = bim::max<double>(this->max_seconds, e.max_seconds);
+    this->seconds += e.seconds;
+    this->bytes += e.bytes;
+    this->pixels += e.pixels;
+    this->count += e.count;
+}
+
+//--------------------------------------------------------------------------------------
+// Timing
+//--------------------------------------------------------------------------------------
+
+void Timing::enable(bool on) {
+    if (on && !is_enabled) started = std::chrono::steady_clock::now();
+    is_enabled = on;
+}
+
+void Timing::clear() {
+    #pragma omp critical (timing_entries)
+    {
+        entries.clear();
+        started = std::chrono::steady_clock::now();
+    }
+}
+
+void Timing::add(const std::string &name, double seconds, bim::uint64 bytes, bim::uint64 pixels) {
+    if (!is_enabled) return;
+    int thread = 0;
+#ifdef _OPENMP
+    thread = omp_get_thread_num();
+#endif
+    #pragma omp critical (timing_entries)
+    entries[name][thread].add(seconds, bytes, pixels);
+}
+
+std::map<std::string, Timing::Entry> Timing::totals() {
+    std::map<std::string, Entry> out;
+    #pragma omp critical (timing_entries)
+    for (std::map<std::string, ThreadEntries>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        Entry &e = out[it->first];
+        for (ThreadEntries::const_iterator t = it->second.begin(); t != it->second.end(); ++t)
+            e.add(t->second);
+    }
+    return out;
+}
+
+static std::string json_escape(const std::string &s) {
+    std::string o;
+    for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        if (c == '"' || c == '\\') { o += '\\'; o += c; }
+        else if ((unsigned char) c < 0x20) o += xstring::xprintf("\\u%.4x", (int) c);
+        else o += c;
+    }
+    return o;
+}
+
+static std::string json_entry(const Timing::Entry &e) {
+    double mb = e.bytes / (1024.0 * 1024.0);
+    return xstring::xprintf("\"count\": %llu, \"seconds\": %.6f, \"min_seconds\": %.6f, \"max_seconds\": %.6f, "
+                            "\"bytes\": %llu, \"pixels\": %llu, \"mb_per_second\": %.3f, \"mpixels_per_second\": %.3f",
+                            (unsigned long long) e.count, e.seconds, e.min_seconds, e.max_seconds,
+                            (unsigned long long) e.bytes, (unsigned long long) e.pixels,
+                            e.seconds > 0 ? mb / e.seconds : 0.0,
+                            e.seconds > 0 ? e.pixels / 1000000.0 / e.seconds : 0.0);
+}
+
+std::string Timing::toJSON() {
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::map<std::string, ThreadEntries> snapshot;
+    #pragma omp critical (timing_entries)
+    snapshot = entries;
+
+    std::string json = xstring::xprintf("{\n  \"wall_seconds\": %.6f,\n  \"timers\": {", wall);
+    for (std::map<std::string, ThreadEntries>::const_iterator it = snapshot.begin(); it != snapshot.end(); ++it) {
+        Entry total;
+        for (ThreadEntries::const_iterator t = it->second.begin(); t != it->second.end(); ++t)
+            total.add(t->second);
+
+        json += it == snapshot.begin() ? "\n" : ",\n";
+        json += "    \"" + json_escape(it->first) + "\": { " + json_entry(total) + ", \"threads\": {";
+        for (ThreadEntries::const_iterator t = it->second.begin(); t != it->second.end(); ++t) {
+            json += t == it->second.begin() ? " " : ", ";
+            json += xstring::xprintf("\"%d\": { ", t->first) + json_entry(t->second) + " }";
+        }
+        json += " } }";
+    }
+    json += "\n  }\n}\n";
+    return json;
+}
+
+bool Timing::toFile(const std::string &fileName) {
+    std::ofstream f(fileName.c_str(), std::ios_base::out | std::ios_base::trunc);
+    if (!f.is_open()) return false;
+    f << toJSON();
+    return f.good();
+}
+
+//--------------------------------------------------------------------------------------
+// ScopedTimer
+//--------------------------------------------------------------------------------------
+
+ScopedTimer::ScopedTimer(const char *name, bim::uint64 bytes, bim::uint64 pixels)
+: active(Timing::enabled()), bytes(bytes), pixels(pixels) {
+    if (!this->active) return;
+    this->name = name;
+    this->t0 = std::chrono::steady_clock::now();
+}
+
+ScopedTimer::ScopedTimer(const std::string &name, bim::uint64 bytes, bim::uint64 pixels)
+: active(Timing::enabled()), bytes(bytes), pixels(pixels) {
+    if (!this->active) return;
+    this->name = name;
+    this->t0 = std::chrono::steady_clock::now();
+}
+
+void ScopedTimer::stop() {
+    if (!this->active) return;
+    this->active = false;
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->t0).count();
+    Timing::add(this->name, s, this->bytes, this->pixels);
+}
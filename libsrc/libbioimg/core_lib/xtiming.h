@@ -0,0 +1,106 @@
+/*******************************************************************************
+ Wall-clock instrumentation of the processing pipeline
+
+ Scoped timers record elapsed wall time together with the number of bytes
+ and pixels processed under a given name, e.g. "decode" or "operation/-resize".
+ Measurements are aggregated per name and per OpenMP thread and can be
+ written as a JSON report. Recording is disabled by default and costs a
+ single flag test per timer until enabled.
+
+ Example:
+   bim::Timing::enable();
+   {
+     bim::ScopedTimer t("decode");
+     ...
+     t.add(bytes, pixels);
+   }
+   bim::Timing::toFile("timing.json");
+
+ History:
+   10/19/2026 12:00:00 - First creation
+
+ Ver : 1
+*******************************************************************************/
+
+#ifndef XTIMING_H
+#define XTIMING_H
+
+#include <string>
+#include <map>
+#include <chrono>
+
+#include "xtypes.h"
+
+namespace bim {
+
+//--------------------------------------------------------------------------------------
+// Timing - global registry of timing measurements
+//--------------------------------------------------------------------------------------
+
+class Timing {
+public:
+    class Entry {
+    public:
+        Entry(): count(0), seconds(0), min_seconds(0), max_seconds(0), bytes(0), pixels(0) {}
+        void add(double s, bim::uint64 b, bim::uint64 p);
+        void add(const Entry &e);
+
+        bim::uint64 count;
+        double seconds;
+        double min_seconds;
+        double max_seconds;
+        bim::uint64 bytes;
+        bim::uint64 pixels;
+    };
+
+    // per thread entries of one measurement name
+    typedef std::map<int, Entry> ThreadEntries;
+
+public:
+    static void enable(bool on = true);
+    static bool enabled() { return is_enabled; }
+    static void clear();
+
+    static void add(const std::string &name, double seconds, bim::uint64 bytes = 0, bim::uint64 pixels = 0);
+
+    // totals over all threads
+    static std::map<std::string, Entry> totals();
+
+    static std::string toJSON();
+    static bool toFile(const std::string &fileName);
+
+private:
+    static bool is_enabled;
+    static std::chrono::steady_clock::time_point started;
+    static std::map<std::string, ThreadEntries> entries;
+};
+
+//--------------------------------------------------------------------------------------
+// ScopedTimer - records wall time from construction to destruction
+//--------------------------------------------------------------------------------------
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char *name, bim::uint64 bytes = 0, bim::uint64 pixels = 0);
+    explicit ScopedTimer(const std::string &name, bim::uint64 bytes = 0, bim::uint64 pixels = 0);
+    ~ScopedTimer() { stop(); }
+
+    void add(bim::uint64 bytes, bim::uint64 pixels = 0) { this->bytes += bytes; this->pixels += pixels; }
+
+    // records the measurement now instead of on destruction
+    void stop();
+
+    // drops the measurement, e.g. if the operation failed
+    void cancel() { this->active = false; }
+
+private:
+    bool active;
+    std::string name;
+    bim::uint64 bytes;
+    bim::uint64 pixels;
+    std::chrono::steady_clock::time_point t0;
+};
+
+} // namespace bim
+
+#endif // XTIMING_H
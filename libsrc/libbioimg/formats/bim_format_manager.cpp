@@ -9,8 +9,13 @@
   History:
     03/23/2004 18:03 - First creation
     08/04/2004 18:22 - custom stream managment compliant
+    10/19/2026 12:00 - wall-clock timing of open, decode, encode and flush
+    10/19/2026 12:00 - channel selective reading
+    10/19/2026 12:00 - tile by tile writing
+    10/19/2026 12:00 - writeImage reports encoder errors
+    10/19/2026 12:00 - formats safe for concurrent sessions
 
-  ver: 2
+  ver: 7
 
 *******************************************************************************/
 
@@ -20,6 +25,7 @@
 
 #include "bim_format_manager.h"
 #include "xstring.h"
+#include "xtiming.h"
 
 
 // Disables Visual Studio 2005 warnings for deprecated code
@@ -642,6 +648,7 @@ int FormatManager::writeImage ( BIM_STREAM_CLASS *stream, ReadProc readProc,
   FormatHeader *selectedFmt;
 
   getNeededFormatByName(formatName, format_index, sub_index);
+  if (format_index < 0) return 1;
   selectedFmt = formatList.at( format_index );
 
   FormatHandle fmtParams = selectedFmt->aquireFormatProc();
@@ -671,13 +678,13 @@ int FormatManager::writeImage ( BIM_STREAM_CLASS *stream, ReadProc readProc,
 
   if ( selectedFmt->openImageProc ( &fmtParams, IO_WRITE ) != 0) return 1;
 
-  selectedFmt->writeImageProc ( &fmtParams );
+  bim::uint res = selectedFmt->writeImageProc ( &fmtParams );
 
   selectedFmt->closeImageProc ( &fmtParams );
 
   // RELEASE FORMAT
   selectedFmt->releaseFormatProc ( &fmtParams );
-  return 0;
+  return res;
 }
 
 int FormatManager::writeImage (const bim::Filename fileName, ImageBitmap *bmp, const char *formatName,
@@ -857,12 +864,20 @@ bool FormatManager::sessionIsWriting(const std::string &fileName) const {
   return false;
 }
 
+// accounts the pixels of a decoded or encoded bitmap to a timer
+inline void timing_add_bitmap(ScopedTimer &t, ImageBitmap *bmp, int r) {
+  if (r != 0) { t.cancel(); return; }
+  if (!bmp || !Timing::enabled()) return;
+  t.add(getImgSizeInBytes(bmp) * bmp->i.samples, bmp->i.width * bmp->i.height);
+}
+
 int FormatManager::sessionStartRead ( BIM_STREAM_CLASS *stream, ReadProc readProc, SeekProc seekProc,
                          SizeProc sizeProc, TellProc tellProc, EofProc eofProc,
                          CloseProc closeProc, const bim::Filename fileName, const char *formatName)
 {
   if (session_active) sessionEnd();
   sessionCurrentPage = 0;
+  ScopedTimer timer("open");
 
   if (formatName == NULL) {
     if ( ( stream != NULL ) && (seekProc != NULL) && (readProc != NULL) ) {
@@ -924,6 +939,7 @@ int FormatManager::sessionStartRead ( BIM_STREAM_CLASS *stream, ReadProc readPro
       session_active = true;
       this->info = selectedFmt->getImageInfoProc ( &sessionHandle, 0 );
   } else {
+      timer.cancel();
 #ifdef DEBUG
       std::cerr << "FormatManager::sessionStartRead(): Failed to open file with openImageProc(). Aborted." << std::endl;
 #endif
@@ -957,6 +973,7 @@ int FormatManager::sessionStartWrite ( BIM_STREAM_CLASS *stream,
   int res;
   if (session_active == true) sessionEnd();
   sessionCurrentPage = 0;
+  ScopedTimer timer("create");
 
   getNeededFormatByName(formatName, sessionFormatIndex, sessionSubIndex);
   if (sessionFormatIndex < 0) {
@@ -991,12 +1008,14 @@ int FormatManager::sessionStartWrite ( BIM_STREAM_CLASS *stream,
 
   res = selectedFmt->openImageProc ( &sessionHandle, IO_WRITE );
 
-  if (res == 0) session_active = true;
+  if (res == 0) session_active = true; else timer.cancel();
   return res;
 }
 
 void FormatManager::sessionEnd() {
   if ( (sessionFormatIndex>=0) && (sessionFormatIndex<(int)formatList.size()) ) {
+    // writers finalize and flush the file on close
+    ScopedTimer timer(session_active && sessionHandle.io_mode == IO_WRITE ? "flush" : "close");
     FormatHeader *selectedFmt = formatList.at( sessionFormatIndex );
     selectedFmt->closeImageProc    ( &sessionHandle );
     selectedFmt->releaseFormatProc ( &sessionHandle );
@@ -1004,12 +1023,24 @@ void FormatManager::sessionEnd() {
   sessionFormatIndex = -1;
   session_active = false;
   sessionCurrentPage = 0;
+  sessionChannels.clear();
 }
 
 void  FormatManager::sessionSetQuality  (int quality) {
   sessionHandle.quality = (unsigned char) quality;
 }
 
+void FormatManager::sessionSetChannels(const std::vector<int> &channels) {
+  sessionChannels.clear();
+  for (size_t i=0; i<channels.size(); ++i)
+    sessionChannels.push_back( (bim::int32) channels[i] );
+  sessionHandle.channelsRead = 0;
+}
+
+bool FormatManager::sessionChannelsRead() const {
+  return sessionChannels.size() > 0 && sessionHandle.channelsRead != 0;
+}
+
 int FormatManager::sessionGetFormat ()
 {
   if (session_active != true) return -1;
@@ -1072,8 +1103,17 @@ int FormatManager::sessionReadImage ( ImageBitmap *bmp, bim::uint page ) {
   sessionCurrentPage = page;
   sessionHandle.image = bmp;
   sessionHandle.pageNumber = page;
+  sessionHandle.channels = sessionChannels.size() > 0 ? &sessionChannels[0] : NULL;
+  sessionHandle.numChannels = (bim::uint32) sessionChannels.size();
+  sessionHandle.channelsRead = 0;
+  ScopedTimer timer("decode");
   int r = selectedFmt->readImageProc ( &sessionHandle, page );
+  // readers that can not skip samples decode all of them, drop the ones not requested
+  if (r == 0) extractRequestedChannels( &sessionHandle, bmp );
+  timing_add_bitmap(timer, bmp, r);
   sessionHandle.image = NULL;
+  sessionHandle.channels = NULL;
+  sessionHandle.numChannels = 0;
   return r;
 }
 
@@ -1083,7 +1123,43 @@ int FormatManager::sessionWriteImage ( ImageBitmap *bmp, bim::uint page) {
   sessionCurrentPage = page;
   sessionHandle.image = bmp;
   sessionHandle.pageNumber = page;
-  return selectedFmt->writeImageProc ( &sessionHandle );
+  ScopedTimer timer("encode");
+  int r = selectedFmt->writeImageProc ( &sessionHandle );
+  timing_add_bitmap(timer, bmp, r);
+  return r;
+}
+
+bool FormatManager::sessionCanWriteTiles() const {
+    if (session_active != true || sessionHandle.io_mode != IO_WRITE) return false;
+    return formatList.at(sessionFormatIndex)->writeImageTileProc != NULL;
+}
+
+bool FormatManager::isConcurrentFormat( const std::string &formatName ) {
+    const char *formats[] = { "tiff", "ome-tiff", "jpeg", "png", "webp", "jp2", 0 };
+    xstring f = xstring(formatName).toLowerCase();
+    for (int i=0; formats[i]; ++i)
+        if (f == formats[i]) return true;
+    return false;
+}
+
+bool FormatManager::sessionIsConcurrent() {
+    if (session_active != true) return false;
+    return isConcurrentFormat( sessionGetFormatName() );
+}
+
+int FormatManager::sessionWriteTile(ImageBitmap *bmp, bim::uint page, bim::uint64 xid, bim::uint64 yid, bim::uint level) {
+    if (session_active != true) return 1;
+    FormatHeader *selectedFmt = formatList.at(sessionFormatIndex);
+    if (!selectedFmt->writeImageTileProc) return 1;
+    sessionCurrentPage = page;
+    sessionHandle.image = bmp;
+    sessionHandle.pageNumber = page;
+    ScopedTimer timer("encode/tile");
+    int r = selectedFmt->writeImageTileProc(&sessionHandle, page, xid, yid, level);
+    if (r == 0) timer.add(bmp->i.tileWidth * bmp->i.tileHeight * bmp->i.samples * (bmp->i.depth / 8), bmp->i.tileWidth * bmp->i.tileHeight);
+    else timer.cancel();
+    sessionHandle.image = NULL;
+    return r;
 }
 
 
@@ -1093,7 +1169,10 @@ int FormatManager::sessionReadLevel(ImageBitmap *bmp, bim::uint page, uint level
     FormatHeader *selectedFmt = formatList.at(sessionFormatIndex);
     if (!selectedFmt->readImageLevelProc) return 1;
     sessionHandle.image = bmp;
+    sessionHandle.channelsRead = 0; // channel subsets only apply to sessionReadImage
+    ScopedTimer timer("decode/level");
     int r = selectedFmt->readImageLevelProc(&sessionHandle, page, level);
+    timing_add_bitmap(timer, bmp, r);
     sessionHandle.image = NULL;
     return r;
 }
@@ -1103,7 +1182,28 @@ int FormatManager::sessionReadTile(ImageBitmap *bmp, bim::uint page, bim::uint64
     FormatHeader *selectedFmt = formatList.at(sessionFormatIndex);
     if (!selectedFmt->readImageTileProc) return 1;
     sessionHandle.image = bmp;
+    sessionHandle.channelsRead = 0; // channel subsets only apply to sessionReadImage
+    ScopedTimer timer("decode/tile");
     int r = selectedFmt->readImageTileProc(&sessionHandle, page, xid, yid, level);
+    timing_add_bitmap(timer, bmp, r);
+    sessionHandle.image = NULL;
+    return r;
+}
+
+bool FormatManager::sessionCanReadRegion() const {
+    if (session_active != true) return false;
+    return formatList.at(sessionFormatIndex)->readImageRegionProc != NULL;
+}
+
+int FormatManager::sessionReadRegion(ImageBitmap *bmp, bim::uint page, bim::uint64 x1, bim::uint64 y1, bim::uint64 x2, bim::uint64 y2, bim::uint level) {
+    if (session_active != true) return 1;
+    FormatHeader *selectedFmt = formatList.at(sessionFormatIndex);
+    if (!selectedFmt->readImageRegionProc) return 1;
+    sessionHandle.image = bmp;
+    sessionHandle.channelsRead = 0; // channel subsets only apply to sessionReadImage
+    ScopedTimer timer("decode/region");
+    int r = selectedFmt->readImageRegionProc(&sessionHandle, page, x1, y1, x2, y2, level);
+    timing_add_bitmap(timer, bmp, r);
     sessionHandle.image = NULL;
     return r;
 }
@@ -1154,31 +1254,24 @@ void  FormatManager::sessionReadImagePreview ( ImageBitmap *bmp,
 */
 }
 
-void  FormatManager::sessionReadImageThumb   ( ImageBitmap *bmp, bim::uint w, bim::uint h) {
-/*
-  if (session_active != true) return;
-  FormatHeader *selectedFmt = formatList.at( sessionFormatIndex );
-  sessionCurrentPage = 0;
-  sessionHandle.image = bmp;
-  sessionHandle.pageNumber = 0;
-
-  //----------------------------------------------------
-  // now if function is not implemented, run standard
-  // implementation
-  //----------------------------------------------------
-  if ( selectedFmt->readImagePreviewProc != NULL )
-    selectedFmt->readImagePreviewProc ( &sessionHandle, w, h );
-  else
-  {
-    // read whole image and resize if needed
-    selectedFmt->readImageProc ( &sessionHandle, 0 );
-
-    // now resize to desired size
-    if ( (w>0) && (h>0) )
-      resizeImgNearNeighbor( bmp, w, h);
-
-  }
-*/
+int FormatManager::sessionReadImageThumb(ImageBitmap *bmp, bim::uint w, bim::uint h) {
+    if (session_active != true) return 1;
+    FormatHeader *selectedFmt = formatList.at(sessionFormatIndex);
+    sessionCurrentPage = 0;
+    sessionHandle.image = bmp;
+    sessionHandle.pageNumber = 0;
+
+    // formats decoding reduced resolutions return the smallest one covering w x h,
+    // others return the full first page, callers finish the resize in both cases
+    ScopedTimer timer("decode/thumbnail");
+    int r = 1;
+    if (selectedFmt->readImageThumbProc)
+        r = selectedFmt->readImageThumbProc(&sessionHandle, w, h);
+    if (r != 0)
+        r = selectedFmt->readImageProc(&sessionHandle, 0);
+    timing_add_bitmap(timer, bmp, r);
+    sessionHandle.image = NULL;
+    return r;
 }
 
 //--------------------------------------------------------------------------------------
@@ -19,8 +19,11 @@
   History:
     03/23/2004 18:03 - First creation
     08/04/2004 18:22 - custom stream managment compliant
+    10/19/2026 12:00 - channel selective reading
+    10/19/2026 12:00 - tile by tile writing
+    10/19/2026 12:00 - formats safe for concurrent sessions
 
-  ver: 2
+  ver: 5
 
 *******************************************************************************/
 
@@ -158,7 +161,7 @@ public:
   void  sessionReadImagePreview ( ImageBitmap *bmp,
                                   bim::uint roiX, bim::uint roiY, bim::uint roiW, bim::uint roiH,
                                   bim::uint w, bim::uint h);
-  void  sessionReadImageThumb   ( ImageBitmap *bmp, bim::uint w, bim::uint h);
+  int   sessionReadImageThumb   ( ImageBitmap *bmp, bim::uint w, bim::uint h);
 
 
   int   sessionReadLevel(ImageBitmap *bmp, bim::uint page, uint level);
@@ -167,12 +170,34 @@ public:
   int   sessionReadTile(ImageBitmap *bmp, bim::uint page, uint64 xid, uint64 yid, uint level);
   int   sessionReadTile(Image &img, bim::uint page, uint64 xid, uint64 yid, uint level) { return sessionReadTile(img.imageBitmap(), page, xid, yid, level); }
 
+  bool  sessionCanReadRegion() const;
+  int   sessionReadRegion(ImageBitmap *bmp, bim::uint page, uint64 x1, uint64 y1, uint64 x2, uint64 y2, uint level);
+  int   sessionReadRegion(Image &img, bim::uint page, uint64 x1, uint64 y1, uint64 x2, uint64 y2, uint level) { return sessionReadRegion(img.imageBitmap(), page, x1, y1, x2, y2, level); }
+
+
+  // subset of samples returned by sessionReadImage, channels[i] is the file sample
+  // of output sample i, empty reads all; kept until sessionEnd
+  void  sessionSetChannels ( const std::vector<int> &channels );
+  std::vector<int> sessionGetChannels () const { return std::vector<int>(sessionChannels.begin(), sessionChannels.end()); }
+  // true if the last sessionReadImage returned only the requested samples
+  bool  sessionChannelsRead () const;
 
   void  sessionSetQuality ( int quality );
   int   sessionWriteImage ( ImageBitmap *bmp, bim::uint page );
   int   sessionWriteImage ( Image &img, bim::uint page )
   { return sessionWriteImage(img.imageBitmap(), page); }
 
+  // writes tile xid,yid of an image larger than memory, bmp->i describes the whole
+  // image including tileWidth and tileHeight while bmp->bits hold only that tile,
+  // padded to the full tile size; the image is finalized by sessionEnd
+  bool  sessionCanWriteTiles() const;
+
+  // formats whose codecs keep all of their state in the format handle, only sessions of
+  // these may read or write images at the same time as other sessions of the same format
+  static bool isConcurrentFormat( const std::string &formatName );
+  bool  sessionIsConcurrent();
+  int   sessionWriteTile(ImageBitmap *bmp, bim::uint page, uint64 xid, uint64 yid, uint level);
+
   void  sessionEnd();
   //--------------------------------------------------------------------------------------
   // end: session-wide operations
@@ -190,6 +215,7 @@ protected:
   int sessionFormatIndex, sessionSubIndex;
   int sessionCurrentPage;
   std::string sessionFileName;
+  std::vector<bim::int32> sessionChannels;
 
   std::vector<FormatHeader *> formatList;
 
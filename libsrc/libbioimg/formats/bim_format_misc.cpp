@@ -0,0 +1,423 @@
+/*****************************************************************************
+Planar <-> interleaved conversion kernels
+
+Every output vector of a deinterleaved channel is assembled from the N
+input vectors that hold its values with one byte shuffle each, the same
+table driven shuffles (with source and destination roles exchanged)
+produce interleaved vectors from channel vectors. Shuffle masks are built
+once for every sample count (2..4), sample size (1..8 bytes) and byte
+order, so a single kernel per instruction set covers all combinations.
+The AVX2 kernels run two independent 128 bit groups in the two lanes
+since byte shuffles can not cross lanes.
+
+History:
+2026-10-19 12:00:00 - First creation
+
+ver : 1
+*****************************************************************************/
+
+#include <cstring>
+#include <vector>
+
+#include <xtypes.h>
+#include "bim_format_misc.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define BIM_INTERLEAVE_X86
+#define BIM_TARGET_SSSE3
+#define BIM_TARGET_AVX2
+#include <intrin.h>
+#include <immintrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BIM_INTERLEAVE_X86
+#define BIM_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define BIM_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+namespace {
+
+//------------------------------------------------------------------------------
+// instruction set detection
+//------------------------------------------------------------------------------
+
+int detect_simd_level() {
+#if defined(BIM_INTERLEAVE_X86) && defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 0);
+    int max_leaf = r[0];
+    __cpuid(r, 1);
+    bool ssse3 = (r[2] & (1 << 9)) != 0;
+    bool osxsave = (r[2] & (1 << 27)) != 0;
+    bool avx = (r[2] & (1 << 28)) != 0;
+    bool avx2 = false;
+    if (max_leaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(r, 7, 0);
+        avx2 = (r[1] & (1 << 5)) != 0;
+    }
+    return avx2 ? 2 : ssse3 ? 1 : 0;
+#elif defined(BIM_INTERLEAVE_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return 2;
+    if (__builtin_cpu_supports("ssse3")) return 1;
+    return 0;
+#else
+    return 0;
+#endif
+}
+
+const int simd_supported = detect_simd_level();
+int simd_level = simd_supported;
+
+//------------------------------------------------------------------------------
+// shuffle masks
+//------------------------------------------------------------------------------
+
+const unsigned char mask_zero = 0x80; // pshufb writes 0 for bytes with the high bit set
+
+inline int size_index(int bytes) {
+    return bytes == 1 ? 0 : bytes == 2 ? 1 : bytes == 4 ? 2 : 3;
+}
+
+class ShuffleMasks {
+public:
+    // deinterleave: [swap][size][samples-2][channel][input vector]
+    // interleave:   [swap][size][samples-2][output vector][channel]
+    unsigned char de[2][4][3][4][4][16];
+    unsigned char in[2][4][3][4][4][16];
+
+    ShuffleMasks() {
+        const int sizes[4] = { 1, 2, 4, 8 };
+        for (int sw = 0; sw < 2; ++sw)
+        for (int si = 0; si < 4; ++si)
+        for (int n = 2; n <= 4; ++n) {
+            int E = sizes[si];
+            for (int a = 0; a < 4; ++a)
+            for (int b = 0; b < 4; ++b)
+            for (int j = 0; j < 16; ++j) {
+                int e = j / E;
+                int sb = sw ? E - 1 - j % E : j % E;
+
+                // de: channel a, input vector b
+                int src = (n*e + a)*E + sb;
+                this->de[sw][si][n - 2][a][b][j] = (a < n && src / 16 == b) ? (unsigned char)(src % 16) : mask_zero;
+
+                // in: output vector a, channel b
+                int g = (16 * a + j) / E;
+                int ob = sw ? E - 1 - (16 * a + j) % E : (16 * a + j) % E;
+                this->in[sw][si][n - 2][a][b][j] = (a < n && g % n == b) ? (unsigned char)((g / n)*E + ob) : mask_zero;
+            }
+        }
+    }
+};
+
+const ShuffleMasks masks;
+
+//------------------------------------------------------------------------------
+// SIMD kernels, return the number of pixels converted
+//------------------------------------------------------------------------------
+
+#ifdef BIM_INTERLEAVE_X86
+
+template <int N>
+BIM_TARGET_SSSE3
+bim::uint64 deinterleave_ssse3(unsigned char * const *dst, const unsigned char *src, bim::uint64 x,
+                               bim::uint64 width, int E, const unsigned char (*m)[4][16]) {
+    const bim::uint64 px = 16 / E;
+    __m128i mask[N][N];
+    for (int k = 0; k < N; ++k)
+    for (int v = 0; v < N; ++v)
+        mask[k][v] = _mm_loadu_si128((const __m128i *) m[k][v]);
+
+    for (; x + px <= width; x += px) {
+        const unsigned char *p = src + x*N*E;
+        __m128i s[N];
+        for (int v = 0; v < N; ++v)
+            s[v] = _mm_loadu_si128((const __m128i *) (p + 16 * v));
+        for (int k = 0; k < N; ++k) {
+            if (!dst[k]) continue;
+            __m128i o = _mm_shuffle_epi8(s[0], mask[k][0]);
+            for (int v = 1; v < N; ++v)
+                o = _mm_or_si128(o, _mm_shuffle_epi8(s[v], mask[k][v]));
+            _mm_storeu_si128((__m128i *) (dst[k] + x*E), o);
+        }
+    }
+    return x;
+}
+
+template <int N>
+BIM_TARGET_AVX2
+bim::uint64 deinterleave_avx2(unsigned char * const *dst, const unsigned char *src, bim::uint64 x,
+                              bim::uint64 width, int E, const unsigned char (*m)[4][16]) {
+    const bim::uint64 px = 32 / E;
+    __m256i mask[N][N];
+    for (int k = 0; k < N; ++k)
+    for (int v = 0; v < N; ++v)
+        mask[k][v] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) m[k][v]));
+
+    for (; x + px <= width; x += px) {
+        const unsigned char *p = src + x*N*E;
+        __m256i s[N];
+        for (int v = 0; v < N; ++v)
+            s[v] = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) (p + 16 * v))),
+                                           _mm_loadu_si128((const __m128i *) (p + 16 * (N + v))), 1);
+        for (int k = 0; k < N; ++k) {
+            if (!dst[k]) continue;
+            __m256i o = _mm256_shuffle_epi8(s[0], mask[k][0]);
+            for (int v = 1; v < N; ++v)
+                o = _mm256_or_si256(o, _mm256_shuffle_epi8(s[v], mask[k][v]));
+            _mm256_storeu_si256((__m256i *) (dst[k] + x*E), o);
+        }
+    }
+    return x;
+}
+
+template <int N>
+BIM_TARGET_SSSE3
+bim::uint64 interleave_ssse3(unsigned char *dst, const unsigned char * const *src, bim::uint64 x,
+                             bim::uint64 width, int E, const unsigned char (*m)[4][16]) {
+    const bim::uint64 px = 16 / E;
+    __m128i mask[N][N];
+    for (int v = 0; v < N; ++v)
+    for (int k = 0; k < N; ++k)
+        mask[v][k] = _mm_loadu_si128((const __m128i *) m[v][k]);
+
+    for (; x + px <= width; x += px) {
+        __m128i s[N];
+        for (int k = 0; k < N; ++k)
+            s[k] = src[k] ? _mm_loadu_si128((const __m128i *) (src[k] + x*E)) : _mm_setzero_si128();
+        unsigned char *p = dst + x*N*E;
+        for (int v = 0; v < N; ++v) {
+            __m128i o = _mm_shuffle_epi8(s[0], mask[v][0]);
+            for (int k = 1; k < N; ++k)
+                o = _mm_or_si128(o, _mm_shuffle_epi8(s[k], mask[v][k]));
+            _mm_storeu_si128((__m128i *) (p + 16 * v), o);
+        }
+    }
+    return x;
+}
+
+template <int N>
+BIM_TARGET_AVX2
+bim::uint64 interleave_avx2(unsigned char *dst, const unsigned char * const *src, bim::uint64 x,
+                            bim::uint64 width, int E, const unsigned char (*m)[4][16]) {
+    const bim::uint64 px = 32 / E;
+    __m256i mask[N][N];
+    for (int v = 0; v < N; ++v)
+    for (int k = 0; k < N; ++k)
+        mask[v][k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) m[v][k]));
+
+    for (; x + px <= width; x += px) {
+        __m256i s[N];
+        for (int k = 0; k < N; ++k)
+            s[k] = src[k] ? _mm256_loadu_si256((const __m256i *) (src[k] + x*E)) : _mm256_setzero_si256();
+        unsigned char *p = dst + x*N*E;
+        for (int v = 0; v < N; ++v) {
+            __m256i o = _mm256_shuffle_epi8(s[0], mask[v][0]);
+            for (int k = 1; k < N; ++k)
+                o = _mm256_or_si256(o, _mm256_shuffle_epi8(s[k], mask[v][k]));
+            _mm_storeu_si128((__m128i *) (p + 16 * v), _mm256_castsi256_si128(o));
+            _mm_storeu_si128((__m128i *) (p + 16 * (N + v)), _mm256_extracti128_si256(o, 1));
+        }
+    }
+    return x;
+}
+
+template <int N>
+bim::uint64 deinterleave_simd(unsigned char * const *dst, const unsigned char *src, bim::uint64 width, int E, bool swap) {
+    const unsigned char (*m)[4][16] = masks.de[swap ? 1 : 0][size_index(E)][N - 2];
+    bim::uint64 x = 0;
+    if (simd_level >= 2) x = deinterleave_avx2<N>(dst, src, x, width, E, m);
+    if (simd_level >= 1) x = deinterleave_ssse3<N>(dst, src, x, width, E, m);
+    return x;
+}
+
+template <int N>
+bim::uint64 interleave_simd(unsigned char *dst, const unsigned char * const *src, bim::uint64 width, int E, bool swap) {
+    const unsigned char (*m)[4][16] = masks.in[swap ? 1 : 0][size_index(E)][N - 2];
+    bim::uint64 x = 0;
+    if (simd_level >= 2) x = interleave_avx2<N>(dst, src, x, width, E, m);
+    if (simd_level >= 1) x = interleave_ssse3<N>(dst, src, x, width, E, m);
+    return x;
+}
+
+#endif // BIM_INTERLEAVE_X86
+
+//------------------------------------------------------------------------------
+// plain kernels, also used for the remainders of SIMD rows
+//------------------------------------------------------------------------------
+
+inline bim::uint8  swap_sample(bim::uint8 v) { return v; }
+inline bim::uint16 swap_sample(bim::uint16 v) { return (bim::uint16)((v >> 8) | (v << 8)); }
+inline bim::uint32 swap_sample(bim::uint32 v) {
+    return (v >> 24) | ((v >> 8) & 0x0000FF00u) | ((v << 8) & 0x00FF0000u) | (v << 24);
+}
+inline bim::uint64 swap_sample(bim::uint64 v) {
+    return ((bim::uint64) swap_sample((bim::uint32) v) << 32) | swap_sample((bim::uint32) (v >> 32));
+}
+
+template <typename T>
+void deinterleave_plain(unsigned char * const *dst, const unsigned char *src, bim::uint64 x, bim::uint64 width,
+                        int samples, bool swap) {
+    const T *in = (const T *) src;
+    for (int s = 0; s < samples; ++s) {
+        if (!dst[s]) continue;
+        T *out = (T *) dst[s];
+        if (swap)
+            for (bim::uint64 i = x; i < width; ++i) out[i] = swap_sample(in[i*samples + s]);
+        else
+            for (bim::uint64 i = x; i < width; ++i) out[i] = in[i*samples + s];
+    }
+}
+
+template <typename T>
+void interleave_plain(unsigned char *dst, const unsigned char * const *src, bim::uint64 x, bim::uint64 width,
+                      int samples, bool swap) {
+    T *out = (T *) dst;
+    for (int s = 0; s < samples; ++s) {
+        const T *in = (const T *) src[s];
+        if (!in)
+            for (bim::uint64 i = x; i < width; ++i) out[i*samples + s] = 0;
+        else if (swap)
+            for (bim::uint64 i = x; i < width; ++i) out[i*samples + s] = swap_sample(in[i]);
+        else
+            for (bim::uint64 i = x; i < width; ++i) out[i*samples + s] = in[i];
+    }
+}
+
+// planes are mapped onto interleaved sample positions, small layouts avoid allocations
+const int max_fixed_samples = 16;
+
+inline void slot_planes(const void **slots, int samples, const void * const *planes, int channels, const int *order) {
+    for (int s = 0; s < samples; ++s) slots[s] = 0;
+    for (int c = 0; c < channels; ++c) {
+        int s = order ? order[c] : c;
+        if (s >= 0 && s < samples) slots[s] = planes[c];
+    }
+}
+
+void deinterleave_slots(unsigned char * const *dst, const unsigned char *src, int samples, bim::uint64 width, int E, bool swap) {
+    bim::uint64 x = 0;
+#ifdef BIM_INTERLEAVE_X86
+    if (samples == 2)
+        x = deinterleave_simd<2>(dst, src, width, E, swap);
+    else if (samples == 3)
+        x = deinterleave_simd<3>(dst, src, width, E, swap);
+    else if (samples == 4)
+        x = deinterleave_simd<4>(dst, src, width, E, swap);
+#endif
+    if (x >= width) return;
+    if (E == 1)
+        deinterleave_plain<bim::uint8>(dst, src, x, width, samples, swap);
+    else if (E == 2)
+        deinterleave_plain<bim::uint16>(dst, src, x, width, samples, swap);
+    else if (E == 4)
+        deinterleave_plain<bim::uint32>(dst, src, x, width, samples, swap);
+    else if (E == 8)
+        deinterleave_plain<bim::uint64>(dst, src, x, width, samples, swap);
+}
+
+void interleave_slots(unsigned char *dst, const unsigned char * const *src, int samples, bim::uint64 width, int E, bool swap) {
+    bim::uint64 x = 0;
+#ifdef BIM_INTERLEAVE_X86
+    if (samples == 2)
+        x = interleave_simd<2>(dst, src, width, E, swap);
+    else if (samples == 3)
+        x = interleave_simd<3>(dst, src, width, E, swap);
+    else if (samples == 4)
+        x = interleave_simd<4>(dst, src, width, E, swap);
+#endif
+    if (x >= width) return;
+    if (E == 1)
+        interleave_plain<bim::uint8>(dst, src, x, width, samples, swap);
+    else if (E == 2)
+        interleave_plain<bim::uint16>(dst, src, x, width, samples, swap);
+    else if (E == 4)
+        interleave_plain<bim::uint32>(dst, src, x, width, samples, swap);
+    else if (E == 8)
+        interleave_plain<bim::uint64>(dst, src, x, width, samples, swap);
+}
+
+inline bool valid_sample_size(int depth) {
+    return depth == 8 || depth == 16 || depth == 32 || depth == 64;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// public API
+//------------------------------------------------------------------------------
+
+int bim::interleave_simd_level() {
+    return simd_level;
+}
+
+void bim::set_interleave_simd_level(int level) {
+    simd_level = bim::trim<int>(level, 0, simd_supported);
+}
+
+void bim::deinterleave_row(void * const *planes, int channels, const void *in, int samples,
+                           bim::uint64 width, int depth, const int *order, bool swap) {
+    if (!planes || !in || samples < 1 || !valid_sample_size(depth)) return;
+    const void *fixed[max_fixed_samples];
+    std::vector<const void *> dynamic;
+    const void **slots = fixed;
+    if (samples > max_fixed_samples) {
+        dynamic.resize(samples);
+        slots = &dynamic[0];
+    }
+    slot_planes(slots, samples, (const void * const *) planes, channels, order);
+    deinterleave_slots((unsigned char * const *) slots, (const unsigned char *) in, samples, width, depth / 8, swap);
+}
+
+void bim::interleave_row(void *out, int samples, const void * const *planes, int channels,
+                         bim::uint64 width, int depth, const int *order, bool swap) {
+    if (!planes || !out || samples < 1 || !valid_sample_size(depth)) return;
+    const void *fixed[max_fixed_samples];
+    std::vector<const void *> dynamic;
+    const void **slots = fixed;
+    if (samples > max_fixed_samples) {
+        dynamic.resize(samples);
+        slots = &dynamic[0];
+    }
+    slot_planes(slots, samples, planes, channels, order);
+    interleave_slots((unsigned char *) out, (const unsigned char * const *) slots, samples, width, depth / 8, swap);
+}
+
+void bim::deinterleave(void * const *planes, int channels, const void *in, int samples,
+                       bim::uint64 width, bim::uint64 height, int depth, bim::uint64 in_stride,
+                       const int *order, bool swap) {
+    if (!planes || !in || channels < 1 || samples < 1 || !valid_sample_size(depth)) return;
+    const bim::uint64 E = depth / 8;
+    if (in_stride == 0) in_stride = width*samples*E;
+
+    #pragma omp parallel default(shared) if (height>BIM_OMP_FOR2)
+    {
+        std::vector<void *> rows(channels);
+        #pragma omp for BIM_OMP_SCHEDULE
+        for (bim::int64 y = 0; y < (bim::int64) height; ++y) {
+            for (int c = 0; c < channels; ++c)
+                rows[c] = planes[c] ? (unsigned char *) planes[c] + y*width*E : 0;
+            bim::deinterleave_row(&rows[0], channels, (const unsigned char *) in + y*in_stride, samples, width, depth, order, swap);
+        }
+    }
+}
+
+void bim::interleave(void *out, int samples, const void * const *planes, int channels,
+                     bim::uint64 width, bim::uint64 height, int depth, bim::uint64 out_stride,
+                     const int *order, bool swap) {
+    if (!planes || !out || channels < 1 || samples < 1 || !valid_sample_size(depth)) return;
+    const bim::uint64 E = depth / 8;
+    if (out_stride == 0) out_stride = width*samples*E;
+
+    #pragma omp parallel default(shared) if (height>BIM_OMP_FOR2)
+    {
+        std::vector<const void *> rows(channels);
+        #pragma omp for BIM_OMP_SCHEDULE
+        for (bim::int64 y = 0; y < (bim::int64) height; ++y) {
+            for (int c = 0; c < channels; ++c)
+                rows[c] = planes[c] ? (const unsigned char *) planes[c] + y*width*E : 0;
+            bim::interleave_row((unsigned char *) out + y*out_stride, samples, &rows[0], channels, width, depth, order, swap);
+        }
+    }
+}
@@ -7,13 +7,16 @@ Author: Dmitry Fedorov <mailto:dima@dimin.net> <http://www.dimin.net/>
 
 History:
 2013-01-12 14:13:40 - First creation
+2026-10-19 12:00:00 - Vectorized planar/interleaved conversion kernels
 
-ver : 1
+ver : 2
 *****************************************************************************/
 
 #ifndef BIM_FORMATS_MISC_H
 #define BIM_FORMATS_MISC_H
 
+#include <xtypes.h>
+
 template <typename T>
 void copy_sample_interleaved_to_planar(bim::uint64 W, bim::uint64 H, int samples, int sample, const void *in, void *out, int stride = 0) {
     T *raw = (T *)in + sample;
@@ -55,4 +58,50 @@ void copy_sample_planar_to_interleaved(bim::uint64 W, bim::uint64 H, int samples
 }
 
 
+//------------------------------------------------------------------------------
+// Planar <-> interleaved conversion kernels
+//
+// bim::Image keeps every channel in its own plane while most codecs want
+// interleaved pixels, these are the shared conversion routines for them.
+// 2, 3 and 4 sample layouts are converted with SSSE3 or AVX2 shuffles when
+// the CPU supports them (detected at run time), everything else falls back
+// to plain loops. depth is the number of bits per sample: 8, 16, 32 or 64.
+//
+// order - optional, plane c corresponds to interleaved sample order[c],
+//         by default plane c is sample c (ex: {2,1,0} converts BGR)
+// swap  - reverse the byte order of every sample while converting
+//------------------------------------------------------------------------------
+
+namespace bim {
+
+// splits one row of "width" interleaved pixels with "samples" values each into
+// "channels" planes, planes may be NULL to skip a channel
+void deinterleave_row(void * const *planes, int channels, const void *in, int samples,
+                      bim::uint64 width, int depth, const int *order = 0, bool swap = false);
+
+// packs "channels" planes into one row of "width" interleaved pixels with "samples"
+// values each, samples not provided by any plane (or NULL planes) are set to 0
+void interleave_row(void *out, int samples, const void * const *planes, int channels,
+                    bim::uint64 width, int depth, const int *order = 0, bool swap = false);
+
+// whole image versions, planes are packed width x height, rows are processed
+// in parallel; stride is the size of an interleaved row in bytes, 0 if packed
+void deinterleave(void * const *planes, int channels, const void *in, int samples,
+                  bim::uint64 width, bim::uint64 height, int depth, bim::uint64 in_stride = 0,
+                  const int *order = 0, bool swap = false);
+
+void interleave(void *out, int samples, const void * const *planes, int channels,
+                bim::uint64 width, bim::uint64 height, int depth, bim::uint64 out_stride = 0,
+                const int *order = 0, bool swap = false);
+
+// instruction set used by the kernels: 0 - plain C++, 1 - SSSE3, 2 - AVX2
+int interleave_simd_level();
+
+// limits the instruction set used by the kernels, mostly for benchmarking,
+// levels above what the CPU supports are ignored
+void set_interleave_simd_level(int level);
+
+} // namespace bim
+
+
 #endif // BIM_FORMATS_MISC_H
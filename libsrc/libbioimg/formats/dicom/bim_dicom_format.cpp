@@ -7,8 +7,9 @@
 
   History:
     2013-01-12 14:13:40 - First creation
+    2026-10-19 12:00:00 - VL Whole Slide Microscopy tiled pyramids with tile and level reads
         
-  ver : 1
+  ver : 2
 *****************************************************************************/
 
 #include <cstdio>
@@ -16,6 +17,8 @@
 #include <cstring>
 #include <cmath>
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
@@ -31,13 +34,15 @@
 #include <gdcmImageRegionReader.h>
 #include <gdcmImageHelper.h>
 #include <gdcmBoxRegion.h>
+#include <gdcmDirectory.h>
+#include <gdcmScanner.h>
+#include <gdcmStringFilter.h>
 
 #include <gdcmGlobal.h>
 #include <gdcmDicts.h>
 #include <gdcmDict.h>
 #include <gdcmValue.h>
 //#include <gdcmAttribute.h>
-//#include <gdcmStringFilter.h>
 
 
 using namespace bim;
@@ -52,9 +57,14 @@ bim::DICOMParams::DICOMParams() {
     file = NULL;
     //reader = new gdcm::ImageReader();
     reader = new gdcm::ImageRegionReader();
+    wsi = false;
 }
 
 bim::DICOMParams::~DICOMParams() {
+    for (size_t l = 1; l < levels.size(); ++l) {
+        if (levels[l].reader) delete levels[l].reader;
+        if (levels[l].file) delete levels[l].file;
+    }
     if (reader) delete reader;
     if (file) delete file;
 }
@@ -126,6 +136,141 @@ inline void set_lut(ImageInfo *info, gdcm::SmartPointer<gdcm::LookupTable> lut,
     }
 }
 
+//----------------------------------------------------------------------------
+// VL Whole Slide Microscopy
+//----------------------------------------------------------------------------
+
+static const gdcm::Tag tag_image_type(0x0008, 0x0008);
+static const gdcm::Tag tag_series_uid(0x0020, 0x000E);
+static const gdcm::Tag tag_dimension_organization(0x0020, 0x9311);
+static const gdcm::Tag tag_number_frames(0x0028, 0x0008);
+static const gdcm::Tag tag_rows(0x0028, 0x0010);
+static const gdcm::Tag tag_columns(0x0028, 0x0011);
+static const gdcm::Tag tag_matrix_columns(0x0048, 0x0006);
+static const gdcm::Tag tag_matrix_rows(0x0048, 0x0007);
+static const gdcm::Tag tag_optical_paths(0x0048, 0x0302);
+static const gdcm::Tag tag_focal_planes(0x0048, 0x0303);
+
+// values may be padded with spaces or zeros
+inline xstring wsi_value(const std::string &v) {
+    size_t b = v.find_first_not_of(" \0", 0, 2);
+    size_t e = v.find_last_not_of(" \0", std::string::npos, 2);
+    if (b == std::string::npos) return "";
+    return v.substr(b, e - b + 1);
+}
+
+inline xstring wsi_tag(const gdcm::File &f, const gdcm::Tag &tag) {
+    if (!f.GetDataSet().FindDataElement(tag)) return "";
+    gdcm::StringFilter sf;
+    sf.SetFile(f);
+    return wsi_value(sf.ToString(tag));
+}
+
+inline xstring wsi_tag(const gdcm::Scanner &scanner, const std::string &filename, const gdcm::Tag &tag) {
+    const char *v = scanner.GetValue(filename.c_str(), tag);
+    return v ? wsi_value(v) : "";
+}
+
+// frames of TILED_FULL instances are tiles of the total pixel matrix in row-major order,
+// repeated for every focal plane and then for every optical path
+inline bool wsi_tiled_full(const xstring &organization, bim::uint64 w, bim::uint64 h, bim::uint64 tw, bim::uint64 th, bim::uint64 frames, bim::uint64 planes) {
+    if (w == 0 || h == 0 || tw == 0 || th == 0) return false;
+    if (organization.size() > 0) return organization == "TILED_FULL";
+    // organization type is optional, accept frame counts matching a full tiling
+    return frames == ((w + tw - 1) / tw) * ((h + th - 1) / th) * planes;
+}
+
+inline bool wsi_level_larger(const bim::DICOMLevel &a, const bim::DICOMLevel &b) {
+    return a.width > b.width;
+}
+
+// each resolution level is stored as a separate instance of the same series,
+// levels smaller than the opened one are found among its sibling files
+void dicomGetWholeSlideInfo(FormatHandle *fmtHndl) {
+    bim::DICOMParams *par = (bim::DICOMParams *) fmtHndl->internalParams;
+    ImageInfo *info = &par->i;
+    gdcm::File & f = par->reader->GetFile();
+
+    bim::uint64 w = wsi_tag(f, tag_matrix_columns).toInt(0);
+    bim::uint64 h = wsi_tag(f, tag_matrix_rows).toInt(0);
+    bim::uint64 tw = info->width;
+    bim::uint64 th = info->height;
+    bim::uint64 frames = wsi_tag(f, tag_number_frames).toInt(1);
+    bim::uint64 planes = bim::max<int>(wsi_tag(f, tag_focal_planes).toInt(1), 1) * bim::max<int>(wsi_tag(f, tag_optical_paths).toInt(1), 1);
+    if (!wsi_tiled_full(wsi_tag(f, tag_dimension_organization), w, h, tw, th, frames, planes)) return;
+
+    par->wsi = true;
+    par->levels.resize(1);
+    par->levels[0].filename = fmtHndl->fileName;
+    par->levels[0].width = w;
+    par->levels[0].height = h;
+    par->levels[0].reader = par->reader;
+    par->levels[0].file = par->file;
+
+    xstring series = wsi_tag(f, tag_series_uid);
+    std::string path = fmtHndl->fileName;
+    size_t p = path.find_last_of("/\\");
+    std::string dir = p == std::string::npos ? std::string(".") : path.substr(0, p);
+    if (series.size() > 0) try {
+        gdcm::Directory directory;
+        directory.Load(dir);
+        gdcm::Scanner scanner;
+        scanner.AddTag(tag_image_type);
+        scanner.AddTag(tag_series_uid);
+        scanner.AddTag(tag_dimension_organization);
+        scanner.AddTag(tag_number_frames);
+        scanner.AddTag(tag_rows);
+        scanner.AddTag(tag_columns);
+        scanner.AddTag(tag_matrix_columns);
+        scanner.AddTag(tag_matrix_rows);
+        scanner.AddTag(tag_optical_paths);
+        scanner.AddTag(tag_focal_planes);
+        scanner.Scan(directory.GetFilenames());
+
+        const gdcm::Directory::FilenamesType &files = directory.GetFilenames();
+        for (size_t i = 0; i < files.size(); ++i) {
+            const std::string &fn = files[i];
+            if (!scanner.IsKey(fn.c_str())) continue;
+            if (wsi_tag(scanner, fn, tag_series_uid) != series) continue;
+            if (!wsi_tag(scanner, fn, tag_image_type).contains("VOLUME")) continue;
+
+            bim::DICOMLevel l;
+            l.filename = fn;
+            l.width = wsi_tag(scanner, fn, tag_matrix_columns).toInt(0);
+            l.height = wsi_tag(scanner, fn, tag_matrix_rows).toInt(0);
+            bim::uint64 l_planes = bim::max<int>(wsi_tag(scanner, fn, tag_focal_planes).toInt(1), 1) * bim::max<int>(wsi_tag(scanner, fn, tag_optical_paths).toInt(1), 1);
+            bim::uint64 l_frames = wsi_tag(scanner, fn, tag_number_frames).toInt(1);
+            // tile size has to remain constant for the hierarchical structure
+            if (wsi_tag(scanner, fn, tag_columns).toInt(0) != tw || wsi_tag(scanner, fn, tag_rows).toInt(0) != th) continue;
+            if (l.width >= w || l_planes != planes) continue;
+            if (!wsi_tiled_full(wsi_tag(scanner, fn, tag_dimension_organization), l.width, l.height, tw, th, l_frames, l_planes)) continue;
+
+            bool duplicate = false;
+            for (size_t j = 1; j < par->levels.size(); ++j)
+                if (par->levels[j].width == l.width) duplicate = true;
+            if (!duplicate) par->levels.push_back(l);
+        }
+        std::sort(par->levels.begin() + 1, par->levels.end(), wsi_level_larger);
+    } catch (...) {
+        par->levels.resize(1);
+    }
+
+    // frames are tiles of a single plane image, pages enumerate focal planes and optical paths
+    info->width = w;
+    info->height = h;
+    info->tileWidth = tw;
+    info->tileHeight = th;
+    info->number_levels = par->levels.size();
+    info->number_z = planes;
+    info->number_t = 1;
+    info->number_pages = planes;
+    info->number_dims = 3;
+    if (planes > 1) {
+        info->number_dims = 4;
+        info->dimensions[3].dim = DIM_Z;
+    }
+}
+
 void dicomGetImageInfo(FormatHandle *fmtHndl) {
     if (fmtHndl == NULL) return;
     if (fmtHndl->internalParams == NULL) return;
@@ -294,6 +439,12 @@ void dicomGetImageInfo(FormatHandle *fmtHndl) {
             }
         }
     } // if paletted
+
+    //---------------------------------------------------------------
+    // whole slide tiled pyramids
+    //---------------------------------------------------------------
+    if (find_tag(ds, 0x0048, 0x0006) && find_tag(ds, 0x0048, 0x0007))
+        dicomGetWholeSlideInfo(fmtHndl);
 }
 
 void dicomCloseImageProc (FormatHandle *fmtHndl) {
@@ -397,12 +548,146 @@ void copy_channel(bim::uint64 W, bim::uint64 H, int samples, int sample, const v
     } // for y
 }
 
+// copies the visible part of a decoded frame into the image at ox,oy
+template <typename T>
+void copy_frame(const void *in, bim::uint64 fw, bim::uint64 fh, int samples, bool planar,
+                ImageBitmap *bmp, bim::uint64 ox, bim::uint64 oy, bim::uint64 w, bim::uint64 h) {
+    size_t step = planar ? 1 : samples;
+    size_t inrowsz = planar ? fw : fw*samples;
+    for (int s = 0; s < samples; ++s) {
+        const T *raw = planar ? (const T *)in + s*fw*fh : (const T *)in + s;
+        T *p = (T *)bmp->bits[s] + oy*bmp->i.width + ox;
+
+        #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (w > BIM_OMP_FOR2 && h > BIM_OMP_FOR2)
+        for (bim::int64 y = 0; y < (bim::int64)h; ++y) {
+            const T *lin = raw + y*inrowsz;
+            T *lou = p + y*bmp->i.width;
+            for (bim::int64 x = 0; x < (bim::int64)w; ++x) {
+                *lou = *lin;
+                lou++;
+                lin += step;
+            } // for x
+        } // for y
+    } // for sample
+}
+
+gdcm::ImageRegionReader *dicom_level_reader(bim::DICOMLevel *l) {
+    if (l->reader) return l->reader;
+    gdcm::ImageRegionReader *reader = new gdcm::ImageRegionReader();
+#ifdef BIM_WIN
+    bim::xstring fn(l->filename);
+    l->file = new std::fstream((const wchar_t *)fn.toUTF16().c_str(), std::fstream::in | std::fstream::binary);
+    reader->SetStream(*l->file);
+#else
+    reader->SetFileName(l->filename.c_str());
+#endif
+    try {
+        if (reader->ReadInformation()) {
+            l->reader = reader;
+            return reader;
+        }
+    } catch (...) {
+    }
+    delete reader;
+    return NULL;
+}
+
+// decodes only frames of tiles tx1..tx2, ty1..ty2 of a whole slide level,
+// the image origin is at the top-left corner of tile tx1,ty1
+int dicom_read_wsi_tiles(bim::DICOMParams *par, bim::uint page, bim::uint level, 
+                         bim::uint64 tx1, bim::uint64 ty1, bim::uint64 tx2, bim::uint64 ty2, ImageBitmap *bmp) {
+    bim::DICOMLevel *l = &par->levels[level];
+    gdcm::ImageRegionReader *reader = dicom_level_reader(l);
+    if (!reader) return 1;
+
+    gdcm::File & f = reader->GetFile();
+    DICOMParams::PlanarConfig planar_config = (DICOMParams::PlanarConfig) gdcm::ImageHelper::GetPlanarConfigurationValue(f);
+    gdcm::PixelFormat pf = gdcm::ImageHelper::GetPixelFormatValue(f);
+    bool planar = planar_config == DICOMParams::RRRGGGBBB;
+    int samples = bmp->i.samples;
+    bim::uint64 tw = par->i.tileWidth;
+    bim::uint64 th = par->i.tileHeight;
+    bim::uint64 tiles_x = (l->width + tw - 1) / tw;
+    bim::uint64 tiles_y = (l->height + th - 1) / th;
+    bim::uint64 frame_sz = tw * th * pf.GetPixelSize();
+    if (pf.GetSamplesPerPixel() != samples) return 1;
+
+    std::vector<char> buffer(frame_sz);
+    char *buf = (char *)&buffer[0];
+    for (bim::uint64 ty = ty1; ty <= ty2; ++ty) {
+        for (bim::uint64 tx = tx1; tx <= tx2; ++tx) {
+            bim::uint64 frame = (page * tiles_y + ty) * tiles_x + tx;
+            gdcm::BoxRegion box;
+            box.SetDomain(0, tw - 1, 0, th - 1, frame, frame);
+            reader->SetRegion(box);
+            if (!reader->ReadIntoBuffer(buf, frame_sz)) return 1;
+
+            bim::uint64 ox = (tx - tx1) * tw;
+            bim::uint64 oy = (ty - ty1) * th;
+            bim::uint64 w = bim::min<bim::uint64>(tw, bmp->i.width - ox);
+            bim::uint64 h = bim::min<bim::uint64>(th, bmp->i.height - oy);
+            if (bmp->i.depth == 8)
+                copy_frame<bim::uint8>(buf, tw, th, samples, planar, bmp, ox, oy, w, h);
+            else if (bmp->i.depth == 16)
+                copy_frame<bim::uint16>(buf, tw, th, samples, planar, bmp, ox, oy, w, h);
+            else if (bmp->i.depth == 32)
+                copy_frame<bim::uint32>(buf, tw, th, samples, planar, bmp, ox, oy, w, h);
+            else if (bmp->i.depth == 64)
+                copy_frame<bim::uint64>(buf, tw, th, samples, planar, bmp, ox, oy, w, h);
+            else
+                return 1;
+        } // for tx
+    } // for ty
+    return 0;
+}
+
+bim::uint dicomReadImageLevelProc(FormatHandle *fmtHndl, bim::uint page, bim::uint level) {
+    if (fmtHndl == NULL) return 1;
+    if (fmtHndl->internalParams == NULL) return 1;
+    bim::DICOMParams *par = (bim::DICOMParams *) fmtHndl->internalParams;
+    if (!par->wsi || level >= par->levels.size() || page >= par->i.number_pages) return 1;
+    fmtHndl->pageNumber = page;
+
+    bim::DICOMLevel *l = &par->levels[level];
+    ImageInfo info = par->i;
+    info.width = l->width;
+    info.height = l->height;
+    ImageBitmap *bmp = fmtHndl->image;
+    if (allocImg(fmtHndl, &info, bmp) != 0) return 1;
+
+    bim::uint64 tiles_x = (l->width + info.tileWidth - 1) / info.tileWidth;
+    bim::uint64 tiles_y = (l->height + info.tileHeight - 1) / info.tileHeight;
+    return dicom_read_wsi_tiles(par, page, level, 0, 0, tiles_x - 1, tiles_y - 1, bmp);
+}
+
+bim::uint dicomReadImageTileProc(FormatHandle *fmtHndl, bim::uint page, bim::uint64 xid, bim::uint64 yid, bim::uint level) {
+    if (fmtHndl == NULL) return 1;
+    if (fmtHndl->internalParams == NULL) return 1;
+    bim::DICOMParams *par = (bim::DICOMParams *) fmtHndl->internalParams;
+    if (!par->wsi || level >= par->levels.size() || page >= par->i.number_pages) return 1;
+    fmtHndl->pageNumber = page;
+
+    // tile sizes may be smaller at the border
+    bim::DICOMLevel *l = &par->levels[level];
+    ImageInfo info = par->i;
+    bim::uint64 x = xid * info.tileWidth;
+    bim::uint64 y = yid * info.tileHeight;
+    if (x >= l->width || y >= l->height) return 1;
+    info.width = bim::min<bim::uint64>(info.tileWidth, l->width - x);
+    info.height = bim::min<bim::uint64>(info.tileHeight, l->height - y);
+    ImageBitmap *bmp = fmtHndl->image;
+    if (allocImg(fmtHndl, &info, bmp) != 0) return 1;
+
+    return dicom_read_wsi_tiles(par, page, level, xid, yid, xid, yid, bmp);
+}
+
 bim::uint dicomReadImageProc  ( FormatHandle *fmtHndl, bim::uint page ) {
     if (fmtHndl == NULL) return 1;
     fmtHndl->pageNumber = page;
 
     bim::DICOMParams *par = (bim::DICOMParams *) fmtHndl->internalParams;
     ImageInfo *info = &par->i;  
+    if (par->wsi) return dicomReadImageLevelProc(fmtHndl, page, 0);
 
     // allocate output image
     ImageBitmap *bmp = fmtHndl->image;
@@ -492,6 +777,18 @@ bim::uint dicom_append_metadata (FormatHandle *fmtHndl, TagMap *hash ) {
   hash->set_value(bim::PIXEL_RESOLUTION_UNIT_X, "mm");
   hash->set_value(bim::PIXEL_RESOLUTION_UNIT_Y, "mm");
 
+  //-------------------------------------------
+  // whole slide resolution levels
+  //-------------------------------------------
+  if (par->wsi) {
+      std::vector<double> scales;
+      for (size_t l = 0; l < par->levels.size(); ++l)
+          scales.push_back((double)par->levels[l].width / (double)info->width);
+      hash->set_value(bim::IMAGE_NUM_RES_L, (int)par->levels.size());
+      hash->set_value(bim::IMAGE_RES_L_SCALES, xstring::join(scales, ","));
+      hash->set_value(bim::IMAGE_RES_STRUCTURE, bim::IMAGE_RES_STRUCTURE_HIERARCHICAL);
+  }
+
 
   xstring slice_thickness_mm = read_tag(ds, 0x0018, 0x0050);
   if (slice_thickness_mm.size() > 0) {
@@ -641,10 +938,10 @@ FormatHeader dicomHeader = {
   // read/write
   dicomReadImageProc, //ReadImageProc 
   NULL, //WriteImageProc
-  NULL, //ReadImageTileProc
+  dicomReadImageTileProc, //ReadImageTileProc
   NULL, //WriteImageTileProc
-  NULL, //ReadImageLineProc
-  NULL, //WriteImageLineProc
+  dicomReadImageLevelProc, //ReadImageLevelProc
+  NULL, //WriteImageLevelProc
   NULL, //ReadImageThumbProc
   NULL, //WriteImageThumbProc
   NULL, //dimJpegReadImagePreviewProc, //ReadImagePreviewProc
@@ -655,7 +952,7 @@ FormatHeader dicomHeader = {
   NULL, //ReadMetaDataAsTextProc
   dicom_append_metadata, //AppendMetaDataProc
 
-  NULL,
+  NULL, //ReadImageRegionProc
   NULL,
   ""
 
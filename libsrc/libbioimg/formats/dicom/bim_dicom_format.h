@@ -7,8 +7,9 @@
 
   History:
     2013-01-12 14:13:40 - First creation
+    2026-10-19 12:00:00 - VL Whole Slide Microscopy tiled pyramids
         
-  ver : 1
+  ver : 2
 *****************************************************************************/
 
 #ifndef BIM_DICOM_FORMAT_H
@@ -17,6 +18,7 @@
 #include <cstdio>
 #include <string>
 #include <fstream>
+#include <vector>
 
 #include <bim_img_format_interface.h>
 #include <bim_img_format_utils.h>
@@ -38,6 +40,19 @@ namespace bim {
 // internal format defs
 //----------------------------------------------------------------------------
 
+// one resolution level of a VL Whole Slide Microscopy pyramid, each level is
+// a separate TILED_FULL multi-frame instance of the same series
+class DICOMLevel {
+public:
+    DICOMLevel(): width(0), height(0), reader(NULL), file(NULL) {}
+
+    std::string filename;
+    bim::uint64 width;  // size of the total pixel matrix
+    bim::uint64 height;
+    gdcm::ImageRegionReader *reader; // opened on first access, level 0 uses the session reader
+    std::fstream *file;
+};
+
 class DICOMParams {
 
 public:
@@ -55,6 +70,10 @@ public:
     gdcm::ImageRegionReader *reader;
     std::fstream *file; // only used in windows case to support UTF16 filenames
     //std::vector<char> buffer; // gdcm seems to be reading the whole 3d/4d image in memory at once, since we read by pages, keep this in memory
+
+    // whole slide images: frames are tiles of the total pixel matrix
+    bool wsi;
+    std::vector<DICOMLevel> levels;
 };
 
 } // namespace bim
@@ -11,8 +11,12 @@ Authors:
 History:
     2015-04-19 14:20:00 - First creation
     2015-07-22 11:21:40 - Rewrite
+    2026-10-19 12:00:00 - Parallel tiled writing
+    2026-10-19 12:00:00 - Region reading, codec reuse between reads
+    2026-10-19 12:00:00 - Validate tile main headers before splicing
+    2026-10-19 12:00:00 - Report files that could not be written
 
-ver : 2
+ver : 6
 *****************************************************************************/
 
 #include <cstdio>
@@ -23,6 +27,13 @@ ver : 2
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include <xtypes.h>
 #include <xstring.h>
@@ -69,7 +80,7 @@ static OPJ_SIZE_T _ReadProc(void *p_buffer, OPJ_SIZE_T p_nb_bytes, void *p_user_
 static OPJ_SIZE_T _WriteProc(void *p_buffer, OPJ_SIZE_T p_nb_bytes, void *p_user_data) {
     bim::JP2Params *par = (bim::JP2Params*) p_user_data;
     par->file->write((char*)p_buffer, p_nb_bytes);
-    return (par->file->rdstate() & std::ifstream::badbit) == 0 ? p_nb_bytes : -1;
+    return (par->file->rdstate() & (std::ifstream::badbit | std::ifstream::failbit)) == 0 ? p_nb_bytes : -1;
 }
 
 static OPJ_OFF_T _SkipProc(OPJ_OFF_T p_nb_bytes, void *p_user_data) {
@@ -89,11 +100,15 @@ static OPJ_BOOL _SeekProc(OPJ_OFF_T p_nb_bytes, FILE * p_user_data) {
 
 bim::JP2Params::JP2Params() {
     i = initImageInfo();
+    file = NULL;
     stream = NULL;
     codec = NULL;
     image = NULL;
     num_tiles_x = 0;
     num_tiles_y = 0;
+    tile_x0 = 0;
+    tile_y0 = 0;
+    decoded = false;
 }
 
 bim::JP2Params::~JP2Params() {
@@ -108,7 +123,11 @@ void bim::JP2Params::open(const char *filename, bim::ImageIOModes io_mode) {
 #else
     this->file = new std::fstream(filename, mode | std::fstream::binary);
 #endif
+    start(io_mode);
+}
 
+void bim::JP2Params::start(bim::ImageIOModes io_mode) {
+    this->decoded = false;
     this->stream = opj_stream_create(OPJ_J2K_STREAM_CHUNK_SIZE, io_mode == IO_READ ? OPJ_TRUE : OPJ_FALSE);
     if (this->stream) {
         opj_stream_set_user_data(this->stream, this, NULL);
@@ -144,7 +163,7 @@ void bim::JP2Params::open(const char *filename, bim::ImageIOModes io_mode) {
     }
 }
 
-void bim::JP2Params::close() {
+void bim::JP2Params::stop() {
     if (image) {
         opj_image_destroy(image);
         image = NULL;
@@ -157,6 +176,18 @@ void bim::JP2Params::close() {
         opj_stream_destroy(stream);
         stream = NULL;
     }
+}
+
+void bim::JP2Params::prepare() {
+    if (!decoded && image) return;
+    stop();
+    file->clear();
+    file->seekg(0, std::fstream::beg);
+    start(IO_READ);
+}
+
+void bim::JP2Params::close() {
+    stop();
     if (file) {
         delete file;
         file = NULL;
@@ -294,6 +325,8 @@ void jp2GetImageInfo(FormatHandle *fmtHndl) {
     info->tileHeight = pCodeStreamInfo->tdy;
     par->num_tiles_x = pCodeStreamInfo->tw;
     par->num_tiles_y = pCodeStreamInfo->th;
+    par->tile_x0 = pCodeStreamInfo->tx0;
+    par->tile_y0 = pCodeStreamInfo->ty0;
     info->number_levels = pCodeStreamInfo->m_default_tile_info.tccp_info[0].numresolutions;
     opj_destroy_cstr_info(&pCodeStreamInfo);
 
@@ -403,21 +436,44 @@ ImageInfo jp2GetImageInfoProc(FormatHandle *fmtHndl, bim::uint page_num) {
 // READ
 //----------------------------------------------------------------------------
 
+// copies a decoded component into a plane of out_width pixels at position ox,oy
 template <typename T>
-void copy_component(bim::uint64 W, bim::uint64 H, int sample, const opj_image_comp_t &in, void *out) {
+void copy_component(const opj_image_comp_t &in, void *out, bim::uint64 out_width, bim::uint64 ox, bim::uint64 oy) {
     OPJ_INT32 a = (in.sgnd ? 1 << (in.prec - 1) : 0);
+    bim::uint64 W = in.w;
+    bim::uint64 H = in.h;
     #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (W > BIM_OMP_FOR2 && H > BIM_OMP_FOR2)
     for (bim::int64 y = 0; y < (bim::int64) H; ++y) {
-        T *p = ((T *)out) + y*W;
-        bim::uint64 pos = y*W;
+        T *p = ((T *)out) + (oy + y)*out_width + ox;
+        const OPJ_INT32 *d = in.data + y*W;
         for (bim::int64 x = 0; x < (bim::int64) W; ++x) {
-            *p = (T)(in.data[pos] + a);
+            *p = (T)(*d + a);
             p++;
-            pos++;
+            d++;
         } // for x
     } // for y
 }
 
+static void copy_components(const opj_image_t *image, ImageBitmap *bmp, bim::uint64 ox = 0, bim::uint64 oy = 0) {
+    ImageInfo *info = &bmp->i;
+    for (int s = 0; s < info->samples; ++s) {
+        const opj_image_comp_t &comp = image->comps[s];
+        if (ox + comp.w > info->width || oy + comp.h > info->height)
+            throw "Decoded component does not fit the image\n";
+        if (info->depth == 8)
+            copy_component<bim::uint8>(comp, bmp->bits[s], info->width, ox, oy);
+        else if (info->depth == 16)
+            copy_component<bim::uint16>(comp, bmp->bits[s], info->width, ox, oy);
+        else if (info->depth == 32)
+            copy_component<bim::uint32>(comp, bmp->bits[s], info->width, ox, oy);
+    } // for sample
+}
+
+// size of a dimension at a resolution level, the same rounding OpenJPEG uses
+static inline bim::uint64 jp2_level_size(bim::uint64 v, bim::uint level) {
+    return (v + ((bim::uint64)1 << level) - 1) >> level;
+}
+
 bim::uint jp2ReadImageProc(FormatHandle *fmtHndl, bim::uint page) {
     if (fmtHndl == NULL) return 1;
     fmtHndl->pageNumber = page;
@@ -428,9 +484,8 @@ bim::uint jp2ReadImageProc(FormatHandle *fmtHndl, bim::uint page) {
     if (allocImg(fmtHndl, info, bmp) != 0) return 1;
 
     try {
-        // openjpeg unfortunately has some problem with multiple decodings, have to reset everything from scratch
-        if (!par->image) 
-            par->open(fmtHndl->fileName, fmtHndl->io_mode);
+        par->prepare();
+        par->decoded = true;
 
         if (!opj_decode(par->codec, par->stream, par->image)) {
             throw "Failed to decode image\n";
@@ -440,18 +495,8 @@ bim::uint jp2ReadImageProc(FormatHandle *fmtHndl, bim::uint page) {
             throw "Failed to finish decompression\n";
         }
 
-        for (int s = 0; s < info->samples; ++s) {
-            if (info->depth == 8)
-                copy_component<bim::uint8>(info->width, info->height, s, par->image->comps[s], bmp->bits[s]);
-            else if (info->depth == 16)
-                copy_component<bim::uint16>(info->width, info->height, s, par->image->comps[s], bmp->bits[s]);
-            else if (info->depth == 32)
-                copy_component<bim::uint32>(info->width, info->height, s, par->image->comps[s], bmp->bits[s]);
-        } // for sample
-
-        par->close();
+        copy_components(par->image, bmp);
     } catch (...) {
-        par->close();
         return 1;
     }
     return 0;
@@ -461,12 +506,11 @@ bim::uint jp2ReadImageLevelProc(FormatHandle *fmtHndl, bim::uint page, bim::uint
     if (fmtHndl == NULL) return 1;
     if (fmtHndl->internalParams == NULL) return 1;
     bim::JP2Params *par = (bim::JP2Params *) fmtHndl->internalParams;
-    ImageInfo *info = &par->i;
+    ImageInfo info = par->i;
 
     try {
-        // openjpeg unfortunately has some problem with multiple decodings, have to reset everything from scratch
-        if (!par->image)
-            par->open(fmtHndl->fileName, fmtHndl->io_mode);
+        par->prepare();
+        par->decoded = true;
 
         // read a specific resolution level
         if (!opj_set_decoded_resolution_factor(par->codec, level)) {
@@ -475,11 +519,11 @@ bim::uint jp2ReadImageLevelProc(FormatHandle *fmtHndl, bim::uint page, bim::uint
         
         // setting resolution level does not change image size in opj_decode, a little hack to
         // update image size based on the resolution level
-        info->width = bim::round<bim::uint64>((double)info->width / pow(2.0, level));
-        info->height = bim::round<bim::uint64>((double)info->height / pow(2.0, level));
-        for (int i = 0; i < info->samples; ++i) {
-            par->image->comps[i].w = info->width;
-            par->image->comps[i].h = info->height;
+        info.width = bim::round<bim::uint64>((double)info.width / pow(2.0, level));
+        info.height = bim::round<bim::uint64>((double)info.height / pow(2.0, level));
+        for (int i = 0; i < info.samples; ++i) {
+            par->image->comps[i].w = info.width;
+            par->image->comps[i].h = info.height;
         }
         
         if (!opj_decode(par->codec, par->stream, par->image)) {
@@ -494,21 +538,10 @@ bim::uint jp2ReadImageLevelProc(FormatHandle *fmtHndl, bim::uint page, bim::uint
         //info->width = par->image->comps[0].w;
         //info->height = par->image->comps[0].h;
         ImageBitmap *bmp = fmtHndl->image;
-        if (allocImg(fmtHndl, info, bmp) != 0) return 1;
-
-        for (int s = 0; s < info->samples; ++s) {
-            if (info->depth == 8)
-                copy_component<bim::uint8>(info->width, info->height, s, par->image->comps[s], bmp->bits[s]);
-            else if (info->depth == 16)
-                copy_component<bim::uint16>(info->width, info->height, s, par->image->comps[s], bmp->bits[s]);
-            else if (info->depth == 32)
-                copy_component<bim::uint32>(info->width, info->height, s, par->image->comps[s], bmp->bits[s]);
-        } // for sample
-
-        par->close();
+        if (allocImg(fmtHndl, &info, bmp) != 0) return 1;
+        copy_components(par->image, bmp);
     }
     catch (...) {
-        par->close();
         return 1;
     }
     return 0;
@@ -518,16 +551,15 @@ bim::uint jp2ReadImageTileProc(FormatHandle *fmtHndl, bim::uint page, bim::uint6
     if (fmtHndl == NULL) return 1;
     if (fmtHndl->internalParams == NULL) return 1;
     bim::JP2Params *par = (bim::JP2Params *) fmtHndl->internalParams;
-    ImageInfo *info = &par->i;
+    ImageInfo info = par->i;
 
     if (xid>=par->num_tiles_x || yid >= par->num_tiles_y) {
         return 1;
     }
 
     try {
-        // openjpeg unfortunately has some problem with multiple decodings, have to reset everything from scratch
-        if (!par->image)
-            par->open(fmtHndl->fileName, fmtHndl->io_mode);
+        par->prepare();
+        par->decoded = true;
 
         // read a specific resolution level
         if (!opj_set_decoded_resolution_factor(par->codec, level)) {
@@ -543,28 +575,127 @@ bim::uint jp2ReadImageTileProc(FormatHandle *fmtHndl, bim::uint page, bim::uint6
             throw "Failed to finish decompression\n";
         }
 
-        info->width = par->image->comps[0].w;
-        info->height = par->image->comps[0].h;
+        info.width = par->image->comps[0].w;
+        info.height = par->image->comps[0].h;
         ImageBitmap *bmp = fmtHndl->image;
-        if (allocImg(fmtHndl, info, bmp) != 0) return 1;
-
-        for (int s = 0; s < info->samples; ++s) {
-            if (info->depth == 8)
-                copy_component<bim::uint8>(info->width, info->height, s, par->image->comps[s], bmp->bits[s]);
-            else if (info->depth == 16)
-                copy_component<bim::uint16>(info->width, info->height, s, par->image->comps[s], bmp->bits[s]);
-            else if (info->depth == 32)
-                copy_component<bim::uint32>(info->width, info->height, s, par->image->comps[s], bmp->bits[s]);
-        } // for sample
-
-        par->close();
+        if (allocImg(fmtHndl, &info, bmp) != 0) return 1;
+        copy_components(par->image, bmp);
      } catch (...) {
-        par->close();
         return 1;
     }
     return 0;
 }
 
+// decodes the full resolution area x0,y0 - x1,y1 at the given level and stores it into
+// the image, ox,oy is the position of the image origin within the level
+static void jp2_decode_area(bim::JP2Params *par, bim::uint level, bim::uint64 x0, bim::uint64 y0, bim::uint64 x1, bim::uint64 y1,
+                            ImageBitmap *bmp, bim::uint64 ox, bim::uint64 oy) {
+    par->prepare();
+    par->decoded = true;
+
+    if (!opj_set_decoded_resolution_factor(par->codec, level)) {
+        throw "Failed to set image level\n";
+    }
+
+    // the level is only stored in the codec's own image, the area size is computed from ours
+    for (OPJ_UINT32 i = 0; i < par->image->numcomps; ++i)
+        par->image->comps[i].factor = level;
+
+    if (!opj_set_decode_area(par->codec, par->image, (OPJ_INT32)x0, (OPJ_INT32)y0, (OPJ_INT32)x1, (OPJ_INT32)y1)) {
+        throw "Failed to set decoding area\n";
+    }
+
+    if (!opj_decode(par->codec, par->stream, par->image)) {
+        throw "Failed to decode image region\n";
+    }
+
+    if (!opj_end_decompress(par->codec, par->stream)) {
+        throw "Failed to finish decompression\n";
+    }
+
+    copy_components(par->image, bmp, jp2_level_size(x0, level) - ox, jp2_level_size(y0, level) - oy);
+}
+
+// Only code-blocks intersecting the requested area are decoded. OpenJPEG decodes
+// within one codec in a single thread, so when the area spans several native
+// tiles each thread opens its own decoder and tiles are decoded concurrently.
+bim::uint jp2ReadImageRegionProc(FormatHandle *fmtHndl, bim::uint page, bim::uint64 x1, bim::uint64 y1, bim::uint64 x2, bim::uint64 y2, bim::uint level) {
+    if (fmtHndl == NULL) return 1;
+    if (fmtHndl->internalParams == NULL) return 1;
+    bim::JP2Params *par = (bim::JP2Params *) fmtHndl->internalParams;
+    ImageInfo info = par->i;
+    if ((int)level >= info.number_levels) return 1;
+
+    bim::uint64 level_w = jp2_level_size(info.width, level);
+    bim::uint64 level_h = jp2_level_size(info.height, level);
+    if (x1 >= level_w || y1 >= level_h || x2 < x1 || y2 < y1) return 1;
+    x2 = bim::min<bim::uint64>(x2, level_w - 1);
+    y2 = bim::min<bim::uint64>(y2, level_h - 1);
+
+    info.width = x2 - x1 + 1;
+    info.height = y2 - y1 + 1;
+    ImageBitmap *bmp = fmtHndl->image;
+    if (allocImg(fmtHndl, &info, bmp) != 0) return 1;
+
+    // requested area on the full resolution grid
+    bim::uint64 ax0 = x1 << level;
+    bim::uint64 ay0 = y1 << level;
+    bim::uint64 ax1 = bim::min<bim::uint64>((x2 + 1) << level, par->i.width);
+    bim::uint64 ay1 = bim::min<bim::uint64>((y2 + 1) << level, par->i.height);
+
+    // split the area at native tile boundaries
+    std::vector<bim::uint64> xs(1, ax0), ys(1, ay0);
+    bim::uint64 tw = bim::max<bim::uint64>(par->i.tileWidth, 1);
+    bim::uint64 th = bim::max<bim::uint64>(par->i.tileHeight, 1);
+    for (bim::uint64 x = par->tile_x0 + (ax0 - par->tile_x0) / tw * tw + tw; x < ax1; x += tw) xs.push_back(x);
+    for (bim::uint64 y = par->tile_y0 + (ay0 - par->tile_y0) / th * th + th; y < ay1; y += th) ys.push_back(y);
+    xs.push_back(ax1);
+    ys.push_back(ay1);
+    bim::int64 nx = xs.size() - 1;
+    bim::int64 blocks = nx * (ys.size() - 1);
+
+    bool parallel = blocks > 1 && !isCustomReading(fmtHndl);
+#ifdef _OPENMP
+    parallel = parallel && omp_get_max_threads() > 1;
+#else
+    parallel = false;
+#endif
+
+    if (!parallel) {
+        try {
+            jp2_decode_area(par, level, ax0, ay0, ax1, ay1, bmp, x1, y1);
+        } catch (...) {
+            return 1;
+        }
+        return 0;
+    }
+
+    std::atomic<bool> failed(false);
+    #pragma omp parallel default(shared)
+    {
+        bim::JP2Params dec;
+        try {
+            dec.open(fmtHndl->fileName, IO_READ);
+        } catch (...) {
+            failed = true;
+        }
+
+        #pragma omp for schedule(dynamic)
+        for (bim::int64 b = 0; b < blocks; ++b) {
+            if (failed) continue;
+            bim::int64 bx = b % nx;
+            bim::int64 by = b / nx;
+            try {
+                jp2_decode_area(&dec, level, xs[bx], ys[by], xs[bx + 1], ys[by + 1], bmp, x1, y1);
+            } catch (...) {
+                failed = true;
+            }
+        } // for b
+    } // omp parallel
+
+    return failed ? 1 : 0;
+}
+
 //----------------------------------------------------------------------------
 // WRITE
 //----------------------------------------------------------------------------
@@ -593,6 +724,326 @@ void copy_from_component(bim::uint64 W, bim::uint64 H, int sample, const void *i
     } // for y
 }
 
+//----------------------------------------------------------------------------
+// Tiled writing
+//
+// OpenJPEG encodes the tiles of one codestream strictly in order and in a single
+// thread, so every tile is encoded here as its own single tile codestream whose
+// reference grid places the tile exactly where it lies in the full image. Such
+// codestream contains the same tile-part the full encoder would produce, tile-parts
+// are renumbered and appended to the main header of the first tile with the image
+// size corrected. Only a few tiles are kept in memory at any time.
+//----------------------------------------------------------------------------
+
+#define BIM_JP2_MARKER_SIZ 0xFF51
+#define BIM_JP2_MARKER_SOT 0xFF90
+
+static inline bim::uint32 jp2_get_uint16(const bim::uchar *p) {
+    return (p[0] << 8) | p[1];
+}
+
+static inline bim::uint32 jp2_get_uint32(const bim::uchar *p) {
+    return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static inline void jp2_put_uint16(bim::uchar *p, bim::uint32 v) {
+    p[0] = (bim::uchar)(v >> 8); p[1] = (bim::uchar)v;
+}
+
+static inline void jp2_put_uint32(bim::uchar *p, bim::uint32 v) {
+    p[0] = (bim::uchar)(v >> 24); p[1] = (bim::uchar)(v >> 16); p[2] = (bim::uchar)(v >> 8); p[3] = (bim::uchar)v;
+}
+
+static void jp2_append_uint32(std::vector<bim::uchar> *buf, bim::uint32 v) {
+    size_t pos = buf->size();
+    buf->resize(pos + 4);
+    jp2_put_uint32(&(*buf)[pos], v);
+}
+
+// memory stream receiving an encoded tile
+
+class JP2MemoryStream {
+public:
+    JP2MemoryStream() : pos(0) {}
+    std::vector<bim::uchar> data;
+    size_t pos;
+};
+
+static OPJ_SIZE_T _MemWriteProc(void *p_buffer, OPJ_SIZE_T p_nb_bytes, void *p_user_data) {
+    JP2MemoryStream *ms = (JP2MemoryStream *)p_user_data;
+    if (ms->pos + p_nb_bytes > ms->data.size()) ms->data.resize(ms->pos + p_nb_bytes);
+    memcpy(&ms->data[ms->pos], p_buffer, p_nb_bytes);
+    ms->pos += p_nb_bytes;
+    return p_nb_bytes;
+}
+
+static OPJ_OFF_T _MemSkipProc(OPJ_OFF_T p_nb_bytes, void *p_user_data) {
+    JP2MemoryStream *ms = (JP2MemoryStream *)p_user_data;
+    if ((OPJ_OFF_T)ms->pos + p_nb_bytes < 0) return -1;
+    ms->pos += (size_t) p_nb_bytes;
+    if (ms->pos > ms->data.size()) ms->data.resize(ms->pos);
+    return p_nb_bytes;
+}
+
+static OPJ_BOOL _MemSeekProc(OPJ_OFF_T p_nb_bytes, void *p_user_data) {
+    JP2MemoryStream *ms = (JP2MemoryStream *)p_user_data;
+    if (p_nb_bytes < 0) return OPJ_FALSE;
+    ms->pos = (size_t) p_nb_bytes;
+    if (ms->pos > ms->data.size()) ms->data.resize(ms->pos);
+    return OPJ_TRUE;
+}
+
+template <typename T>
+void copy_tile_to_component(bim::uint64 W, bim::uint64 x0, bim::uint64 y0, const void *in, const opj_image_comp_t &out) {
+    for (bim::uint64 y = 0; y < out.h; ++y) {
+        const T *p = ((const T *)in) + (y0 + y)*W + x0;
+        OPJ_INT32 *o = out.data + y*out.w;
+        for (bim::uint64 x = 0; x < out.w; ++x)
+            o[x] = (OPJ_INT32)p[x];
+    } // for y
+}
+
+// encodes the tile at x0,y0 as a J2K codestream, returns false on failure
+static bool jp2_encode_tile(const ImageBitmap *bmp, opj_cparameters_t parameters, OPJ_COLOR_SPACE color_space,
+                            bim::uint64 x0, bim::uint64 y0, bim::uint64 w, bim::uint64 h, std::vector<bim::uchar> *out) {
+    const ImageInfo *info = &bmp->i;
+    parameters.cp_tx0 = (int) x0;
+    parameters.cp_ty0 = (int) y0;
+    parameters.image_offset_x0 = (int) x0;
+    parameters.image_offset_y0 = (int) y0;
+
+    std::vector<opj_image_cmptparm_t> cmptparm(info->samples);
+    memset(&cmptparm[0], 0, info->samples * sizeof(opj_image_cmptparm_t));
+    for (int i = 0; i < info->samples; i++) {
+        cmptparm[i].dx = 1;
+        cmptparm[i].dy = 1;
+        cmptparm[i].x0 = (OPJ_UINT32) x0;
+        cmptparm[i].y0 = (OPJ_UINT32) y0;
+        cmptparm[i].w = (OPJ_UINT32) w;
+        cmptparm[i].h = (OPJ_UINT32) h;
+        cmptparm[i].prec = info->depth;
+        cmptparm[i].bpp = info->depth;
+        cmptparm[i].sgnd = (info->pixelType == FMT_SIGNED) ? 1 : 0;
+    }
+
+    opj_image_t *image = opj_image_create(info->samples, &cmptparm[0], color_space);
+    if (!image) return false;
+    image->x0 = (OPJ_UINT32) x0;
+    image->y0 = (OPJ_UINT32) y0;
+    image->x1 = (OPJ_UINT32) (x0 + w);
+    image->y1 = (OPJ_UINT32) (y0 + h);
+
+    for (int s = 0; s < info->samples; ++s) {
+        if (info->depth == 8)
+            copy_tile_to_component<bim::uint8>(info->width, x0, y0, bmp->bits[s], image->comps[s]);
+        else if (info->depth == 16)
+            copy_tile_to_component<bim::uint16>(info->width, x0, y0, bmp->bits[s], image->comps[s]);
+        else if (info->depth == 32)
+            copy_tile_to_component<bim::uint32>(info->width, x0, y0, bmp->bits[s], image->comps[s]);
+    } // for sample
+
+    JP2MemoryStream ms;
+    opj_stream_t *stream = opj_stream_create(OPJ_J2K_STREAM_CHUNK_SIZE, OPJ_FALSE);
+    opj_codec_t *codec = opj_create_compress(OPJ_CODEC_J2K);
+    bool ok = stream && codec;
+    if (ok) {
+        opj_stream_set_user_data(stream, &ms, NULL);
+        opj_stream_set_write_function(stream, (opj_stream_write_fn)_MemWriteProc);
+        opj_stream_set_skip_function(stream, (opj_stream_skip_fn)_MemSkipProc);
+        opj_stream_set_seek_function(stream, (opj_stream_seek_fn)_MemSeekProc);
+        opj_set_info_handler(codec, NULL, NULL);
+        opj_set_warning_handler(codec, NULL, NULL);
+        opj_set_error_handler(codec, jp2_error_callback, NULL);
+
+        ok = opj_setup_encoder(codec, &parameters, image) &&
+             opj_start_compress(codec, image, stream) &&
+             opj_encode(codec, stream) &&
+             opj_end_compress(codec, stream);
+    }
+
+    if (codec) opj_destroy_codec(codec);
+    if (stream) opj_stream_destroy(stream);
+    opj_image_destroy(image);
+    if (ok) out->swap(ms.data);
+    return ok;
+}
+
+// returns the size of the codestream main header, the offset of the first SOT marker, 0 if not found
+static size_t jp2_main_header_size(const std::vector<bim::uchar> &cs) {
+    size_t pos = 2; // skip SOC
+    while (pos + 4 <= cs.size()) {
+        bim::uint32 marker = jp2_get_uint16(&cs[pos]);
+        if (marker == BIM_JP2_MARKER_SOT) return pos;
+        if ((marker & 0xFF00) != 0xFF00) return 0;
+        pos += 2 + jp2_get_uint16(&cs[pos + 2]);
+    }
+    return 0;
+}
+
+// sets the tile index of every tile-part, returns false if the tile-parts are malformed
+static bool jp2_renumber_tile_parts(bim::uchar *p, size_t size, bim::uint32 tile) {
+    size_t pos = 0;
+    while (pos + 12 <= size) {
+        if (jp2_get_uint16(p + pos) != BIM_JP2_MARKER_SOT) return false;
+        jp2_put_uint16(p + pos + 4, tile);
+        bim::uint32 psot = jp2_get_uint32(p + pos + 6);
+        if (psot == 0) return true; // last tile-part extends up to EOC
+        pos += psot;
+    }
+    return pos == size;
+}
+
+// SIZ fields that differ between tiles encoded on their own: image size, image and tile origin
+static bool jp2_siz_tile_field(size_t pos) {
+    return (pos >= 8 && pos < 24) || (pos >= 32 && pos < 40);
+}
+
+// main headers of separately encoded tiles may only differ in the SIZ geometry, any other
+// difference (COD, QCD, QCC, POC...) means the tile-parts can not share the first tile's header
+static bool jp2_same_main_header(const std::vector<bim::uchar> &first, const std::vector<bim::uchar> &cs, size_t header) {
+    if (first.size() != header || header < 40) return false;
+    if (jp2_get_uint16(&cs[2]) != BIM_JP2_MARKER_SIZ) return false;
+    for (size_t pos = 0; pos < header; ++pos)
+        if (first[pos] != cs[pos] && !jp2_siz_tile_field(pos)) return false;
+    return true;
+}
+
+// JP2 signature, file type and header boxes, same as produced by OpenJPEG
+static void jp2_write_header_boxes(std::ostream *f, const ImageInfo *info, OPJ_COLOR_SPACE color_space, TagMap *hash) {
+    std::vector<bim::uchar> buf;
+    jp2_append_uint32(&buf, 12);
+    jp2_append_uint32(&buf, 0x6a502020); // 'jP  '
+    jp2_append_uint32(&buf, 0x0d0a870a);
+
+    jp2_append_uint32(&buf, 20);
+    jp2_append_uint32(&buf, 0x66747970); // 'ftyp'
+    jp2_append_uint32(&buf, 0x6a703220); // brand 'jp2 '
+    jp2_append_uint32(&buf, 0);          // minor version
+    jp2_append_uint32(&buf, 0x6a703220); // compatibility list 'jp2 '
+
+    const char *icc = NULL;
+    bim::uint32 icc_size = 0;
+    if (hash && hash->hasKey(bim::RAW_TAGS_ICC) && hash->get_type(bim::RAW_TAGS_ICC) == bim::RAW_TYPES_ICC) {
+        icc_size = hash->get_size(bim::RAW_TAGS_ICC);
+        icc = hash->get_value_bin(bim::RAW_TAGS_ICC);
+    }
+    bim::uint32 colr_size = 11 + (icc_size > 0 ? icc_size : 4);
+
+    jp2_append_uint32(&buf, 8 + 22 + colr_size);
+    jp2_append_uint32(&buf, 0x6a703268); // 'jp2h'
+
+    jp2_append_uint32(&buf, 22);
+    jp2_append_uint32(&buf, 0x69686472); // 'ihdr'
+    jp2_append_uint32(&buf, (bim::uint32) info->height);
+    jp2_append_uint32(&buf, (bim::uint32) info->width);
+    buf.push_back((bim::uchar)(info->samples >> 8));
+    buf.push_back((bim::uchar)info->samples);
+    buf.push_back((bim::uchar)((info->depth - 1) + (info->pixelType == FMT_SIGNED ? 0x80 : 0)));
+    buf.push_back(7); // compression type, always 7
+    buf.push_back(0); // colorspace is known
+    buf.push_back(0); // no intellectual property
+
+    jp2_append_uint32(&buf, colr_size);
+    jp2_append_uint32(&buf, 0x636f6c72); // 'colr'
+    buf.push_back(icc_size > 0 ? 2 : 1); // method
+    buf.push_back(0); // precedence
+    buf.push_back(0); // approximation
+    if (icc_size > 0) {
+        buf.insert(buf.end(), icc, icc + icc_size);
+    } else {
+        bim::uint32 enumcs = 0;
+        if (color_space == OPJ_CLRSPC_SRGB) enumcs = 16;
+        else if (color_space == OPJ_CLRSPC_GRAY) enumcs = 17;
+        else if (color_space == OPJ_CLRSPC_SYCC) enumcs = 18;
+        jp2_append_uint32(&buf, enumcs);
+    }
+
+    f->write((const char *)&buf[0], buf.size());
+}
+
+static bim::uint jp2WriteTiledImage(FormatHandle *fmtHndl, const opj_cparameters_t &parameters, OPJ_COLOR_SPACE color_space) {
+    bim::JP2Params *par = (bim::JP2Params *) fmtHndl->internalParams;
+    ImageBitmap *bmp = fmtHndl->image;
+    ImageInfo *info = &bmp->i;
+    std::fstream *f = par->file;
+    bim::uint64 tile_size = parameters.cp_tdx;
+    bim::uint64 tiles_x = (info->width + tile_size - 1) / tile_size;
+    bim::uint64 tiles_y = (info->height + tile_size - 1) / tile_size;
+    bim::uint64 num_tiles = tiles_x * tiles_y;
+    if (num_tiles > 65535) return 1; // tile index is a 16 bit value
+
+    // tiles are encoded in batches and written in order, which bounds memory use
+    int batch = 2;
+#ifdef _OPENMP
+    batch = omp_get_max_threads() * 2;
+#endif
+    std::vector< std::vector<bim::uchar> > encoded(batch);
+
+    jp2_write_header_boxes(f, info, color_space, fmtHndl->metaData);
+    std::streampos jp2c_pos = f->tellp();
+    std::vector<bim::uchar> box;
+    jp2_append_uint32(&box, 0);          // size, updated once the codestream is written
+    jp2_append_uint32(&box, 0x6a703263); // 'jp2c'
+    f->write((const char *)&box[0], box.size());
+
+    std::vector<bim::uchar> main_header;
+    std::atomic<bool> failed(false);
+    for (bim::uint64 first = 0; first < num_tiles && !failed; first += batch) {
+        bim::int64 n = (bim::int64) std::min<bim::uint64>(batch, num_tiles - first);
+
+        #pragma omp parallel for default(shared) schedule(dynamic) if (n > 1)
+        for (bim::int64 i = 0; i < n; ++i) {
+            bim::uint64 t = first + i;
+            bim::uint64 x0 = (t % tiles_x) * tile_size;
+            bim::uint64 y0 = (t / tiles_x) * tile_size;
+            bim::uint64 w = std::min<bim::uint64>(tile_size, info->width - x0);
+            bim::uint64 h = std::min<bim::uint64>(tile_size, info->height - y0);
+            if (!jp2_encode_tile(bmp, parameters, color_space, x0, y0, w, h, &encoded[i]))
+                failed = true;
+        } // for i
+        if (failed) break;
+
+        for (bim::int64 i = 0; i < n; ++i) {
+            std::vector<bim::uchar> &cs = encoded[i];
+            size_t header = jp2_main_header_size(cs);
+            if (header == 0 || cs.size() < header + 2 ||
+                !jp2_renumber_tile_parts(&cs[header], cs.size() - header - 2, (bim::uint32) (first + i))) {
+                failed = true;
+                break;
+            }
+
+            if (first + i == 0) {
+                // main header of the first tile describes the whole image once the size is fixed
+                if (header < 40 || jp2_get_uint16(&cs[2]) != BIM_JP2_MARKER_SIZ) { failed = true; break; }
+                main_header.assign(cs.begin(), cs.begin() + header);
+                jp2_put_uint32(&cs[8], (bim::uint32) info->width);
+                jp2_put_uint32(&cs[12], (bim::uint32) info->height);
+                f->write((const char *)&cs[0], header);
+            } else if (!jp2_same_main_header(main_header, cs, header)) {
+                jp2_error_callback("Tile coding parameters differ from the first tile\n", NULL);
+                failed = true;
+                break;
+            }
+            f->write((const char *)&cs[header], cs.size() - header - 2);
+            std::vector<bim::uchar>().swap(cs);
+        } // for i
+
+        xprogress(fmtHndl, first + n, num_tiles, "Writing JPEG2000");
+        if (xtestAbort(fmtHndl) == 1) failed = true;
+    } // for batch
+    if (failed || !f->good()) return 1;
+
+    // end of codestream and the final size of the codestream box
+    const bim::uchar eoc[2] = { 0xFF, 0xD9 };
+    f->write((const char *)eoc, 2);
+    std::streampos end_pos = f->tellp();
+    jp2_put_uint32(&box[0], (bim::uint32) (end_pos - jp2c_pos));
+    f->seekp(jp2c_pos);
+    f->write((const char *)&box[0], 4);
+    f->seekp(end_pos);
+    return f->good() ? 0 : 1;
+}
+
 bim::uint jp2WriteImageProc(FormatHandle *fmtHndl) {
     if (!fmtHndl) return 1;
     bim::JP2Params *par = (bim::JP2Params *) fmtHndl->internalParams;
@@ -659,7 +1110,11 @@ bim::uint jp2WriteImageProc(FormatHandle *fmtHndl) {
             color_space = OPJ_CLRSPC_CMYK;
         }
 
-        opj_image_t *image = opj_image_create(info->samples, &cmptparm[0], color_space);
+        if (tile_size > 0) {
+            return jp2WriteTiledImage(fmtHndl, parameters, color_space);
+        }
+
+        image = opj_image_create(info->samples, &cmptparm[0], color_space);
         if (!image) {
             throw "Could not create JP2 image buffer";
         }
@@ -699,11 +1154,11 @@ bim::uint jp2WriteImageProc(FormatHandle *fmtHndl) {
 
         opj_image_destroy(image);
     } catch (...) {
-        opj_image_destroy(image);
+        if (image) opj_image_destroy(image);
         return 1;
     }
 
-    return 1;
+    return 0;
 }
 
 //----------------------------------------------------------------------------
@@ -827,7 +1282,7 @@ FormatHeader jp2Header = {
     NULL, //ReadMetaDataAsTextProc
     jp2_append_metadata, //AppendMetaDataProc
 
-    NULL,
+    jp2ReadImageRegionProc, //ReadImageRegionProc
     NULL,
     ""
 
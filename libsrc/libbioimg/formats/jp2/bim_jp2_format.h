@@ -11,8 +11,9 @@ Authors:
 History:
     2015-04-19 14:20:00 - First creation
     2015-07-22 11:21:40 - Rewrite
+    2026-10-19 12:00:00 - Region reading
 
-ver : 2
+ver : 3
 *****************************************************************************/
 
 #ifndef BIM_JP2_FORMAT_H
@@ -53,12 +54,22 @@ namespace bim {
 
         int num_tiles_x;
         int num_tiles_y;
+        int tile_x0;
+        int tile_y0;
+        bool decoded;
 
         void open(const char *filename, bim::ImageIOModes mode);
         void close();
 
+        // OpenJPEG can decode a codestream only once, restarts decoding over the open file if needed
+        void prepare();
+
         std::vector<bim::xstring> comments;
         std::vector<char> buffer_icc;
+
+    protected:
+        void start(bim::ImageIOModes mode);
+        void stop();
     };
 
 } // namespace bim
@@ -11,8 +11,9 @@
   03/29/2004 22:23 - First creation
   08/04/2004 22:25 - Update to FMT_IFS 1.2, support for io protorypes
   2010-06-24 15:11 - EXIF/IPTC extraction
+  2026-10-19 12:00 - report encoder errors
 
-  Ver : 3
+  Ver : 4
   *****************************************************************************/
 
 #include "bim_jpeg_format.h"
@@ -212,6 +213,7 @@ static bool jpeg_read_icc(bim::JpegParams *par) {
             memcpy(dst_ptr, src_ptr, data_length[seq_no]);
         }
     }
+    return TRUE;
 }
 
 const unsigned char exif_signature[6] = { 0x45, 0x78, 0x69, 0x66, 0x00, 0x00 };
@@ -349,54 +351,24 @@ static int read_jpeg_image(FormatHandle *fmtHndl) {
                 row_pointer[0] = ((uchar *)image->bits[0]) + (cinfo->output_width*cinfo->output_scanline);
                 (void)jpeg_read_scanlines(cinfo, row_pointer, 1);
             }
-        }  else if (cinfo->output_components == 3) {
-            row_pointer[0] = new uchar[cinfo->output_width*cinfo->output_components];
+        } else {
+            // interleaved components: RGB, CMYK...
+            int samples = cinfo->output_components;
+            int channels = bim::min<int>(samples, image->i.samples);
+            row_pointer[0] = new uchar[cinfo->output_width*samples];
+            void *planes[BIM_MAX_CHANNELS];
             while (cinfo->output_scanline < cinfo->output_height) {
                 xprogress(fmtHndl, cinfo->output_scanline, cinfo->output_height, "Reading JPEG");
                 if (xtestAbort(fmtHndl) == 1) break;
 
-                register unsigned int i;
+                bim::uint64 offset = cinfo->output_width * cinfo->output_scanline;
                 (void)jpeg_read_scanlines(cinfo, row_pointer, 1);
-                uchar *row = row_pointer[0];
-                uchar* pix1 = ((uchar *)image->bits[0]) + cinfo->output_width * (cinfo->output_scanline - 1);
-                uchar* pix2 = ((uchar *)image->bits[1]) + cinfo->output_width * (cinfo->output_scanline - 1);
-                uchar* pix3 = ((uchar *)image->bits[2]) + cinfo->output_width * (cinfo->output_scanline - 1);
-
-                for (i = 0; i < cinfo->output_width; i++) {
-                    *pix1++ = *row++;
-                    *pix2++ = *row++;
-                    *pix3++ = *row++;
-                }
-
+                for (int s = 0; s < channels; ++s)
+                    planes[s] = ((uchar *)image->bits[s]) + offset;
+                bim::deinterleave_row(planes, channels, row_pointer[0], samples, cinfo->output_width, 8);
             } // while scanlines
-            delete row_pointer[0];
+            delete [] row_pointer[0];
         }
-        else if (cinfo->output_components == 4) {
-
-            row_pointer[0] = new uchar[cinfo->output_width*cinfo->output_components];
-
-            while (cinfo->output_scanline < cinfo->output_height) {
-                xprogress(fmtHndl, cinfo->output_scanline, cinfo->output_height, "Reading JPEG");
-                if (xtestAbort(fmtHndl) == 1) break;
-
-                register unsigned int i;
-                (void)jpeg_read_scanlines(cinfo, row_pointer, 1);
-                uchar *row = row_pointer[0];
-                uchar* pix1 = ((uchar *)image->bits[0]) + cinfo->output_width * (cinfo->output_scanline - 1);
-                uchar* pix2 = ((uchar *)image->bits[1]) + cinfo->output_width * (cinfo->output_scanline - 1);
-                uchar* pix3 = ((uchar *)image->bits[2]) + cinfo->output_width * (cinfo->output_scanline - 1);
-                uchar* pix4 = ((uchar *)image->bits[3]) + cinfo->output_width * (cinfo->output_scanline - 1);
-
-                for (i = 0; i < cinfo->output_width; i++) {
-                    *pix1++ = *row++;
-                    *pix2++ = *row++;
-                    *pix3++ = *row++;
-                    *pix4++ = *row++;
-                }
-
-            } // while scanlines
-            delete row_pointer[0];
-        } // if 4 components
 
         jpeg_finish_decompress(cinfo);
     }
@@ -488,7 +460,6 @@ extern "C" {
             dimjpeg_exit_on_error(cinfo, dest->fmtHndl);
 
         xflush(dest->fmtHndl);
-        dimjpeg_exit_on_error(cinfo, dest->fmtHndl);
     }
 
 } // extern C
@@ -599,6 +570,7 @@ static int write_jpeg_image(FormatHandle *fmtHndl) {
 
     struct my_jpeg_destination_mgr *iod_dest = new my_jpeg_destination_mgr(fmtHndl);
     struct my_error_mgr jerr;
+    int res = 0;
 
     cinfo.err = jpeg_std_error(&jerr);
 
@@ -775,32 +747,15 @@ static int write_jpeg_image(FormatHandle *fmtHndl) {
                         }
                     } // if paletted image
 
-                    if (image->i.samples == 2)
+                    if (image->i.samples >= 2)
                     {
-                        uchar* pix1 = ((uchar *)image->bits[0]) + lineSizeBytes * cinfo.next_scanline;
-                        uchar* pix2 = ((uchar *)image->bits[1]) + lineSizeBytes * cinfo.next_scanline;
-                        for (int i = 0; i < w; i++)
-                        {
-                            *row++ = *pix1;
-                            *row++ = *pix2;
-                            *row++ = 0;
-                            pix1++; pix2++;
-                        }
-                    } // if 2 samples
-
-                    if (image->i.samples >= 3)
-                    {
-                        uchar* pix1 = ((uchar *)image->bits[0]) + lineSizeBytes * cinfo.next_scanline;
-                        uchar* pix2 = ((uchar *)image->bits[1]) + lineSizeBytes * cinfo.next_scanline;
-                        uchar* pix3 = ((uchar *)image->bits[2]) + lineSizeBytes * cinfo.next_scanline;
-                        for (int i = 0; i < w; i++)
-                        {
-                            *row++ = *pix1;
-                            *row++ = *pix2;
-                            *row++ = *pix3;
-                            pix1++; pix2++; pix3++;
-                        }
-                    } // if 3 or more samples
+                        const void *planes[3] = { 0, 0, 0 };
+                        int channels = bim::min<int>(image->i.samples, 3);
+                        for (int s = 0; s < channels; ++s)
+                            planes[s] = ((uchar *)image->bits[s]) + lineSizeBytes * cinfo.next_scanline;
+                        bim::interleave_row(row, 3, planes, channels, w, 8);
+                        row += w * 3;
+                    } // if 2 or more samples
                 } // if not gray
             } // 8 bits per sample
 
@@ -853,12 +808,16 @@ static int write_jpeg_image(FormatHandle *fmtHndl) {
 
         jpeg_finish_compress(&cinfo);
         jpeg_destroy_compress(&cinfo);
+    } else {
+        // libjpeg jumped here on an encoder or stream error
+        jpeg_destroy_compress(&cinfo);
+        res = 1;
     }
 
     delete iod_dest;
     delete row_pointer[0];
 
-    return 0;
+    return res;
 }
 
 
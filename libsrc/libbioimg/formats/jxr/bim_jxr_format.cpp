@@ -7,8 +7,9 @@
 
   History:
   2013-01-12 14:13:40 - First creation
+  2026-10-19 12:00:00 - Region, tile and reduced resolution reads
 
-  ver : 1
+  ver : 2
   *****************************************************************************/
 
 #include <cstdio>
@@ -42,6 +43,11 @@ using namespace bim;
 #define JXR_TAGS_EXIFGPS "raw/jxr_exif_gps"
 #define JXR_TYPES_EXIFGPS "binary,jxr_exif_gps"
 
+// the decoder scales down by 1/2 to 1/16 directly, those are advertised as virtual resolution levels
+#define BIM_JXR_NUM_LEVELS 5
+// virtual tile size used for tile requests, any region may be decoded
+#define BIM_JXR_TILE_SIZE 512
+
 //****************************************************************************
 // Misc
 //****************************************************************************
@@ -65,6 +71,7 @@ static ERR _jxr_io_Write(WMPStream* pWS, const void* pv, size_t cb) {
 
 static ERR _jxr_io_SetPos(WMPStream* pWS, size_t offPos) {
     bim::JXRParams *par = (bim::JXRParams*) pWS->state.pvObj;
+    par->file->clear(); // the decoder reads ahead past the end of the stream, allow seeking back
     par->file->seekg(offPos, std::fstream::beg);
     return (par->file->rdstate() & std::ifstream::badbit) == 0 ? WMP_errSuccess : WMP_errFileIO;
 }
@@ -100,6 +107,7 @@ bim::JXRParams::JXRParams() {
     pDecoder = NULL;
     pEncoder = NULL;
     frames_written = 0;
+    decoded = false;
 }
 
 bim::JXRParams::~JXRParams() {
@@ -308,6 +316,7 @@ static ERR ReadMetadata(bim::JXRParams *par) {
         if (currentPos) stream->SetPos(stream, currentPos);
         return error_code;
     }
+    return error_code;
 }
 
 void jxrGetImageInfo(FormatHandle *fmtHndl) {
@@ -406,6 +415,17 @@ void jxrGetImageInfo(FormatHandle *fmtHndl) {
     else
         info->number_dims = 2;
 
+    // reduced resolutions and regions are decoded directly in the stored orientation,
+    // the decoder can't produce reduced resolutions of sub-sampled chroma
+    info->number_levels = 1;
+    if (par->pDecoder->WMP.wmiI.oOrientation == O_NONE) {
+        info->tileWidth = BIM_JXR_TILE_SIZE;
+        info->tileHeight = BIM_JXR_TILE_SIZE;
+        bool subsampled = pixelInfo.cfColorFormat == YUV_420 || pixelInfo.cfColorFormat == YUV_422;
+        while (!subsampled && info->number_levels < BIM_JXR_NUM_LEVELS && (bim::min<bim::uint64>(info->width, info->height) >> info->number_levels) > 0)
+            ++info->number_levels;
+    }
+
     // have to read metadata before reading image pixels and rewind the stream
     error_code = ReadMetadata(par);
     JXR_CHECK(error_code);
@@ -499,6 +519,16 @@ bim::uint jxr_append_metadata(FormatHandle *fmtHndl, TagMap *hash) {
     
     jxr_create_proper_exif(fmtHndl, hash); // parse and write proper EXIF block
 
+    // virtual resolution levels decoded directly by the codec
+    if (par->i.number_levels > 1) {
+        std::vector<double> scales;
+        for (bim::uint l = 0; l < par->i.number_levels; ++l)
+            scales.push_back(1.0 / (double)((bim::uint64)1 << l));
+        hash->set_value(bim::IMAGE_NUM_RES_L, (int)par->i.number_levels);
+        hash->set_value(bim::IMAGE_RES_L_SCALES, xstring::join(scales, ","));
+        hash->set_value(bim::IMAGE_RES_STRUCTURE, bim::IMAGE_RES_STRUCTURE_HIERARCHICAL);
+    }
+
     // these blocks contain improper offsets and probably not really suitable for writing back directly
     /*if (par->buffer_exif.size()>0)
         hash->set_value(JXR_TAGS_EXIF, par->buffer_exif, JXR_TYPES_EXIF);
@@ -597,24 +627,55 @@ bool getOutputPixelFormat(const PKPixelFormatGUID &guid_format_in, PKPixelFormat
     return false;
 }
 
-bim::uint jxrReadImageProc(FormatHandle *fmtHndl, bim::uint page) {
+// size of a virtual resolution level, same rounding as the decoder's thumbnail size
+inline bim::uint64 jxr_level_size(bim::uint64 v, bim::uint level) {
+    bim::uint64 scale = (bim::uint64)1 << level;
+    return (v + scale - 1) / scale;
+}
+
+// decodes the region x,y,w,h of a resolution level, the decoder only decodes macroblocks
+// intersecting the region and produces reduced levels without decoding the full resolution
+bim::uint jxr_read_region(FormatHandle *fmtHndl, bim::uint page, bim::uint64 x, bim::uint64 y, bim::uint64 w, bim::uint64 h, bim::uint level) {
     if (fmtHndl == NULL) return 1;
+    if (fmtHndl->internalParams == NULL) return 1;
     fmtHndl->pageNumber = page;
     bim::JXRParams *par = (bim::JXRParams *) fmtHndl->internalParams;
     ERR error_code = 0;
 
-    error_code = par->pDecoder->SelectFrame(par->pDecoder, page);
-    JXR_CHECK(error_code);
-    jxrGetImageInfo(fmtHndl);
-
     ImageBitmap *bmp = fmtHndl->image;
     ImageInfo *info = &par->i;
-
     PKFormatConverter *pConverter = NULL;
     unsigned char *pb = NULL;
-    const PKRect rect = { 0, 0, (I32)info->width, (I32)info->height };
-   
+
     try {
+        // start every decode from a freshly initialized decoder
+        if (par->decoded) {
+            par->pDecoder->Release(&par->pDecoder);
+            par->pDecoder = NULL;
+            error_code = par->pStream->SetPos(par->pStream, 0);
+            JXR_CHECK(error_code);
+        }
+        par->decoded = true;
+        jxrGetImageInfo(fmtHndl);
+        error_code = par->pDecoder->SelectFrame(par->pDecoder, page);
+        JXR_CHECK(error_code);
+        if (level >= info->number_levels) return 1;
+
+        // regions are only decoded in the stored orientation, otherwise the whole image is decoded
+        CWMImageInfo *wmi = &par->pDecoder->WMP.wmiI;
+        bool full = x == 0 && y == 0 && w == info->width && h == info->height && level == 0;
+        if (wmi->oOrientation != O_NONE && !full) return 1;
+        if (w == 0 || h == 0 || x + w > jxr_level_size(info->width, level) || y + h > jxr_level_size(info->height, level)) return 1;
+
+        wmi->cThumbnailWidth = jxr_level_size(wmi->cWidth, level);
+        wmi->cThumbnailHeight = jxr_level_size(wmi->cHeight, level);
+        wmi->bSkipFlexbits = FALSE;
+        wmi->cROILeftX = full ? 0 : x;
+        wmi->cROITopY = full ? 0 : y;
+        wmi->cROIWidth = full ? 0 : w;
+        wmi->cROIHeight = full ? 0 : h;
+        const PKRect rect = { 0, 0, (I32)w, (I32)h };
+
         PKPixelFormatGUID guid_format_in;
         error_code = par->pDecoder->GetPixelFormat(par->pDecoder, &guid_format_in);
         JXR_CHECK(error_code);
@@ -623,7 +684,10 @@ bim::uint jxrReadImageProc(FormatHandle *fmtHndl, bim::uint page) {
         bool needs_conversion = getOutputPixelFormat(guid_format_in, guid_format_out, info);
 
         // allocate output image
-        if (allocImg(fmtHndl, info, bmp) != 0) return 1;
+        ImageInfo region_info = *info;
+        region_info.width = w;
+        region_info.height = h;
+        if (allocImg(fmtHndl, &region_info, bmp) != 0) return 1;
         const unsigned stride = getLineSizeInBytes(bmp) * info->samples;
 
         if (!needs_conversion && info->samples == 1) {
@@ -634,14 +698,7 @@ bim::uint jxrReadImageProc(FormatHandle *fmtHndl, bim::uint page) {
             std::vector<unsigned char> buffer(buf_sz, 0);
             error_code = par->pDecoder->Copy(par->pDecoder, &rect, (U8*)&buffer[0], stride);
             JXR_CHECK(error_code);
-            for (int s = 0; s < info->samples; ++s) {
-                if (info->depth == 8)
-                    copy_sample_interleaved_to_planar<bim::uint8>(info->width, info->height, info->samples, s, &buffer[0], bmp->bits[s]);
-                else if (info->depth == 16)
-                    copy_sample_interleaved_to_planar<bim::uint16>(info->width, info->height, info->samples, s, &buffer[0], bmp->bits[s]);
-                else if (info->depth == 32)
-                    copy_sample_interleaved_to_planar<bim::uint32>(info->width, info->height, info->samples, s, &buffer[0], bmp->bits[s]);
-            } // for sample
+            bim::deinterleave(bmp->bits, info->samples, &buffer[0], info->samples, w, h, info->depth);
         } else { // we need to use the conversion API for complex types
             // allocate the pixel format converter
             error_code = PKCodecFactory_CreateFormatConverter(&pConverter);
@@ -665,27 +722,20 @@ bim::uint jxrReadImageProc(FormatHandle *fmtHndl, bim::uint page) {
                 error_code = PixelFormatLookup(&pPITo, LOOKUP_FORWARD);
                 JXR_CHECK(error_code);
 
-                unsigned int stride_from = ((pPIFrom.cbitUnit + 7) >> 3) * info->width;
-                unsigned int stride_to = ((pPITo.cbitUnit + 7) >> 3) * info->width;
+                unsigned int stride_from = ((pPIFrom.cbitUnit + 7) >> 3) * w;
+                unsigned int stride_to = ((pPITo.cbitUnit + 7) >> 3) * w;
                 stride = bim::max<unsigned int>(stride_from, stride_to);
             }
 
             // allocate a local decoder / encoder buffer
-            error_code = PKAllocAligned((void **)&pb, stride * info->height, 128);
+            error_code = PKAllocAligned((void **)&pb, stride * h, 128);
             JXR_CHECK(error_code);
 
             // copy / convert pixels
             error_code = pConverter->Copy(pConverter, &rect, pb, stride);
             JXR_CHECK(error_code);
 
-            for (int s = 0; s < info->samples; ++s) {
-                if (info->depth == 8)
-                    copy_sample_interleaved_to_planar<bim::uint8>(info->width, info->height, info->samples, s, pb, bmp->bits[s], stride);
-                else if (info->depth == 16)
-                    copy_sample_interleaved_to_planar<bim::uint16>(info->width, info->height, info->samples, s, pb, bmp->bits[s], stride);
-                else if (info->depth == 32)
-                    copy_sample_interleaved_to_planar<bim::uint32>(info->width, info->height, info->samples, s, pb, bmp->bits[s], stride);
-            } // for sample
+            bim::deinterleave(bmp->bits, info->samples, pb, info->samples, w, h, info->depth, stride);
 
             PKFreeAligned((void **)&pb);
             PKFormatConverter_Release(&pConverter);
@@ -699,6 +749,64 @@ bim::uint jxrReadImageProc(FormatHandle *fmtHndl, bim::uint page) {
     return 0;
 }
 
+bim::uint jxrReadImageProc(FormatHandle *fmtHndl, bim::uint page) {
+    if (fmtHndl == NULL) return 1;
+    if (fmtHndl->internalParams == NULL) return 1;
+    bim::JXRParams *par = (bim::JXRParams *) fmtHndl->internalParams;
+    return jxr_read_region(fmtHndl, page, 0, 0, par->i.width, par->i.height, 0);
+}
+
+bim::uint jxrReadImageLevelProc(FormatHandle *fmtHndl, bim::uint page, bim::uint level) {
+    if (fmtHndl == NULL) return 1;
+    if (fmtHndl->internalParams == NULL) return 1;
+    bim::JXRParams *par = (bim::JXRParams *) fmtHndl->internalParams;
+    return jxr_read_region(fmtHndl, page, 0, 0, jxr_level_size(par->i.width, level), jxr_level_size(par->i.height, level), level);
+}
+
+bim::uint jxrReadImageTileProc(FormatHandle *fmtHndl, bim::uint page, bim::uint64 xid, bim::uint64 yid, bim::uint level) {
+    if (fmtHndl == NULL) return 1;
+    if (fmtHndl->internalParams == NULL) return 1;
+    bim::JXRParams *par = (bim::JXRParams *) fmtHndl->internalParams;
+
+    // tile sizes may be smaller at the border
+    bim::uint64 width = jxr_level_size(par->i.width, level);
+    bim::uint64 height = jxr_level_size(par->i.height, level);
+    bim::uint64 x = xid * BIM_JXR_TILE_SIZE;
+    bim::uint64 y = yid * BIM_JXR_TILE_SIZE;
+    if (x >= width || y >= height) return 1;
+    bim::uint64 w = bim::min<bim::uint64>(BIM_JXR_TILE_SIZE, width - x);
+    bim::uint64 h = bim::min<bim::uint64>(BIM_JXR_TILE_SIZE, height - y);
+    return jxr_read_region(fmtHndl, page, x, y, w, h, level);
+}
+
+bim::uint jxrReadImageRegionProc(FormatHandle *fmtHndl, bim::uint page, bim::uint64 x1, bim::uint64 y1, bim::uint64 x2, bim::uint64 y2, bim::uint level) {
+    if (fmtHndl == NULL) return 1;
+    if (fmtHndl->internalParams == NULL) return 1;
+    bim::JXRParams *par = (bim::JXRParams *) fmtHndl->internalParams;
+
+    // regions are clipped to the level size
+    bim::uint64 width = jxr_level_size(par->i.width, level);
+    bim::uint64 height = jxr_level_size(par->i.height, level);
+    if (x1 > x2 || y1 > y2 || x1 >= width || y1 >= height) return 1;
+    x2 = bim::min<bim::uint64>(x2, width - 1);
+    y2 = bim::min<bim::uint64>(y2, height - 1);
+    return jxr_read_region(fmtHndl, page, x1, y1, x2 - x1 + 1, y2 - y1 + 1, level);
+}
+
+// decodes the first page at the smallest resolution level still covering w x h,
+// the caller is responsible for the final resize
+bim::uint jxrReadImageThumbProc(FormatHandle *fmtHndl, bim::uint w, bim::uint h) {
+    if (fmtHndl == NULL) return 1;
+    if (fmtHndl->internalParams == NULL) return 1;
+    bim::JXRParams *par = (bim::JXRParams *) fmtHndl->internalParams;
+
+    bim::uint level = 0;
+    while (level + 1 < par->i.number_levels && 
+           jxr_level_size(par->i.width, level + 1) >= w && jxr_level_size(par->i.height, level + 1) >= h)
+        ++level;
+    return jxrReadImageLevelProc(fmtHndl, 0, level);
+}
+
 //----------------------------------------------------------------------------
 // WRITE
 //----------------------------------------------------------------------------
@@ -1073,14 +1181,7 @@ bim::uint jxrWriteImageProc(FormatHandle *fmtHndl) {
         std::vector<unsigned char> buffer(plane_sz);
         if (buffer.size() < plane_sz) return 1;
 
-        for (int s = 0; s<info->samples; ++s) {
-            if (info->depth == 8)
-                copy_sample_planar_to_interleaved<bim::uint8>(info->width, info->height, info->samples, s, bmp->bits[s], &buffer[0]);
-            else if (info->depth == 16)
-                copy_sample_planar_to_interleaved<bim::uint16>(info->width, info->height, info->samples, s, bmp->bits[s], &buffer[0]);
-            else if (info->depth == 32)
-                copy_sample_planar_to_interleaved<bim::uint32>(info->width, info->height, info->samples, s, bmp->bits[s], &buffer[0]);
-        } // for sample
+        bim::interleave(&buffer[0], info->samples, bmp->bits, info->samples, info->width, info->height, info->depth);
         
         error_code = par->pEncoder->WritePixels(par->pEncoder, info->height, &buffer[0], stride);
         JXR_CHECK(error_code);
@@ -1148,11 +1249,11 @@ FormatHeader jxrHeader = {
     // read/write
     jxrReadImageProc, //ReadImageProc 
     jxrWriteImageProc, //WriteImageProc
-    NULL, //ReadImageTileProc
+    jxrReadImageTileProc, //ReadImageTileProc
     NULL, //WriteImageTileProc
-    NULL, //ReadImageLineProc
-    NULL, //WriteImageLineProc
-    NULL, //ReadImageThumbProc
+    jxrReadImageLevelProc, //ReadImageLevelProc
+    NULL, //WriteImageLevelProc
+    jxrReadImageThumbProc, //ReadImageThumbProc
     NULL, //WriteImageThumbProc
     NULL, //dimJpegReadImagePreviewProc, //ReadImagePreviewProc
 
@@ -1162,7 +1263,7 @@ FormatHeader jxrHeader = {
     NULL, //ReadMetaDataAsTextProc
     jxr_append_metadata, //AppendMetaDataProc
 
-    NULL,
+    jxrReadImageRegionProc, //ReadImageRegionProc
     NULL,
     ""
 
@@ -7,8 +7,9 @@
 
   History:
   2013-01-12 14:13:40 - First creation
+  2026-10-19 12:00:00 - Region, tile and reduced resolution reads
 
-  ver : 1
+  ver : 2
   *****************************************************************************/
 
 #ifndef BIM_JXR_FORMAT_H
@@ -48,6 +49,7 @@ namespace bim {
         PKImageDecode *pDecoder;
         PKImageEncode *pEncoder;
         int frames_written;
+        bool decoded; // the decoder modifies its state while decoding and has to be recreated
         
         std::vector<char> buffer_icc;
         std::vector<char> buffer_xmp;
@@ -19,8 +19,9 @@
   History:
     03/23/2004 18:03 - First creation
     01/25/2007 21:00 - added QImaging TIFF
+    10/19/2026 12:00 - wall-clock timing of metadata parsing
       
-  ver: 3
+  ver: 4
         
 
 *******************************************************************************/
@@ -35,6 +36,7 @@
 
 #include <xtypes.h>
 #include <xstring.h>
+#include <xtiming.h>
 #include <bim_metatags.h>
 #include <bim_lcms_parse.h>
 
@@ -204,6 +206,7 @@ void MetaFormatManager::append_channel_names(const std::vector<std::string> &nam
 
 void MetaFormatManager::sessionParseMetaData(bim::uint page) {
     if (got_meta_for_session == page) return;
+    ScopedTimer timer("metadata");
 
     //channel_names.clear();
     display_lut.clear();
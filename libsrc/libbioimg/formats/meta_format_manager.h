@@ -19,8 +19,9 @@
   History:
     03/23/2004 18:03 - First creation
     01/25/2007 21:00 - added QImaging TIFF
+    10/19/2026 12:00 - writeImage returns the encoder result
 
-  ver: 2
+  ver: 3
 
 *******************************************************************************/
 
@@ -55,27 +56,27 @@ public:
   void sessionWriteSetMetadata( const TagMap &hash );
   void sessionWriteSetOMEXML( const std::string &omexml );
 
-  void writeImage(BIM_STREAM_CLASS *stream, ReadProc readProc, WriteProc writeProc, FlushProc flushProc,
+  int writeImage(BIM_STREAM_CLASS *stream, ReadProc readProc, WriteProc writeProc, FlushProc flushProc,
       SeekProc seekProc, SizeProc sizeProc, TellProc  tellProc,
       EofProc eofProc, CloseProc closeProc, const bim::Filename fileName,
       ImageBitmap *bmp, const char *formatName, int quality, TagMap *meta = NULL, const char *options = NULL) {
-      FormatManager::writeImage(stream, readProc,
+      return FormatManager::writeImage(stream, readProc,
           writeProc, flushProc, seekProc,
           sizeProc, tellProc, eofProc, closeProc,
           fileName, bmp, formatName, quality, meta == NULL ? &this->metadata : meta, options);
   }
 
-  void writeImage(const bim::Filename fileName, ImageBitmap *bmp, const char *formatName, int quality, TagMap *meta=NULL) {
-      writeImage(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, fileName, bmp, formatName, quality, meta);
+  int writeImage(const bim::Filename fileName, ImageBitmap *bmp, const char *formatName, int quality, TagMap *meta=NULL) {
+      return writeImage(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, fileName, bmp, formatName, quality, meta);
   }
   /*void writeImage(const bim::Filename fileName, ImageBitmap *bmp, const char *formatName, int quality) {
       writeImage(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, fileName, bmp, formatName, quality, NULL);
   }*/
-  void writeImage(const bim::Filename fileName, ImageBitmap *bmp, const char *formatName, const char *options = NULL, TagMap *meta=NULL) {
-      writeImage(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, fileName, bmp, formatName, 100, meta, options);
+  int writeImage(const bim::Filename fileName, ImageBitmap *bmp, const char *formatName, const char *options = NULL, TagMap *meta=NULL) {
+      return writeImage(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, fileName, bmp, formatName, 100, meta, options);
   }
-  void writeImage(const bim::Filename fileName, Image &img, const char *formatName, const char *options = NULL, TagMap *meta = NULL) {
-      writeImage(fileName, img.imageBitmap(), formatName, options, meta);
+  int writeImage(const bim::Filename fileName, Image &img, const char *formatName, const char *options = NULL, TagMap *meta = NULL) {
+      return writeImage(fileName, img.imageBitmap(), formatName, options, meta);
   }
 
   // META
@@ -20,6 +20,7 @@ Ver : 2
 #include <string>
 #include <set>
 #include <list>
+#include <vector>
 #include <utility>
 #include <algorithm>
 
@@ -27,6 +28,7 @@ Ver : 2
 #include "tag_map.h"
 #include <bim_metatags.h>
 #include <bim_exiv_parse.h>
+#include <bim_format_misc.h>
 
 // Disables Visual Studio 2005 warnings for deprecated code
 #if ( defined(_MSC_VER) && (_MSC_VER >= 1400) )
@@ -555,23 +557,13 @@ int read_ffmpeg_image(FormatHandle *fmtHndl) {
     const std::vector<unsigned char> *frame = par->ff_in.currBGR();
     const unsigned char *fbuf = &(*frame)[0];
 
-    if (frame->size() >= page_size)
-    for ( bim::uint c=0; c<info->samples; ++c ) {
-      const unsigned char *pI = fbuf + (info->samples-c-1);
-      unsigned char *pO = (unsigned char *) img->bits[c];
-
-      for ( int y=0; y<info->height; ++y ) {
-
-        xprogress( fmtHndl, y, info->height, "Reading Video" );
-        if ( xtestAbort( fmtHndl ) == 1) break;  
-
-        for ( unsigned long x=0; x<info->width; ++x ) {
-          *pO = *pI;
-          ++pO;
-          pI+=info->samples;
-        } // for x
-      } // for y
-    }// c
+    // frames are BGR, channels are stored in reverse order
+    if (frame->size() >= page_size) {
+      std::vector<int> order(info->samples);
+      for ( bim::uint c=0; c<info->samples; ++c ) 
+        order[c] = info->samples-c-1;
+      bim::deinterleave( img->bits, info->samples, fbuf, info->samples, info->width, info->height, 8, 0, &order[0] );
+    }
   } // if could seek to the page
 
   return 0;
@@ -643,24 +635,7 @@ int write_ffmpeg_image(FormatHandle *fmtHndl) {
 
   // write data into the raw frame
   int channels = std::min<int>( info->samples, 3 );
-  if (channels<3)
-    memset(fbuf, 0, info->width*info->height*3);
-  for ( int c=0; c<channels; ++c ) {
-    unsigned char *pI = fbuf + c;
-    unsigned char *pO = (unsigned char *) img->bits[c];
-
-    for ( int y=0; y<info->height; ++y ) {
-
-      xprogress( fmtHndl, y, info->height, "Writing video" );
-      if ( xtestAbort( fmtHndl ) == 1) break;  
-
-      for ( unsigned long x=0; x<info->width; ++x ) {
-        *pI = *pO;
-        ++pO;
-        pI+=3;
-      } // for x
-    } // for y
-  }// c
+  bim::interleave( fbuf, 3, img->bits, channels, info->width, info->height, 8 );
 
   try {
     par->ff_out.addFromRawFrame( (int) info->width, (int) info->height, 3 );
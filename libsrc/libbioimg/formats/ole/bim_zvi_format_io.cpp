@@ -9,8 +9,9 @@
 
   History:
     2010-08-26 17:13:22 - First creation
+    2026-10-19 12:00:00 - Read only requested channels
 
-  Ver : 1
+  Ver : 2
 *****************************************************************************/
 
 #include <cstring>
@@ -132,13 +133,13 @@ int zvi_read_image(FormatHandle *fmtHndl) {
   bim::zvi::Directory *zvi_dir = &par->zvi_dir;
 
   ImageBitmap *img = fmtHndl->image;
-  if ( allocImg( fmtHndl, &par->i, img) != 0 ) return 1;
+  if ( allocImgChannels( fmtHndl, &par->i, img) != 0 ) return 1;
 
   for (unsigned int sample=0; sample<img->i.samples; ++sample) {
     xprogress( fmtHndl, sample+1, img->i.samples, "Reading ZVI" );
     if ( xtestAbort( fmtHndl ) == 1) break;  
 
-    int c=sample, z=0, t=0;
+    int c=requestedChannel(fmtHndl, sample), z=0, t=0;
     get_z_t( zvi_dir, fmtHndl->pageNumber, sample, z, t );
     if (!zvi_dir->readImagePixels( c, z, t, getImgSizeInBytes(img), (unsigned char *) img->bits[sample] )) return 1;
   }  // for sample
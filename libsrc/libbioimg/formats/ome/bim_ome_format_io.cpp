@@ -12,8 +12,9 @@
 
   History:
     11/21/2005 15:43 - First creation
+    10/19/2026 12:00 - Report errors writing pixels
             
-  Ver : 1
+  Ver : 2
 *****************************************************************************/
 
 #include <string>
@@ -156,7 +157,7 @@ static int write_ome_image(FormatHandle *fmtHndl)
   for (unsigned int sample=0; sample<img->i.samples; ++sample) {
     // now write pixels
     std::string str = "      <Bin:BinData Compression=\"none\">";
-    xwrite( fmtHndl, (void*) str.c_str(), 1, str.size() );  
+    if (xwrite( fmtHndl, (void*) str.c_str(), 1, str.size() ) != str.size()) return 1;
 
     // now dump base64 bits
     uchar *p = (uchar *) img->bits[sample];
@@ -166,13 +167,13 @@ static int write_ome_image(FormatHandle *fmtHndl)
     while (size_left>0)
     {
       b64_encodeblock( p, ascii_quatro, size_left );
-      xwrite( fmtHndl, (void*) ascii_quatro, 1, 4 );
+      if (xwrite( fmtHndl, (void*) ascii_quatro, 1, 4 ) != 4) return 1;
       p+=3;
       size_left-=3;
     }
 
     str = "</Bin:BinData>\n";
-    xwrite( fmtHndl, (void*) str.c_str(), 1, str.size() ); 
+    if (xwrite( fmtHndl, (void*) str.c_str(), 1, str.size() ) != str.size()) return 1;
   }
 
   return 0;
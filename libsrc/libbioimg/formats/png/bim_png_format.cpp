@@ -26,6 +26,7 @@
 #include <bim_metatags.h>
 #include <bim_exiv_parse.h>
 #include <bim_lcms_parse.h>
+#include <bim_format_misc.h>
 
 using namespace bim;
 
@@ -330,92 +331,35 @@ static int read_png_image(FormatHandle *fmtHndl)
   }
   else
   { // multi samples (channels)
-    unsigned char *buf = new unsigned char [ bpl * img->i.samples ];
-    
-    if (num_passes == 0)
-    { // faster code in the case of non interlaced image
+    bim::uint64 row_size = (bim::uint64) bpl * img->i.samples;
+    void *planes[BIM_MAX_CHANNELS];
 
+    if (num_passes <= 1)
+    { // non interlaced images are split into channels row by row
+      unsigned char *buf = new unsigned char [ row_size ];
       while ( y < h ) 
       {
-        png_bytep pbuf = buf;
-        png_read_row( par->png_ptr, pbuf, NULL ); 
-
-        if ( img->i.samples == 3 )
-        {
-          unsigned long x = 0;
-          uchar *p0 = ((unsigned char *) img->bits[0]) + ( y * bpl );
-          uchar *p1 = ((unsigned char *) img->bits[1]) + ( y * bpl );
-          uchar *p2 = ((unsigned char *) img->bits[2]) + ( y * bpl );
-          for ( x=0; x<bpl*3; x+=3 )
-          {
-            *p0 = buf[x+0]; p0++; // R
-            *p1 = buf[x+1]; p1++; // G
-            *p2 = buf[x+2]; p2++; // B
-          }
-        }
-
-        if ( img->i.samples == 4 )
-        {
-          unsigned long x = 0;
-          uchar *p0 = ((unsigned char *) img->bits[0]) + ( y * bpl );
-          uchar *p1 = ((unsigned char *) img->bits[1]) + ( y * bpl );
-          uchar *p2 = ((unsigned char *) img->bits[2]) + ( y * bpl );
-          uchar *p3 = ((unsigned char *) img->bits[3]) + ( y * bpl );
-          for ( x=0; x<bpl*4; x+=4 )
-          {
-            *p0 = buf[x+0]; p0++; // R          
-            *p1 = buf[x+1]; p1++; // G
-            *p2 = buf[x+2]; p2++; // B
-            *p3 = buf[x+3]; p3++; // A
-          }
-        }
-
+        png_read_row( par->png_ptr, buf, NULL ); 
+        for ( unsigned int sample=0; sample<img->i.samples; ++sample )
+          planes[sample] = ((unsigned char *) img->bits[sample]) + ( y * bpl );
+        bim::deinterleave_row( planes, img->i.samples, buf, img->i.samples, info->width, info->depth );
         y++;
       } // while
+      delete [] buf;
     }
     else
-    {  // slower code which handles interlaced images
-      for ( unsigned int sample=0; sample<img->i.samples; ++sample )
-        memset( img->bits[sample], 0, bpl * h );
-
+    { // interlaced passes only fill their own pixels, rows must persist over all passes
+      unsigned char *buf = new unsigned char [ row_size * h ];
+      memset( buf, 0, row_size * h );
       for ( pass=0; pass<num_passes; pass++ ) {    
-        while ( y < h ) {
-          png_bytep pbuf = buf;
-          memset( buf, 0, bpl * img->i.samples );
-          png_read_row( par->png_ptr, pbuf, NULL ); 
-
-          if ( img->i.samples == 3 ) {
-            unsigned long x = 0;
-            uchar *p0 = ((unsigned char *) img->bits[0]) + ( y * bpl );
-            uchar *p1 = ((unsigned char *) img->bits[1]) + ( y * bpl );
-            uchar *p2 = ((unsigned char *) img->bits[2]) + ( y * bpl );
-            for ( x=0; x<bpl*3; x+=3 ) {
-              if (buf[x+0] != 0) *p0 = buf[x+0]; p0++; // R
-              if (buf[x+1] != 0) *p1 = buf[x+1]; p1++; // G
-              if (buf[x+2] != 0) *p2 = buf[x+2]; p2++; // B
-            }
-          }
-
-          if ( img->i.samples == 4 ) {
-            unsigned long x = 0;
-            uchar *p0 = ((unsigned char *) img->bits[0]) + ( y * bpl );
-            uchar *p1 = ((unsigned char *) img->bits[1]) + ( y * bpl );
-            uchar *p2 = ((unsigned char *) img->bits[2]) + ( y * bpl );
-            uchar *p3 = ((unsigned char *) img->bits[3]) + ( y * bpl );
-            for ( x=0; x<bpl*4; x+=4 ) {
-              *p0 = buf[x+0]; p0++; // R          
-              *p1 = buf[x+1]; p1++; // G
-              *p2 = buf[x+2]; p2++; // B
-              *p3 = buf[x+3]; p3++; // A
-            }
-          }
-
-          y++;
-        } // while
-        y = 0;
+        for ( y=0; y<h; ++y )
+          png_read_row( par->png_ptr, buf + y*row_size, NULL ); 
       } // interlace passes
+      for ( unsigned int sample=0; sample<img->i.samples; ++sample )
+        planes[sample] = img->bits[sample];
+      bim::deinterleave( planes, img->i.samples, buf, img->i.samples, info->width, h, info->depth );
+      delete [] buf;
     } // interlaced code
-    delete [] buf;
   }
 
   png_read_end( par->png_ptr, par->end_info );
@@ -469,46 +413,13 @@ void png_write_metadata(bim::PngParams *par, TagMap *hash) {
     png_set_text( par->png_ptr, par->info_ptr, &m[0], m.size() );*/
 }
 
-template <typename T>
-void write_png_buff ( ImageBitmap *img, T *buf, int y ) {
-  
+void write_png_buff ( ImageBitmap *img, unsigned char *buf, int y, int samples ) {
   unsigned int bpl = getLineSizeInBytes( img );  
-  unsigned long x = 0;
-  unsigned int w = (unsigned int) img->i.width;
-
-  if ( img->i.samples == 2 ) {
-    T *p0 = (T*) ( ((unsigned char *) img->bits[0]) + ( y * bpl ) );
-    T *p1 = (T*) ( ((unsigned char *) img->bits[1]) + ( y * bpl ) );
-    for ( x=0; x<w*3; x+=3 ) {
-      buf[x+0] = *p0; p0++; // 1          
-      buf[x+1] = *p1; p1++; // 2
-      buf[x+2] = 0; // B
-    }
-  } // if 2 channels
-
-  if ( img->i.samples == 3 ) {
-    T *p0 = (T*) ( ((unsigned char *) img->bits[0]) + ( y * bpl ) );
-    T *p1 = (T*) ( ((unsigned char *) img->bits[1]) + ( y * bpl ) );
-    T *p2 = (T*) ( ((unsigned char *) img->bits[2]) + ( y * bpl ) );
-    for ( x=0; x<w*3; x+=3 ) {
-      buf[x+0] = *p0; p0++; // R          
-      buf[x+1] = *p1; p1++; // G
-      buf[x+2] = *p2; p2++; // B
-    }
-  } // if 3 channels
-
-  if ( img->i.samples == 4 ) {
-    T *p0 = (T*) ( ((unsigned char *) img->bits[0]) + ( y * bpl ) );
-    T *p1 = (T*) ( ((unsigned char *) img->bits[1]) + ( y * bpl ) );
-    T *p2 = (T*) ( ((unsigned char *) img->bits[2]) + ( y * bpl ) );
-    T *p3 = (T*) ( ((unsigned char *) img->bits[3]) + ( y * bpl ) );
-    for ( x=0; x<w*4; x+=4 ) {
-      buf[x+0] = *p0; p0++; // R          
-      buf[x+1] = *p1; p1++; // G
-      buf[x+2] = *p2; p2++; // B
-      buf[x+3] = *p3; p3++; // A
-    }
-  } // if 4 chanels
+  const void *planes[4] = { 0, 0, 0, 0 };
+  int channels = bim::min<int>( img->i.samples, samples );
+  for ( int sample=0; sample<channels; ++sample )
+    planes[sample] = ((unsigned char *) img->bits[sample]) + ( y * bpl );
+  bim::interleave_row( buf, samples, planes, channels, img->i.width, img->i.depth );
 }
 
 static int write_png_image(FormatHandle *fmtHndl)
@@ -588,11 +499,7 @@ static int write_png_image(FormatHandle *fmtHndl)
     while ( y < h ) {
       png_bytep pbuf = buf;
 
-      if (info->depth == 8)
-        write_png_buff<uchar> ( img, (uchar *) buf, y );
-      
-      if (info->depth == 16)
-        write_png_buff<uint16> ( img, (uint16 *) buf, y );
+      write_png_buff ( img, buf, y, ch );
 
       png_write_row( par->png_ptr, pbuf );
 
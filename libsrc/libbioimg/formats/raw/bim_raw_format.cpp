@@ -9,8 +9,9 @@
   History:
   12/01/2005 15:27 - First creation
   2007-07-12 21:01 - reading raw
+  2026-10-19 12:00 - header writers report success
 
-  Ver : 2
+  Ver : 3
 
   *****************************************************************************/
 
@@ -762,6 +763,7 @@ const int mhdWriteImageHeader(FormatHandle *fmtHndl) {
 
     if (xwrite(fmtHndl, (void *)header.c_str(), 1, header.size()) != header.size()) return 1;
     xflush(fmtHndl);
+    return 0;
 }
 
 //----------------------------------------------------------------------------
@@ -813,6 +815,7 @@ const int nrrdWriteImageHeader(FormatHandle *fmtHndl) {
 
     if (xwrite(fmtHndl, (void *)header.c_str(), 1, header.size()) != header.size()) return 1;
     xflush(fmtHndl);
+    return 0;
 }
 
 //----------------------------------------------------------------------------
@@ -903,7 +906,7 @@ bim::uint rawWriteImageProc(FormatHandle *fmtHndl) {
         return mhdWriteImageHeader(fmtHndl);
 
     if (fmtHndl->subFormat == BIM_RAW_FORMAT_NRRD && fmtHndl->pageNumber == 0)
-        nrrdWriteImageHeader(fmtHndl);
+        if (nrrdWriteImageHeader(fmtHndl) != 0) return 1;
 
     return write_raw_image(fmtHndl);
 }
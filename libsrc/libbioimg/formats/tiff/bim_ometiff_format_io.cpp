@@ -6,8 +6,9 @@
     
   History:
     2009-07-09 12:01 - First creation
+    2026-10-19 12:00 - Read only requested channels
 
-  Ver : 1
+  Ver : 2
 *****************************************************************************/
 
 #include <cstdio>
@@ -291,7 +292,15 @@ bim::uint64 computeTiffDirectoryNoChannels( bim::FormatHandle *fmtHndl, int page
   return dirNum;
 }
 
+int read_tiff_blocks(TIFF *tif, bim::ImageBitmap *img, bim::FormatHandle *fmtHndl, int channel);
+
 bool ometiff_read_striped(TIFF *tif, bim::ImageBitmap *img, bim::FormatHandle *fmtHndl, const unsigned int &sample) {
+    // old-style JPEG streams are only safely decoded sequentially
+    bim::uint16 compression = COMPRESSION_NONE;
+    TIFFGetField(tif, TIFFTAG_COMPRESSION, &compression);
+    if (compression != COMPRESSION_OJPEG)
+        return read_tiff_blocks(tif, img, fmtHndl, sample) == 0;
+
     bim::uint lineSize = getLineSizeInBytes(img);
     bim::uchar *p = (bim::uchar *) img->bits[sample];
     for (register bim::uint64 y = 0; y < img->i.height; y++) {
@@ -305,31 +314,7 @@ bool ometiff_read_striped(TIFF *tif, bim::ImageBitmap *img, bim::FormatHandle *f
 
 bool ometiff_read_tiled(TIFF *tif, bim::ImageBitmap *img, bim::FormatHandle *fmtHndl, const int &sample) {
     if (!tif || !img) return false;
-
-    bim::uint lineSize = getLineSizeInBytes(img);
-    bim::uint bpp = ceil((double)img->i.depth / 8.0);
-    bim::uint32 columns, rows;
-    TIFFGetField(tif, TIFFTAG_TILEWIDTH, &columns);
-    TIFFGetField(tif, TIFFTAG_TILELENGTH, &rows);
-
-    std::vector<bim::uchar> buffer(TIFFTileSize(tif));
-    bim::uchar *buf = &buffer[0];
-
-    for (bim::uint y = 0; y<img->i.height; y += rows) {
-        xprogress(fmtHndl, y, img->i.height, "Reading TIFF");
-        if (xtestAbort(fmtHndl) == 1) return false;
-
-        bim::uint tile_height = (img->i.height - y >= rows) ? rows : (bim::uint) img->i.height - y;
-        for (bim::uint x = 0; x<(bim::uint)img->i.width; x += columns) {
-            bim::uint tile_width = (img->i.width - x < columns) ? (bim::uint) img->i.width - x : (bim::uint) columns;
-            if (TIFFReadTile(tif, buf, x, y, 0, 0) < 0) return false;
-            for (bim::uint yi = 0; yi < tile_height; yi++) {
-                bim::uchar *p = (bim::uchar *) img->bits[sample] + (lineSize * (y + yi));
-                _TIFFmemcpy(p + (x*bpp), buf + (yi*columns*bpp), tile_width*bpp);
-            }
-        } // for x
-    } // for y
-    return true;
+    return read_tiff_blocks(tif, img, fmtHndl, sample) == 0;
 }
 
 
@@ -370,7 +355,8 @@ bim::uint omeTiffReadPlane( bim::FormatHandle *fmtHndl, bim::TiffParams *par, in
     return 2;
   }
 
-  if (img->i.depth != bitspersample || img->i.width != width || img->i.height != height) {
+  if (channelsRequested(fmtHndl) || img->i.samples != info->samples ||
+      img->i.depth != bitspersample || img->i.width != width || img->i.height != height) {
       //info->samples = ome->ch;
       info->depth = bitspersample;
       info->width = width;
@@ -381,15 +367,15 @@ bim::uint omeTiffReadPlane( bim::FormatHandle *fmtHndl, bim::TiffParams *par, in
       else if (sampleformat == SAMPLEFORMAT_IEEEFP)
           info->pixelType = bim::FMT_FLOAT;
 
-      if (allocImg(fmtHndl, info, img) != 0) return 1;
+      if (allocImgChannels(fmtHndl, info, img) != 0) return 1;
   }
 
 
   //--------------------------------------------------------------------
-  // read data
+  // read data, each channel is stored in its own IFD so unrequested ones are never touched
   //--------------------------------------------------------------------
-  for (unsigned int sample = 0; sample < (unsigned int)info->samples; ++sample) {
-      tiff_page = computeTiffDirectory(fmtHndl, fmtHndl->pageNumber, sample);
+  for (unsigned int sample = 0; sample < (unsigned int)img->i.samples; ++sample) {
+      tiff_page = computeTiffDirectory(fmtHndl, fmtHndl->pageNumber, requestedChannel(fmtHndl, sample));
       TIFFSetDirectory(tif, (bim::uint16) tiff_page);
       if (!TIFFIsTiled(tif)) {
           if (!ometiff_read_striped(tif, img, fmtHndl, sample)) return 1;
@@ -9,8 +9,10 @@
   History:
     03/29/2004 22:23 - First creation
     01/23/2007 20:42 - fixes in warning reporting
+    10/19/2026 12:00 - tile by tile writing
+    10/19/2026 12:00 - close per thread decoding handles
         
-  Ver : 4
+  Ver : 6
 *****************************************************************************/
 
 #include <cstdio>
@@ -38,6 +40,8 @@ char* read_text_tiff_metadata ( FormatHandle *fmtHndl, TiffParams *tifParams );
 bim::uint tiff_append_metadata (FormatHandle *fmtHndl, TagMap *hash );
 int read_tiff_image(FormatHandle *fmtHndl, TiffParams *tifParams);
 int write_tiff_image(FormatHandle *fmtHndl, TiffParams *tifParams, ImageBitmap *img = NULL, bool subscale = false);
+int write_tiff_image_tile(FormatHandle *fmtHndl, TiffParams *tifParams, bim::uint page, bim::uint64 xid, bim::uint64 yid, bim::uint level);
+int finish_tiff_image_tiles(FormatHandle *fmtHndl, TiffParams *tifParams);
 
 int read_tiff_image_level(FormatHandle *fmtHndl, TiffParams *tifParams, bim::uint page, bim::uint level);
 int read_tiff_image_tile(FormatHandle *fmtHndl, TiffParams *tifParams, bim::uint page, bim::uint64 xid, bim::uint64 yid, bim::uint level);
@@ -74,6 +78,7 @@ TiffParams::TiffParams() {
   this->info = initImageInfo();
   this->tiff = NULL;
   this->subType = tstGeneric;
+  this->tileStream = NULL;
 }
 
 // ----------------------------------------------------
@@ -625,10 +630,17 @@ void tiffCloseImageProc (FormatHandle *fmtHndl) {
   TiffParams *par = (TiffParams *) fmtHndl->internalParams;
 
   if ( (par != NULL) && (par->tiff != NULL) ) {
+    finish_tiff_image_tiles( fmtHndl, par );
     XTIFFClose( par->tiff );
     par->tiff = NULL;
   }
 
+  if (par != NULL) {
+    for (size_t i=0; i<par->decoders.size(); ++i)
+      if (par->decoders[i]) XTIFFClose( par->decoders[i] );
+    par->decoders.clear();
+  }
+
   // close stream handle
   if ( fmtHndl->stream && !isCustomReading(fmtHndl) ) xclose( fmtHndl );
 
@@ -783,6 +795,14 @@ bim::uint tiffWriteImageProc ( FormatHandle *fmtHndl ) {
   return write_tiff_image(fmtHndl, par); //, fmtHndl->image);
 }
 
+bim::uint tiffWriteImageTileProc(FormatHandle *fmtHndl, bim::uint page, bim::uint64 xid, bim::uint64 yid, bim::uint level) {
+    if (fmtHndl == NULL) return 1;
+    if (fmtHndl->internalParams == NULL) return 1;
+    TiffParams *par = (TiffParams *)fmtHndl->internalParams;
+    if (par->tiff == NULL || fmtHndl->io_mode != IO_WRITE) return 1;
+    return write_tiff_image_tile(fmtHndl, par, page, xid, yid, level);
+}
+
 bim::uint tiffReadImageLevelProc(FormatHandle *fmtHndl, bim::uint page, bim::uint level) {
     if (fmtHndl == NULL) return 1;
     if (fmtHndl->internalParams == NULL) return 1;
@@ -967,7 +987,7 @@ FormatHeader tiffHeader = {
   tiffReadImageProc, //ReadImageProc 
   tiffWriteImageProc, //WriteImageProc
   tiffReadImageTileProc, //ReadImageTileProc
-  NULL, //WriteImageTileProc
+  tiffWriteImageTileProc, //WriteImageTileProc
   tiffReadImageLevelProc, //ReadImageLevelProc
   NULL, //WriteImageLineProc
   NULL, //ReadImageThumbProc
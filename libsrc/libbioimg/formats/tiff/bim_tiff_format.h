@@ -13,13 +13,17 @@
 
   History:
     03/29/2004 22:23 - First creation
+    10/19/2026 12:00 - state of tile by tile writing
+    10/19/2026 12:00 - per thread decoding handles
         
-  Ver : 1
+  Ver : 2
 *****************************************************************************/
 
 #ifndef BIM_TIFF_FORMAT_H
 #define BIM_TIFF_FORMAT_H
 
+#include <vector>
+
 #include <bim_img_format_interface.h>
 #include <bim_img_format_utils.h>
 
@@ -114,6 +118,8 @@ public:
     void addLevel(const double &scale, const bim::uint64 &offset = 0);
 };
 
+class TiffTileStream; // state of an image written tile by tile
+
 class TiffParams {
 public:
   TiffParams();
@@ -130,6 +136,9 @@ public:
   FluoviewInfo fluoviewInfo;
   LsmInfo lsmInfo;
   OMETiffInfo omeTiffInfo;
+
+  TiffTileStream *tileStream; // NULL unless writing tile by tile
+  std::vector<TIFF*> decoders; // read handles of decoding threads, opened once per session
 };
 
 } // namespace bim
@@ -11,8 +11,13 @@
 
   History:
     03/29/2004 22:23 - First creation
+    10/19/2026 12:00 - Parallel strip and tile decoding
+    10/19/2026 12:00 - Decode only requested samples of planar images
+    10/19/2026 12:00 - Tile by tile writing with spooled pyramid levels
+    10/19/2026 12:00 - Report errors writing tiles and reduced levels
+    10/19/2026 12:00 - Report errors writing strips
         
-  Ver : 1
+  Ver : 6
 *****************************************************************************/
 
 #include <cstdio>
@@ -20,6 +25,13 @@
 #include <cstring>
 #include <cmath>
 #include <limits>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include <xstring.h>
 #include <tag_map.h>
@@ -27,6 +39,7 @@
 #include <bim_exiv_parse.h>
 #include <bim_lcms_parse.h>
 #include <bim_image.h>
+#include <bim_format_misc.h>
 
 #include "xtiffio.h"
 #include "bim_tiny_tiff.h"
@@ -586,37 +599,187 @@ bim::uint write_tiff_metadata (bim::FormatHandle *fmtHndl, bim::TiffParams *tifP
 // WRITING LINE SEGMENT FROM BUFFER
 //****************************************************************************
 
-template< typename T >
-void write_line_segment_t(void *po, void *bufo, bim::ImageBitmap *img, bim::uint sample, bim::uint64 w) {
-    T *p   = (T *) po;
-    T *buf = (T *) bufo;  
-    bim::uint nsamples = img->i.samples;
-    for (bim::int64 x=sample, xi=0; x<w*nsamples; x+=nsamples, ++xi) {
-        p[xi] = buf[x];
-    }
+// splits w interleaved pixels into the sample planes of img, at pixel x of line y
+void deinterleave_line_segment(bim::ImageBitmap *img, const void *buf, bim::uint64 y, bim::uint64 x, bim::uint64 w) {
+    bim::uint64 offset = getLineSizeInBytes(img) * y + x * (img->i.depth / 8);
+    void *planes[BIM_MAX_CHANNELS];
+    for (bim::uint sample = 0; sample < img->i.samples; ++sample)
+        planes[sample] = (bim::uchar *) img->bits[sample] + offset;
+    bim::deinterleave_row(planes, img->i.samples, buf, img->i.samples, w, img->i.depth);
 }
 
-void write_line_segment(void *po, void *bufo, bim::ImageBitmap *img, bim::uint sample, bim::uint64 w) {
-  if (img->i.depth==8)  
-      write_line_segment_t<bim::uint8>  (po, bufo, img, sample, w);
-  else
-  if (img->i.depth==16) 
-      write_line_segment_t<bim::uint16> (po, bufo, img, sample, w);
-  else
-  if (img->i.depth==32) 
-      write_line_segment_t<bim::uint32> (po, bufo, img, sample, w);
-  else
-  if (img->i.depth==64) 
-      write_line_segment_t<bim::float64>(po, bufo, img, sample, w);
+// packs w pixels of the sample planes of img, from pixel x of line y, into an interleaved buffer
+void interleave_line_segment(bim::ImageBitmap *img, void *buf, bim::uint64 y, bim::uint64 x, bim::uint64 w) {
+    bim::uint64 offset = getLineSizeInBytes(img) * y + x * (img->i.depth / 8);
+    const void *planes[BIM_MAX_CHANNELS];
+    for (bim::uint sample = 0; sample < img->i.samples; ++sample)
+        planes[sample] = (const bim::uchar *) img->bits[sample] + offset;
+    bim::interleave_row(buf, img->i.samples, planes, img->i.samples, w, img->i.depth);
 }
 
 
+//****************************************************************************
+// PARALLEL STRIP AND TILE DECODING
+//****************************************************************************
+
+// returns the read handle of decoding thread "thread" positioned at the current directory of tif,
+// libtiff keeps codec state and file position per handle so every decoding thread needs its own one,
+// handles live for the whole session since opening parses the first directory again, which may hold
+// a large OME-XML description, returns NULL if the file can not be reopened
+TIFF *tiff_thread_decoder(bim::TiffParams *par, TIFF *tif, bim::FormatHandle *fmtHndl, int thread) {
+    if (!par || !tif || !fmtHndl || !fmtHndl->fileName) return NULL;
+    if (thread < 0 || thread >= (int) par->decoders.size()) return NULL;
+
+    TIFF *dec = par->decoders[thread];
+    if (!dec) {
+#ifdef BIM_WIN
+        bim::xstring fn(fmtHndl->fileName);
+        dec = XTIFFOpenW(fn.toUTF16().c_str(), "r");
+#else
+        dec = XTIFFOpen(fmtHndl->fileName, "r");
+#endif
+        par->decoders[thread] = dec;
+    }
+    if (!dec) return NULL;
+    if (TIFFCurrentDirOffset(dec) != TIFFCurrentDirOffset(tif) && TIFFSetSubDirectory(dec, TIFFCurrentDirOffset(tif)) == 0)
+        return NULL;
+
+    // JPEG YCbCr may be decoded into RGB on the main handle
+    bim::uint16 compression = COMPRESSION_NONE;
+    int jpeg_color_mode = JPEGCOLORMODE_RAW;
+    TIFFGetField(tif, TIFFTAG_COMPRESSION, &compression);
+    if (compression == COMPRESSION_JPEG && TIFFGetField(tif, TIFFTAG_JPEGCOLORMODE, &jpeg_color_mode))
+        TIFFSetField(dec, TIFFTAG_JPEGCOLORMODE, jpeg_color_mode);
+    return dec;
+}
+
+// reads all strips or tiles of the current directory into img
+// blocks are decompressed in parallel when there are enough of them to keep all threads busy,
+// thread 0 reads through tif and the others through their own handles, predictor and fill order
+// are undone by libtiff per block; streams that can not be reopened and LSM files, whose strip
+// sizes are patched on tif only, are decoded block by block through tif
+// returns 0 on success, 1 if aborted and -1 if a block could not be decoded
+// if channel >= 0 the directory holds a single sample that goes into that channel of img,
+// otherwise separate planes are read for the samples of img as given by requestedChannel
+int read_tiff_blocks(TIFF *tif, bim::ImageBitmap *img, bim::FormatHandle *fmtHndl, int channel = -1) {
+    if (!tif || !img) return 1;
+
+    bool tiled = TIFFIsTiled(tif) != 0;
+    bim::uint32 width = (bim::uint32) img->i.width;
+    bim::uint32 height = (bim::uint32) img->i.height;
+    bim::uint32 block_width = width;
+    bim::uint32 block_height = height;
+    bim::uint16 planarConfig = PLANARCONFIG_CONTIG;
+    TIFFGetField(tif, TIFFTAG_PLANARCONFIG, &planarConfig);
+    if (tiled) {
+        TIFFGetField(tif, TIFFTAG_TILEWIDTH, &block_width);
+        TIFFGetField(tif, TIFFTAG_TILELENGTH, &block_height);
+    } else {
+        TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &block_height);
+        if (block_height > height) block_height = height;
+    }
+    if (block_width == 0 || block_height == 0 || height == 0) return 1;
+
+    bool interleaved = channel < 0 && img->i.samples > 1 && planarConfig != PLANARCONFIG_SEPARATE;
+    bim::uint planes = (channel < 0 && !interleaved) ? img->i.samples : 1;
+    bim::uint64 across = (width + block_width - 1) / block_width;
+    bim::uint64 down = (height + block_height - 1) / block_height;
+    bim::uint64 per_plane = across*down;
+    bim::uint64 blocks = std::min<bim::uint64>(per_plane*planes, tiled ? TIFFNumberOfTiles(tif) : TIFFNumberOfStrips(tif));
+
+    bim::uint lineSize = getLineSizeInBytes(img);
+    bim::uint bpp = (bim::uint) ceil((double)img->i.depth / 8.0);
+    tiff_size_t block_size = tiled ? TIFFTileSize(tif) : TIFFStripSize(tif);
+    tiff_size_t row_size = tiled ? TIFFTileRowSize(tif) : TIFFScanlineSize(tif);
+    if (block_size <= 0 || row_size <= 0) return 1;
+
+    bim::TiffParams *par = (bim::TiffParams *) fmtHndl->internalParams;
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    bool parallel = threads > 1 && blocks >= (bim::uint64) threads && par && !isCustomReading(fmtHndl) && par->subType != bim::tstCzLsm;
+    if (parallel && par->decoders.size() < (size_t) threads)
+        par->decoders.resize(threads, NULL);
+
+    bim::uint64 done = 0;
+    std::atomic<bool> aborted(false);
+    std::atomic<bool> failed(false);
+
+    #pragma omp parallel default(shared) if (parallel)
+    {
+        TIFF *dec = NULL;
+#ifdef _OPENMP
+        if (parallel && omp_get_thread_num() > 0)
+            dec = tiff_thread_decoder(par, tif, fmtHndl, omp_get_thread_num());
+#endif
+        std::vector<bim::uchar> buffer(block_size);
+        bim::uchar *buf = &buffer[0];
+
+        #pragma omp for BIM_OMP_SCHEDULE
+        for (bim::int64 b = 0; b < (bim::int64) blocks; ++b) {
+            if (aborted || failed) continue;
+
+            // separate planes of unrequested samples are skipped
+            bim::uint plane = (bim::uint) (b / per_plane);
+            bim::uint64 pos = b % per_plane;
+            bim::uint64 block = interleaved || channel >= 0 ? b : requestedChannel(fmtHndl, plane)*per_plane + pos;
+
+            tiff_size_t r = 0;
+            if (dec) {
+                r = tiled ? TIFFReadEncodedTile(dec, (bim::uint32) block, buf, block_size) : TIFFReadEncodedStrip(dec, (bim::uint32) block, buf, block_size);
+            } else {
+                // thread 0 and threads that could not reopen the file share the main handle
+                #pragma omp critical (tiff_shared_decoder)
+                r = tiled ? TIFFReadEncodedTile(tif, (bim::uint32) block, buf, block_size) : TIFFReadEncodedStrip(tif, (bim::uint32) block, buf, block_size);
+            }
+            if (r < 0) {
+                failed = true;
+                continue;
+            }
+
+            bim::uint64 y = (pos / across) * block_height;
+            bim::uint64 x = (pos % across) * block_width;
+            bim::uint rows = (bim::uint) std::min<bim::uint64>(block_height, height - y);
+            bim::uint cols = (bim::uint) std::min<bim::uint64>(block_width, width - x);
+
+            if (interleaved) { // samples in one same plane ex: RGBRGBRGB...
+                for (bim::uint yi = 0; yi < rows; ++yi)
+                    deinterleave_line_segment(img, buf + (yi*row_size), y + yi, x, cols);
+            } else {
+                bim::uint sample = channel >= 0 ? (bim::uint) channel : plane;
+                bim::uint64 copy_size = tiled ? cols*bpp : std::min<bim::uint64>(lineSize, row_size);
+                for (bim::uint yi = 0; yi < rows; ++yi) {
+                    bim::uchar *p = (bim::uchar *) img->bits[sample] + (lineSize * (y + yi));
+                    _TIFFmemcpy(p + (x*bpp), buf + (yi*row_size), copy_size);
+                }
+            }
+
+            #pragma omp critical (tiff_block_progress)
+            {
+                ++done;
+                xprogress(fmtHndl, done, blocks, "Reading TIFF");
+                if (xtestAbort(fmtHndl) == 1) aborted = true;
+            }
+        } // for b
+    } // omp parallel
+
+    if (failed) return -1;
+    return aborted ? 1 : 0;
+}
+
 //****************************************************************************
 // SCANLINE METHOD TIFF
 //****************************************************************************
 
 int read_scanline_tiff(TIFF *tif, bim::ImageBitmap *img, bim::FormatHandle *fmtHndl) {
     if (!tif || !img) return -1;
+
+    // old-style JPEG streams are only safely decoded sequentially
+    bim::uint16 compression = COMPRESSION_NONE;
+    TIFFGetField(tif, TIFFTAG_COMPRESSION, &compression);
+    if (compression != COMPRESSION_OJPEG)
+        return read_tiff_blocks(tif, img, fmtHndl);
   
     bim::uint lineSize = getLineSizeInBytes( img );
     bim::uint16 photometric = PHOTOMETRIC_MINISWHITE;
@@ -632,7 +795,7 @@ int read_scanline_tiff(TIFF *tif, bim::ImageBitmap *img, bim::FormatHandle *fmtH
             for(bim::uint y=0; y<img->i.height; y++) {
                 xprogress( fmtHndl, y*(sample+1), img->i.height*img->i.samples, "Reading TIFF" );
                 if ( xtestAbort( fmtHndl ) == 1) break;  
-                if (!TIFFReadScanline(tif, p, y, sample)) return -1;
+                if (!TIFFReadScanline(tif, p, y, requestedChannel(fmtHndl, sample))) return -1;
                 p += lineSize;
             } // for y
         }  // for sample
@@ -649,10 +812,7 @@ int read_scanline_tiff(TIFF *tif, bim::ImageBitmap *img, bim::FormatHandle *fmtH
             }
             // process YCrCb, etc data
 
-            for (bim::uint sample=0; sample<img->i.samples; ++sample) {
-                bim::uchar *p = (bim::uchar *) img->bits[sample] + (lineSize * y);
-                write_line_segment(p, buf, img, sample, img->i.width);
-            }  // for sample
+            deinterleave_line_segment(img, buf, y, 0, img->i.width);
 
         } // for y
         _TIFFfree( buf );
@@ -668,56 +828,7 @@ int read_scanline_tiff(TIFF *tif, bim::ImageBitmap *img, bim::FormatHandle *fmtH
 int read_tiled_tiff(TIFF *tif, bim::ImageBitmap *img, bim::FormatHandle *fmtHndl) {
     if (!tif || !img) return 1;
     if (!TIFFIsTiled(tif)) return 1;
-
-    bim::uint lineSize = getLineSizeInBytes(img);
-    bim::uint bpp = ceil((double)img->i.depth / 8.0);
-    bim::uint16 planarConfig;
-    bim::uint32 columns, rows;
-    bim::uint16 photometric = PHOTOMETRIC_MINISWHITE;
-    TIFFGetField(tif, TIFFTAG_PLANARCONFIG, &planarConfig);
-    TIFFGetField(tif, TIFFTAG_TILEWIDTH, &columns);
-    TIFFGetField(tif, TIFFTAG_TILELENGTH, &rows);
-    TIFFGetField(tif, TIFFTAG_PHOTOMETRIC, &photometric);
-
-    std::vector<bim::uchar> buffer(TIFFTileSize(tif));
-    bim::uchar *buf = &buffer[0];
-
-    for (bim::uint y = 0; y < img->i.height; y += rows) {
-        xprogress(fmtHndl, y, img->i.height, "Reading tiled TIFF");
-        if (xtestAbort(fmtHndl) == 1) break;
-
-        bim::uint tile_height = (img->i.height - y >= rows) ? rows : (bim::uint) img->i.height - y;
-        for (bim::uint x = 0; x < (bim::uint)img->i.width; x += columns) {
-            bim::uint tile_width = (img->i.width - x < columns) ? (bim::uint) img->i.width - x : (bim::uint) columns;
-
-            if ((planarConfig == PLANARCONFIG_SEPARATE) || (img->i.samples == 1)) {
-                for (bim::uint sample = 0; sample < img->i.samples; sample++) {
-                    if (TIFFReadTile(tif, buf, x, y, 0, sample) < 0) break;
-
-                    // now put tile into the image 
-                    for (bim::uint yi = 0; yi < tile_height; yi++) {
-                        bim::uchar *p = (bim::uchar *) img->bits[sample] + (lineSize * (y + yi));
-                        _TIFFmemcpy(p + (x*bpp), buf + (yi*columns*bpp), tile_width*bpp);
-                    }
-                }  // for sample
-            } else { // if image contains several samples in one same plane ex: RGBRGBRGB...
-                if (TIFFReadTile(tif, buf, x, y, 0, 0) < 0) break;
-                // process YCrCb, etc data
-
-                for (bim::uint sample = 0; sample < img->i.samples; sample++) {
-                    // now put tile into the image 
-                    #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (tile_height>BIM_OMP_FOR2)
-                    for (bim::int64 yi = 0; yi < tile_height; yi++) {
-                        bim::uchar *p = (bim::uchar *) img->bits[sample] + (lineSize * (y + yi));
-                        write_line_segment(p + (x*bpp), buf + (yi*columns*img->i.samples*bpp), img, sample, tile_width);
-                    }
-                }  // for sample
-            } // if not separate planes
-
-        } // for x
-    } // for y
-
-    return 0;
+    return read_tiff_blocks(tif, img, fmtHndl);
 }
 
 
@@ -807,17 +918,24 @@ int read_tiff_image(bim::FormatHandle *fmtHndl, bim::TiffParams *tifParams) {
       for (unsigned int y=0; y < height; ++y)
         lsmFixStripByteCounts( tif, y, sample );
 
-  if ( allocImg( fmtHndl, &img->i, img) != 0 ) return 1;
+  // separate sample planes can be skipped, samples interleaved in one plane are decoded together
+  if (PlanarConfig == PLANARCONFIG_SEPARATE && samplesperpixel > 1 && photometric != PHOTOMETRIC_YCBCR && photometric != PHOTOMETRIC_CIELAB) {
+    if ( allocImgChannels( fmtHndl, &img->i, img) != 0 ) return 1;
+  } else {
+    if ( allocImg( fmtHndl, &img->i, img) != 0 ) return 1;
+  }
 
   // if image is STK
   if (tifParams->subType == bim::tstStk)
     return stkReadPlane(tifParams, fmtHndl->pageNumber, img, fmtHndl);
 
 
+  int res = 0;
   if( !TIFFIsTiled(tif) )
-    read_scanline_tiff(tif, img, fmtHndl);
+    res = read_scanline_tiff(tif, img, fmtHndl);
   else
-    read_tiled_tiff(tif, img, fmtHndl);
+    res = read_tiled_tiff(tif, img, fmtHndl);
+  if (res != 0) return 1;
 
   processPhotometric(img, tifParams, photometric);
 
@@ -849,7 +967,7 @@ int write_striped_tiff(TIFF *out, bim::ImageBitmap *img, bim::FormatHandle *fmtH
                 xprogress(fmtHndl, y*(sample + 1), height*img->i.samples, "Writing TIFF");
                 if (xtestAbort(fmtHndl) == 1) break;
 
-                TIFFWriteScanline(out, bits, y, sample);
+                if (TIFFWriteScanline(out, bits, y, sample) < 0) return 1;
                 bits += line_size;
             } // for y
         } // for samples
@@ -863,23 +981,15 @@ int write_striped_tiff(TIFF *out, bim::ImageBitmap *img, bim::FormatHandle *fmtH
             xprogress(fmtHndl, y, height, "Writing TIFF");
             if (xtestAbort(fmtHndl) == 1) break;
 
-            bim::uchar *bufIn0 = ((bim::uchar *)img->bits[0]) + y*width*Bpp;
-            bim::uchar *bufIn1 = ((bim::uchar *)img->bits[1]) + y*width*Bpp;
-            bim::uchar *bufIn2 = ((bim::uchar *)img->bits[2]) + y*width*Bpp;
-            bim::uchar *p = (bim::uchar *)buffer;
-            for (register bim::uint x = 0; x<width; x++) {
-                p[0] = *(bufIn0 + x);
-                p[1] = *(bufIn1 + x);
-                p[2] = *(bufIn2 + x);
-                p += 3;
-            }
-            TIFFWriteScanline(out, buffer, y, 0);
+            interleave_line_segment(img, buffer, y, 0, width);
+            if (TIFFWriteScanline(out, buffer, y, 0) < 0) return 1;
         }
     }
     return 0;
 }
 
-int write_tiled_tiff(TIFF *tif, bim::ImageBitmap *img, bim::FormatHandle *fmtHndl) {
+// writes the tiles covered by img, placed at pixel x0,y0 of the directory which must be tile aligned
+int write_tiled_tiff(TIFF *tif, bim::ImageBitmap *img, bim::FormatHandle *fmtHndl, bim::uint64 x0 = 0, bim::uint64 y0 = 0) {
     bim::TiffParams *par = (bim::TiffParams *)fmtHndl->internalParams;
 
     bim::uint64 width = (bim::uint64) img->i.width;
@@ -894,15 +1004,17 @@ int write_tiled_tiff(TIFF *tif, bim::ImageBitmap *img, bim::FormatHandle *fmtHnd
     bim::uint32 rows = par->info.tileHeight;
     bim::uint bpp = ceil((double)img->i.depth / 8.0);
 
-    TIFFSetField(tif, TIFFTAG_TILEWIDTH, columns);
-    TIFFSetField(tif, TIFFTAG_TILELENGTH, rows);
+    if (!TIFFIsTiled(tif)) {
+        TIFFSetField(tif, TIFFTAG_TILEWIDTH, columns);
+        TIFFSetField(tif, TIFFTAG_TILELENGTH, rows);
+    }
     
     std::vector<bim::uint8> buffer(TIFFTileSize(tif));
     bim::uint8 *buf = &buffer[0];
 
     for (bim::uint y = 0; y<img->i.height; y += rows) {
         xprogress(fmtHndl, y, img->i.height, "Writing tiled TIFF");
-        if (xtestAbort(fmtHndl) == 1) break;
+        if (xtestAbort(fmtHndl) == 1) return 1;
 
         for (bim::uint x = 0; x<(bim::uint)img->i.width; x += columns) {
             bim::uint tile_width = (width - x >= columns) ? columns : (bim::uint) width - x;
@@ -918,23 +1030,14 @@ int write_tiled_tiff(TIFF *tif, bim::ImageBitmap *img, bim::FormatHandle *fmtHnd
                         bim::uint8 * BIM_RESTRICT from = ((bim::uint8 *)img->bits[sample]) + (y + i)*bpp*width + x*bpp;
                         memcpy(to, from, tile_width*bpp);
                     }
-                    if (TIFFWriteTile(tif, buf, x, y, 0, sample) < 0) break;
+                    if (TIFFWriteTile(tif, buf, x0 + x, y0 + y, 0, sample) < 0) return 1;
                 }  // for sample
             }  else { // if image contains interleaved samples: RGBRGBRGB...
-                int step = bpp * img->i.samples;
-                for (bim::uint sample = 0; sample < img->i.samples; ++sample) {
-                    #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (tile_height>BIM_OMP_FOR2)
-                    for (bim::int64 i = 0; i < tile_height; ++i) {
-                        bim::uint8 * BIM_RESTRICT to = buf + sample*bpp + i*step*columns;
-                        bim::uint8 * BIM_RESTRICT from = ((bim::uint8 *)img->bits[sample]) + (y + i)*bpp*width + x*bpp;
-                        for (bim::int64 x = 0; x < tile_width; ++x) {
-                            memcpy(to, from, bpp);
-                            from += bpp;
-                            to += step;
-                        }
-                    }
-                }  // for sample
-                if (TIFFWriteTile(tif, buf, x, y, 0, 0) < 0) break;
+                bim::uint64 step = bpp * img->i.samples * columns;
+                #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (tile_height>BIM_OMP_FOR2)
+                for (bim::int64 i = 0; i < tile_height; ++i)
+                    interleave_line_segment(img, buf + i*step, y + i, x, tile_width);
+                if (TIFFWriteTile(tif, buf, x0 + x, y0 + y, 0, 0) < 0) return 1;
             } // if not separate planes
         } // for x
     } // for y
@@ -1020,15 +1123,28 @@ int tiff_update_subifd_next_pointer(TIFF* tif, bim::uint64 dir_offset, bim::uint
     return true;
 }
 
-int write_tiff_image(bim::FormatHandle *fmtHndl, bim::TiffParams *par, bim::ImageBitmap *img = NULL, bool subscale = false) {
-  if (!areValidParams(fmtHndl, par)) return 1;
+// correct libtiff writing of subifds by linking sibling ifds through nextifd offset
+void tiff_link_subifds(TIFF *out, bim::TiffParams *par) {
+    if (par->pyramid.format != bim::PyramidInfo::pyrFmtSubDirs) return;
+    for (size_t i = 0; i + 1 < par->pyramid.directory_offsets.size(); ++i) {
+        if (!tiff_update_subifd_next_pointer(out, par->pyramid.directory_offsets[i], par->pyramid.directory_offsets[i + 1])) break;
+    }
+}
 
-  if (par->subType == bim::tstOmeTiff || par->subType == bim::tstOmeBigTiff)
-      return omeTiffWritePlane( fmtHndl, par);
+// number of reduced levels written below an image, each half the size of the previous one
+int tiff_pyramid_levels(bim::uint64 width, bim::uint64 height) {
+    int levels = 0;
+    while (bim::max<bim::uint64>(width, height) > bim::PyramidInfo::min_level_size) {
+        width /= 2;
+        height /= 2;
+        ++levels;
+    }
+    return levels;
+}
 
+// sets up the fields of a new directory described by img->i, pixels are not accessed
+void write_tiff_fields(bim::FormatHandle *fmtHndl, bim::TiffParams *par, bim::ImageBitmap *img, bool subscale) {
   TIFF *out = par->tiff;
-  if (!img) img = fmtHndl->image;
- 
   bim::uint32 width = (bim::uint32) img->i.width;
   bim::uint32 height = (bim::uint32) img->i.height;
   bim::uint32 rowsperstrip = (bim::uint32) -1;
@@ -1094,11 +1210,10 @@ int write_tiff_image(bim::FormatHandle *fmtHndl, bim::TiffParams *par, bim::Imag
 
       if (!subscale) {
           par->pyramid.directory_offsets.resize(0);
-          bim::int64 num_levels = ceil(bim::log2<double>(sz)) - ceil(bim::log2<double>(bim::PyramidInfo::min_level_size)) + 1;
           if (par->pyramid.format == bim::PyramidInfo::pyrFmtSubDirs) {
               // if pyramid levels are to be written into SUBIFDs, write the tag and indicate to libtiff how many subifds are coming
-              bim::uint16 num_sub_ifds = num_levels - 1; // number of pyramidal levels - 1
-              std::vector<bim::uint64> offsets_sub_ifds(num_levels - 1, 0UL);
+              bim::uint16 num_sub_ifds = tiff_pyramid_levels(width, height); // number of pyramidal levels - 1
+              std::vector<bim::uint64> offsets_sub_ifds(num_sub_ifds, 0UL);
               TIFFSetField(out, TIFFTAG_SUBIFD, num_sub_ifds, &offsets_sub_ifds[0]);
           }
       }
@@ -1194,15 +1309,26 @@ int write_tiff_image(bim::FormatHandle *fmtHndl, bim::TiffParams *par, bim::Imag
   if (fmtHndl->pageNumber == 0 && !subscale) {
       write_tiff_metadata(fmtHndl, par);
   }
+}
+
+int write_tiff_image(bim::FormatHandle *fmtHndl, bim::TiffParams *par, bim::ImageBitmap *img = NULL, bool subscale = false) {
+  if (!areValidParams(fmtHndl, par)) return 1;
+
+  if (par->subType == bim::tstOmeTiff || par->subType == bim::tstOmeBigTiff)
+      return omeTiffWritePlane( fmtHndl, par);
+
+  TIFF *out = par->tiff;
+  if (!img) img = fmtHndl->image;
+  write_tiff_fields(fmtHndl, par, img, subscale);
 
   //------------------------------------------------------------------------------
   // writing image
   //------------------------------------------------------------------------------
   
   if (par->info.tileWidth < 1 || par->pyramid.format == bim::PyramidInfo::pyrFmtNone) {
-      write_striped_tiff(out, img, fmtHndl);
-  } else {
-      write_tiled_tiff(out, img, fmtHndl);
+      if (write_striped_tiff(out, img, fmtHndl) != 0) return 1;
+  } else if (write_tiled_tiff(out, img, fmtHndl) != 0) {
+      return 1;
   }
 
   // correct libtiff writing of subifds by linking sibling ifds through nextifd offset
@@ -1230,11 +1356,7 @@ int write_tiff_image(bim::FormatHandle *fmtHndl, bim::TiffParams *par, bim::Imag
           ++i;
       }
 
-      // correct libtiff writing of subifds by linking sibling ifds through nextifd offset
-      if (par->pyramid.format == bim::PyramidInfo::pyrFmtSubDirs)
-      for (int i = 0; i < par->pyramid.directory_offsets.size() - 1; ++i) {
-          if (!tiff_update_subifd_next_pointer(out, par->pyramid.directory_offsets[i], par->pyramid.directory_offsets[i + 1])) break;
-      }
+      tiff_link_subifds(out, par);
   }
 
   //------------------------------------------------------------------------------
@@ -1286,14 +1408,15 @@ int read_tiff_image_level(bim::FormatHandle *fmtHndl, bim::TiffParams *tifParams
     bim::uint bpp = ceil((double)img->i.depth / 8.0);
     if (allocImg(fmtHndl, &img->i, img) != 0) return 1;
 
+    int res = 0;
     if (!TIFFIsTiled(tif))
-        read_scanline_tiff(tif, img, fmtHndl);
+        res = read_scanline_tiff(tif, img, fmtHndl);
     else
-        read_tiled_tiff(tif, img, fmtHndl);
+        res = read_tiled_tiff(tif, img, fmtHndl);
 
     processPhotometric(img, tifParams, photometric);
     TIFFSetDirectory(tif, current_dir);
-    return 0;
+    return res != 0 ? 1 : 0;
 }
 
 int read_tiff_image_tile(bim::FormatHandle *fmtHndl, bim::TiffParams *tifParams, bim::uint page, bim::uint64 xid, bim::uint64 yid, bim::uint level) {
@@ -1359,19 +1482,10 @@ int read_tiff_image_tile(bim::FormatHandle *fmtHndl, bim::TiffParams *tifParams,
         }  // for sample
     } else { // if image contains interleaved samples: RGBRGBRGB...
         if (TIFFReadTile(tif, buf, x, y, 0, 0) > 0) {
-            int step = bpp * img->i.samples;
-            for (bim::uint sample = 0; sample < img->i.samples; sample++) {
-                #pragma omp parallel for default(shared)  BIM_OMP_SCHEDULE if (tile_height>BIM_OMP_FOR2)
-                for (bim::int64 y = 0; y < tile_height; ++y) {
-                    bim::uint8 * BIM_RESTRICT from = buf + sample*bpp + y*step*columns;
-                    bim::uint8 * BIM_RESTRICT to = ((bim::uint8 *)img->bits[sample]) + y*bpp*tile_width;
-                    for (bim::int64 x = 0; x < tile_width; ++x) {
-                        memcpy(to, from, bpp);
-                        to += bpp;
-                        from += step;
-                    }
-                }
-            }  // for sample
+            bim::uint64 step = bpp * img->i.samples * columns;
+            #pragma omp parallel for default(shared)  BIM_OMP_SCHEDULE if (tile_height>BIM_OMP_FOR2)
+            for (bim::int64 y = 0; y < tile_height; ++y)
+                deinterleave_line_segment(img, buf + y*step, y, 0, tile_width);
         }
     } // if not separate planes
 
@@ -1380,3 +1494,177 @@ int read_tiff_image_tile(bim::FormatHandle *fmtHndl, bim::TiffParams *tifParams,
     return 0;
 }
 
+//****************************************************************************
+// TILE BY TILE WRITER
+//****************************************************************************
+
+// Reduced levels can only be written once the full resolution directory is
+// finished, so every completed row of tiles is downsampled right away and its
+// rows are spooled into a temporary file, the spool of each level is then
+// written and reduced into the spool of the next one. Only one row of tiles
+// per level is ever kept in memory.
+class bim::TiffTileStream {
+public:
+    TiffTileStream(): num_levels(0), tiles_left(0), band_y(-1), spool(NULL) {}
+    ~TiffTileStream() { if (spool) fclose(spool); }
+
+    bim::ImageInfo info;   // geometry of the full resolution image
+    int num_levels;        // reduced levels to write, 0 if no pyramid
+    bim::uint64 tiles_left; // full resolution tiles not yet written
+    bim::Image band;       // row of tiles being assembled, only kept for pyramids
+    bim::int64 band_y;     // first image row of the band, -1 if none
+    std::FILE *spool;      // rows of level 1, samples of each row stored one after another
+};
+
+static bool tiff_spool_rows(std::FILE *f, bim::Image &img) {
+    bim::uint64 line = img.bytesPerLine();
+    for (bim::uint64 y = 0; y < img.height(); ++y)
+        for (bim::uint s = 0; s < img.samples(); ++s)
+            if (fwrite(img.scanLine(s, y), 1, line, f) != line) return false;
+    return true;
+}
+
+static bool tiff_unspool_rows(std::FILE *f, bim::Image &img) {
+    bim::uint64 line = img.bytesPerLine();
+    for (bim::uint64 y = 0; y < img.height(); ++y)
+        for (bim::uint s = 0; s < img.samples(); ++s)
+            if (fread(img.scanLine(s, y), 1, line, f) != line) return false;
+    return true;
+}
+
+// reduces the assembled band into the spool of level 1
+static bool tiff_flush_tile_band(bim::TiffTileStream *ts) {
+    if (ts->band_y < 0) return true;
+    ts->band_y = -1;
+    if (ts->band.height() < 2) return true;
+    bim::Image reduced = ts->band.downSampleBy2x();
+    return tiff_spool_rows(ts->spool, reduced);
+}
+
+int finish_tiff_image_tiles(bim::FormatHandle *fmtHndl, bim::TiffParams *par);
+
+// fmtHndl->image->i describes the whole image, tileWidth and tileHeight included,
+// while its planes hold tile xid,yid padded to the full tile size, tiles may come
+// in any order within a row of tiles but rows must be written top to bottom, the
+// last tile finishes the image so errors writing reduced levels are returned by it
+int write_tiff_image_tile(bim::FormatHandle *fmtHndl, bim::TiffParams *par, bim::uint page, bim::uint64 xid, bim::uint64 yid, bim::uint level) {
+    if (!areValidParams(fmtHndl, par)) return 1;
+    if (par->subType == bim::tstOmeTiff || par->subType == bim::tstOmeBigTiff) return 1;
+    if (page != 0 || level != 0) return 1;
+    bim::ImageBitmap *img = fmtHndl->image;
+    if (!img || img->i.tileWidth < 1 || img->i.tileHeight < 1 || img->i.depth % 8 != 0) return 1;
+    TIFF *out = par->tiff;
+
+    bim::TiffTileStream *ts = par->tileStream;
+    if (!ts) {
+        // reduced bands of odd height would not add up to the height of the level
+        if (img->i.tileHeight % 2 != 0) par->pyramid.format = bim::PyramidInfo::pyrFmtNone;
+        par->info.tileWidth = img->i.tileWidth;
+        par->info.tileHeight = img->i.tileHeight;
+        fmtHndl->pageNumber = 0;
+        write_tiff_fields(fmtHndl, par, img, false);
+
+        ts = new bim::TiffTileStream();
+        ts->info = img->i;
+        ts->tiles_left = ((img->i.width + img->i.tileWidth - 1) / img->i.tileWidth) *
+                         ((img->i.height + img->i.tileHeight - 1) / img->i.tileHeight);
+        if (par->pyramid.format != bim::PyramidInfo::pyrFmtNone)
+            ts->num_levels = tiff_pyramid_levels(img->i.width, img->i.height);
+        if (ts->num_levels > 0 && (ts->spool = tmpfile()) == NULL) {
+            delete ts;
+            return 1;
+        }
+        par->tileStream = ts;
+    }
+
+    const bim::ImageInfo &info = ts->info;
+    if (img->i.width != info.width || img->i.height != info.height || img->i.samples != info.samples ||
+        img->i.depth != info.depth || img->i.pixelType != info.pixelType ||
+        img->i.tileWidth != info.tileWidth || img->i.tileHeight != info.tileHeight) return 1;
+
+    bim::uint64 x0 = xid * info.tileWidth;
+    bim::uint64 y0 = yid * info.tileHeight;
+    if (x0 >= info.width || y0 >= info.height) return 1;
+
+    // keep the row of tiles for the reduced levels
+    if (ts->spool) {
+        if ((bim::int64) y0 < ts->band_y) return 1;
+        if ((bim::int64) y0 > ts->band_y) {
+            if (!tiff_flush_tile_band(ts)) return 1;
+            bim::uint64 h = bim::min<bim::uint64>(info.tileHeight, info.height - y0);
+            if ((ts->band.width() != info.width || ts->band.height() != h) &&
+                ts->band.alloc(info.width, h, info.samples, info.depth, info.pixelType) != 0) return 1;
+            ts->band_y = y0;
+        }
+        bim::uint64 bpp = info.depth / 8;
+        bim::uint64 w = bim::min<bim::uint64>(info.tileWidth, info.width - x0);
+        for (bim::uint s = 0; s < info.samples; ++s) {
+            #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (ts->band.height()>BIM_OMP_FOR2)
+            for (bim::int64 y = 0; y < (bim::int64) ts->band.height(); ++y) {
+                const bim::uint8 *from = ((const bim::uint8 *) img->bits[s]) + y * info.tileWidth * bpp;
+                memcpy(ts->band.scanLine(s, y) + x0 * bpp, from, w * bpp);
+            }
+        }
+    }
+
+    bim::ImageBitmap tile = *img;
+    tile.i.width = info.tileWidth;
+    tile.i.height = info.tileHeight;
+    if (write_tiled_tiff(out, &tile, fmtHndl, x0, y0) != 0) return 1;
+    if (--ts->tiles_left == 0) return finish_tiff_image_tiles(fmtHndl, par);
+    return 0;
+}
+
+// finishes the full resolution directory and writes the spooled reduced levels
+int finish_tiff_image_tiles(bim::FormatHandle *fmtHndl, bim::TiffParams *par) {
+    bim::TiffTileStream *ts = par->tileStream;
+    if (!ts) return 0;
+    par->tileStream = NULL;
+    TIFF *out = par->tiff;
+
+    int res = tiff_flush_tile_band(ts) ? 0 : 1;
+    ts->band = bim::Image();
+    TIFFWriteDirectory(out);
+
+    bim::ImageInfo info = ts->info;
+    for (int level = 1; level <= ts->num_levels && res == 0; ++level) {
+        info.width /= 2;
+        info.height /= 2;
+        rewind(ts->spool);
+        std::FILE *next = level < ts->num_levels ? tmpfile() : NULL;
+        if (level < ts->num_levels && !next) { res = 1; break; }
+
+        bim::ImageBitmap hdr;
+        hdr.i = info;
+        write_tiff_fields(fmtHndl, par, &hdr, true);
+
+        bim::Image band;
+        for (bim::uint64 y = 0; y < info.height; y += info.tileHeight) {
+            xprogress(fmtHndl, y, info.height, "Writing TIFF pyramid");
+            if (xtestAbort(fmtHndl) == 1) { res = 1; break; }
+            bim::uint64 h = bim::min<bim::uint64>(info.tileHeight, info.height - y);
+            if (band.height() != h && band.alloc(info.width, h, info.samples, info.depth, info.pixelType) != 0) { res = 1; break; }
+            if (!tiff_unspool_rows(ts->spool, band)) { res = 1; break; }
+            if (write_tiled_tiff(out, band.imageBitmap(), fmtHndl, 0, y) != 0) { res = 1; break; }
+            if (next && h > 1) {
+                bim::Image reduced = band.downSampleBy2x();
+                if (!tiff_spool_rows(next, reduced)) { res = 1; break; }
+            }
+        }
+
+        if (par->pyramid.format == bim::PyramidInfo::pyrFmtSubDirs) {
+            bim::uint64 dir_offset = (TIFFSeekFile(out, 0, SEEK_END) + 1) &~1;
+            par->pyramid.directory_offsets.push_back(dir_offset);
+        }
+        TIFFWriteDirectory(out);
+
+        fclose(ts->spool);
+        ts->spool = next;
+    }
+    tiff_link_subifds(out, par);
+
+    TIFFFlushData(out);
+    TIFFFlush(out);
+    delete ts;
+    return res;
+}
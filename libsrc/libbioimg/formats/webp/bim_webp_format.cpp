@@ -7,8 +7,9 @@
 
   History:
   2013-01-12 14:13:40 - First creation
+  2026-10-19 12:00:00 - Report errors writing the file
 
-  ver : 1
+  ver : 2
   *****************************************************************************/
 
 #include <cstdio>
@@ -350,9 +351,7 @@ bim::uint webpReadImageProc(FormatHandle *fmtHndl, bim::uint page) {
     }
     const unsigned char *buffer = output_buffer->u.RGBA.rgba;
     const unsigned int stride = output_buffer->u.RGBA.stride;
-    for (int s = 0; s < info->samples; ++s) {
-        copy_sample_interleaved_to_planar<uint8>(info->width, info->height, info->samples, s, buffer, bmp->bits[s], stride);
-    } // for sample
+    bim::deinterleave(bmp->bits, info->samples, buffer, info->samples, info->width, info->height, 8, stride);
 
     WebPFreeDecBuffer(output_buffer);
     return 0;
@@ -403,9 +402,7 @@ bim::uint webpWriteImageProc(FormatHandle *fmtHndl) {
     if (buffer.size() < fsize) return 1;
     memset(&buffer[0], 0, fsize);
 
-    for (int s = 0; s<bim::min<int>(info->samples, 4); ++s) {
-        copy_sample_planar_to_interleaved<uint8>(info->width, info->height, out_samples, s, bmp->bits[s], &buffer[0]);
-    } // for sample
+    bim::interleave(&buffer[0], out_samples, bmp->bits, bim::min<int>(info->samples, 4), info->width, info->height, 8);
 
     // if writing first image
     bool first_frame = !par->mux;
@@ -508,6 +505,7 @@ bim::uint webpWriteImageProc(FormatHandle *fmtHndl) {
     std::fstream file(fmtHndl->fileName, std::fstream::out | std::fstream::binary);
 #endif   
     file.write((char *)output_data.bytes, output_data.size);
+    bool written = file.good();
     file.close();
 
     // free WebP output file
@@ -518,7 +516,7 @@ bim::uint webpWriteImageProc(FormatHandle *fmtHndl) {
     if (writer.mem) free(writer.mem);
 #endif
 
-    return 0;
+    return written ? 0 : 1;
 }
 
 //****************************************************************************
@@ -27,8 +27,18 @@
 
   History:
     03/23/2004 18:03 - First creation
+    10/19/2026 12:00 - Copy-on-write shared metadata
+    10/19/2026 12:00 - Wall-clock timing of operations
+    10/19/2026 12:00 - Channel metadata remapping for channel selective reads
+    10/19/2026 12:00 - Fused evaluation of runs of pointwise modifiers
+    10/19/2026 12:00 - Single pass rendering of display RGB images
+    10/19/2026 12:00 - Arbitrary rotation and affine/projective warps
+    10/19/2026 12:00 - Thread safe memory references
+    10/19/2026 12:00 - Modifiers receive the caller's configuration
+    10/19/2026 12:00 - toFile reports write errors
+    10/19/2026 12:00 - Memory references guarded by a mutex visible to all threads
       
-  ver: 1
+  ver: 11
         
 *******************************************************************************/
 
@@ -39,9 +49,11 @@
 #include <algorithm>
 
 #include <cstring>
+#include <mutex>
 
 #include "xtypes.h"
 #include "xconf.h"
+#include "xtiming.h"
 #include "bim_image.h"
 #include "bim_img_format_utils.h"
 #include "bim_buffer.h"
@@ -77,6 +89,10 @@ Image operation_transform_icc_name(Image &img, const bim::xstring &arguments, co
 //------------------------------------------------------------------------------------
 
 std::vector<ImgRefs*> Image::refs;
+
+// guards refs, images are created and released by OpenMP workers as well as
+// plain threads like the Image5D prefetcher, which an omp critical does not cover
+static std::mutex refs_mutex;
 const Image::map_modifiers Image::modifiers = Image::create_modifiers();
 
 Image::Image() {
@@ -170,34 +186,37 @@ int Image::getCurrentRefId() {
   return getRefId( bmp );
 }
 
+// the list of references is searched and modified by images living in any thread,
+// so all lookups and reference counting happen with refs_mutex locked
+
 void Image::connectToMemory( ImageBitmap *b ) {
   disconnectFromMemory();
 
-  int ref_id = getRefId( b );
-  if (ref_id == -1) return;
-
-  #pragma omp atomic
-  refs.at(ref_id)->refs++;
-  bmp = &refs.at(ref_id)->bmp;
+  {
+    std::lock_guard<std::mutex> lock(refs_mutex);
+    int ref_id = getRefId( b );
+    if (ref_id != -1) {
+      refs.at(ref_id)->refs++;
+      bmp = &refs.at(ref_id)->bmp;
+    }
+  }
 }
 
 void Image::connectToUnmanagedMemory(ImageBitmap *b) {
     disconnectFromMemory();
 
-    int ref_id = getRefId(b);
-    if (ref_id == -1) {
-        ImgRefs *new_ref = new ImgRefs;
-        new_ref->bmp = *b;
-        #pragma omp critical(MEMREF)
-        {
+    {
+        std::lock_guard<std::mutex> lock(refs_mutex);
+        int ref_id = getRefId(b);
+        if (ref_id == -1) {
+            ImgRefs *new_ref = new ImgRefs;
+            new_ref->bmp = *b;
             refs.push_back(new_ref);
             ref_id = refs.size() - 1;
         }
+        refs.at(ref_id)->refs += 2;
+        bmp = &refs.at(ref_id)->bmp;
     }
-
-    #pragma omp atomic
-    refs.at(ref_id)->refs += 2;
-    bmp = &refs.at(ref_id)->bmp;
 }
 
 void Image::connectToNewMemory() {
@@ -205,8 +224,8 @@ void Image::connectToNewMemory() {
   
   // create a new reference
   ImgRefs *new_ref = new ImgRefs;
-  #pragma omp critical(MEMREF)
   {
+      std::lock_guard<std::mutex> lock(refs_mutex);
       refs.push_back(new_ref);
       size_t ref_id = refs.size() - 1;
       refs.at(ref_id)->refs++;
@@ -216,23 +235,22 @@ void Image::connectToNewMemory() {
 }
 
 void Image::disconnectFromMemory() {
-  int ref_id = getCurrentRefId();
+  ImgRefs *old_ref = NULL;
+  {
+    std::lock_guard<std::mutex> lock(refs_mutex);
+    // decrease the reference to the image
+    int ref_id = getCurrentRefId();
+    if (ref_id != -1 && --refs[ref_id]->refs < 1) {
+      old_ref = refs[ref_id];
+      refs.erase(refs.begin() + ref_id);
+    }
+  }
   bmp = NULL;
 
-  // decrease the reference to the image
-  if (ref_id == -1) return;
-  #pragma omp atomic
-  refs.at(ref_id)->refs--;
-
-  // check if current reference will be zero, then delete image
-  if (refs[ref_id]->refs < 1) {
-      ImgRefs *new_ref = refs[ref_id];
-      #pragma omp critical(MEMREF)
-      {
-          deleteImg(&refs.at(ref_id)->bmp);
-          refs.erase(refs.begin() + ref_id);
-      }
-      delete new_ref;
+  // the last reference is gone, no other image can find this memory anymore
+  if (old_ref) {
+    deleteImg(&old_ref->bmp);
+    delete old_ref;
   }
 }
 
@@ -827,8 +845,7 @@ bool Image::fromPyramidFile(const std::string &fileName, int page, int level, in
 
 bool Image::toFile( const char *fileName, const char *formatName, const char *options ) {
   MetaFormatManager fm;
-  fm.writeImage ( (const bim::Filename) fileName, bmp,  formatName, options);
-  return true;
+  return fm.writeImage ( (const bim::Filename) fileName, bmp,  formatName, options) == 0;
 }
 
 #endif //BIM_USE_IMAGEMANAGER
@@ -954,14 +971,14 @@ bim::uchar *Image::scanLineRGB( bim::uint64 y ) {
 // channels
 //------------------------------------------------------------------------------------
 
-TagMap remapMetadata( const TagMap &md, unsigned int samples, const std::vector<int> &mapping ) {
+SharedTagMap remapMetadata( const SharedTagMap &md, unsigned int samples, const std::vector<int> &mapping ) {
 
   if (md.size()==0) return md;
-  TagMap metadata = md;
+  SharedTagMap metadata = md;
 
   std::vector<std::string> channel_names;
   for (unsigned int i=0; i<samples; ++i)
-    channel_names.push_back( metadata.get_value(xstring::xprintf("channel_%d_name",i), xstring::xprintf("%d",i)) );
+    channel_names.push_back( md->get_value(xstring::xprintf("channel_%d_name",i), xstring::xprintf("%d",i)) );
 
   for (unsigned int i=0; i<mapping.size(); ++i) {
     xstring new_name("empty");
@@ -971,7 +988,7 @@ TagMap remapMetadata( const TagMap &md, unsigned int samples, const std::vector<
       else
         new_name = xstring::xprintf("%d",i);
 
-    metadata.set_value( xstring::xprintf("channel_%d_name",i), new_name);
+    metadata.edit().set_value( xstring::xprintf("channel_%d_name",i), new_name);
   }
 
   return metadata;
@@ -1034,6 +1051,10 @@ void Image::remapChannels( const std::vector<int> &mapping ) {
   bmp->i.samples = (unsigned int) channel_map.size();
 }
 
+void Image::remapChannelMetadata( unsigned int samples, const std::vector<int> &mapping ) {
+  metadata = remapMetadata( metadata, samples, mapping );
+}
+
 void Image::remapToRGB( ) {
   if ( samples() == 3 ) return;
   std::vector<int> map;
@@ -1078,15 +1099,15 @@ Image operation_remap(Image &img, const bim::xstring &arguments, const xoperatio
 // resize
 //------------------------------------------------------------------------------------
 
-TagMap resizeMetadata( const TagMap &md, unsigned int w_to, unsigned int h_to, unsigned int w_in, unsigned int h_in ) {
-  TagMap metadata = md;
-  if ( metadata.hasKey("pixel_resolution_x") ) {
-    double new_res = metadata.get_value_double("pixel_resolution_x", 0) * ((double) w_in /(double) w_to );
-    metadata.set_value("pixel_resolution_x", new_res);
+SharedTagMap resizeMetadata( const SharedTagMap &md, unsigned int w_to, unsigned int h_to, unsigned int w_in, unsigned int h_in ) {
+  SharedTagMap metadata = md;
+  if ( md->hasKey("pixel_resolution_x") ) {
+    double new_res = md->get_value_double("pixel_resolution_x", 0) * ((double) w_in /(double) w_to );
+    metadata.edit().set_value("pixel_resolution_x", new_res);
   }
-  if ( metadata.hasKey("pixel_resolution_y") ) {
-    double new_res = metadata.get_value_double("pixel_resolution_y", 0) * ((double) h_in /(double) h_to );
-    metadata.set_value("pixel_resolution_y", new_res);
+  if ( md->hasKey("pixel_resolution_y") ) {
+    double new_res = md->get_value_double("pixel_resolution_y", 0) * ((double) h_in /(double) h_to );
+    metadata.edit().set_value("pixel_resolution_y", new_res);
   }
   return metadata;
 }
@@ -1329,15 +1350,15 @@ Image operation_resample(Image &img, const bim::xstring &arguments, const xopera
 // Rotation
 //------------------------------------------------------------------------------------
 
-TagMap rotateMetadata( const TagMap &md, const double &deg ) {
-  TagMap metadata = md;
+SharedTagMap rotateMetadata( const SharedTagMap &md, const double &deg ) {
+  SharedTagMap metadata = md;
   if (fabs(deg)!=90) return metadata;
 
-  if ( metadata.hasKey("pixel_resolution_x") && metadata.hasKey("pixel_resolution_y") ) {
-    double y_res = metadata.get_value_double("pixel_resolution_x", 0);
-    double x_res = metadata.get_value_double("pixel_resolution_y", 0);
-    metadata.set_value("pixel_resolution_x", x_res);
-    metadata.set_value("pixel_resolution_y", y_res);
+  if ( md->hasKey("pixel_resolution_x") && md->hasKey("pixel_resolution_y") ) {
+    double y_res = md->get_value_double("pixel_resolution_x", 0);
+    double x_res = md->get_value_double("pixel_resolution_y", 0);
+    metadata.edit().set_value("pixel_resolution_x", x_res);
+    metadata.edit().set_value("pixel_resolution_y", y_res);
   }
   return metadata;
 }
@@ -1360,11 +1381,32 @@ void image_rotate ( T *pdest, unsigned int w_to, unsigned int h_to, unsigned int
 
 }
 
-// only available values now are +90, -90 and 180
-Image Image::rotate( double deg ) const {
+Image Image::rotate( double deg, ResizeMethod method ) const {
   Image img;
   if (bmp==NULL) return img;
-  if (deg!=90 && deg!=-90 && deg!=180) return *this;
+
+  // normalize into (-180, 180]
+  deg = fmod(deg, 360.0);
+  if (deg > 180) deg -= 360;
+  if (deg <= -180) deg += 360;
+  if (deg == 0) return *this;
+
+  if (deg!=90 && deg!=-90 && deg!=180) {
+    double a = deg * bim::Pi / 180.0;
+    double cs = cos(a), sn = sin(a);
+    double w_in = (double) this->width();
+    double h_in = (double) this->height();
+    // slightly shrink the bounding box to avoid an extra column due to rounding errors
+    bim::uint w = bim::max<bim::uint>( (bim::uint) ceil(fabs(w_in*cs) + fabs(h_in*sn) - 1e-6), 1 );
+    bim::uint h = bim::max<bim::uint>( (bim::uint) ceil(fabs(w_in*sn) + fabs(h_in*cs) - 1e-6), 1 );
+    double cx = (w_in-1)/2.0, cy = (h_in-1)/2.0;
+    double ncx = (w-1)/2.0, ncy = (h-1)/2.0;
+
+    std::vector<double> m(6);
+    m[0] = cs; m[1] = -sn; m[2] = ncx - cs*cx + sn*cy;
+    m[3] = sn; m[4] =  cs; m[5] = ncy - sn*cx - cs*cy;
+    return transform_geometry( m, method, w, h );
+  }
 
   int w = this->width();
   int h = this->height();
@@ -1401,11 +1443,133 @@ Image Image::rotate( double deg ) const {
   return img;
 }
 
+//------------------------------------------------------------------------------------
+// Geometric warps
+//------------------------------------------------------------------------------------
+
+template <typename T, typename Tw>
+void image_warp ( T *pdest, bim::uint w_to, bim::uint h_to, bim::uint offset_to,
+                  const T *psrc, bim::uint w_in, bim::uint h_in, bim::uint offset_in,
+                  const double *m, Image::ResizeMethod method, double background ) {
+  T bg = bim::trim<T, double>( background );
+  if (method == Image::szNearestNeighbor)
+    image_warp_NN<T, Tw>( pdest, w_to, h_to, offset_to, psrc, w_in, h_in, offset_in, m, bg );
+  else
+  if (method == Image::szBiLinear)
+    image_warp_BL<T, Tw>( pdest, w_to, h_to, offset_to, psrc, w_in, h_in, offset_in, m, bg );
+  else
+  if (method == Image::szBiCubic)
+    image_warp_BC<T, Tw>( pdest, w_to, h_to, offset_to, psrc, w_in, h_in, offset_in, m, bg );
+}
+
+// inverts a row-major 3x3 matrix, returns false if it's singular
+static bool invert_matrix3x3( const double *a, double *r ) {
+  double c0 = a[4]*a[8] - a[5]*a[7];
+  double c1 = a[5]*a[6] - a[3]*a[8];
+  double c2 = a[3]*a[7] - a[4]*a[6];
+  double det = a[0]*c0 + a[1]*c1 + a[2]*c2;
+  if (fabs(det) < 1e-12) return false;
+  r[0] = c0 / det; r[1] = (a[2]*a[7] - a[1]*a[8]) / det; r[2] = (a[1]*a[5] - a[2]*a[4]) / det;
+  r[3] = c1 / det; r[4] = (a[0]*a[8] - a[2]*a[6]) / det; r[5] = (a[2]*a[3] - a[0]*a[5]) / det;
+  r[6] = c2 / det; r[7] = (a[1]*a[6] - a[0]*a[7]) / det; r[8] = (a[0]*a[4] - a[1]*a[3]) / det;
+  return true;
+}
+
+Image Image::transform_geometry( const std::vector<double> &m, ResizeMethod method, 
+                                 bim::uint w, bim::uint h, double background ) const {
+  Image img;
+  if (bmp==NULL) return img;
+  if (m.size()!=6 && m.size()!=9) return img;
+  if (w==0) w = (bim::uint) this->width();
+  if (h==0) h = (bim::uint) this->height();
+
+  // output pixels are computed from the input, so the inverse mapping is needed
+  double fwd[9] = { m[0], m[1], m[2], m[3], m[4], m[5], 0, 0, 1 };
+  if (m.size()==9) { fwd[6] = m[6]; fwd[7] = m[7]; fwd[8] = m[8]; }
+  double inv[9];
+  if (!invert_matrix3x3(fwd, inv)) return img;
+  if (m.size()==6) { inv[6] = 0; inv[7] = 0; inv[8] = 1; }
+
+  if (img.alloc( w, h, bmp->i.samples, bmp->i.depth, bmp->i.pixelType )!= 0) return img;
+
+  for (int sample=0; sample<(int)bmp->i.samples; ++sample ) {
+
+    if (bmp->i.depth==8 && bmp->i.pixelType==FMT_UNSIGNED)
+      image_warp<bim::uchar, float>( (bim::uchar*) img.bits(sample), w, h, w,
+                                    (bim::uchar*) bmp->bits[sample], bmp->i.width, bmp->i.height, bmp->i.width, inv, method, background );
+    else
+    if (bmp->i.depth==16 && bmp->i.pixelType==FMT_UNSIGNED)
+      image_warp<uint16, float>( (uint16*) img.bits(sample), w, h, w,
+                                 (uint16*) bmp->bits[sample], bmp->i.width, bmp->i.height, bmp->i.width, inv, method, background );
+    else
+    if (bmp->i.depth==32 && bmp->i.pixelType==FMT_UNSIGNED)
+      image_warp<uint32, double>( (uint32*) img.bits(sample), w, h, w,
+                                  (uint32*) bmp->bits[sample], bmp->i.width, bmp->i.height, bmp->i.width, inv, method, background );
+    else
+    if (bmp->i.depth==8 && bmp->i.pixelType==FMT_SIGNED)
+      image_warp<int8, float>( (int8*) img.bits(sample), w, h, w,
+                               (int8*) bmp->bits[sample], bmp->i.width, bmp->i.height, bmp->i.width, inv, method, background );
+    else
+    if (bmp->i.depth==16 && bmp->i.pixelType==FMT_SIGNED)
+      image_warp<int16, float>( (int16*) img.bits(sample), w, h, w,
+                                (int16*) bmp->bits[sample], bmp->i.width, bmp->i.height, bmp->i.width, inv, method, background );
+    else
+    if (bmp->i.depth==32 && bmp->i.pixelType==FMT_SIGNED)
+      image_warp<int32, double>( (int32*) img.bits(sample), w, h, w,
+                                 (int32*) bmp->bits[sample], bmp->i.width, bmp->i.height, bmp->i.width, inv, method, background );
+    else
+    if (bmp->i.depth==32 && bmp->i.pixelType==FMT_FLOAT)
+      image_warp<float32, double>( (float32*) img.bits(sample), w, h, w,
+                                   (float32*) bmp->bits[sample], bmp->i.width, bmp->i.height, bmp->i.width, inv, method, background );
+    else
+    if (bmp->i.depth==64 && bmp->i.pixelType==FMT_FLOAT)
+      image_warp<float64, double>( (float64*) img.bits(sample), w, h, w,
+                                   (float64*) bmp->bits[sample], bmp->i.width, bmp->i.height, bmp->i.width, inv, method, background );
+
+  } // sample
+
+  img.bmp->i = this->bmp->i;
+  img.bmp->i.width  = w;
+  img.bmp->i.height = h;
+  img.metadata = this->metadata;
+  return img;
+}
+
+static Image::ResizeMethod parse_resize_method( const xstring &s, Image::ResizeMethod def ) {
+  if (s.toLowerCase() == "nn") return Image::szNearestNeighbor;
+  if (s.toLowerCase() == "bl") return Image::szBiLinear;
+  if (s.toLowerCase() == "bc") return Image::szBiCubic;
+  return def;
+}
+
+// -transform_geometry m0,m1,m2,m3,m4,m5[,m6,m7,m8][,NN|BL|BC]
+Image operation_transform_geometry(Image &img, const bim::xstring &arguments, const xoperations &operations, ImageHistogram *hist, XConf *c) {
+    std::vector<xstring> strl = arguments.split(",");
+    Image::ResizeMethod method = Image::szBiLinear;
+    if (strl.size()==7 || strl.size()==10) {
+        method = parse_resize_method(strl.back(), method);
+        strl.pop_back();
+    }
+    if (strl.size()!=6 && strl.size()!=9) {
+        std::cout << "Geometric transform needs 6 affine or 9 projective matrix values...\n";
+        return img;
+    }
+    std::vector<double> m;
+    for (size_t i=0; i<strl.size(); ++i)
+        m.push_back( strl[i].toDouble(0) );
+    Image out = img.transform_geometry(m, method);
+    if (out.isEmpty()) {
+        std::cout << "Geometric transform matrix is singular...\n";
+        return img;
+    }
+    return out;
+};
+
 Image Image::rotate_guess() const {
     double angle = 0;
     bool mirror = false;
     
-    xstring orientation = this->metadata.get_value( "Exif/Image/Orientation", "" );
+    xstring orientation = this->metadata->get_value( "Exif/Image/Orientation", "" );
 
     if (orientation == "top, left")           angle = 0; // exif value 1
     else if (orientation == "top, right")     { angle = 0; mirror = true; } // exif value 2
@@ -1421,8 +1585,8 @@ Image Image::rotate_guess() const {
         img = img.mirror();
 
     // reset orientation tag
-    if (metadata.hasKey("Exif/Image/Orientation"))
-        img.metadata.set_value( "Exif/Image/Orientation", "top, left" );  
+    if (metadata->hasKey("Exif/Image/Orientation"))
+        img.metadata.edit().set_value( "Exif/Image/Orientation", "top, left" );  
 
     return img;
 }
@@ -1485,14 +1649,10 @@ Image operation_rotate(Image &img, const bim::xstring &arguments, const xoperati
     if (arguments.toLowerCase() == "guess") {
         return img.rotate_guess();
     }
-    else if (arguments.toDouble(0) != 0) {
-        double rotate_angle = arguments.toDouble(0);
-        if (rotate_angle != 0 && rotate_angle != 90 && rotate_angle != -90 && rotate_angle != 180) {
-            std::cout << "This rotation angle value is not yet supported...\n";
-            return img;
-        }
-
-        return img.rotate(rotate_angle);
+    std::vector<xstring> strl = arguments.split(",");
+    if (strl.size()>0 && strl[0].toDouble(0) != 0) {
+        Image::ResizeMethod method = strl.size()>1 ? parse_resize_method(strl[1], Image::szBiLinear) : Image::szBiLinear;
+        return img.rotate(strl[0].toDouble(0), method);
     }
     return img;
 };
@@ -2173,7 +2333,7 @@ Image operation_threshold(Image &img, const bim::xstring &arguments, const xoper
 std::vector<bim::DisplayColor> init_fusion_from_meta(const Image &img) {
     std::vector<bim::DisplayColor> out_weighted_fuse_channels;
     std::vector<bim::DisplayColor> channel_colors_default = bim::defaultChannelColors();
-    bim::TagMap m = img.get_metadata();
+    const bim::TagMap &m = *img.meta();
     int num_samples = img.samples();
     if (img.imageMode()==IM_RGBA || (img.imageMode()==IM_RGB && num_samples==4)) {
         num_samples = 3;
@@ -2301,14 +2461,14 @@ Image Image::fuse( int red, int green, int blue, int yellow, int magenta, int cy
 // Channel fusion
 //------------------------------------------------------------------------------------
 
-TagMap fuseMetadata( const TagMap &md, unsigned int samples, const std::vector< std::vector< std::pair<int,float> > > &map ) {
+SharedTagMap fuseMetadata( const SharedTagMap &md, unsigned int samples, const std::vector< std::vector< std::pair<int,float> > > &map ) {
 
     if (md.size()==0) return md;
-    TagMap metadata = md;
+    SharedTagMap metadata = md;
 
     std::vector<std::string> channel_names;
     for (unsigned int i=0; i<samples; ++i)
-        channel_names.push_back( metadata.get_value(xstring::xprintf("channel_%d_name",i), xstring::xprintf("%d",i)) );
+        channel_names.push_back( md->get_value(xstring::xprintf("channel_%d_name",i), xstring::xprintf("%d",i)) );
 
     for (unsigned int i=0; i<map.size(); ++i) {
         xstring new_name;
@@ -2320,7 +2480,7 @@ TagMap fuseMetadata( const TagMap &md, unsigned int samples, const std::vector<
             }
             //new_name = xstring::xprintf("%d",i);
         } 
-        metadata.set_value( xstring::xprintf("channel_%d_name",i), new_name);
+        metadata.edit().set_value( xstring::xprintf("channel_%d_name",i), new_name);
     }
 
     return metadata;
@@ -2574,6 +2734,196 @@ Image Image::fuseToRGB(const std::vector<bim::DisplayColor> &mapping, Image::Fus
     return fuse( map, method, hist );
 }
 
+//------------------------------------------------------------------------------------
+// Display rendering
+//------------------------------------------------------------------------------------
+
+// maps the display range of a channel onto the output range, args = DisplayRange*
+void display_range_generator(const Histogram &in, std::vector<Lut::StorageType> &lut, unsigned int out_phys_range, void *args) {
+    const DisplayRange *r = (const DisplayRange *) args;
+    double b = in.first_pos();
+    double e = in.last_pos();
+    if (r->minv != r->maxv) {
+        b = (r->minv - in.get_shift()) * in.get_scale();
+        e = (r->maxv - in.get_shift()) * in.get_scale();
+    }
+    double range = e - b;
+    if (range <= 0) range = 1;
+    double gamma = r->gamma > 0 ? 1.0 / r->gamma : 1.0;
+    for (unsigned int x = 0; x<lut.size(); ++x) {
+        double v = bim::trim<double, double>((x - b) / range, 0.0, 1.0);
+        lut[x] = pow(v, gamma) * (out_phys_range - 1);
+    }
+}
+
+struct display_channel {
+    int sample;
+    const Lut::StorageType *lut;
+    double shift;
+    double scale;
+    unsigned int last_bin;
+    double weight[3];
+};
+
+// out holds pointers to the first pixel of each output component, pixels are step bytes apart
+template <typename T>
+void render_display_channels(const Image &img, const std::vector<display_channel> &channels, Image::FuseMethod method, 
+                             unsigned char *out[3], bim::uint64 step, bim::uint64 stride) {
+    const bool direct = std::numeric_limits<T>::is_integer && sizeof(T) <= 2;
+    bim::uint64 w = img.width();
+    bim::uint64 h = img.height();
+    double num[3] = { 0, 0, 0 };
+    for (size_t c = 0; c<channels.size(); ++c)
+        for (int k = 0; k<3; ++k)
+            if (channels[c].weight[k] > 0) num[k]++;
+    for (int k = 0; k<3; ++k)
+        if (method != Image::fmAverage || num[k] == 0) num[k] = 1;
+
+    #pragma omp parallel default(shared) if (h>BIM_OMP_FOR2)
+    {
+        std::vector<double> line(w * 3);
+        #pragma omp for BIM_OMP_SCHEDULE
+        for (bim::int64 y = 0; y<(bim::int64)h; ++y) {
+            std::fill(line.begin(), line.end(), 0.0);
+            for (size_t c = 0; c<channels.size(); ++c) {
+                const display_channel &dc = channels[c];
+                const T *src = (const T *) img.scanLine(dc.sample, y);
+                for (bim::uint64 x = 0; x<w; ++x) {
+                    unsigned int bin = direct ? (unsigned int) ((bim::int64) src[x] - (bim::int64) bim::lowest<T>())
+                                              : bim::trim<unsigned int, double>((src[x] - dc.shift) * dc.scale, 0, dc.last_bin);
+                    double v = dc.lut[bin];
+                    double *p = &line[x * 3];
+                    if (method == Image::fmMax) {
+                        p[0] = std::max<double>(p[0], v * dc.weight[0]);
+                        p[1] = std::max<double>(p[1], v * dc.weight[1]);
+                        p[2] = std::max<double>(p[2], v * dc.weight[2]);
+                    } else {
+                        p[0] += v * dc.weight[0];
+                        p[1] += v * dc.weight[1];
+                        p[2] += v * dc.weight[2];
+                    }
+                }
+            } // channels
+
+            for (int k = 0; k<3; ++k) {
+                unsigned char *dest = out[k] + y * stride;
+                for (bim::uint64 x = 0; x<w; ++x)
+                    dest[x * step] = bim::trim<unsigned char, double>(line[x * 3 + k] / num[k], 0, 255);
+            }
+        } // y
+    }
+}
+
+static bool render_display(const Image &img, unsigned char *out[3], bim::uint64 step, bim::uint64 stride, const std::vector<bim::DisplayColor> &colors, 
+                           const std::vector<DisplayRange> &ranges, Image::FuseMethod method, ImageHistogram *hin) {
+    unsigned int samples = bim::min<unsigned int>(img.samples(), (unsigned int) colors.size());
+
+    // integer images up to 16 bits have a bin per value and with given ranges need no statistics,
+    // other images are binned over their data range finely enough for 8 bit output
+    bool binned = img.depth() > 16 || img.pixelType() == FMT_FLOAT;
+    bool need_stats = binned;
+    for (unsigned int i = 0; i<samples; ++i)
+        if (i >= ranges.size() || ranges[i].minv == ranges[i].maxv) need_stats = true;
+    bool use_hin = !binned && hin && hin->isValid() && hin->channels() >= (int) samples;
+
+    std::vector<Histogram> hist(samples);
+    for (unsigned int i = 0; i<samples; ++i) {
+        if (use_hin) {
+            hist[i] = *(*hin)[i];
+        } else if (need_stats) {
+            if (binned) hist[i].setDefaultSize(65536);
+            hist[i].newData(img.depth(), img.bits(i), (unsigned int) img.numPixels(), img.pixelType());
+        } else {
+            hist[i].init(img.depth(), img.pixelType());
+        }
+    }
+
+    double max_contribution = 0;
+    for (unsigned int i = 0; i<samples; ++i) {
+        max_contribution = std::max<double>(max_contribution, colors[i].r);
+        max_contribution = std::max<double>(max_contribution, colors[i].g);
+        max_contribution = std::max<double>(max_contribution, colors[i].b);
+    }
+    if (max_contribution <= 0) max_contribution = 1;
+
+    Histogram out_hist(8, FMT_UNSIGNED);
+    std::vector<Lut> luts(samples);
+    std::vector<display_channel> channels;
+    for (unsigned int i = 0; i<samples; ++i) {
+        if (colors[i].r <= 0 && colors[i].g <= 0 && colors[i].b <= 0) continue;
+        DisplayRange r = i<ranges.size() ? ranges[i] : DisplayRange();
+        luts[i].init(hist[i], out_hist, display_range_generator, &r);
+        display_channel dc;
+        dc.sample = i;
+        dc.lut = &luts[i].get_lut()[0];
+        dc.shift = hist[i].get_shift();
+        dc.scale = hist[i].get_scale();
+        dc.last_bin = luts[i].size() - 1;
+        dc.weight[0] = bim::max<double>(colors[i].r, 0) / max_contribution;
+        dc.weight[1] = bim::max<double>(colors[i].g, 0) / max_contribution;
+        dc.weight[2] = bim::max<double>(colors[i].b, 0) / max_contribution;
+        channels.push_back(dc);
+    }
+
+    if (img.depth() == 8 && img.pixelType() == FMT_UNSIGNED)
+        render_display_channels<uint8>(img, channels, method, out, step, stride);
+    else
+    if (img.depth() == 16 && img.pixelType() == FMT_UNSIGNED)
+        render_display_channels<uint16>(img, channels, method, out, step, stride);
+    else
+    if (img.depth() == 32 && img.pixelType() == FMT_UNSIGNED)
+        render_display_channels<uint32>(img, channels, method, out, step, stride);
+    else
+    if (img.depth() == 8 && img.pixelType() == FMT_SIGNED)
+        render_display_channels<int8>(img, channels, method, out, step, stride);
+    else
+    if (img.depth() == 16 && img.pixelType() == FMT_SIGNED)
+        render_display_channels<int16>(img, channels, method, out, step, stride);
+    else
+    if (img.depth() == 32 && img.pixelType() == FMT_SIGNED)
+        render_display_channels<int32>(img, channels, method, out, step, stride);
+    else
+    if (img.depth() == 32 && img.pixelType() == FMT_FLOAT)
+        render_display_channels<float32>(img, channels, method, out, step, stride);
+    else
+    if (img.depth() == 64 && img.pixelType() == FMT_FLOAT)
+        render_display_channels<float64>(img, channels, method, out, step, stride);
+    else
+        return false;
+    return true;
+}
+
+bool Image::renderToRGB(unsigned char *rgb, bim::uint64 stride, const std::vector<bim::DisplayColor> &colors, const std::vector<DisplayRange> &ranges,
+                        Image::FuseMethod method, ImageHistogram *hist) const {
+    if (bmp == NULL || rgb == NULL) return false;
+    unsigned char *out[3] = { rgb, rgb + 1, rgb + 2 };
+    return render_display(*this, out, 3, stride, colors, ranges, method, hist);
+}
+
+Image Image::renderToRGB(const std::vector<bim::DisplayColor> &colors, const std::vector<DisplayRange> &ranges, Image::FuseMethod method, ImageHistogram *hist) const {
+    Image img;
+    if (bmp == NULL) return img;
+    if (img.alloc(bmp->i.width, bmp->i.height, 3, 8) != 0) return Image();
+    unsigned char *out[3] = { (unsigned char *) img.bits(0), (unsigned char *) img.bits(1), (unsigned char *) img.bits(2) };
+    if (!render_display(*this, out, 1, img.bytesPerLine(), colors, ranges, method, hist)) return Image();
+
+    // channel contributions as in fuseToRGB for the fused metadata
+    std::vector< std::vector< std::pair<int, float> > > map(3);
+    for (unsigned int i = 0; i<colors.size() && i<bmp->i.samples; ++i) {
+        map[0].push_back(std::make_pair(colors[i].r>0 ? (int) i : -1, (float) colors[i].r));
+        map[1].push_back(std::make_pair(colors[i].g>0 ? (int) i : -1, (float) colors[i].g));
+        map[2].push_back(std::make_pair(colors[i].b>0 ? (int) i : -1, (float) colors[i].b));
+    }
+
+    img.bmp->i = this->bmp->i;
+    img.bmp->i.samples = 3;
+    img.bmp->i.depth = 8;
+    img.bmp->i.pixelType = FMT_UNSIGNED;
+    img.bmp->i.imageMode = IM_RGB;
+    img.metadata = fuseMetadata(this->metadata, bmp->i.samples, map);
+    return img;
+}
+
 Image operation_fusegrey(Image &img, const bim::xstring &arguments, const xoperations &operations, ImageHistogram *hist, XConf *c) {
     hist->clear(); // dima: should properly modify instead of clearing
     return img.fuseToGrayscale();
@@ -2610,6 +2960,32 @@ Image operation_fusemeta(Image &img, const bim::xstring &arguments, const xopera
     return img;
 };
 
+// channels are separated by semicolon as r,g,b[,min,max[,gamma]], "meta" takes colors from metadata
+Image operation_render(Image &img, const bim::xstring &arguments, const xoperations &operations, ImageHistogram *hist, XConf *c) {
+    Image::FuseMethod fuse_method = Image::fmAdd;
+    if (operations.arguments("-fusemethod").toLowerCase() == "m") fuse_method = Image::fmMax;
+    if (operations.arguments("-fusemethod").toLowerCase() == "a") fuse_method = Image::fmAverage;
+
+    std::vector<bim::DisplayColor> colors;
+    std::vector<DisplayRange> ranges;
+    if (arguments.size() == 0 || arguments.toLowerCase() == "meta") {
+        colors = init_fusion_from_meta(img);
+    } else {
+        std::vector<xstring> ch = arguments.split(";");
+        for (int c = 0; c<ch.size(); ++c) {
+            std::vector<double> v = ch[c].splitDouble(",");
+            double gamma = v.size()>5 ? v[5] : 1.0;
+            v.resize(5, 0);
+            colors.push_back(bim::DisplayColor((int) v[0], (int) v[1], (int) v[2]));
+            ranges.push_back(DisplayRange(v[3], v[4], gamma));
+        }
+    }
+
+    img = img.renderToRGB(colors, ranges, fuse_method, hist);
+    hist->clear(); // dima: should properly modify instead of clearing
+    return img;
+};
+
 Image operation_fuse(Image &img, const bim::xstring &arguments, const xoperations &operations, ImageHistogram *hist, XConf *c) {
     Image::FuseMethod fuse_method = Image::fmAverage;
     if (operations.arguments("-fusemethod").toLowerCase() == "m") fuse_method = Image::fmMax; // dima: should be moved into command args
@@ -2667,12 +3043,12 @@ Image operation_fuse6(Image &img, const bim::xstring &arguments, const xoperatio
 //Append channels
 //------------------------------------------------------------------------------------
 
-void appendChannelMetadata( TagMap &md, const TagMap &i2md, int c1, int c2 ) {
+void appendChannelMetadata( SharedTagMap &md, const TagMap &i2md, int c1, int c2 ) {
   for (int i=0; i<c2; ++i) {
     xstring key1 = xstring::xprintf("channel_%d_name", c1+i);    
     xstring key2 = xstring::xprintf("channel_%d_name", i);
     if ( i2md.hasKey(key2) )
-      md.set_value(key1, i2md.get_value(key2) );
+      md.edit().set_value(key1, i2md.get_value(key2) );
   }
 }
 
@@ -2701,7 +3077,7 @@ Image Image::appendChannels( const Image &i2 ) const {
   img.bmp->i.samples = c;
   img.metadata = this->metadata;
   //img.histo = this->histo;
-  appendChannelMetadata( img.metadata, i2.metadata, this->samples(), i2.samples() );
+  appendChannelMetadata( img.metadata, *i2.metadata, this->samples(), i2.samples() );
   return img;
 }
 
@@ -2713,17 +3089,17 @@ void Image::updateGeometry(const unsigned int &z, const unsigned int &t, const u
   if (bmp==NULL) return; 
   if (z>0) {
     bmp->i.number_z = z;
-    metadata.set_value( "image_num_z", z );
+    metadata.edit().set_value( "image_num_z", z );
   }
 
   if (t>0) {
     bmp->i.number_t = t;
-    metadata.set_value( "image_num_t", t );
+    metadata.edit().set_value( "image_num_t", t );
   }
 
   if (c>1) {
       bmp->i.samples = c;
-      metadata.set_value("image_num_c", c);
+      metadata.edit().set_value("image_num_c", c);
   }
 }
 
@@ -2733,14 +3109,15 @@ void Image::updateResolution( const double r[4] ) {
   bmp->i.yRes = r[1];
   bmp->i.resUnits = RES_um;
 
-  metadata.set_value("pixel_resolution_x", r[0]);
-  metadata.set_value("pixel_resolution_y", r[1]);
-  metadata.set_value("pixel_resolution_z", r[2]);
-  metadata.set_value("pixel_resolution_t", r[3]);
-  metadata.set_value( "pixel_resolution_unit_x", "microns" );
-  metadata.set_value( "pixel_resolution_unit_y", "microns" );
-  metadata.set_value( "pixel_resolution_unit_z", "microns" );
-  metadata.set_value( "pixel_resolution_unit_t", "seconds" );
+  TagMap &md = metadata.edit();
+  md.set_value("pixel_resolution_x", r[0]);
+  md.set_value("pixel_resolution_y", r[1]);
+  md.set_value("pixel_resolution_z", r[2]);
+  md.set_value("pixel_resolution_t", r[3]);
+  md.set_value( "pixel_resolution_unit_x", "microns" );
+  md.set_value( "pixel_resolution_unit_y", "microns" );
+  md.set_value( "pixel_resolution_unit_z", "microns" );
+  md.set_value( "pixel_resolution_unit_t", "seconds" );
 }
 
 
@@ -3021,9 +3398,8 @@ Image operation_superpixels(Image &img, const bim::xstring &arguments, const xop
 
 Image operation_meta_remove(Image &img, const bim::xstring &arguments, const xoperations &operations, ImageHistogram *hist, XConf *c) {
     std::vector<xstring> tags = arguments.split(",");
-    bim::TagMap *meta = (bim::TagMap *) img.meta();
     for (int i = 0; i < tags.size(); ++i) {
-        meta->delete_tag(tags[i]);
+        img.delete_metadata_tag(tags[i]);
     }
     return img;
 };
@@ -3036,18 +3412,14 @@ Image operation_meta_keep(Image &img, const bim::xstring &arguments, const xoper
         keys.append_tag(tags[i], "");
     }
 
-    // remove all tags except given
-    bim::TagMap *meta = (bim::TagMap *) img.meta();
-    bim::TagMap::iterator it = meta->begin();
-    while (it != meta->end()) {
-        if (!keys.hasKey((*it).first)) {
-            bim::TagMap::iterator delit = it;
-            ++it;
-            meta->erase(delit);
-        } else {
-            ++it;
-        }
+    // remove all tags except given, kept values are shared with the original map
+    const bim::TagMap *meta = img.meta();
+    bim::TagMap kept;
+    for (bim::TagMap::const_iterator it = meta->begin(); it != meta->end(); ++it) {
+        if (keys.hasKey((*it).first))
+            kept.insert(*it);
     }
+    img.set_metadata(kept);
     return img;
 };
 
@@ -3062,6 +3434,7 @@ std::map<std::string, ImageModifierProc> Image::create_modifiers() {
     ops["-fusegrey"] = operation_fusegrey;
     ops["-fusergb"] = operation_fusergb;
     ops["-fusemeta"] = operation_fusemeta;
+    ops["-render"] = operation_render;
     ops["-display"] = operation_fusemeta;
     ops["-fuse"] = operation_fuse;
     ops["-fuse6"] = operation_fuse6;
@@ -3070,6 +3443,7 @@ std::map<std::string, ImageModifierProc> Image::create_modifiers() {
     ops["-resize"] = operation_resize;
     ops["-resample"] = operation_resample;
     ops["-rotate"] = operation_rotate;
+    ops["-transform_geometry"] = operation_transform_geometry;
     ops["-mirror"] = operation_mirror;
     ops["-flip"] = operation_flip;
     ops["-negative"] = operation_negative;
@@ -3100,6 +3474,187 @@ std::map<std::string, ImageModifierProc> Image::create_modifiers() {
     return ops;
 }
 
+//------------------------------------------------------------------------------------
+// Fused pointwise modifiers
+//------------------------------------------------------------------------------------
+
+// modifiers mapping each pixel value independently of its position, statistics they
+// use come from the histogram passed along the chain
+static bool is_pointwise_modifier(ImageModifierProc f) {
+    return f == operation_negative || f == operation_levels || f == operation_brightnesscontrast
+        || f == operation_stretch || f == operation_depth
+        #ifdef BIM_USE_TRANSFORMS
+        || f == operation_hounsfield
+        #endif
+        ;
+}
+
+// pixel types where every representable value fits into a lookup table
+static bool is_lut_type(const Image &img) {
+    return (img.depth() == 8 || img.depth() == 16) && (img.pixelType() == FMT_UNSIGNED || img.pixelType() == FMT_SIGNED);
+}
+
+template <typename T>
+void image_fill_values(Image &img) {
+    for (unsigned int sample = 0; sample<img.samples(); ++sample) {
+        T *p = (T *) img.bits(sample);
+        for (bim::uint64 x = 0; x<img.width(); ++x)
+            p[x] = (T) (bim::lowest<T>() + (bim::int64) x);
+    }
+}
+
+// histogram of the image after the mapping given by values, in holds counts of the original values
+template <typename T>
+void image_values_histogram(const Image &values, const ImageHistogram &in, ImageHistogram &out) {
+    out = ImageHistogram(values.samples(), values.depth(), values.pixelType());
+    for (unsigned int sample = 0; sample<values.samples(); ++sample) {
+        const T *v = (const T *) values.bits(sample);
+        for (bim::uint64 x = 0; x<values.width(); ++x)
+            out[sample]->append_value((unsigned int) ((bim::int64) v[x] - (bim::int64) bim::lowest<T>()), in[sample]->get_value((unsigned int) x));
+    }
+}
+
+template <typename Ti, typename To>
+void image_values_lut(const Image &in, Image &out, const Image &values) {
+    bim::uint64 w = in.numPixels();
+    for (unsigned int sample = 0; sample<in.samples(); ++sample) {
+        const Ti *src = (const Ti *) in.bits(sample);
+        const To *lut = (const To *) values.bits(sample);
+        To *dest = (To *) out.bits(sample);
+        #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (w>BIM_OMP_FOR1)
+        for (bim::int64 x = 0; x<(bim::int64)w; ++x)
+            dest[x] = lut[(bim::int64) src[x] - (bim::int64) bim::lowest<Ti>()];
+    }
+}
+
+template <typename Ti>
+void image_values_lut(const Image &in, Image &out, const Image &values) {
+    if (values.depth() == 8 && values.pixelType() == FMT_UNSIGNED)
+        image_values_lut<Ti, uint8>(in, out, values);
+    else
+    if (values.depth() == 16 && values.pixelType() == FMT_UNSIGNED)
+        image_values_lut<Ti, uint16>(in, out, values);
+    else
+    if (values.depth() == 32 && values.pixelType() == FMT_UNSIGNED)
+        image_values_lut<Ti, uint32>(in, out, values);
+    else
+    if (values.depth() == 8 && values.pixelType() == FMT_SIGNED)
+        image_values_lut<Ti, int8>(in, out, values);
+    else
+    if (values.depth() == 16 && values.pixelType() == FMT_SIGNED)
+        image_values_lut<Ti, int16>(in, out, values);
+    else
+    if (values.depth() == 32 && values.pixelType() == FMT_SIGNED)
+        image_values_lut<Ti, int32>(in, out, values);
+    else
+    if (values.depth() == 32 && values.pixelType() == FMT_FLOAT)
+        image_values_lut<Ti, float32>(in, out, values);
+    else
+    if (values.depth() == 64 && values.pixelType() == FMT_FLOAT)
+        image_values_lut<Ti, float64>(in, out, values);
+}
+
+// Runs a chain of at least two consecutive pointwise modifiers over an image holding
+// every value representable by the 8 or 16 bit integer pixel type and applies the
+// resulting table to the image in a single pass. Modifiers see exactly the statistics
+// they would see one by one: the histogram passed along the chain if it is valid and
+// otherwise the histogram of their actual input, obtained by carrying the counts of
+// the original image through the table. Returns the first modifier not consumed.
+xoperations::const_iterator Image::process_pointwise(xoperations::const_iterator it, const xoperations &operations, ImageHistogram *hist, XConf *c) {
+    if (!bmp || !is_lut_type(*this)) return it;
+    bim::uint64 num_values = ((bim::uint64) 1) << this->depth();
+    if (this->numPixels() <= num_values) return it;
+
+    int num_pointwise = 0;
+    for (xoperations::const_iterator o = it; o != operations.end() && num_pointwise<2; ++o) {
+        map_modifiers::const_iterator fit = modifiers.find(o->first);
+        if (fit == modifiers.end()) continue;
+        if (!is_pointwise_modifier(fit->second)) break;
+        ++num_pointwise;
+    }
+    if (num_pointwise < 2) return it;
+
+    ScopedTimer timer("operation/fused");
+    Image values(num_values, 1, this->depth(), this->samples(), this->pixelType());
+    if (!values.bmp || values.isNull()) return it;
+    values.bmp->i = this->bmp->i;
+    values.bmp->i.width = num_values;
+    values.bmp->i.height = 1;
+    values.metadata = this->metadata;
+    if (this->pixelType() == FMT_UNSIGNED && this->depth() == 8)
+        image_fill_values<uint8>(values);
+    else
+    if (this->pixelType() == FMT_UNSIGNED && this->depth() == 16)
+        image_fill_values<uint16>(values);
+    else
+    if (this->pixelType() == FMT_SIGNED && this->depth() == 8)
+        image_fill_values<int8>(values);
+    else
+    if (this->pixelType() == FMT_SIGNED && this->depth() == 16)
+        image_fill_values<int16>(values);
+
+    bool chain_stats = hist && hist->isValid();
+    ImageHistogram counts, stats;
+    if (!chain_stats) counts.fromImage(*this);
+
+    xoperations::const_iterator o = it;
+    for (; o != operations.end(); ++o) {
+        map_modifiers::const_iterator fit = modifiers.find(o->first);
+        if (fit == modifiers.end()) continue;
+        ImageModifierProc f = (*fit).second;
+        if (!is_pointwise_modifier(f) || !is_lut_type(values)) break;
+
+        ImageHistogram *h = hist;
+        if (!chain_stats) {
+            // combined channel statistics are only computed by the modifier itself
+            std::vector<xstring> strl = o->second.split(",");
+            if (f == operation_depth && strl.size()>3 && strl[3].toLowerCase() == "cc") break;
+            if (values.depth() == 8 && values.pixelType() == FMT_UNSIGNED)
+                image_values_histogram<uint8>(values, counts, stats);
+            else
+            if (values.depth() == 16 && values.pixelType() == FMT_UNSIGNED)
+                image_values_histogram<uint16>(values, counts, stats);
+            else
+            if (values.depth() == 8 && values.pixelType() == FMT_SIGNED)
+                image_values_histogram<int8>(values, counts, stats);
+            else
+            if (values.depth() == 16 && values.pixelType() == FMT_SIGNED)
+                image_values_histogram<int16>(values, counts, stats);
+            h = &stats;
+        }
+
+        c->print(xstring::xprintf("About to run fused %s", o->first.c_str()), 2);
+        values = (*f)(values, o->second, operations, h, c);
+        if (!values.bmp || values.isNull()) {
+            *this = values;
+            return ++o;
+        }
+    }
+
+    Image out;
+    if (out.alloc(this->width(), this->height(), values.samples(), values.depth()) == 0) {
+        out.bmp->i = values.bmp->i;
+        out.bmp->i.width = this->width();
+        out.bmp->i.height = this->height();
+        out.metadata = values.metadata;
+
+        if (this->pixelType() == FMT_UNSIGNED && this->depth() == 8)
+            image_values_lut<uint8>(*this, out, values);
+        else
+        if (this->pixelType() == FMT_UNSIGNED && this->depth() == 16)
+            image_values_lut<uint16>(*this, out, values);
+        else
+        if (this->pixelType() == FMT_SIGNED && this->depth() == 8)
+            image_values_lut<int8>(*this, out, values);
+        else
+        if (this->pixelType() == FMT_SIGNED && this->depth() == 16)
+            image_values_lut<int16>(*this, out, values);
+    }
+    *this = out;
+    if (bmp) timer.add(this->bytesPerChan() * this->samples(), this->width() * this->height());
+    return o;
+}
+
 void Image::process(const xoperations &operations, ImageHistogram *_hist, XConf *c) {
     ImageHistogram hist;
     if (!_hist) hist.fromImage(*this); else hist = *_hist;
@@ -3107,14 +3662,22 @@ void Image::process(const xoperations &operations, ImageHistogram *_hist, XConf
     if (!c) c = &cc;
 
     for (xoperations::const_iterator it = operations.begin(); it != operations.end(); ++it) {
+        xoperations::const_iterator next = this->process_pointwise(it, operations, &hist, c);
+        if (next != it) {
+            if (next == operations.end()) break;
+            it = next;
+        }
         std::string operation = it->first;
         bim::xstring arguments = it->second;
         map_modifiers::const_iterator fit = modifiers.find(operation);
         if (fit != modifiers.end()) {
             c->print(xstring::xprintf("About to run %s", operation.c_str()), 2);
             c->timerStart();
+            ScopedTimer timer("operation/" + operation);
             ImageModifierProc f = (*fit).second;
-            *this = (*f)(*this, arguments, operations, &hist, &cc);
+            *this = (*f)(*this, arguments, operations, &hist, c);
+            if (bmp) timer.add(this->bytesPerChan() * this->samples(), this->width() * this->height());
+            timer.stop();
             c->printElapsed(xstring::xprintf("%s ran in: ", operation.c_str()), 2);
         }
     }
@@ -30,8 +30,15 @@
 
   History:
     03/23/2004 18:03 - First creation
+    10/19/2026 12:00 - Copy-on-write shared metadata
+    10/19/2026 12:00 - Channel metadata remapping for channel selective reads
+    10/19/2026 12:00 - Fused evaluation of runs of pointwise modifiers
+    10/19/2026 12:00 - Single pass rendering of display RGB images
+    10/19/2026 12:00 - Arbitrary rotation and affine/projective warps
+    10/19/2026 12:00 - Mutable metadata access detaches shared metadata
+    10/19/2026 12:00 - Superpixel tile size set by the caller
       
-  ver: 12
+  ver: 19
         
 *******************************************************************************/
 
@@ -92,6 +99,13 @@ class Image;
 
 typedef Image(*ImageModifierProc) (Image &img, const bim::xstring &arguments, const xoperations &operations, ImageHistogram *hist, XConf *c);
 
+// display range of a channel, values from minv to maxv are stretched over the display range and
+// gamma is applied to the normalized value, equal minv and maxv use the data range of the channel
+struct DisplayRange {
+    double minv, maxv, gamma;
+    DisplayRange(double minv=0, double maxv=0, double gamma=1.0): minv(minv), maxv(maxv), gamma(gamma) {}
+};
+
 //------------------------------------------------------------------------------
 // Image
 //------------------------------------------------------------------------------
@@ -321,15 +335,19 @@ class Image {
     // Metadata
     //--------------------------------------------------------------------------
 
-    const TagMap *meta() const { return &metadata; }
-    TagMap      get_metadata() const { return metadata; }
-    std::string get_metadata_tag( const std::string &key, const std::string &def ) const { return metadata.get_value( key, def ); }
-    int         get_metadata_tag_int( const std::string &key, const int &def ) const { return metadata.get_value_int( key, def ); }
-    double      get_metadata_tag_double( const std::string &key, const double &def ) const { return metadata.get_value_double( key, def ); }
+    // metadata is shared between copies of the image and cloned on the first modification
+    const TagMap *meta() const { return metadata.operator->(); }
+    TagMap      *edit_metadata() { return &metadata.edit(); }
+    TagMap      get_metadata() const { return *metadata; }
+    const SharedTagMap &get_shared_metadata() const { return metadata; }
+    std::string get_metadata_tag( const std::string &key, const std::string &def ) const { return metadata->get_value( key, def ); }
+    int         get_metadata_tag_int( const std::string &key, const int &def ) const { return metadata->get_value_int( key, def ); }
+    double      get_metadata_tag_double( const std::string &key, const double &def ) const { return metadata->get_value_double( key, def ); }
 
-    void        delete_metadata_tag(const std::string &key) { metadata.delete_tag(key); }
+    void        delete_metadata_tag(const std::string &key) { if (metadata->hasKey(key)) metadata.edit().delete_tag(key); }
 
     void        set_metadata( const TagMap &md ) { metadata = md; }
+    void        set_metadata( const SharedTagMap &md ) { metadata = md; }
     
     //--------------------------------------------------------------------------    
     // histogram
@@ -370,12 +388,20 @@ class Image {
     // resize will use image pyramid if size difference is quite large
     Image resize( uint w, uint h=0, ResizeMethod method = szNearestNeighbor, bool keep_aspect_ratio = false ) const;
 
-    // only available values now are +90, -90 and 180
-    Image rotate( double deg ) const;
+    // positive angles rotate clockwise, +90, -90 and 180 are exact, other angles are
+    // interpolated around the image center into the bounding box of the rotated image
+    Image rotate( double deg, ResizeMethod method = szBiLinear ) const;
     Image rotate_guess() const; // rotates image guessing orientation using EXIF tags
     Image mirror() const; // mirror the image horizontally
     Image flip() const; // flip the image vertically 
 
+    // warps the image by a matrix mapping input pixel coordinates into the output ones,
+    // 6 values give an affine transform: x' = m0*x + m1*y + m2, y' = m3*x + m4*y + m5
+    // 9 values give a projective one where x' and y' are further divided by m6*x + m7*y + m8
+    // output has the given size or the size of the input, uncovered pixels get the background
+    Image transform_geometry( const std::vector<double> &m, ResizeMethod method = szBiLinear, 
+                              uint w = 0, uint h = 0, double background = 0 ) const;
+
     Image negative() const;
 
     void trim(double min_v, double max_v) const;
@@ -446,22 +472,14 @@ class Image {
     Image filter_edge() const;
 
     // regionSize in pixels, regularization 0-1, with 0 shape is least regular
-    Image superpixels(bim::uint64 regionSize, float regularization, float min_size_ratio = 0.7) const;
+    // tile_size bounds working memory for large images, 0 uses 2048 or 8 regions whichever is larger
+    Image superpixels(bim::uint64 regionSize, float regularization, float min_size_ratio = 0.7, bim::uint64 tile_size = 0) const;
     #endif //BIM_USE_FILTERS
 
     //--------------------------------------------------------------------------    
     // transforms
     //--------------------------------------------------------------------------
     #ifdef BIM_USE_TRANSFORMS
-    /*
-    enum TransformGeometryMethod { 
-      tmgNone=0, 
-      tmgAffine=1, 
-      tmgProjective=2, 
-    };
-    Image transform_geometry( m ) const;
-    */
-
     enum TransformColorMethod { 
       tmcNone=0, 
       tmcRGB2HSV=1, 
@@ -507,7 +525,9 @@ class Image {
         tmRadon        = 7,
         tmRadonInv     = 8,
     };
-    Image transform( TransformMethod type ) const;
+    // depth selects output precision for transforms that support it: 32 or 64 bit float, currently radon, chebyshev and wavelet
+    // levels is the number of decomposition levels of the wavelet transform
+    Image transform( TransformMethod type, int depth=64, int levels=1 ) const;
 
     // Hounsfield Units - used for CT (CAT) data
     // provided conversion maps from device dependent to HU (device independent) scale
@@ -573,6 +593,10 @@ class Image {
     void remapChannels( const std::vector<int> &mapping );
     void remapToRGB();
 
+    // remaps only channel metadata, used when the reader already decoded the mapped channels
+    // of an image with the given number of samples
+    void remapChannelMetadata( unsigned int samples, const std::vector<int> &mapping );
+
     // since this method produces only one output channel it will not have any multiple channel pointers to the same meory space
     // althogh it will still affect other shared images so that it is recommended to use deepCopy() if you have any
     void extractChannel( int c );
@@ -605,6 +629,16 @@ class Image {
     Image fuseToGrayscale() const;
     Image fuseToRGB(const std::vector<bim::DisplayColor> &mapping, FuseMethod method=fmAverage, ImageHistogram *hist=0) const;
 
+    // renders an 8 bit RGB image for display in a single pass over the input channels
+    // * each channel is stretched by its display range and gamma and contributes with its color
+    // * channels without a range, or with an empty one, use their data range from the histogram
+    // * method combines channel contributions: fmAdd, fmAverage or fmMax
+    Image renderToRGB(const std::vector<bim::DisplayColor> &colors, const std::vector<DisplayRange> &ranges=std::vector<DisplayRange>(), 
+                      FuseMethod method=fmAdd, ImageHistogram *hist=0) const;
+    // same as above writing into an interleaved RGB buffer of stride bytes per line
+    bool renderToRGB(unsigned char *rgb, bim::uint64 stride, const std::vector<bim::DisplayColor> &colors, const std::vector<DisplayRange> &ranges=std::vector<DisplayRange>(), 
+                     FuseMethod method=fmAdd, ImageHistogram *hist=0) const;
+
   public:
       // special function to create image class from an existing bitmap without managing its memory
       // it will not delete the bitmap when destroyed
@@ -614,8 +648,8 @@ class Image {
     // pointer to a shared bitmap
     ImageBitmap *bmp;
 
-    // not shared image metadata
-    TagMap metadata;
+    // copy-on-write image metadata
+    SharedTagMap metadata;
     // not shared image histogram
     //ImageHistogram *histo;
 
@@ -637,6 +671,9 @@ class Image {
       typedef std::map<std::string, ImageModifierProc> map_modifiers;
       static map_modifiers create_modifiers();
       static const map_modifiers modifiers;
+
+      // evaluates a run of pointwise modifiers as one lookup table, returns the first modifier not consumed
+      xoperations::const_iterator process_pointwise(xoperations::const_iterator it, const xoperations &operations, ImageHistogram *hist, XConf *c);
 };
 
 //------------------------------------------------------------------------------
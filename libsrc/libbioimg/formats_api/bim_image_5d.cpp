@@ -9,17 +9,22 @@
   image also contains all associated metadata as tags
 
   time points are cached in-memory by the last access time (based on allowed cache size)
+  neighbouring time points are prefetched into the cache by a background thread
   
   Author: Dima Fedorov Levit <dimin@dimin.net> <http://www.dimin.net/>
 
   History:
      - First creation
+    10/19/2026 12:00 - Asynchronous prefetch of neighbouring time points
+    10/19/2026 12:00 - Prefetch support reported by the API
+    10/19/2026 12:00 - Prefetch in all builds, only for formats safe for concurrent sessions
       
-  ver: 1
+  ver: 4
         
 *******************************************************************************/
 
 #include <cmath>
+#include <algorithm>
 
 #include <xstring.h>
 #include <xtypes.h>
@@ -28,16 +33,24 @@
 
 using namespace bim;
 
-bim::Image5D::Image5D(): number_axis(5) {
+bim::Image5D::Image5D(): number_axis(5), prefetch_cancel(false), prefetch_quit(false) {
   maximum_cache_size = 200 * 1024 * 1024; // 200MB
+  maximum_prefetch_size = 100 * 1024 * 1024; // 100MB
+  prefetch_requested = 1;
+  prefetch_range = prefetch_requested;
   init();
 }
 
 bim::Image5D::~Image5D() {
-  //free();
+  stopPrefetch();
 }
 
 void bim::Image5D::init() {
+  stopPrefetch();
+  prefetch_queue.clear();
+  prefetched.clear();
+  prefetch_file.clear();
+  prefetch_last = -1;
   progress_proc = NULL;
   error_proc = NULL;
   test_abort_proc = NULL;
@@ -92,10 +105,14 @@ bool bim::Image5D::fromFile( const std::string &fileName ) {
     metadata = fm.get_metadata(); 
     initFromMeta();
 
+    // the prefetch thread would decode concurrently with this session
+    prefetch_range = fm.sessionIsConcurrent() ? prefetch_requested : 0;
+
     // populate the stacks vector with empty stacks
     stacks.resize(image_size[bim::Image5D::t]);
     for (unsigned int i=0; i<stacks.size(); ++i) stacks[i] = ImageStack();
-    
+    prefetched.resize(stacks.size(), false);
+    prefetch_file = fileName;
   }
 
   // the images are not gonna be red here, we'll read them on request
@@ -109,6 +126,7 @@ bool bim::Image5D::isCached() const {
 bool bim::Image5D::isCached( unsigned int t ) const {
   if (t>=image_size[bim::Image5D::t]) return false;
   if (t>=stacks.size()) return false;
+  std::lock_guard<std::mutex> lock(cache_mutex);
   return !stacks[t].isEmpty();
 }
 
@@ -123,18 +141,30 @@ ImageStack *bim::Image5D::stackAt( unsigned int t ) {
   if (t>=image_size[bim::Image5D::t]) return 0;
   if (t>=stacks.size()) return 0;
   ImageStack *s = &stacks[t];
+
+  std::unique_lock<std::mutex> lock(cache_mutex);
+  // the prefetch thread is decoding this time point, wait for it instead of decoding it twice
+  while (prefetch_loading == (int) t)
+    prefetch_done.wait(lock);
   
   // move to the back of the cache_priority
   cache_priority.remove(s);
   cache_priority.push_back(s);
+  prefetched[t] = false;
+
+  // neighbours are decoded in the background while this one is served
+  schedulePrefetch(t);
+  if (!s->isEmpty()) return s;
 
   // if stack was discarded by caching, reload
-  if (s->isEmpty()) {
-    s->progress_proc = this->progress_proc;
-    s->test_abort_proc = this->test_abort_proc;
-    if (!s->fromFileManager(&fm, this->pagesOf(t)) ) return 0;
-    updateCache();
-  }
+  lock.unlock();
+  ImageStack loaded;
+  loaded.progress_proc = this->progress_proc;
+  loaded.test_abort_proc = this->test_abort_proc;
+  if (!loaded.fromFileManager(&fm, this->pagesOf(t)) ) return 0;
+  lock.lock();
+  *s = loaded;
+  updateCache();
   return s;
 }
 
@@ -156,15 +186,148 @@ double bim::Image5D::memorySize() const {
   return mem;
 }
 
+double bim::Image5D::stackSize() const {
+  double depth = metadata.get_value_double( "image_pixel_depth", 8 );
+  return (double) image_size[bim::Image5D::x] * image_size[bim::Image5D::y] * 
+         image_size[bim::Image5D::c] * image_size[bim::Image5D::z] * depth / 8.0;
+}
+
 void bim::Image5D::updateCache() {
   if (memorySize()<=maximum_cache_size) return;
   while (memorySize()>maximum_cache_size && cache_priority.size()>1) {
     ImageStack *s = cache_priority.front();
     s->clear();
+    prefetched[s - &stacks[0]] = false;
     cache_priority.pop_front();
   }
 }
 
+//------------------------------------------------------------------------------
+// prefetch
+//------------------------------------------------------------------------------
+
+// image memory references are guarded by a mutex, images may be created in any thread
+bool bim::Image5D::isPrefetchSupported() {
+  return true;
+}
+
+bool bim::Image5D::setPrefetchRange( unsigned int n ) {
+  prefetch_requested = n;
+  prefetch_range = !isLoaded() || fm.sessionIsConcurrent() ? n : 0;
+  if (prefetch_range==0) stopPrefetch();
+  return prefetch_range == n;
+}
+
+double bim::Image5D::prefetchedSize() const {
+  double mem=0;
+  for (unsigned int i=0; i<stacks.size(); ++i)
+    if (prefetched[i]) mem += stacks[i].bytesInStack();
+  return mem;
+}
+
+void bim::Image5D::stopPrefetch() {
+  if (prefetch_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(cache_mutex);
+      prefetch_quit = true;
+      prefetch_cancel = true;
+      prefetch_queue.clear();
+    }
+    prefetch_wake.notify_all();
+    prefetch_thread.join();
+  }
+  prefetch_quit = false;
+  prefetch_cancel = false;
+  prefetch_loading = -1;
+}
+
+// called with cache_mutex locked, replaces requests with neighbours of the accessed time point
+// ordered along the direction of access, the time point being decoded is dropped if not needed anymore
+void bim::Image5D::schedulePrefetch( unsigned int t ) {
+  int nt = (int) image_size[bim::Image5D::t];
+  int dir = 0;
+  if (prefetch_last>=0 && prefetch_last!=(int)t) {
+    dir = (int)t > prefetch_last ? 1 : -1;
+    if (loop_time && t==0 && prefetch_last==nt-1) dir = 1;
+    if (loop_time && (int)t==nt-1 && prefetch_last==0) dir = -1;
+  }
+  prefetch_last = t;
+  prefetch_queue.clear();
+
+  // the range is always 0 for formats not safe for concurrent sessions
+  if (prefetch_range==0 || nt<2) return;
+  int step = dir<0 ? -1 : 1;
+  std::vector<int> order;
+  for (int i=1; i<=(int)prefetch_range; ++i) {
+    order.push_back( (int)t + i*step );
+    if (dir==0) order.push_back( (int)t - i*step );
+  }
+  if (dir!=0)
+    for (int i=1; i<=(int)prefetch_range; ++i)
+      order.push_back( (int)t - i*step );
+
+  bool keep_loading = false;
+  for (unsigned int i=0; i<order.size(); ++i) {
+    int v = order[i];
+    if (loop_time) v = ((v % nt) + nt) % nt;
+    if (v<0 || v>=nt || v==(int)t) continue;
+    if (v==prefetch_loading) { keep_loading = true; continue; }
+    if (!stacks[v].isEmpty()) continue;
+    if (std::find(prefetch_queue.begin(), prefetch_queue.end(), (unsigned int) v) != prefetch_queue.end()) continue;
+    prefetch_queue.push_back(v);
+  }
+  if (prefetch_loading>=0 && !keep_loading) prefetch_cancel = true;
+  if (prefetch_queue.empty()) return;
+
+  if (!prefetch_thread.joinable())
+    prefetch_thread = std::thread( &bim::Image5D::prefetchLoop, this );
+  prefetch_wake.notify_all();
+}
+
+// the prefetch thread reads through its own session, decoded stacks are added to the cache
+// only if they fit without evicting anything and within the prefetch size
+void bim::Image5D::prefetchLoop() {
+  MetaFormatManager pfm;
+  bool opened = pfm.sessionStartRead((const bim::Filename) prefetch_file.c_str()) == 0;
+
+  std::unique_lock<std::mutex> lock(cache_mutex);
+  while (opened && !prefetch_quit) {
+    if (prefetch_queue.empty()) {
+      prefetch_wake.wait(lock);
+      continue;
+    }
+    unsigned int t = prefetch_queue.front();
+    prefetch_queue.pop_front();
+    double bytes = stackSize();
+    if (!stacks[t].isEmpty()) continue;
+    if (memorySize()+bytes > maximum_cache_size) continue;
+    if (prefetchedSize()+bytes > maximum_prefetch_size) continue;
+    prefetch_loading = t;
+    prefetch_cancel = false;
+    lock.unlock();
+
+    ImageStack s;
+    std::vector<unsigned int> pages = this->pagesOf(t);
+    for (unsigned int i=0; i<pages.size() && !prefetch_cancel; ++i) {
+      Image img;
+      if (pfm.sessionReadImage( img.imageBitmap(), pages[i] ) != 0) break;
+      s.append( img );
+    }
+
+    lock.lock();
+    if (!prefetch_cancel && s.numberPlanes()==(int)pages.size() && stacks[t].isEmpty()) {
+      stacks[t] = s;
+      prefetched[t] = true;
+      cache_priority.remove(&stacks[t]);
+      cache_priority.push_front(&stacks[t]); // evicted first if never accessed
+    }
+    prefetch_loading = -1;
+    prefetch_done.notify_all();
+  }
+  lock.unlock();
+  pfm.sessionEnd();
+}
+
 ImageStack *bim::Image5D::stack() {
   return this->stackAt( this->current_position[bim::Image5D::t] );
 }
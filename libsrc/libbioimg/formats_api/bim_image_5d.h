@@ -9,13 +9,17 @@
   image also contains all associated metadata as tags
 
   time points are cached in-memory by the last access time (based on allowed cache size)
+  neighbouring time points are prefetched into the cache by a background thread
   
   Author: Dima Fedorov Levit <dimin@dimin.net> <http://www.dimin.net/>
 
   History:
      - First creation
+    10/19/2026 12:00 - Asynchronous prefetch of neighbouring time points
+    10/19/2026 12:00 - Prefetch support reported by the API
+    10/19/2026 12:00 - Prefetch in all builds, only for formats safe for concurrent sessions
       
-  ver: 1
+  ver: 4
         
 *******************************************************************************/
 
@@ -24,6 +28,11 @@
 
 #include <vector>
 #include <list>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 #include <meta_format_manager.h>
 #include "bim_image.h"
@@ -80,6 +89,20 @@ class Image5D {
     double getMaximumCacheSize() const { return maximum_cache_size; }
     void   setMaximumCacheSize( const double &bytes ) { maximum_cache_size = bytes; }
 
+    // images may be created in the prefetch thread since image memory references are guarded
+    // by a mutex, so every build can prefetch
+    static bool isPrefetchSupported();
+
+    // number of time points before and after the accessed one decoded in the background, 0 disables
+    // prefetched stacks never evict cached ones and all not yet accessed stay under the prefetch size
+    // the prefetch thread decodes through its own session, so files in formats not safe for
+    // concurrent sessions (FormatManager::isConcurrentFormat) are never prefetched: the range is 0
+    // while such a file is loaded and setting a non zero range returns false
+    unsigned int getPrefetchRange() const { return prefetch_range; }
+    bool   setPrefetchRange( unsigned int n );
+    double getMaximumPrefetchSize() const { return maximum_prefetch_size; }
+    void   setMaximumPrefetchSize( const double &bytes ) { maximum_prefetch_size = bytes; }
+
     const TagMap* getMetadata() const { return &metadata; }
     std::string fileName() const { return fm.sessionFilename(); }
 
@@ -97,12 +120,35 @@ class Image5D {
     std::list<ImageStack*>  cache_priority; // images in the front are the most likely to be removed
     TagMap metadata;
 
+    unsigned int prefetch_range;     // range in effect for the loaded file
+    unsigned int prefetch_requested; // range set by the user
+    double maximum_prefetch_size;
+
   private:
     MetaFormatManager fm;
     void initFromMeta();
     void updateCache();
     std::vector<unsigned int> pagesOf(unsigned int t) const;
     double memorySize() const;
+    double stackSize() const;
+
+    // stacks, cache_priority and the prefetch state are shared with the prefetch thread
+    mutable std::mutex cache_mutex;
+    std::thread prefetch_thread;
+    std::condition_variable prefetch_wake;    // new time points were requested
+    std::condition_variable prefetch_done;    // prefetch thread finished a time point
+    std::list<unsigned int> prefetch_queue;   // time points in the order of loading
+    std::vector<bool> prefetched;             // loaded by the prefetch thread and not accessed yet
+    std::string prefetch_file;
+    int prefetch_loading;                     // time point decoded by the prefetch thread or -1
+    int prefetch_last;                        // last accessed time point, gives the direction
+    std::atomic<bool> prefetch_cancel;
+    std::atomic<bool> prefetch_quit;
+
+    void schedulePrefetch( unsigned int t );
+    void stopPrefetch();
+    void prefetchLoop();
+    double prefetchedSize() const;
 
   // callbacks
   public:
@@ -6,8 +6,11 @@
 
   History:
     2011-05-11 08:32:12 - First creation
+    2026-10-19 12:00:00 - Tile parallel superpixels
+    2026-10-19 12:00:00 - Exact superpixels below the tile size, seams reconciled above
+    2026-10-19 12:00:00 - Small superpixels eliminated in tiles, tile size set by the caller
       
-  ver: 1
+  ver: 4
         
 *******************************************************************************/
 
@@ -98,7 +101,7 @@ Image Image::filter_edge() const {
 //------------------------------------------------------------------------------------
 
 // regionSize in pixels, regularization 0-1, with 1 the shape is most regular
-Image Image::superpixels( bim::uint64 regionSize, float regularization, float min_size_ratio ) const {
+Image Image::superpixels( bim::uint64 regionSize, float regularization, float min_size_ratio, bim::uint64 tile_size ) const {
     Image out(this->width(), this->height(), 32, 1, FMT_UNSIGNED);
 
     bim::uint32 *seg = (bim::uint32*) out.bits(0);
@@ -106,35 +109,39 @@ Image Image::superpixels( bim::uint64 regionSize, float regularization, float mi
     
     regularization = regularization * (regionSize * regionSize);
 
+    // images up to the tile size on a side are segmented exactly, larger ones in tiles,
+    // tiles do not depend on the number of threads so the result is the same on any machine
+    bim::uint64 tileSize = tile_size > 0 ? tile_size : bim::max<bim::uint64>(2048, regionSize*8);
+
     if (this->depth()==8 && this->pixelType()==FMT_UNSIGNED)
-        slic_segment<bim::uint8, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize);
+        slic_segment_tiled<bim::uint8, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize, tileSize);
     else
     if (this->depth()==16 && this->pixelType()==FMT_UNSIGNED)
-        slic_segment<bim::uint16, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize);
+        slic_segment_tiled<bim::uint16, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize, tileSize);
     else
     if (this->depth()==32 && this->pixelType()==FMT_UNSIGNED)
-        slic_segment<bim::uint32, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize);
+        slic_segment_tiled<bim::uint32, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize, tileSize);
     else
     if (this->depth()==64 && this->pixelType()==FMT_UNSIGNED)
-        slic_segment<bim::uint64, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize);
+        slic_segment_tiled<bim::uint64, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize, tileSize);
     else
     if (this->depth()==8 && this->pixelType()==FMT_SIGNED)
-        slic_segment<bim::int8, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize);
+        slic_segment_tiled<bim::int8, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize, tileSize);
     else
     if (this->depth()==16 && this->pixelType()==FMT_SIGNED)
-        slic_segment<bim::int16, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize);
+        slic_segment_tiled<bim::int16, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize, tileSize);
     else
     if (this->depth()==32 && this->pixelType()==FMT_SIGNED)
-        slic_segment<bim::int32, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize);
+        slic_segment_tiled<bim::int32, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize, tileSize);
     else
     if (this->depth()==64 && this->pixelType()==FMT_SIGNED)
-        slic_segment<bim::int64, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize);
+        slic_segment_tiled<bim::int64, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize, tileSize);
     else
     if (this->depth()==32 && this->pixelType()==FMT_FLOAT)
-        slic_segment<bim::float32, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize);
+        slic_segment_tiled<bim::float32, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize, tileSize);
     else
     if (this->depth()==64 && this->pixelType()==FMT_FLOAT)
-        slic_segment<bim::float64, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize);
+        slic_segment_tiled<bim::float64, float> (seg, this, this->width(), this->height(), this->samples(), regionSize, regularization, minRegionSize, tileSize);
 
     return out;
 }
@@ -150,8 +157,11 @@ Image operation_superpixels(Image &img, const bim::xstring &arguments, const xop
     float min_size_ratio = 0.7;
     if (vals.size()>2)
         min_size_ratio = vals[2];
+    bim::uint64 tile_size = 0;
+    if (vals.size()>3 && vals[3] > 0)
+        tile_size = (bim::uint64) vals[3];
     if (superpixels > 0)
-        return img.superpixels(superpixels, superpixels_regularization, min_size_ratio);
+        return img.superpixels(superpixels, superpixels_regularization, min_size_ratio, tile_size);
     return img;
 };
 
@@ -109,6 +109,10 @@ bool ImageProxy::readRegion(Image &img, bim::uint page, bim::uint64 x1, bim::uin
     int requested_level = getImageLevel(level);
     if (requested_level < 0) return 1;
 
+    // formats able to decode arbitrary regions do it directly
+    if (fm->sessionCanReadRegion())
+        return fm->sessionReadRegion(img.imageBitmap(), page, x1, y1, x2, y2, requested_level) == 0;
+
     int im_tile_sz = fm->get_metadata_tag_int(bim::TILE_NUM_X, 0);
     if (im_tile_sz < 1 || im_tile_sz != fm->get_metadata_tag_int(bim::TILE_NUM_Y, 0))
         return false;
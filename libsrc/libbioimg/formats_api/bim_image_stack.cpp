@@ -6,8 +6,11 @@
 
   History:
     03/23/2004 18:03 - First creation
+    10/19/2026 12:00 - Decode only the requested channel
+    10/19/2026 12:00 - Blocked transposes for YZX reslicing
+    10/19/2026 12:00 - Out-of-core reslicing of files
       
-  ver: 1
+  ver: 4
         
 *******************************************************************************/
 
@@ -20,6 +23,8 @@
 #include <vector>
 
 #include "bim_image_stack.h"
+#include "resize.h"
+#include "rotate.h"
 
 #include <meta_format_manager.h>
 #include <xstring.h>
@@ -139,6 +144,10 @@ bool ImageStack::fromFile(const char *fileName, unsigned int limit_width, unsign
 
   if ( (res = fm.sessionStartRead((const bim::Filename) fileName)) == 0) {
 
+    // readers that store channels separately skip the other ones
+    if ( channel>=0 )
+      fm.sessionSetChannels( std::vector<int>(1, channel) );
+
     int pages = fm.sessionGetNumberOfPages();
     for (int page=0; page<pages; ++page) {
       do_progress( page+1, pages, "Loading stack" );
@@ -149,7 +158,7 @@ bool ImageStack::fromFile(const char *fileName, unsigned int limit_width, unsign
       if (fm.sessionReadImage( img.imageBitmap(), page ) != 0) break;
 
       // use channel constraint
-      if ( channel>=0 )
+      if ( channel>=0 && !fm.sessionChannelsRead() )
         img.extractChannel( channel );
 
       // use size limits
@@ -526,6 +535,54 @@ TagMap metadataRearrange3D( const TagMap &md, const ImageStack *stack, const Ima
   return metadata;
 }
 
+// out[j] receives the YZ section at x0+j rotated by -90 degrees, which is the same as
+// projectionYZAxis(x0+j).rotate(-90), planes fill columns starting at z0,
+// rows of all sections are transposed together
+template <typename T>
+void reslice_yzx( const std::vector<const Image *> &planes, bim::uint64 z0, bim::uint64 x0, std::vector<Image> &out ) {
+  bim::int64 h = planes[0]->height();
+  bim::uint64 d = planes.size();
+  bim::uint64 n = out.size();
+  for (unsigned int c=0; c<planes[0]->samples(); ++c) {
+    #pragma omp parallel default(shared) if (h>BIM_OMP_FOR2)
+    {
+      std::vector<const T *> src(d);
+      std::vector<T *> dst(n);
+      #pragma omp for BIM_OMP_SCHEDULE
+      for (bim::int64 y=0; y<h; ++y) {
+        for (bim::uint64 z=0; z<d; ++z)
+          src[z] = ((const T *) planes[z]->scanLine(c, y)) + x0;
+        for (bim::uint64 j=0; j<n; ++j)
+          dst[j] = ((T *) out[j].scanLine(c, h-1-y)) + z0;
+        transpose_rows<T>( &dst[0], &src[0], d, n );
+      } // y
+    }
+  } // c
+}
+
+static void reslice_yzx( const std::vector<const Image *> &planes, bim::uint64 z0, bim::uint64 x0, std::vector<Image> &out ) {
+  if (planes.size()==0 || out.size()==0) return;
+  int depth = planes[0]->depth();
+  if (depth==8)
+    reslice_yzx<bim::uint8>( planes, z0, x0, out );
+  else if (depth==16)
+    reslice_yzx<bim::uint16>( planes, z0, x0, out );
+  else if (depth==32)
+    reslice_yzx<bim::uint32>( planes, z0, x0, out );
+  else if (depth==64)
+    reslice_yzx<bim::uint64>( planes, z0, x0, out );
+}
+
+// row y0+j of the plane becomes row z of out[j], which is projectionXZAxis(y0+j)
+static void reslice_xzy( const Image &plane, bim::uint64 z, bim::uint64 y0, std::vector<Image> &out ) {
+  bim::int64 n = out.size();
+  for (unsigned int c=0; c<plane.samples(); ++c) {
+    #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (n>BIM_OMP_FOR2)
+    for (bim::int64 j=0; j<n; ++j)
+      memcpy( out[j].scanLine(c, z), plane.scanLine(c, y0+j), out[j].bytesPerLine() );
+  } // c
+}
+
 bool ImageStack::rearrange3DToFile( const RearrangeDimensions &operation, const char *fileName, const char *formatName, const char *options ) const {
     unsigned int psize = operation == ImageStack::adXZY ? this->height(): this->width();
 
@@ -536,19 +593,29 @@ bool ImageStack::rearrange3DToFile( const RearrangeDimensions &operation, const
         TagMap meta = metadataRearrange3D( this->metadata, this, operation );
         fm.sessionWriteSetMetadata( meta );
 
-        for (unsigned int p=0; p<psize; ++p) {
-            Image image;
+        // YZX sections are produced in groups sharing the pass over the stack
+        const unsigned int group = operation == ImageStack::adYZX ? 64 : 1;
+        std::vector<Image> images;
+        for (unsigned int p0=0; p0<psize; p0+=group) {
+            images.clear();
             if (operation == ImageStack::adXZY) 
-                image = this->projectionXZAxis(p); // XYZ -> XZY
-            else if (operation == ImageStack::adYZX) {
-                image = this->projectionYZAxis(p); // XYZ -> YZX
-                image = image.rotate(-90);
+                images.push_back( this->projectionXZAxis(p0) ); // XYZ -> XZY
+            else if (operation == ImageStack::adYZX) { // XYZ -> YZX
+                for (unsigned int p=p0; p<std::min<unsigned int>(p0+group, psize); ++p)
+                    images.push_back( Image(this->length(), this->height(), this->depth(), this->samples(), this->pixelType()) );
+                std::vector<const Image *> planes;
+                for (unsigned int z=0; z<this->length(); ++z)
+                    planes.push_back( this->imageAt(z) );
+                reslice_yzx( planes, 0, p0, images );
+            }
+            for (unsigned int i=0; i<images.size(); ++i) {
+                Image &image = images[i];
+                // this part should probably be removed in the main library
+                image.imageBitmap()->i.number_pages = psize;
+                image.imageBitmap()->i.number_z = meta.get_value_int("image_num_z", 1);
+                image.imageBitmap()->i.number_t = meta.get_value_int("image_num_t", 1);
+                fm.sessionWriteImage( image.imageBitmap(), p0+i );
             }
-            // this part should probably be removed in the main library
-            image.imageBitmap()->i.number_pages = psize;
-            image.imageBitmap()->i.number_z = meta.get_value_int("image_num_z", 1);
-            image.imageBitmap()->i.number_t = meta.get_value_int("image_num_t", 1);
-            fm.sessionWriteImage( image.imageBitmap(), p );
         }
         fm.sessionEnd(); 
     } else {
@@ -558,6 +625,107 @@ bool ImageStack::rearrange3DToFile( const RearrangeDimensions &operation, const
     return true;
 }
 
+// reads a page the same way fromFile does when given operations
+static Image read_stack_page( MetaFormatManager &fm, unsigned int page, const xoperations *operations ) {
+    Image img;
+    if (fm.sessionReadImage( img.imageBitmap(), page ) != 0) return Image();
+    if (operations) {
+        img = img.ensureTypedDepth();
+        img = img.ensureColorSpace();
+        img.process(*operations);
+    }
+    return img;
+}
+
+bool ImageStack::rearrange3DFileToFile( const RearrangeDimensions &operation, const char *inputName, 
+                                        const char *fileName, const char *formatName, const char *options,
+                                        bim::uint64 memory_limit, const xoperations *ops ) {
+    MetaFormatManager fm;
+    if (!fm.isFormatSupportsWMP( formatName )) return false;
+    MetaFormatManager fmi;
+    if (fmi.sessionStartRead((bim::Filename) inputName) != 0) {
+        fmi.sessionEnd();
+        return false;
+    }
+
+    // geometry of the processed stack comes from the first page
+    unsigned int d = fmi.sessionGetNumberOfPages();
+    Image first = read_stack_page( fmi, 0, ops );
+    if (d<1 || first.isEmpty()) {
+        fmi.sessionEnd();
+        return false;
+    }
+    fmi.sessionParseMetaData(0);
+    TagMap meta = metadataRearrange3D( fmi.get_metadata(), NULL, operation );
+
+    unsigned int w = first.width();
+    unsigned int h = first.height();
+    unsigned int psize = operation == ImageStack::adXZY ? h : w;
+    bim::uint64 page_bytes = first.bytesInImage();
+    bim::uint64 out_bytes = operation == ImageStack::adXZY ? (bim::uint64) w*d*first.depth()*first.samples()/8 :
+                                                             (bim::uint64) d*h*first.depth()*first.samples()/8;
+
+    // YZX transposes groups of input pages, XZY copies rows straight from each page,
+    // the rest of the budget holds a band of output pages filled during one pass over the input
+    unsigned int group = 1;
+    if (operation == ImageStack::adYZX)
+        group = (unsigned int) bim::trim<bim::uint64>( memory_limit/4/bim::max<bim::uint64>(page_bytes, 1), 1, 64 );
+    bim::uint64 budget = memory_limit > group*page_bytes ? memory_limit - group*page_bytes : 0;
+    unsigned int band = (unsigned int) bim::trim<bim::uint64>( budget/bim::max<bim::uint64>(out_bytes, 1), 1, psize );
+    unsigned int passes = (psize + band - 1) / band;
+
+    handling_image = true;
+    bool ok = fm.sessionStartWrite((bim::Filename) fileName, formatName, options) == 0;
+    if (ok) fm.sessionWriteSetMetadata( meta );
+
+    std::vector<Image> images;
+    std::vector<Image> pages;
+    for (unsigned int p0=0; ok && p0<psize; p0+=band) {
+        unsigned int n = std::min<unsigned int>(band, psize-p0);
+        images.clear();
+        for (unsigned int i=0; i<n; ++i) {
+            if (operation == ImageStack::adXZY) 
+                images.push_back( Image(w, d, first.depth(), first.samples(), first.pixelType()) );
+            else
+                images.push_back( Image(d, h, first.depth(), first.samples(), first.pixelType()) );
+        }
+
+        // one sequential pass over the input pages
+        for (unsigned int z0=0; ok && z0<d; z0+=group) {
+            do_progress( (p0/band)*d + z0 + 1, passes*d, "Reslicing stack" );
+            if (progress_abort()) { ok = false; break; }
+            pages.clear();
+            std::vector<const Image *> planes;
+            for (unsigned int z=z0; z<std::min<unsigned int>(z0+group, d); ++z) {
+                pages.push_back( z==0 ? first : read_stack_page( fmi, z, ops ) );
+                if (pages.back().width()!=w || pages.back().height()!=h || pages.back().depth()!=first.depth() || 
+                    pages.back().samples()!=first.samples()) { ok = false; break; }
+            }
+            if (!ok) break;
+            for (unsigned int i=0; i<pages.size(); ++i)
+                planes.push_back( &pages[i] );
+
+            if (operation == ImageStack::adXZY) 
+                reslice_xzy( pages[0], z0, p0, images ); // XYZ -> XZY
+            else if (operation == ImageStack::adYZX) // XYZ -> YZX
+                reslice_yzx( planes, z0, p0, images );
+        }
+
+        for (unsigned int i=0; ok && i<images.size(); ++i) {
+            Image &image = images[i];
+            // this part should probably be removed in the main library
+            image.imageBitmap()->i.number_pages = psize;
+            image.imageBitmap()->i.number_z = meta.get_value_int("image_num_z", 1);
+            image.imageBitmap()->i.number_t = meta.get_value_int("image_num_t", 1);
+            fm.sessionWriteImage( image.imageBitmap(), p0+i );
+        }
+    }
+    fm.sessionEnd(); 
+    fmi.sessionEnd();
+    handling_image = false;
+    return ok;
+}
+
 
 TagMap resizeMetadata3d( const TagMap &md, unsigned int w_to, unsigned int h_to, unsigned int d_to, unsigned int w_in, unsigned int h_in, unsigned int d_in ) {
   TagMap metadata = md;
@@ -579,6 +747,32 @@ TagMap resizeMetadata3d( const TagMap &md, unsigned int w_to, unsigned int h_to,
   return metadata;
 }
 
+// interpolates planes of "in" along Z into all planes of "out", both stacks have the same plane size
+// working types are the same as used by Image::resample
+template <typename T, typename Tw>
+void resample_stack_z( const ImageStack &in, ImageStack &out, Image::ResizeMethod method ) {
+  unsigned int d_in = in.numberPlanes();
+  unsigned int d_to = out.numberPlanes();
+  bim::uint64 plane_size = in.imageAt(0)->bytesPerChan() / sizeof(T);
+  std::vector<const T *> src(d_in);
+  std::vector<T *> dst(d_to);
+  for (unsigned int c=0; c<in.samples(); ++c) {
+    for (unsigned int z=0; z<d_in; ++z)
+      src[z] = (const T *) in.imageAt(z)->bits(c);
+    for (unsigned int z=0; z<d_to; ++z)
+      dst[z] = (T *) out.imageAt(z)->bits(c);
+
+    if (method == Image::szNearestNeighbor)
+      volume_resample_z_NN<T, Tw>( &dst[0], d_to, &src[0], d_in, plane_size );
+    else
+    if (method == Image::szBiLinear)
+      volume_resample_z_BL<T, Tw>( &dst[0], d_to, &src[0], d_in, plane_size );
+    else
+    if (method == Image::szBiCubic)
+      volume_resample_z_BC<T, Tw>( &dst[0], d_to, &src[0], d_in, plane_size );
+  } // for c
+}
+
 void ImageStack::resize( bim::uint w, bim::uint h, bim::uint d, Image::ResizeMethod method, bool keep_aspect_ratio ) {
   uint wor = images[0].width();
   uint hor = images[0].height();
@@ -606,22 +800,32 @@ void ImageStack::resize( bim::uint w, bim::uint h, bim::uint d, Image::ResizeMet
   for (int z=0; z<d; ++z)
     stack.append( images[0].deepCopy() );
   
-  // now interpolate Z
-  for (unsigned int y=0; y<stack.height(); ++y) {
-    #pragma omp master
-    do_progress( y, stack.height(), "Interpolating Z" );
-    Image img_xz = projectionXZAxis( y );
-    img_xz = img_xz.resize(w, d, method, false );
-    
-    #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (d>BIM_OMP_FOR2)
-    for (int z=0; z<d; ++z) {
-      for (unsigned int c=0; c<stack.samples(); ++c) {
-        unsigned char *line_out = stack.images[z].scanLine( c, y );
-        unsigned char *line_in = img_xz.scanLine( c, z );
-        memcpy( line_out, line_in, img_xz.bytesPerLine() );
-      } // for c
-    } // for z
-  } // for y
+  // now interpolate Z directly across planes
+  do_progress( 0, stack.samples(), "Interpolating Z" );
+  DataFormat pf = this->pixelType();
+  if (this->depth()==8 && pf==FMT_UNSIGNED)
+    resample_stack_z<bim::uint8, float>( *this, stack, method );
+  else
+  if (this->depth()==16 && pf==FMT_UNSIGNED)
+    resample_stack_z<bim::uint16, float>( *this, stack, method );
+  else
+  if (this->depth()==32 && pf==FMT_UNSIGNED)
+    resample_stack_z<bim::uint32, double>( *this, stack, method );
+  else
+  if (this->depth()==8 && pf==FMT_SIGNED)
+    resample_stack_z<bim::int8, float>( *this, stack, method );
+  else
+  if (this->depth()==16 && pf==FMT_SIGNED)
+    resample_stack_z<bim::int16, float>( *this, stack, method );
+  else
+  if (this->depth()==32 && pf==FMT_SIGNED)
+    resample_stack_z<bim::int32, double>( *this, stack, method );
+  else
+  if (this->depth()==32 && pf==FMT_FLOAT)
+    resample_stack_z<bim::float32, double>( *this, stack, method );
+  else
+  if (this->depth()==64 && pf==FMT_FLOAT)
+    resample_stack_z<bim::float64, double>( *this, stack, method );
 
   stack.metadata = resizeMetadata3d( this->metadata, w, h, d, wor, hor, dor );
   *this = stack;
@@ -6,8 +6,9 @@
 
   History:
     03/23/2004 18:03 - First creation
+    10/19/2026 12:00 - Out-of-core reslicing of files
       
-  ver: 1
+  ver: 2
         
 *******************************************************************************/
 
@@ -122,7 +123,7 @@ class ImageStack {
 
     void process(const xoperations &operations, ImageHistogram *hist = 0, XConf *c = 0);
 
-    // only available values now are +90, -90 and 180
+    // see Image::rotate
     void rotate( double deg );
 
     void negative();
@@ -137,12 +138,24 @@ class ImageStack {
       return this->rearrange3DToFile( operation, fileName.c_str(), formatName.c_str(), options.c_str() ); 
     }
 
+    // same as rearrange3DToFile but pages of inputName are never all kept in memory, the input is read
+    // sequentially once per band of output pages where a band fits into memory_limit bytes,
+    // operations are applied to every input page as in fromFile
+    bool rearrange3DFileToFile( const RearrangeDimensions &operation, const char *inputName, 
+                                const char *fileName, const char *formatName, const char *options=NULL,
+                                bim::uint64 memory_limit = 1024*1024*1024, const xoperations *ops = 0 );
+
     Image pixelArithmeticMax() const;
     Image pixelArithmeticMin() const;
 
     Image textureAtlas(int rows=0, int cols=0) const;
     Image textureAtlas(const xstring &arguments) const;
 
+    #ifdef BIM_USE_TRANSFORMS
+    // volumetric transforms, currently only Image::tmWavelet, see Image::transform
+    ImageStack transform( Image::TransformMethod type, int depth=64, int levels=1 ) const;
+    #endif //BIM_USE_TRANSFORMS
+
   protected:
     std::vector<Image> images;
     TagMap metadata;
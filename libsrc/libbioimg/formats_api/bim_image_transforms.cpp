@@ -6,8 +6,9 @@
 
   History:
     2011-05-11 08:32:12 - First creation
+    2026-10-19 12:00:00 - Copy-on-write metadata
       
-  ver: 1
+  ver: 2
         
 *******************************************************************************/
 
@@ -16,6 +17,7 @@
 
 #include "xtypes.h"
 #include "bim_image.h"
+#include "bim_image_stack.h"
 
 #include <algorithm>
 #include <limits>
@@ -31,7 +33,7 @@
 #include "../transforms/FuzzyCalc.h"
 #include "../transforms/chebyshev.h"
 #include "../transforms/wavelet/Symlet5.h"
-#include "../transforms/wavelet/DataGrid2D.h"
+#include "../transforms/wavelet/dwt.h"
 #include "../transforms/radon.h"
 
 #include "bim_icc_profiles.h" // rather large static definition of default icc profiles
@@ -105,20 +107,62 @@ Image fft2 (const Image &matrix_IN) {
     return im;
 }
 
-// dima: This implementation comes from WndChrm and is not the best, rewrite when possible
-Image chebyshev2 (const Image &matrix_IN) {
-    Image in = matrix_IN.convertToDepth(64, bim::Lut::ltTypecast, bim::FMT_FLOAT);
-    bim::uint64 N = std::min<bim::uint64>(in.width(), in.height());
-	bim::uint64 width = N;
-	bim::uint64 height = std::min<bim::uint64>( in.height(), N ); 
-    bim::uint64 samples = in.samples();
-
-    Image out(width, height, 64, samples, FMT_FLOAT );
+template <typename Ti, typename To>
+void do_chebyshev2 (const Image &in, Image &out, unsigned int N) {
+    std::vector<const Ti *> pixels(in.samples());
+    std::vector<To *> ptrs(in.samples());
     for (unsigned int sample=0; sample<in.samples(); sample++) {
-        double *inp = (double *) in.bits(sample);
-        double *oup = (double *) out.bits(sample);
-        Chebyshev2D(inp, oup, N, in.width(), in.height());
+        pixels[sample] = (const Ti *) in.bits(sample);
+        ptrs[sample] = (To *) out.bits(sample);
     }
+    Chebyshev2D_channels<Ti, To>(&ptrs[0], &pixels[0], (int) in.samples(), N, (unsigned int) in.width(), (unsigned int) in.height());
+}
+
+template <typename To>
+void do_chebyshev2_dispatch (const Image &in, Image &out, unsigned int N) {
+    if (in.depth()==8 && in.pixelType()==FMT_UNSIGNED)
+        do_chebyshev2<bim::uint8, To>  ( in, out, N );
+    else
+    if (in.depth()==16 && in.pixelType()==FMT_UNSIGNED)
+        do_chebyshev2<bim::uint16, To> ( in, out, N );
+    else
+    if (in.depth()==32 && in.pixelType()==FMT_UNSIGNED)
+        do_chebyshev2<bim::uint32, To> ( in, out, N );
+    else
+    if (in.depth()==64 && in.pixelType()==FMT_UNSIGNED)
+        do_chebyshev2<bim::uint64, To> ( in, out, N );
+    else
+    if (in.depth()==8 && in.pixelType()==FMT_SIGNED)
+        do_chebyshev2<bim::int8, To>   ( in, out, N );
+    else
+    if (in.depth()==16 && in.pixelType()==FMT_SIGNED)
+        do_chebyshev2<bim::int16, To>  ( in, out, N );
+    else
+    if (in.depth()==32 && in.pixelType()==FMT_SIGNED)
+        do_chebyshev2<bim::int32, To>  ( in, out, N );
+    else
+    if (in.depth()==64 && in.pixelType()==FMT_SIGNED)
+        do_chebyshev2<bim::int64, To>  ( in, out, N );
+    else
+    if (in.depth()==32 && in.pixelType()==FMT_FLOAT)
+        do_chebyshev2<bim::float32, To> ( in, out, N );
+    else
+    if (in.depth()==64 && in.pixelType()==FMT_FLOAT)
+        do_chebyshev2<bim::float64, To> ( in, out, N );
+}
+
+// This transform comes from WndChrm, basis matrices are cached per tile size and
+// all channels are projected at once, pixels are read in their own type
+// depth defines output and working precision: 32 or 64 bit float
+Image chebyshev2 (const Image &in, int depth) {
+    unsigned int N = (unsigned int) std::min<bim::uint64>(in.width(), in.height());
+    if (depth != 32) depth = 64;
+
+    Image out(N, N, depth, in.samples(), FMT_FLOAT );
+    if (depth == 32)
+        do_chebyshev2_dispatch<bim::float32>(in, out, N);
+    else
+        do_chebyshev2_dispatch<bim::float64>(in, out, N);
     return out;
 }
 
@@ -127,79 +171,146 @@ Image chebyshev2 (const Image &matrix_IN) {
 //------------------------------------------------------------------------------------
 
 template <typename Ti, typename To>
-void do_wavelet2 (const Image &in, Image &out) {
-    unsigned int width  = (unsigned int) in.width();
-    unsigned int height = (unsigned int) in.height();
-    bim::uint64 samples = in.samples();
-
+void do_wavelet2 (const Image &in, Image &out, const Wavelet *w, int levels) {
+    std::vector<const Ti *> pixels(in.samples());
+    std::vector<To *> ptrs(in.samples());
     for (unsigned int sample=0; sample<in.samples(); sample++) {
-	    DataGrid *grid = new DataGrid2D(width,height,-1);
-        //Ti *p = (Ti*) in.bits(sample);
-        #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (height>BIM_OMP_FOR2)
-        for (int y=0;y<height;y++) {
-            Ti *p = (Ti*) in.scanLine(sample, y);
-		    for(unsigned int x=0; x<width; x++) {
-			    grid->setData(x, y, -1, (double) *p);
-                p++;
-            }
-        }
-	    Symlet5 *Sym5 = new Symlet5(0, 1); // dima: here the number of levels is only 1, we probably should estimate appropriate number here
-	    Sym5->transform2D(grid);
-	    
-        unsigned int ow = std::min<unsigned int>(grid->getX(), out.width());
-        unsigned int oh = std::min<unsigned int>(grid->getY(), out.height());
-        //To *po = (To*) out.bits(sample);
-        #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (oh>BIM_OMP_FOR2)
-        for (int y=0;y<oh;y++) {
-            To *po = (To*) out.scanLine(sample, y);
-		    for(unsigned int x=0; x<ow; x++) {
-			    *po = (To) grid->getData(x, y, -1);
-                po++;
-            }
-        }
+        pixels[sample] = (const Ti *) in.bits(sample);
+        ptrs[sample] = (To *) out.bits(sample);
+    }
+    dwt2D_channels<Ti, To>(&ptrs[0], &pixels[0], (int) in.samples(), (int) in.width(), (int) in.height(),
+                           w, levels, (int) out.width(), (int) out.height());
+}
 
-	    delete Sym5;
-	    delete grid;
-    } // sample
+template <typename To>
+void do_wavelet2_dispatch (const Image &in, Image &out, const Wavelet *w, int levels) {
+    if (in.depth()==8 && in.pixelType()==FMT_UNSIGNED)
+        do_wavelet2<bim::uint8, To>  ( in, out, w, levels );
+    else
+    if (in.depth()==16 && in.pixelType()==FMT_UNSIGNED)
+        do_wavelet2<bim::uint16, To> ( in, out, w, levels );
+    else
+    if (in.depth()==32 && in.pixelType()==FMT_UNSIGNED)
+        do_wavelet2<bim::uint32, To> ( in, out, w, levels );
+    else
+    if (in.depth()==64 && in.pixelType()==FMT_UNSIGNED)
+        do_wavelet2<bim::uint64, To> ( in, out, w, levels );
+    else
+    if (in.depth()==8 && in.pixelType()==FMT_SIGNED)
+        do_wavelet2<bim::int8, To>   ( in, out, w, levels );
+    else
+    if (in.depth()==16 && in.pixelType()==FMT_SIGNED)
+        do_wavelet2<bim::int16, To>  ( in, out, w, levels );
+    else
+    if (in.depth()==32 && in.pixelType()==FMT_SIGNED)
+        do_wavelet2<bim::int32, To>  ( in, out, w, levels );
+    else
+    if (in.depth()==64 && in.pixelType()==FMT_SIGNED)
+        do_wavelet2<bim::int64, To>  ( in, out, w, levels );
+    else
+    if (in.depth()==32 && in.pixelType()==FMT_FLOAT)
+        do_wavelet2<bim::float32, To> ( in, out, w, levels );
+    else
+    if (in.depth()==64 && in.pixelType()==FMT_FLOAT)
+        do_wavelet2<bim::float64, To> ( in, out, w, levels );
+}
+
+// Symlet 5 decomposition with the coefficient layout of Wavelet::transform2D
+// levels is clamped to what the smallest image dimension allows
+// depth defines output and working precision: 32 or 64 bit float
+Image wavelet2 (const Image &in, int depth, int levels) {
+    int width  = (int) in.width();
+    int height = (int) in.height();
+    Symlet5 sym5(0, 1);
+    levels = dwt_levels(&sym5, levels, width, height);
+
+    // a single level keeps the historical output size of width+8 x height+8,
+    // deeper decompositions return the whole layout
+    int ow = width+8, oh = height+8, od = 0;
+    if (levels > 1)
+        dwt_layout_size(&sym5, levels, width, height, 0, &ow, &oh, &od);
+
+    if (depth != 32) depth = 64;
+    Image out(ow, oh, depth, in.samples(), FMT_FLOAT );
+
+    if (depth == 32)
+        do_wavelet2_dispatch<bim::float32>(in, out, &sym5, levels);
+    else
+        do_wavelet2_dispatch<bim::float64>(in, out, &sym5, levels);
+    return out;
 }
- 
-Image wavelet2 (const Image &in) {
-    unsigned int width  = (unsigned int) in.width();
-    unsigned int height = (unsigned int) in.height();
-    bim::uint64 samples = in.samples();
-    // wavelet code adds borders between outputs
-    Image out(width+8, height+8, 64, samples, FMT_FLOAT );
 
+template <typename Ti, typename To>
+void do_wavelet3 (const ImageStack &in, ImageStack &out, const Wavelet *w, int levels) {
+    int channels = (int) in.samples();
+    int depth = in.numberPlanes();
+    int out_depth = out.numberPlanes();
+    std::vector<const Ti *> pixels(channels*depth);
+    std::vector<To *> ptrs(channels*out_depth);
+    for (int c=0; c<channels; c++) {
+        for (int z=0; z<depth; z++)
+            pixels[c*depth + z] = (const Ti *) in[z]->bits(c);
+        for (int z=0; z<out_depth; z++)
+            ptrs[c*out_depth + z] = (To *) out[z]->bits(c);
+    }
+    dwt3D_channels<Ti, To>(&ptrs[0], &pixels[0], channels, (int) in.width(), (int) in.height(), depth,
+                           w, levels, (int) out.width(), (int) out.height(), out_depth);
+}
+
+template <typename To>
+void do_wavelet3_dispatch (const ImageStack &in, ImageStack &out, const Wavelet *w, int levels) {
     if (in.depth()==8 && in.pixelType()==FMT_UNSIGNED)
-        do_wavelet2<bim::uint8, double>  ( in, out );
+        do_wavelet3<bim::uint8, To>  ( in, out, w, levels );
     else
     if (in.depth()==16 && in.pixelType()==FMT_UNSIGNED)
-        do_wavelet2<bim::uint16, double> ( in, out );
+        do_wavelet3<bim::uint16, To> ( in, out, w, levels );
     else
     if (in.depth()==32 && in.pixelType()==FMT_UNSIGNED)
-        do_wavelet2<bim::uint32, double> ( in, out );
+        do_wavelet3<bim::uint32, To> ( in, out, w, levels );
     else
     if (in.depth()==64 && in.pixelType()==FMT_UNSIGNED)
-        do_wavelet2<bim::uint64, double> ( in, out );
+        do_wavelet3<bim::uint64, To> ( in, out, w, levels );
     else
     if (in.depth()==8 && in.pixelType()==FMT_SIGNED)
-        do_wavelet2<bim::int8, double>   ( in, out );
+        do_wavelet3<bim::int8, To>   ( in, out, w, levels );
     else
     if (in.depth()==16 && in.pixelType()==FMT_SIGNED)
-        do_wavelet2<bim::int16, double>  ( in, out );
+        do_wavelet3<bim::int16, To>  ( in, out, w, levels );
     else
     if (in.depth()==32 && in.pixelType()==FMT_SIGNED)
-        do_wavelet2<bim::int32, double>  ( in, out );
+        do_wavelet3<bim::int32, To>  ( in, out, w, levels );
     else
     if (in.depth()==64 && in.pixelType()==FMT_SIGNED)
-        do_wavelet2<bim::int64, double>  ( in, out );
+        do_wavelet3<bim::int64, To>  ( in, out, w, levels );
     else
     if (in.depth()==32 && in.pixelType()==FMT_FLOAT)
-        do_wavelet2<bim::float32, double> ( in, out );
+        do_wavelet3<bim::float32, To> ( in, out, w, levels );
     else
     if (in.depth()==64 && in.pixelType()==FMT_FLOAT)
-        do_wavelet2<bim::float64, double> ( in, out );
+        do_wavelet3<bim::float64, To> ( in, out, w, levels );
+}
 
+// volumetric Symlet 5 decomposition with the coefficient layout of Wavelet::transform3D
+ImageStack wavelet3 (const ImageStack &in, int depth, int levels) {
+    ImageStack out;
+    if (in.isEmpty()) return out;
+    int width  = (int) in.width();
+    int height = (int) in.height();
+    int planes = in.numberPlanes();
+    Symlet5 sym5(0, 1);
+    levels = dwt_levels(&sym5, levels, width, height, planes);
+
+    int ow, oh, od;
+    dwt_layout_size(&sym5, levels, width, height, planes, &ow, &oh, &od);
+
+    if (depth != 32) depth = 64;
+    for (int z=0; z<od; z++)
+        out.append( Image(ow, oh, depth, in.samples(), FMT_FLOAT) );
+
+    if (depth == 32)
+        do_wavelet3_dispatch<bim::float32>(in, out, &sym5, levels);
+    else
+        do_wavelet3_dispatch<bim::float64>(in, out, &sym5, levels);
     return out;
 }
 
@@ -207,8 +318,54 @@ Image wavelet2 (const Image &in) {
 // radon
 //------------------------------------------------------------------------------------
 
-Image radon2 (const Image &matrix_IN) {
-    Image in = matrix_IN.convertToDepth(64, bim::Lut::ltTypecast, bim::FMT_FLOAT);
+template <typename Ti, typename To>
+void do_radon2 (const Image &in, Image &out, const double *theta, int num_angles, int rFirst, int output_size) {
+    std::vector<const Ti *> pixels(in.samples());
+    std::vector<To *> ptrs(in.samples());
+    for (unsigned int sample=0; sample<in.samples(); sample++) {
+        pixels[sample] = (const Ti *) in.bits(sample);
+        ptrs[sample] = (To *) out.bits(sample);
+    }
+    radon_channels<Ti, To>(&ptrs[0], &pixels[0], (int) in.samples(), theta, (int) in.height(), (int) in.width(), 
+                           ((int)in.width()-1)/2, ((int)in.height()-1)/2, num_angles, rFirst, output_size);
+}
+
+template <typename To>
+void do_radon2_dispatch (const Image &in, Image &out, const double *theta, int num_angles, int rFirst, int output_size) {
+    if (in.depth()==8 && in.pixelType()==FMT_UNSIGNED)
+        do_radon2<bim::uint8, To>  ( in, out, theta, num_angles, rFirst, output_size );
+    else
+    if (in.depth()==16 && in.pixelType()==FMT_UNSIGNED)
+        do_radon2<bim::uint16, To> ( in, out, theta, num_angles, rFirst, output_size );
+    else
+    if (in.depth()==32 && in.pixelType()==FMT_UNSIGNED)
+        do_radon2<bim::uint32, To> ( in, out, theta, num_angles, rFirst, output_size );
+    else
+    if (in.depth()==64 && in.pixelType()==FMT_UNSIGNED)
+        do_radon2<bim::uint64, To> ( in, out, theta, num_angles, rFirst, output_size );
+    else
+    if (in.depth()==8 && in.pixelType()==FMT_SIGNED)
+        do_radon2<bim::int8, To>   ( in, out, theta, num_angles, rFirst, output_size );
+    else
+    if (in.depth()==16 && in.pixelType()==FMT_SIGNED)
+        do_radon2<bim::int16, To>  ( in, out, theta, num_angles, rFirst, output_size );
+    else
+    if (in.depth()==32 && in.pixelType()==FMT_SIGNED)
+        do_radon2<bim::int32, To>  ( in, out, theta, num_angles, rFirst, output_size );
+    else
+    if (in.depth()==64 && in.pixelType()==FMT_SIGNED)
+        do_radon2<bim::int64, To>  ( in, out, theta, num_angles, rFirst, output_size );
+    else
+    if (in.depth()==32 && in.pixelType()==FMT_FLOAT)
+        do_radon2<bim::float32, To> ( in, out, theta, num_angles, rFirst, output_size );
+    else
+    if (in.depth()==64 && in.pixelType()==FMT_FLOAT)
+        do_radon2<bim::float64, To> ( in, out, theta, num_angles, rFirst, output_size );
+}
+
+// pixels are read in their own type, all channels are projected in one parallel pass
+// depth defines output and working precision: 32 or 64 bit float
+Image radon2 (const Image &in, int depth) {
 	bim::uint64 width = in.width();
 	bim::uint64 height = in.height(); 
     bim::uint64 samples = in.samples();
@@ -224,14 +381,14 @@ Image radon2 (const Image &matrix_IN) {
 	int rFirst = -rLast;
 	unsigned int output_size = rLast-rFirst+1;
 
-    Image out(output_size, num_angles, 64, samples, FMT_FLOAT );
+    if (depth != 32) depth = 64;
+    Image out(output_size, num_angles, depth, samples, FMT_FLOAT );
     out.fill(0);
 
-    for (unsigned int sample=0; sample<in.samples(); sample++) {
-        double *ptr = (double *) out.bits(sample);
-        double *pixels = (double *) in.bits(sample);
-        radon(ptr, pixels, theta, height, width, (width-1)/2, (height-1)/2, num_angles, rFirst, output_size);
-	}
+    if (depth == 32)
+        do_radon2_dispatch<bim::float32>(in, out, theta, num_angles, rFirst, output_size);
+    else
+        do_radon2_dispatch<bim::float64>(in, out, theta, num_angles, rFirst, output_size);
 
     out = out.rotate(90);
     return out;
@@ -242,29 +399,40 @@ Image radon2 (const Image &matrix_IN) {
 // inverse transforms are not implemented yet
 //------------------------------------------------------------------------------------
 
-Image Image::transform( Image::TransformMethod type ) const {
+Image Image::transform( Image::TransformMethod type, int depth, int levels ) const {
     if (type==Image::tmFFT)
         return fft2 (*this);
     else if (type==Image::tmChebyshev)
-        return chebyshev2 (*this);    
+        return chebyshev2 (*this, depth);    
     else if (type==Image::tmWavelet)
-        return wavelet2 (*this);    
+        return wavelet2 (*this, depth, levels);
     else if (type==Image::tmRadon)
-        return radon2 (*this);    
+        return radon2 (*this, depth);    
 
     return Image();  
 }
 
+// volumetric transforms, only wavelet is available for now
+ImageStack ImageStack::transform( Image::TransformMethod type, int depth, int levels ) const {
+    if (type==Image::tmWavelet)
+        return wavelet3 (*this, depth, levels);
+    return ImageStack();
+}
 
 Image operation_transform(Image &img, const bim::xstring &arguments, const xoperations &operations, ImageHistogram *hist, XConf *c) {
+    std::vector<xstring> args = arguments.toLowerCase().split(",");
+    xstring method = args.size()>0 ? args[0] : "";
+    int depth = args.size()>1 ? args[1].toInt(64) : 64;
+    int levels = args.size()>2 ? args[2].toInt(1) : 1;
+
     Image::TransformMethod transform = Image::tmNone;
-    if (arguments.toLowerCase() == "chebyshev") transform = Image::tmChebyshev;
-    if (arguments.toLowerCase() == "fft")       transform = Image::tmFFT;
-    if (arguments.toLowerCase() == "radon")     transform = Image::tmRadon;
-    if (arguments.toLowerCase() == "wavelet")   transform = Image::tmWavelet;
+    if (method == "chebyshev") transform = Image::tmChebyshev;
+    if (method == "fft")       transform = Image::tmFFT;
+    if (method == "radon")     transform = Image::tmRadon;
+    if (method == "wavelet")   transform = Image::tmWavelet;
 
     if (transform != Image::tmcNone)
-        return img.transform(transform);
+        return img.transform(transform, depth, levels);
     return img;
 };
 
@@ -1111,10 +1279,10 @@ const void copy_sample(const Image &in, Image &out, int isample, int osample) {
 }
 
 Image Image::transform_icc(const std::vector<char> &profile) {
-    if (!metadata.hasKey(bim::RAW_TAGS_ICC) || metadata.get_type(bim::RAW_TAGS_ICC) != bim::RAW_TYPES_ICC) return *this;
+    if (!metadata->hasKey(bim::RAW_TAGS_ICC) || metadata->get_type(bim::RAW_TAGS_ICC) != bim::RAW_TYPES_ICC) return *this;
 
     // set proper color definitions and bit depths
-    cmsHPROFILE iProfile = cmsOpenProfileFromMem(metadata.get_value_bin(bim::RAW_TAGS_ICC), metadata.get_size(bim::RAW_TAGS_ICC));
+    cmsHPROFILE iProfile = cmsOpenProfileFromMem(metadata->get_value_bin(bim::RAW_TAGS_ICC), metadata->get_size(bim::RAW_TAGS_ICC));
     cmsHPROFILE oProfile = cmsOpenProfileFromMem(&profile[0], profile.size());
     int iColorSpace  = color_space_sig2int(cmsGetColorSpace(iProfile));
     int oColorSpace  = color_space_sig2int(cmsGetColorSpace(oProfile));
@@ -1193,7 +1361,7 @@ Image Image::transform_icc(const std::vector<char> &profile) {
     
     // set new profile
     out.bmp->i.imageMode = color_space_to_ImageMode(oColorSpace);
-    out.metadata.set_value(bim::RAW_TAGS_ICC, profile, bim::RAW_TYPES_ICC);
+    out.metadata.edit().set_value(bim::RAW_TAGS_ICC, profile, bim::RAW_TYPES_ICC);
     return out;
 }
 
@@ -1213,14 +1381,14 @@ void Image::icc_load(const std::string &filename) {
     if (filename.size() < 1) return;
     std::vector<char> buf;
     icc_load_profile(filename, buf);
-    metadata.set_value(bim::RAW_TAGS_ICC, buf, bim::RAW_TYPES_ICC);
+    metadata.edit().set_value(bim::RAW_TAGS_ICC, buf, bim::RAW_TYPES_ICC);
 }
 
 void Image::icc_save(const std::string &filename) const {
-    if (filename.size() > 0 && metadata.hasKey(bim::RAW_TAGS_ICC) && metadata.get_type(bim::RAW_TAGS_ICC) == bim::RAW_TYPES_ICC) {
+    if (filename.size() > 0 && metadata->hasKey(bim::RAW_TAGS_ICC) && metadata->get_type(bim::RAW_TAGS_ICC) == bim::RAW_TYPES_ICC) {
         std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary);
         if (!out.is_open()) return;
-        out.write(metadata.get_value_bin(bim::RAW_TAGS_ICC), metadata.get_size(bim::RAW_TAGS_ICC));
+        out.write(metadata->get_value_bin(bim::RAW_TAGS_ICC), metadata->get_size(bim::RAW_TAGS_ICC));
         out.close();
     }
 }
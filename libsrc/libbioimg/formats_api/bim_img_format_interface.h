@@ -35,8 +35,10 @@
     2009-06-29 16:21 - updated API to v1.7
     2010-01-25 16:45 - updated API to v1.8
     2012-01-01 16:45 - updated API to v2.0
+    2026-10-19 12:00 - updated API to v2.1, region reading
+    2026-10-19 12:00 - updated API to v2.2, channel selective reading
 
-  ver: 20
+  ver: 22
         
 *******************************************************************************/
 
@@ -412,11 +414,15 @@ typedef struct FormatHandle {
   BIM_IMAGE_CLASS       *image;              // pointer to an image structure to read/write
   BIM_OPTIONS_CLASS     *options;            // v1.6 pointer to encoding options string
 
-  void *param1; // reserved
+  // v2.2 channel subset to read, channels[i] is the file sample decoded into output sample i,
+  // readers that decode only those samples set channelsRead, otherwise the host extracts them
+  const int32       *channels;           // v2.2 IN: requested samples, NULL reads all, used to be param1
+  uint32            numChannels;         // v2.2 IN: number of entries in channels
+  uint32            channelsRead;        // v2.2 OUT: 1 if the reader honoured the channel subset
   void *param2; // reserved
   void *param3; // reserved  
 
-  char reserved[52];
+  char reserved[44];
   
 } FormatHandle;
 //-----------------------------------------------------
@@ -521,6 +527,10 @@ typedef uint(*WriteImageTileProc)   (FormatHandle *fmtHndl, uint page, uint64 xi
 typedef uint(*ReadImageLevelProc)    (FormatHandle *fmtHndl, uint page, uint level); // v2.0, redesignated
 typedef uint(*WriteImageLevelProc)   (FormatHandle *fmtHndl, uint page, uint level); // v2.0, redesignated
 
+// reads pixels x1..x2 and y1..y2 (inclusive) of a resolution level, coordinates are
+// given in pixels of that level, the region is clipped to the level size
+typedef uint(*ReadImageRegionProc)   (FormatHandle *fmtHndl, uint page, uint64 x1, uint64 y1, uint64 x2, uint64 y2, uint level); // v2.1
+
 // difference with preview is that if there's a thumbnail in the image file
 // then it will be upscaled/downscaled to meet w and h...
 typedef uint (*ReadImageThumbProc)   (FormatHandle *fmtHndl, uint w, uint h);
@@ -609,7 +619,7 @@ typedef struct FormatHeader {
   void *readMetaDataAsTextProc;
   AppendMetaDataProc      appendMetaDataProc; // v1.7
 
-  void *param1;       // reserved
+  ReadImageRegionProc     readImageRegionProc; // v2.1, used to be reserved
   void *param2;       // reserved
   char reserved[100];
 } FormatHeader;
@@ -29,8 +29,9 @@
     04/08/2004 11:57 - First creation
     10/10/2005 15:15 - Fixes in allocImg to read palette for images
     2008-06-27 14:57 - Fixes by Mario Emmenlauer to support large files
+    2026-10-19 12:00 - Channel selective reading
       
-  ver: 4
+  ver: 5
         
 *******************************************************************************/
 
@@ -38,6 +39,7 @@
 #include <cmath>
 #include <cstdio>
 #include <cstring>
+#include <vector>
 
 #include <xstring.h>
 #include <bim_metatags.h>
@@ -340,6 +342,10 @@ FormatHandle bim::initFormatHandle()
 
   tp.image = NULL;
   tp.options = NULL;
+
+  tp.channels = NULL;
+  tp.numChannels = 0;
+  tp.channelsRead = 0;
   
   tp.readProc  = NULL;
   tp.writeProc = NULL;
@@ -523,6 +529,75 @@ void bim::deleteImg( FormatHandle *fmtHndl, ImageBitmap *img) {
   } // for samples
 }
 
+//------------------------------------------------------------------------------
+// channel selective reading
+//------------------------------------------------------------------------------
+
+bool bim::channelsRequested( FormatHandle *fmtHndl ) {
+  return fmtHndl && fmtHndl->channels && fmtHndl->numChannels > 0;
+}
+
+// samples of color spaces that need conversion are only meaningful together
+static bool channels_separable( const ImageInfo &info, bim::uint numChannels, const int32 *channels ) {
+  if (info.imageMode != IM_GRAYSCALE && info.imageMode != IM_RGB && info.imageMode != IM_RGBA && info.imageMode != IM_MULTI)
+    return false;
+  for (bim::uint i=0; i<numChannels; ++i)
+    if (channels[i] < 0 || channels[i] >= (int) info.samples)
+      return false;
+  return true;
+}
+
+bim::uint bim::requestedChannel( FormatHandle *fmtHndl, bim::uint sample ) {
+  if (!channelsRequested(fmtHndl) || !fmtHndl->channelsRead || sample >= fmtHndl->numChannels) return sample;
+  return (bim::uint) fmtHndl->channels[sample];
+}
+
+int bim::allocImgChannels( FormatHandle *fmtHndl, ImageInfo *info, ImageBitmap *img ) {
+  if (!fmtHndl || !info || !img) return 1;
+  if (!channelsRequested(fmtHndl) || !channels_separable(*info, fmtHndl->numChannels, fmtHndl->channels))
+    return allocImg( fmtHndl, info, img );
+
+  // image mode is kept as is, same as when channels are remapped after decoding
+  ImageInfo iminfo = *info;
+  iminfo.samples = fmtHndl->numChannels;
+  if (allocImg( fmtHndl, &iminfo, img ) != 0) return 1;
+  fmtHndl->channelsRead = 1;
+  return 0;
+}
+
+int bim::extractRequestedChannels( FormatHandle *fmtHndl, ImageBitmap *img ) {
+  if (!fmtHndl || !img) return 1;
+  if (!channelsRequested(fmtHndl) || fmtHndl->channelsRead) return 0;
+  if (!channels_separable(img->i, fmtHndl->numChannels, fmtHndl->channels)) return 0;
+
+  bim::uint samples = img->i.samples;
+  bim::uint n = fmtHndl->numChannels;
+  std::vector<void*> planes(n, (void*) NULL);
+  std::vector<bool> used(samples, false);
+  uint64 size = getImgSizeInBytes( img );
+  for (bim::uint i=0; i<n; ++i) {
+    int c = fmtHndl->channels[i];
+    if (!used[c]) {
+      planes[i] = img->bits[c];
+      used[c] = true;
+    } else { // requested twice, planes are never shared
+      planes[i] = xmalloc( fmtHndl, size );
+      if (!planes[i]) return 1;
+      memcpy( planes[i], img->bits[c], size );
+    }
+  }
+
+  for (bim::uint sample=0; sample<samples; ++sample)
+    if (!used[sample] && img->bits[sample])
+      xfree( fmtHndl, img->bits[sample] );
+
+  for (bim::uint sample=0; sample<BIM_MAX_CHANNELS; ++sample)
+    img->bits[sample] = sample < n ? planes[sample] : NULL;
+  img->i.samples = n;
+  fmtHndl->channelsRead = 1;
+  return 0;
+}
+
 int bim::getSampleHistogram(ImageBitmap *img, long *hist, int sample)
 {
   if (img == 0) return -1;
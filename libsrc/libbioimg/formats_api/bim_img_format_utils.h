@@ -124,6 +124,16 @@ int allocImg( FormatHandle *fmtHndl, ImageInfo *info );
 void deleteImg( ImageBitmap *img);
 void deleteImg( FormatHandle *fmtHndl, ImageBitmap *img);
 
+// channel selective reading, v2.2
+// true if the host asked for a subset of samples
+bool channelsRequested( FormatHandle *fmtHndl );
+// file sample that should be decoded into the output sample, same sample unless allocImgChannels honoured the request
+uint requestedChannel( FormatHandle *fmtHndl, uint sample );
+// alloc image using info with as many samples as requested, marks the request as honoured
+int allocImgChannels( FormatHandle *fmtHndl, ImageInfo *info, ImageBitmap *img );
+// keeps only the requested samples of a fully decoded image, used by the host if the reader did not
+int extractRequestedChannels( FormatHandle *fmtHndl, ImageBitmap *img );
+
 uint64 getLineSizeInBytes(ImageBitmap *img);
 uint64 getImgSizeInBytes(ImageBitmap *img);
 uint getImgNumColors(ImageBitmap *img);
@@ -8,6 +8,7 @@
   History:
     2007-07-06 17:02 - First creation
     2013-06-15 14:40 - Parallel implementation
+    2026-10-19 12:00 - Volume interpolation along Z
       
   ver: 1
         
@@ -21,6 +22,8 @@
 #include <fstream>
 #include <limits>
 #include <vector>
+#include <cstring>
+#include <algorithm>
 
 #include "xtypes.h"
 
@@ -152,6 +155,32 @@ void ResizeImage( Td *pdest, unsigned int w_to, unsigned int h_to, unsigned int
                          DInterpolationFilter<Tw> &filter, const Tw blur );
 
 
+//************************************************************************************
+// Volume resize functions along Z, templated type is the pixel data type
+// planes are given as arrays of pointers to plane_size values each, 
+// only Z is interpolated, planes are processed in blocks and in parallel
+//************************************************************************************
+
+// nearest neighbor ------------------------------------------------------------------
+template <typename T, typename Tw>
+void volume_resample_z_NN ( T **pdest, unsigned int d_to, const T * const *psrc, unsigned int d_in, bim::uint64 plane_size );
+
+// Bilinear --------------------------------------------------------------------------
+template <typename T, typename Tw>
+void volume_resample_z_BL ( T **pdest, unsigned int d_to, const T * const *psrc, unsigned int d_in, bim::uint64 plane_size );
+
+// Bicubic ---------------------------------------------------------------------------
+template <typename T, typename Tw>
+void volume_resample_z_BC ( T **pdest, unsigned int d_to, const T * const *psrc, unsigned int d_in, bim::uint64 plane_size );
+
+//------------------------------------------------------------------------------------
+// Generic resize function along Z, same filtering as VerticalFilter
+//------------------------------------------------------------------------------------
+template <typename Td, typename Tw>
+void ResizeVolumeZ( Td **pdest, unsigned int d_to, const Td * const *psrc, unsigned int d_in, bim::uint64 plane_size,
+                    DInterpolationFilter<Tw> &filter, const Tw blur );
+
+
 
 
 
@@ -797,6 +826,125 @@ void image_resample_BC ( T *pdest, unsigned int w_to, unsigned int h_to, unsigne
 }
 
 
+//************************************************************************************
+// Volume interpolation along Z
+//************************************************************************************
+
+// number of values of a plane interpolated at once, accumulator and the
+// corresponding blocks of all contributing planes stay in cache
+#define BIM_RESIZE_Z_BLOCK 2048
+
+//------------------------------------------------------------------------------------
+//  o filter: filter to use
+//  o blur: The blur factor where > 1 is blurry, < 1 is sharp
+//------------------------------------------------------------------------------------
+template <typename Td, typename Tw>
+void ResizeVolumeZ( Td **pdest, unsigned int d_to, const Td * const *psrc, unsigned int d_in, bim::uint64 plane_size,
+                    DInterpolationFilter<Tw> &filter, const Tw blur )
+{
+  Td TdMin = bim::lowest<Td>();
+  Td TdMax = std::numeric_limits<Td>::max();
+  Tw TwEps = std::numeric_limits<Tw>::epsilon();
+  Tw z_factor = (Tw) d_to / (Tw) d_in;
+  Tw z_support = (Tw)( blur * bim::max<double>( 1.0/z_factor, 1.0*filter.support() ) );
+  if (z_support > filter.support() )
+    filter.setSupport( z_support );
+
+  Tw scale = (Tw)(blur * bim::max<double>( 1.0/z_factor, 1.0 ) );
+  Tw support = scale * filter.support();
+  if (support <= 0.5) {
+    // Reduce to point sampling
+    support = (Tw) (0.5+TwEps);
+    scale = 1.0;
+  }
+  scale = (Tw)(1.0/scale);
+
+  // contributions of input planes to every output plane, computed the same way as in VerticalFilter
+  std::vector<unsigned int> starts(d_to), counts(d_to);
+  std::vector< std::vector<Tw> > weights(d_to);
+  for (unsigned int z=0; z<d_to; ++z) {
+    Tw center  = (Tw)  (z+0.5)/z_factor;
+    Tw density = 0.0;
+    unsigned int start = (int) (bim::max<double>(center-support,0.0) + 0.5);
+    unsigned int stop  = (int) (bim::min<double>(center+support, d_in+0.5));
+    std::vector<Tw> &w = weights[z];
+    w.resize(stop-start);
+    for (unsigned int n=0; n<(stop-start); ++n) {
+      w[n] = filter.function( (Tw)(scale * ((start+n)-center+0.5)) );
+      density += w[n];
+    }
+    if ((density != 0.0) && (density != 1.0)) {
+      // normalize
+      density = (Tw)(1.0/density);
+      for (unsigned int i=0; i<w.size(); ++i)
+        w[i] *= density;
+    }
+    starts[z] = start;
+    counts[z] = (unsigned int) w.size();
+  }
+
+  // all output planes of one block are computed by the same thread, consecutive
+  // output planes mostly share input planes that are then still in cache
+  const bim::int64 blocks = (bim::int64) ((plane_size + BIM_RESIZE_Z_BLOCK - 1) / BIM_RESIZE_Z_BLOCK);
+  const bim::int64 tasks = blocks * d_to;
+  #pragma omp parallel default(shared) if (tasks>BIM_OMP_FOR2)
+  {
+    std::vector<Tw> acc(BIM_RESIZE_Z_BLOCK);
+    #pragma omp for BIM_OMP_SCHEDULE
+    for (bim::int64 t=0; t<tasks; ++t) {
+      const unsigned int z = (unsigned int) (t % d_to);
+      const bim::uint64 x0 = (bim::uint64) (t / d_to) * BIM_RESIZE_Z_BLOCK;
+      const unsigned int len = (unsigned int) std::min<bim::uint64>(BIM_RESIZE_Z_BLOCK, plane_size-x0);
+      for (unsigned int x=0; x<len; ++x)
+        acc[x] = 0;
+
+      for (unsigned int i=0; i<counts[z]; ++i) {
+        const Td *p = psrc[starts[z]+i] + x0;
+        Tw alpha = weights[z][i];
+        for (unsigned int x=0; x<len; ++x)
+          acc[x] += alpha*p[x];
+      } // for i to n
+
+      Td *q = pdest[z] + x0;
+      // we have to round if data is integer and work is float
+      if (std::numeric_limits<Td>::is_integer && !std::numeric_limits<Tw>::is_integer)
+        for (unsigned int x=0; x<len; ++x)
+          q[x] = bim::trim<Td, Tw>( bim::round<Tw>(acc[x]), TdMin, TdMax );
+      else
+        for (unsigned int x=0; x<len; ++x)
+          q[x] = bim::trim<Td, Tw>( acc[x], TdMin, TdMax );
+    } // for t
+  }
+}
+
+//------------------------------------------------------------------------------------
+// resize
+//------------------------------------------------------------------------------------
+
+template <typename T, typename Tw>
+void volume_resample_z_NN ( T **pdest, unsigned int d_to, const T * const *psrc, unsigned int d_in, bim::uint64 plane_size ) {
+  Tw ratio = d_in / (Tw) d_to;
+
+  #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (d_to>BIM_OMP_FOR2)
+  for (bim::int64 z=0; z<d_to; z++) {
+    unsigned int zn = bim::trim<unsigned int, Tw>(ceil(z*ratio), 0, d_in-1 );
+    memcpy( pdest[z], psrc[zn], plane_size*sizeof(T) );
+  } // z
+}
+
+template <typename T, typename Tw>
+void volume_resample_z_BL ( T **pdest, unsigned int d_to, const T * const *psrc, unsigned int d_in, bim::uint64 plane_size ) {
+  DTriangleFilter<Tw> filter;
+  ResizeVolumeZ<T, Tw>( pdest, d_to, psrc, d_in, plane_size, filter, 0.85f );
+}
+
+template <typename T, typename Tw>
+void volume_resample_z_BC ( T **pdest, unsigned int d_to, const T * const *psrc, unsigned int d_in, bim::uint64 plane_size ) {
+  DCubicFilter<Tw> filter;
+  ResizeVolumeZ<T, Tw>( pdest, d_to, psrc, d_in, plane_size, filter, 0.95f );
+}
+
+
 //************************************************************************************
 // Vector interpolation
 //************************************************************************************
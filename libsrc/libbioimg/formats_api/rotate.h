@@ -6,8 +6,10 @@
 
   History:
     2007-07-06 17:02 - First creation
+    2026-10-19 12:00 - Affine and projective warps
+    2026-10-19 12:00 - Cache blocked parallel transposes for 90 degree rotations
       
-  ver: 1
+  ver: 3
         
 *******************************************************************************/
 
@@ -19,10 +21,16 @@
 #include <fstream>
 #include <limits>
 #include <vector>
+#include <cmath>
 
 #include "xtypes.h"
 #include "bim_buffer.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BIM_ROTATE_SSE2
+#include <emmintrin.h>
+#endif
+
 #ifdef min
 #undef min
 #endif
@@ -31,6 +39,21 @@
 #undef max
 #endif
 
+//------------------------------------------------------------------------------------
+// Transposes, templated type is the pixel data type
+//------------------------------------------------------------------------------------
+
+// dst[j][i] = src[i][j] for i<rows and j<cols, rows may come from different planes,
+// runs serially in 64x64 cache blocks made of in-register transposed micro tiles
+template <typename T>
+void transpose_rows ( T *const *dst, const T *const *src, bim::uint64 rows, bim::uint64 cols );
+
+// dest row x (w_in-1-x with flip_x) receives source column x, in the order of source
+// rows or reversed with flip_y, blocks of rows are processed in parallel
+template <typename T>
+void image_transpose ( T *pdest, bim::uint64 offset_to, const T *psrc, bim::uint64 w_in, bim::uint64 h_in, bim::uint64 offset_in,
+                       bool flip_x = false, bool flip_y = false );
+
 //------------------------------------------------------------------------------------
 // Simple Rotate functions, templated type is the pixel data type
 //------------------------------------------------------------------------------------
@@ -51,51 +74,186 @@ template <typename T>
 void image_mirror ( T *pdest, unsigned int w_to, unsigned int h_to, unsigned int offset_to,
                         const T *psrc,  unsigned int w_in, unsigned int h_in, unsigned int offset_in );
 
+//------------------------------------------------------------------------------------
+// Geometric warps, templated T is the pixel data type and Tw the working type
+// m is a row-major 3x3 matrix mapping output pixel coordinates into the input image,
+// pixel centers are at integer coordinates, pixels mapped outside of the input
+// are set to the background value
+//------------------------------------------------------------------------------------
+
+// nearest neighbor ------------------------------------------------------------------
+template <typename T, typename Tw>
+void image_warp_NN ( T *pdest, unsigned int w_to, unsigned int h_to, unsigned int offset_to,
+                     const T *psrc,  unsigned int w_in, unsigned int h_in, unsigned int offset_in,
+                     const double *m, const T &background );
+
+// Bilinear --------------------------------------------------------------------------
+template <typename T, typename Tw>
+void image_warp_BL ( T *pdest, unsigned int w_to, unsigned int h_to, unsigned int offset_to,
+                     const T *psrc,  unsigned int w_in, unsigned int h_in, unsigned int offset_in,
+                     const double *m, const T &background );
+
+// Bicubic, Catmull-Rom --------------------------------------------------------------
+template <typename T, typename Tw>
+void image_warp_BC ( T *pdest, unsigned int w_to, unsigned int h_to, unsigned int offset_to,
+                     const T *psrc,  unsigned int w_in, unsigned int h_in, unsigned int offset_in,
+                     const double *m, const T &background );
+
 
 //************************************************************************************
 // IMPLEMENTATION PART
 //************************************************************************************
 
+//------------------------------------------------------------------------------------
+// transposes
+//------------------------------------------------------------------------------------
+
+// N x N micro tile: dst[j][dx+i] = src[i][sx+j], element types of the same size share kernels
+template <typename T, int S = sizeof(T)>
+class TransposeTile {
+public:
+  static const int N = 4;
+  static inline void run( T *const *dst, bim::uint64 dx, const T *const *src, bim::uint64 sx ) {
+    for (int j=0; j<N; ++j)
+      for (int i=0; i<N; ++i)
+        dst[j][dx+i] = src[i][sx+j];
+  }
+};
+
+#ifdef BIM_ROTATE_SSE2
+
 template <typename T>
-void image_rotate_right ( T *pdest, unsigned int /*w_to*/, unsigned int /*h_to*/, unsigned int offset_to,
-                         const T *psrc, unsigned int w_in, unsigned int h_in, unsigned int offset_in ) {
+class TransposeTile<T, 1> {
+public:
+  static const int N = 8;
+  static inline void run( T *const *dst, bim::uint64 dx, const T *const *src, bim::uint64 sx ) {
+    __m128i a0 = _mm_unpacklo_epi8( _mm_loadl_epi64((const __m128i *)(src[0]+sx)), _mm_loadl_epi64((const __m128i *)(src[1]+sx)) );
+    __m128i a1 = _mm_unpacklo_epi8( _mm_loadl_epi64((const __m128i *)(src[2]+sx)), _mm_loadl_epi64((const __m128i *)(src[3]+sx)) );
+    __m128i a2 = _mm_unpacklo_epi8( _mm_loadl_epi64((const __m128i *)(src[4]+sx)), _mm_loadl_epi64((const __m128i *)(src[5]+sx)) );
+    __m128i a3 = _mm_unpacklo_epi8( _mm_loadl_epi64((const __m128i *)(src[6]+sx)), _mm_loadl_epi64((const __m128i *)(src[7]+sx)) );
+    __m128i b0 = _mm_unpacklo_epi16(a0, a1);
+    __m128i b1 = _mm_unpackhi_epi16(a0, a1);
+    __m128i b2 = _mm_unpacklo_epi16(a2, a3);
+    __m128i b3 = _mm_unpackhi_epi16(a2, a3);
+    __m128i c[4] = { _mm_unpacklo_epi32(b0, b2), _mm_unpackhi_epi32(b0, b2),
+                     _mm_unpacklo_epi32(b1, b3), _mm_unpackhi_epi32(b1, b3) };
+    for (int j=0; j<4; ++j) {
+      _mm_storel_epi64( (__m128i *)(dst[2*j]+dx), c[j] );
+      _mm_storel_epi64( (__m128i *)(dst[2*j+1]+dx), _mm_srli_si128(c[j], 8) );
+    }
+  }
+};
 
-  register unsigned int x, y;
-  register unsigned int xn, yn;
-  const T *p = (T*) psrc;
-  T *q = (T*) pdest;
+template <typename T>
+class TransposeTile<T, 2> {
+public:
+  static const int N = 8;
+  static inline void run( T *const *dst, bim::uint64 dx, const T *const *src, bim::uint64 sx ) {
+    __m128i r[8], a[8], b[8];
+    for (int i=0; i<8; ++i)
+      r[i] = _mm_loadu_si128( (const __m128i *)(src[i]+sx) );
+    for (int i=0; i<4; ++i) {
+      a[2*i]   = _mm_unpacklo_epi16(r[2*i], r[2*i+1]);
+      a[2*i+1] = _mm_unpackhi_epi16(r[2*i], r[2*i+1]);
+    }
+    for (int i=0; i<2; ++i) {
+      b[4*i]   = _mm_unpacklo_epi32(a[4*i],   a[4*i+2]);
+      b[4*i+1] = _mm_unpackhi_epi32(a[4*i],   a[4*i+2]);
+      b[4*i+2] = _mm_unpacklo_epi32(a[4*i+1], a[4*i+3]);
+      b[4*i+3] = _mm_unpackhi_epi32(a[4*i+1], a[4*i+3]);
+    }
+    for (int j=0; j<4; ++j) {
+      _mm_storeu_si128( (__m128i *)(dst[2*j]+dx),   _mm_unpacklo_epi64(b[j], b[j+4]) );
+      _mm_storeu_si128( (__m128i *)(dst[2*j+1]+dx), _mm_unpackhi_epi64(b[j], b[j+4]) );
+    }
+  }
+};
 
-  for (y=0; y<h_in; y++) {
-    for (x=0; x<w_in; x++) {
-      xn = (h_in-1)-y;
-      yn = x;
-      q = pdest + (offset_to * yn);
-      q[xn] = p[x];      
-    } // x
-    p += offset_in;
-  } // y
+template <typename T>
+class TransposeTile<T, 4> {
+public:
+  static const int N = 4;
+  static inline void run( T *const *dst, bim::uint64 dx, const T *const *src, bim::uint64 sx ) {
+    __m128i r0 = _mm_loadu_si128( (const __m128i *)(src[0]+sx) );
+    __m128i r1 = _mm_loadu_si128( (const __m128i *)(src[1]+sx) );
+    __m128i r2 = _mm_loadu_si128( (const __m128i *)(src[2]+sx) );
+    __m128i r3 = _mm_loadu_si128( (const __m128i *)(src[3]+sx) );
+    __m128i a0 = _mm_unpacklo_epi32(r0, r1);
+    __m128i a1 = _mm_unpackhi_epi32(r0, r1);
+    __m128i a2 = _mm_unpacklo_epi32(r2, r3);
+    __m128i a3 = _mm_unpackhi_epi32(r2, r3);
+    _mm_storeu_si128( (__m128i *)(dst[0]+dx), _mm_unpacklo_epi64(a0, a2) );
+    _mm_storeu_si128( (__m128i *)(dst[1]+dx), _mm_unpackhi_epi64(a0, a2) );
+    _mm_storeu_si128( (__m128i *)(dst[2]+dx), _mm_unpacklo_epi64(a1, a3) );
+    _mm_storeu_si128( (__m128i *)(dst[3]+dx), _mm_unpackhi_epi64(a1, a3) );
+  }
+};
+
+#endif // BIM_ROTATE_SSE2
+
+template <typename T>
+void transpose_rows ( T *const *dst, const T *const *src, bim::uint64 rows, bim::uint64 cols ) {
+  const bim::uint64 block = 64;
+  const bim::uint64 N = TransposeTile<T>::N;
+  for (bim::uint64 r0=0; r0<rows; r0+=block) {
+    bim::uint64 r1 = bim::min<bim::uint64>(r0+block, rows);
+    for (bim::uint64 c0=0; c0<cols; c0+=block) {
+      bim::uint64 c1 = bim::min<bim::uint64>(c0+block, cols);
+      bim::uint64 r = r0;
+      for (; r+N<=r1; r+=N) {
+        bim::uint64 c = c0;
+        for (; c+N<=c1; c+=N)
+          TransposeTile<T>::run( dst+c, r, src+r, c );
+        for (; c<c1; ++c)
+          for (bim::uint64 i=r; i<r+N; ++i)
+            dst[c][i] = src[i][c];
+      }
+      for (; r<r1; ++r)
+        for (bim::uint64 c=c0; c<c1; ++c)
+          dst[c][r] = src[r][c];
+    } // c0
+  } // r0
+}
+
+template <typename T>
+void image_transpose ( T *pdest, bim::uint64 offset_to, const T *psrc, bim::uint64 w_in, bim::uint64 h_in, bim::uint64 offset_in,
+                       bool flip_x, bool flip_y ) {
+  const bim::int64 block = 64;
+  const bim::int64 blocks = (h_in + block - 1) / block;
+
+  #pragma omp parallel default(shared) if (blocks>1 && w_in*h_in>BIM_OMP_FOR1)
+  {
+    std::vector<const T *> src(block);
+    std::vector<T *> dst(w_in);
+    #pragma omp for BIM_OMP_SCHEDULE
+    for (bim::int64 b=0; b<blocks; ++b) {
+      bim::uint64 y0 = b*block;
+      bim::uint64 y1 = bim::min<bim::uint64>(y0+block, h_in);
+      // reversed source rows land in ascending dest columns starting at h_in-y1
+      bim::uint64 col = flip_y ? h_in-y1 : y0;
+      for (bim::uint64 i=0; i<y1-y0; ++i)
+        src[i] = psrc + (flip_y ? y1-1-i : y0+i) * offset_in;
+      for (bim::uint64 x=0; x<w_in; ++x)
+        dst[x] = pdest + (flip_x ? w_in-1-x : x) * offset_to + col;
+      transpose_rows<T>( &dst[0], &src[0], y1-y0, w_in );
+    } // b
+  }
 }
 
+//------------------------------------------------------------------------------------
+// rotations
+//------------------------------------------------------------------------------------
 
 template <typename T>
-void image_rotate_left ( T *pdest, unsigned int /*w_to*/, unsigned int h_to, unsigned int offset_to,
+void image_rotate_right ( T *pdest, unsigned int /*w_to*/, unsigned int /*h_to*/, unsigned int offset_to,
                          const T *psrc, unsigned int w_in, unsigned int h_in, unsigned int offset_in ) {
+  image_transpose<T>( pdest, offset_to, psrc, w_in, h_in, offset_in, false, true );
+}
 
-  register unsigned int x, y;
-  register unsigned int xn, yn;
-  const T *p = (T*) psrc;
-  T *q = (T*) pdest;
-
-  for (y=0; y<h_in; y++) {
-    for (x=0; x<w_in; x++) {
-      xn = y;
-      yn = (h_to-1)-x;
-      q = pdest + (offset_to * yn);
-      q[xn] = p[x];      
-    } // x
-    p += offset_in;
-    //q += offset_to;
-  } // y
+template <typename T>
+void image_rotate_left ( T *pdest, unsigned int /*w_to*/, unsigned int /*h_to*/, unsigned int offset_to,
+                         const T *psrc, unsigned int w_in, unsigned int h_in, unsigned int offset_in ) {
+  image_transpose<T>( pdest, offset_to, psrc, w_in, h_in, offset_in, true, false );
 }
 
 template <typename T>
@@ -135,4 +293,140 @@ void image_mirror ( T *pdest, unsigned int w_to, unsigned int h_to, unsigned int
   } // y
 }
 
+//------------------------------------------------------------------------------------
+// warps
+//------------------------------------------------------------------------------------
+
+// input coordinates of one output row, kept in separate arrays so the loop vectorizes
+inline void warp_row_coordinates( const double *m, unsigned int w, bim::int64 y, double *sx, double *sy ) {
+  const double bx = m[1]*y + m[2];
+  const double by = m[4]*y + m[5];
+  if (m[6]==0 && m[7]==0 && m[8]==1) {
+    for (unsigned int x=0; x<w; ++x) {
+      sx[x] = m[0]*x + bx;
+      sy[x] = m[3]*x + by;
+    }
+  } else {
+    const double bw = m[7]*y + m[8];
+    for (unsigned int x=0; x<w; ++x) {
+      double iw = 1.0 / (m[6]*x + bw);
+      sx[x] = (m[0]*x + bx) * iw;
+      sy[x] = (m[3]*x + by) * iw;
+    }
+  }
+}
+
+// pixels whose input position falls within the half pixel border around the input are painted
+inline bool warp_inside( double x, double y, unsigned int w, unsigned int h ) {
+  return x > -0.5 && y > -0.5 && x < w-0.5 && y < h-0.5;
+}
+
+template <typename T, typename Tw>
+inline T warp_value( Tw v ) {
+  if (std::numeric_limits<T>::is_integer) v = floor(v + 0.5);
+  return bim::trim<T, Tw>(v);
+}
+
+template <typename T, typename Tw>
+void image_warp_NN ( T *pdest, unsigned int w_to, unsigned int h_to, unsigned int offset_to,
+                     const T *psrc,  unsigned int w_in, unsigned int h_in, unsigned int offset_in,
+                     const double *m, const T &background ) {
+
+  #pragma omp parallel default(shared) if (h_to>BIM_OMP_FOR2)
+  {
+    std::vector<double> sx(w_to), sy(w_to);
+    #pragma omp for BIM_OMP_SCHEDULE
+    for (bim::int64 y=0; y<(bim::int64)h_to; ++y) {
+      warp_row_coordinates( m, w_to, y, &sx[0], &sy[0] );
+      T *q = pdest + y*offset_to;
+      for (unsigned int x=0; x<w_to; ++x) {
+        if (!warp_inside(sx[x], sy[x], w_in, h_in)) { q[x] = background; continue; }
+        unsigned int xn = bim::min<unsigned int>( (unsigned int) (sx[x] + 0.5), w_in-1 );
+        unsigned int yn = bim::min<unsigned int>( (unsigned int) (sy[x] + 0.5), h_in-1 );
+        q[x] = psrc[(bim::uint64) yn*offset_in + xn];
+      } // x
+    } // y
+  }
+}
+
+template <typename T, typename Tw>
+void image_warp_BL ( T *pdest, unsigned int w_to, unsigned int h_to, unsigned int offset_to,
+                     const T *psrc,  unsigned int w_in, unsigned int h_in, unsigned int offset_in,
+                     const double *m, const T &background ) {
+
+  #pragma omp parallel default(shared) if (h_to>BIM_OMP_FOR2)
+  {
+    std::vector<double> sx(w_to), sy(w_to);
+    #pragma omp for BIM_OMP_SCHEDULE
+    for (bim::int64 y=0; y<(bim::int64)h_to; ++y) {
+      warp_row_coordinates( m, w_to, y, &sx[0], &sy[0] );
+      T *q = pdest + y*offset_to;
+      for (unsigned int x=0; x<w_to; ++x) {
+        if (!warp_inside(sx[x], sy[x], w_in, h_in)) { q[x] = background; continue; }
+        double xx = bim::trim<double>(sx[x], 0, w_in-1);
+        double yy = bim::trim<double>(sy[x], 0, h_in-1);
+        unsigned int x0 = (unsigned int) xx;
+        unsigned int y0 = (unsigned int) yy;
+        unsigned int x1 = bim::min<unsigned int>(x0+1, w_in-1);
+        unsigned int y1 = bim::min<unsigned int>(y0+1, h_in-1);
+        Tw fx = (Tw) (xx - x0);
+        Tw fy = (Tw) (yy - y0);
+        const T *p0 = psrc + (bim::uint64) y0*offset_in;
+        const T *p1 = psrc + (bim::uint64) y1*offset_in;
+        Tw v0 = (Tw) p0[x0] + ((Tw) p0[x1] - (Tw) p0[x0]) * fx;
+        Tw v1 = (Tw) p1[x0] + ((Tw) p1[x1] - (Tw) p1[x0]) * fx;
+        q[x] = warp_value<T, Tw>( v0 + (v1 - v0) * fy );
+      } // x
+    } // y
+  }
+}
+
+// Catmull-Rom weights of the 4 samples around a position with fraction f
+template <typename Tw>
+inline void warp_cubic_weights( Tw f, Tw *w ) {
+  Tw f2 = f*f;
+  Tw f3 = f2*f;
+  w[0] = (Tw) (-0.5*f3 + f2 - 0.5*f);
+  w[1] = (Tw) ( 1.5*f3 - 2.5*f2 + 1.0);
+  w[2] = (Tw) (-1.5*f3 + 2.0*f2 + 0.5*f);
+  w[3] = (Tw) ( 0.5*f3 - 0.5*f2);
+}
+
+template <typename T, typename Tw>
+void image_warp_BC ( T *pdest, unsigned int w_to, unsigned int h_to, unsigned int offset_to,
+                     const T *psrc,  unsigned int w_in, unsigned int h_in, unsigned int offset_in,
+                     const double *m, const T &background ) {
+
+  #pragma omp parallel default(shared) if (h_to>BIM_OMP_FOR2)
+  {
+    std::vector<double> sx(w_to), sy(w_to);
+    #pragma omp for BIM_OMP_SCHEDULE
+    for (bim::int64 y=0; y<(bim::int64)h_to; ++y) {
+      warp_row_coordinates( m, w_to, y, &sx[0], &sy[0] );
+      T *q = pdest + y*offset_to;
+      for (unsigned int x=0; x<w_to; ++x) {
+        if (!warp_inside(sx[x], sy[x], w_in, h_in)) { q[x] = background; continue; }
+        double xx = bim::trim<double>(sx[x], 0, w_in-1);
+        double yy = bim::trim<double>(sy[x], 0, h_in-1);
+        bim::int64 x0 = (bim::int64) xx;
+        bim::int64 y0 = (bim::int64) yy;
+        Tw wx[4], wy[4];
+        warp_cubic_weights<Tw>( (Tw) (xx - x0), wx );
+        warp_cubic_weights<Tw>( (Tw) (yy - y0), wy );
+
+        unsigned int xs[4];
+        for (int i=0; i<4; ++i)
+          xs[i] = (unsigned int) bim::trim<bim::int64>(x0-1+i, 0, w_in-1);
+
+        Tw v = 0;
+        for (int j=0; j<4; ++j) {
+          const T *p = psrc + (bim::uint64) bim::trim<bim::int64>(y0-1+j, 0, h_in-1)*offset_in;
+          v += wy[j] * (wx[0]*p[xs[0]] + wx[1]*p[xs[1]] + wx[2]*p[xs[2]] + wx[3]*p[xs[3]]);
+        }
+        q[x] = warp_value<T, Tw>( v );
+      } // x
+    } // y
+  }
+}
+
 #endif //BIM_ROTATE_H
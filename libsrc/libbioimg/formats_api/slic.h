@@ -148,10 +148,91 @@ except for the very first pixel).
 #include <cstring>
 
 #include <limits>
+#include <vector>
 #include <algorithm>
 
 
 
+/** @brief elimination of small regions
+** @param segmentation labels of regions from 0 to the number of regions minus one, relabelled in place.
+** @param width image width.
+** @param height image height.
+** @param minRegionSize minimum size of a segment.
+**
+** Connected segments smaller than @a minRegionSize are merged into an already
+** visited neighbour segment, see @ref slic-tech. Runs over the whole image so
+** segments are seen complete, also when labels were computed in tiles.
+**/
+
+inline void slic_eliminate_small_regions (bim::uint32 *segmentation,
+    bim::uint64 width,
+    bim::uint64 height,
+    bim::uint64 minRegionSize)
+{
+    bim::uint64 numPixels = width * height;
+    bim::uint32 * cleaned = (bim::uint32 *) calloc(numPixels, sizeof(bim::uint32)) ;
+    bim::uint64 * segment = (bim::uint64 *) malloc(sizeof(bim::uint64) * numPixels) ;
+    bim::int64 dx [] = {+1, -1,  0,  0} ;
+    bim::int64 dy [] = { 0,  0, +1, -1} ;
+
+    for (bim::int64 pixel = 0 ; pixel < (bim::int64)numPixels ; ++pixel) {
+        if (cleaned[pixel]) continue;
+        bim::uint32 label = segmentation[pixel];
+        bim::uint64 numExpanded = 0;
+        bim::uint64 segmentSize = 0;
+        segment[segmentSize++] = pixel;
+
+        // find cleanedLabel as the label of an already cleaned
+        // region neihbour of this pixel
+        bim::uint32 cleanedLabel = label + 1 ;
+        cleaned[pixel] = label + 1 ;
+        bim::int64 x = pixel % width ;
+        bim::int64 y = pixel / width ;
+        for (bim::int64 direction = 0 ; direction < 4 ; ++direction) {
+            bim::int64 xp = x + dx[direction] ;
+            bim::int64 yp = y + dy[direction] ;
+            bim::int64 neighbor = xp + yp * width ;
+            if (0 <= xp && xp < (bim::int64)width &&
+                0 <= yp && yp < (bim::int64)height &&
+                cleaned[neighbor]) {
+                    cleanedLabel = cleaned[neighbor] ;
+            }
+        }
+
+        // expand the segment
+        while (numExpanded < segmentSize) {
+            bim::int64 open = segment[numExpanded++] ;
+            x = open % width ;
+            y = open / width ;
+            for (bim::int64 direction = 0 ; direction < 4 ; ++direction) {
+                bim::int64 xp = x + dx[direction] ;
+                bim::int64 yp = y + dy[direction] ;
+                bim::int64 neighbor = xp + yp * width ;
+                if (0 <= xp && xp < (bim::int64)width &&
+                    0 <= yp && yp < (bim::int64)height &&
+                    cleaned[neighbor] == 0 &&
+                    segmentation[neighbor] == label) {
+                        cleaned[neighbor] = label + 1 ;
+                        segment[segmentSize++] = neighbor ;
+                }
+            }
+        }
+
+        // change label to cleanedLabel if the semgent is too small
+        if (segmentSize < minRegionSize) {
+            while (segmentSize > 0) {
+                cleaned[segment[--segmentSize]] = cleanedLabel ;
+            }
+        }
+    }
+    // restore base 0 indexing of the regions
+    for (bim::int64 pixel = 0 ; pixel < (bim::int64)numPixels ; ++pixel) cleaned[pixel] -- ;
+
+    memcpy(segmentation, cleaned, numPixels * sizeof(bim::uint32)) ;
+    free(cleaned) ;
+    free(segment) ;
+}
+
 /** @brief SLIC superpixel segmentation
 ** @param segmentation segmentation.
 ** @param image image to segment.
@@ -313,7 +394,7 @@ void slic_segment (bim::uint32 *segmentation,
         memset(masses, 0, sizeof(bim::uint32) * width * height) ;
         memset(centers, 0, sizeof(Tw) * (2 + numChannels) * numRegions) ;
 
-        #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (height>BIM_OMP_FOR2)        
+        // serial since rows add into the same regions
         for (bim::int64 y = 0 ; y < (bim::int64)height ; ++y) {
             for (bim::int64 x = 0 ; x < (bim::int64)width ; ++x) {
                 bim::int64 pixel = x + y * width ;
@@ -341,68 +422,461 @@ void slic_segment (bim::uint32 *segmentation,
     free(masses) ;
     free(centers) ;
 
-    // elimiate small regions
-    {
-        bim::uint32 * cleaned = (bim::uint32 *) calloc(numPixels, sizeof(bim::uint32)) ;
-        bim::uint64 * segment = (bim::uint64 *) malloc(sizeof(bim::uint64) * numPixels) ;
-        bim::int64 dx [] = {+1, -1,  0,  0} ;
-        bim::int64 dy [] = { 0,  0, +1, -1} ;
-
-        for (bim::int64 pixel = 0 ; pixel < (bim::int64)numPixels ; ++pixel) {
-            if (cleaned[pixel]) continue;
-            bim::uint32 label = segmentation[pixel];
-            bim::uint64 numExpanded = 0;
-            bim::uint64 segmentSize = 0;
-            segment[segmentSize++] = pixel;
-
-            // find cleanedLabel as the label of an already cleaned
-            // region neihbour of this pixel
-            bim::uint32 cleanedLabel = label + 1 ;
-            cleaned[pixel] = label + 1 ;
-            bim::int64 x = pixel % width ;
-            bim::int64 y = pixel / width ;
-            for (bim::int64 direction = 0 ; direction < 4 ; ++direction) {
-                bim::int64 xp = x + dx[direction] ;
-                bim::int64 yp = y + dy[direction] ;
-                bim::int64 neighbor = xp + yp * width ;
-                if (0 <= xp && xp < (bim::int64)width &&
-                    0 <= yp && yp < (bim::int64)height &&
-                    cleaned[neighbor]) {
-                        cleanedLabel = cleaned[neighbor] ;
+    slic_eliminate_small_regions(segmentation, width, height, minRegionSize);
+}
+
+/** @brief SLIC superpixel segmentation of one tile
+** @param segmentation segmentation of the whole image, only the tile is written.
+** @param x0,y0,x1,y1 tile bounds, must be multiples of @a regionSize except at the image border.
+** @param margin overlap with neighbouring tiles, a multiple of @a regionSize.
+**
+** Runs the k-means iterations of ::slic_segment on the tile extended by @a margin
+** and writes labels of the tile pixels only, small regions are not eliminated.
+** The window is aligned to the global grid of regions so every label is the
+** index of its global grid region, as produced by ::slic_segment, and segments
+** crossing tile seams get the same label from both tiles. Memory is proportional
+** to the window size and the function is serial, tiles are meant to run in parallel.
+**/
+
+template <typename T, typename Tw>
+void slic_segment_window (bim::uint32 *segmentation,
+    const bim::Image *image,
+    bim::uint64 width,
+    bim::uint64 height,
+    bim::uint64 numChannels,
+    bim::uint64 regionSize,
+    float regularization,
+    bim::uint64 x0, bim::uint64 y0, bim::uint64 x1, bim::uint64 y1,
+    bim::uint64 margin)
+{
+    bim::uint64 wx0 = x0 > margin ? x0 - margin : 0;
+    bim::uint64 wy0 = y0 > margin ? y0 - margin : 0;
+    bim::uint64 ww = bim::min<bim::uint64>(x1 + margin, width) - wx0;
+    bim::uint64 wh = bim::min<bim::uint64>(y1 + margin, height) - wy0;
+    bim::uint64 numRegionsX = (bim::uint64) ceil((double) ww / regionSize);
+    bim::uint64 numRegionsY = (bim::uint64) ceil((double) wh / regionSize);
+    bim::uint64 numRegions = numRegionsX * numRegionsY;
+    bim::uint64 numPixels = ww * wh;
+    bim::uint64 maxNumIterations = 100;
+    bim::uint64 stride = 2 + numChannels;
+
+    // global grid position of the window
+    bim::uint64 globalRegionsX = (bim::uint64) ceil((double) width / regionSize);
+    bim::uint64 gu = wx0 / regionSize;
+    bim::uint64 gv = wy0 / regionSize;
+
+    std::vector<Tw> edgeMap(numPixels, 0);
+    std::vector<Tw> centers(stride * numRegions, 0);
+    std::vector<bim::uint32> masses(numRegions, 0);
+    std::vector<bim::uint32> labels(numPixels, 0);
+
+    // compute edge map (gradient strength), window borders use pixels outside of the window
+    for (bim::uint64 k=0; k<numChannels; ++k) {
+        for (bim::uint64 y=0; y<wh; ++y) {
+            bim::uint64 iy = wy0 + y;
+            if (iy < 1 || iy+1 >= height) continue;
+            for (bim::uint64 x=0; x<ww; ++x) {
+                bim::uint64 ix = wx0 + x;
+                if (ix < 1 || ix+1 >= width) continue;
+                Tw a = (Tw) atimage(ix-1,iy,k);
+                Tw b = (Tw) atimage(ix+1,iy,k);
+                Tw c = (Tw) atimage(ix,iy+1,k);
+                Tw d = (Tw) atimage(ix,iy-1,k);
+                edgeMap[x + y*ww] += (a - b)  * (a - b) + (c - d) * (c - d) ;
+            }
+        }
+    }
+
+    // initialize K-means centers
+    for (bim::int64 v = 0 ; v < (bim::int64)numRegionsY ; ++v) {
+        for (bim::int64 u = 0 ; u < (bim::int64)numRegionsX ; ++u) {
+            Tw minEdgeValue = std::numeric_limits<Tw>::infinity();
+
+            bim::int64 x = bim::round<bim::int64>(regionSize * (u + 0.5)) ;
+            bim::int64 y = bim::round<bim::int64>(regionSize * (v + 0.5)) ;
+            x = bim::max<bim::int64>(bim::min<bim::int64>(x, ww-1), 0);
+            y = bim::max<bim::int64>(bim::min<bim::int64>(y, wh-1), 0);
+
+            bim::int64 centerx = x, centery = y;
+            // search in a 3x3 neighbourhood the smallest edge response
+            for (bim::int64 yp = bim::max<bim::int64>(0, y-1) ; yp <= bim::min<bim::int64>(wh-1, y+1) ; ++ yp) {
+                for (bim::int64 xp = bim::max<bim::int64>(0, x-1) ; xp <= bim::min<bim::int64>(ww-1, x+1) ; ++ xp) {
+                    Tw thisEdgeValue = edgeMap[xp + yp*ww] ;
+                    if (thisEdgeValue < minEdgeValue) {
+                        minEdgeValue = thisEdgeValue;
+                        centerx = xp;
+                        centery = yp;
+                    }
                 }
             }
 
-            // expand the segment
-            while (numExpanded < segmentSize) {
-                bim::int64 open = segment[numExpanded++] ;
-                x = open % width ;
-                y = open / width ;
-                for (bim::int64 direction = 0 ; direction < 4 ; ++direction) {
-                    bim::int64 xp = x + dx[direction] ;
-                    bim::int64 yp = y + dy[direction] ;
-                    bim::int64 neighbor = xp + yp * width ;
-                    if (0 <= xp && xp < (bim::int64)width &&
-                        0 <= yp && yp < (bim::int64)height &&
-                        cleaned[neighbor] == 0 &&
-                        segmentation[neighbor] == label) {
-                            cleaned[neighbor] = label + 1 ;
-                            segment[segmentSize++] = neighbor ;
+            bim::int64 i = (v*numRegionsX + u) * stride;
+            centers[i++] = (Tw) centerx;
+            centers[i++] = (Tw) centery;
+            for (bim::uint64 k=0; k<numChannels; ++k) {
+                centers[i++] = (Tw) atimage(wx0+centerx,wy0+centery,k) ;
+            }
+        }
+    }
+    std::vector<Tw>().swap(edgeMap);
+
+    // run k-means iterations
+    Tw previousEnergy = std::numeric_limits<Tw>::infinity();
+    Tw startingEnergy = 0;
+    Tw factor = regularization / (regionSize * regionSize);
+
+    for (bim::uint64 iter=0; iter<maxNumIterations; ++iter) {
+        Tw energy = 0;
+
+        // assign pixels to centers
+        for (bim::int64 y=0; y<(bim::int64)wh; ++y) {
+            bim::int64 v = (bim::int64) floor((double)y / regionSize - 0.5) ;
+            for (bim::int64 x=0; x<(bim::int64)ww; ++x) {
+                bim::int64 u = (bim::int64) floor((double)x / regionSize - 0.5) ;
+                Tw minDistance = std::numeric_limits<Tw>::infinity();
+
+                for (bim::int64 vp = bim::max<bim::int64>(0, v) ; vp <= bim::min<bim::int64>(numRegionsY-1, v+1) ; ++vp) {
+                    for (bim::int64 up = bim::max<bim::int64>(0, u) ; up <= bim::min<bim::int64>(numRegionsX-1, u+1) ; ++up) {
+                        bim::int64 region = up  + vp * numRegionsX;
+                        const Tw *center = &centers[stride * region];
+                        Tw spatial = (x - center[0]) * (x - center[0]) + (y - center[1]) * (y - center[1]);
+                        Tw appearance = 0;
+                        for (bim::uint64 k = 0 ; k < numChannels ; ++k) {
+                            Tw z = (Tw) atimage(wx0+x,wy0+y,k) ;
+                            appearance += (z - center[k+2]) * (z - center[k+2]);
+                        }
+                        Tw distance = appearance + factor * spatial;
+                        if (minDistance > distance) {
+                            minDistance = distance ;
+                            labels[x + y * ww] = (bim::uint32)region;
+                        }
                     }
                 }
+                energy += minDistance;
+            } // x
+        } // y
+
+        // check energy termination conditions
+        if (iter == 0) {
+            startingEnergy = energy ;
+        } else {
+            if ((previousEnergy - energy) < 1e-5 * (startingEnergy - energy)) {
+                break ;
             }
+        }
+        previousEnergy = energy ;
 
-            // change label to cleanedLabel if the semgent is too small
-            if (segmentSize < minRegionSize) {
-                while (segmentSize > 0) {
-                    cleaned[segment[--segmentSize]] = cleanedLabel ;
+        // recompute centers
+        std::fill(masses.begin(), masses.end(), 0);
+        std::fill(centers.begin(), centers.end(), 0);
+        for (bim::uint64 y = 0 ; y < wh ; ++y) {
+            for (bim::uint64 x = 0 ; x < ww ; ++x) {
+                bim::uint64 region = labels[x + y * ww] ;
+                Tw *center = &centers[stride * region];
+                masses[region] ++ ;
+                center[0] += x ;
+                center[1] += y ;
+                for (bim::uint64 k = 0 ; k < numChannels ; ++k) {
+                    center[k+2] += (Tw) atimage(wx0+x,wy0+y,k) ;
                 }
             }
         }
-        // restore base 0 indexing of the regions
-        for (bim::int64 pixel = 0 ; pixel < (bim::int64)numPixels ; ++pixel) cleaned[pixel] -- ;
 
-        memcpy(segmentation, cleaned, numPixels * sizeof(bim::uint32)) ;
-        free(cleaned) ;
-        free(segment) ;
+        for (bim::uint64 region = 0 ; region < numRegions ; ++region) {
+            Tw mass = bim::max<Tw>((Tw)masses[region], 1e-8f) ;
+            for (bim::uint64 i = stride * region ; i < stride * (region + 1) ; ++i) {
+                centers[i] /= mass ;
+            }
+        }
     }
+    // write tile pixels with labels of the global region grid
+    for (bim::uint64 y = y0 ; y < y1 ; ++y) {
+        const bim::uint32 *src = &labels[(x0 - wx0) + (y - wy0) * ww];
+        bim::uint32 *dst = segmentation + y * width;
+        for (bim::uint64 x = x0 ; x < x1 ; ++x, ++src) {
+            dst[x] = (bim::uint32) ((*src % numRegionsX + gu) + (*src / numRegionsX + gv) * globalRegionsX);
+        }
+    }
+}
+
+/** @brief reconciliation of tile seams
+** @param tile tile size used to compute @a segmentation, seams are at its multiples.
+**
+** Tiles see only their margin of the neighbouring tiles, so centers of regions
+** along a seam differ between the two tiles. Centers of all regions are
+** recomputed from the stitched labels and pixels closer than one region to a
+** seam are assigned again to the closest of them, as in one more k-means
+** iteration, so both sides of a seam are decided by the same centers.
+**/
+
+inline bool slic_near_seam (bim::uint64 x, bim::uint64 tile, bim::uint64 regionSize, bim::uint64 size) {
+    bim::uint64 d = x % tile;
+    if (x >= tile && d < regionSize) return true;
+    return tile - d <= regionSize && x + (tile - d) < size;
+}
+
+template <typename T, typename Tw>
+void slic_reconcile_seams (bim::uint32 *segmentation,
+    const bim::Image *image,
+    bim::uint64 width,
+    bim::uint64 height,
+    bim::uint64 numChannels,
+    bim::uint64 regionSize,
+    float regularization,
+    bim::uint64 tile)
+{
+    bim::uint64 numRegionsX = (bim::uint64) ceil((double) width / regionSize);
+    bim::uint64 numRegionsY = (bim::uint64) ceil((double) height / regionSize);
+    bim::uint64 numRegions = numRegionsX * numRegionsY;
+    bim::uint64 stride = 2 + numChannels;
+
+    std::vector<Tw> centers(stride * numRegions, 0);
+    std::vector<bim::uint64> masses(numRegions, 0);
+    for (bim::uint64 y = 0 ; y < height ; ++y) {
+        for (bim::uint64 x = 0 ; x < width ; ++x) {
+            bim::uint64 region = segmentation[x + y * width] ;
+            Tw *center = &centers[stride * region];
+            masses[region] ++ ;
+            center[0] += x ;
+            center[1] += y ;
+            for (bim::uint64 k = 0 ; k < numChannels ; ++k) {
+                center[k+2] += (Tw) atimage(x,y,k) ;
+            }
+        }
+    }
+    for (bim::uint64 region = 0 ; region < numRegions ; ++region) {
+        Tw mass = bim::max<Tw>((Tw)masses[region], 1e-8f) ;
+        for (bim::uint64 i = stride * region ; i < stride * (region + 1) ; ++i) {
+            centers[i] /= mass ;
+        }
+    }
+
+    Tw factor = regularization / (regionSize * regionSize);
+    #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (height>BIM_OMP_FOR2)
+    for (bim::int64 y=0; y<(bim::int64)height; ++y) {
+        bool rowSeam = slic_near_seam(y, tile, regionSize, height);
+        bim::int64 v = (bim::int64) floor((double)y / regionSize - 0.5) ;
+        for (bim::int64 x=0; x<(bim::int64)width; ++x) {
+            if (!rowSeam && !slic_near_seam(x, tile, regionSize, width)) continue;
+            bim::int64 u = (bim::int64) floor((double)x / regionSize - 0.5) ;
+            Tw minDistance = std::numeric_limits<Tw>::infinity();
+
+            for (bim::int64 vp = bim::max<bim::int64>(0, v) ; vp <= bim::min<bim::int64>(numRegionsY-1, v+1) ; ++vp) {
+                for (bim::int64 up = bim::max<bim::int64>(0, u) ; up <= bim::min<bim::int64>(numRegionsX-1, u+1) ; ++up) {
+                    bim::int64 region = up  + vp * numRegionsX;
+                    if (masses[region] == 0) continue;
+                    const Tw *center = &centers[stride * region];
+                    Tw spatial = (x - center[0]) * (x - center[0]) + (y - center[1]) * (y - center[1]);
+                    Tw appearance = 0;
+                    for (bim::uint64 k = 0 ; k < numChannels ; ++k) {
+                        Tw z = (Tw) atimage(x,y,k) ;
+                        appearance += (z - center[k+2]) * (z - center[k+2]);
+                    }
+                    Tw distance = appearance + factor * spatial;
+                    if (minDistance > distance) {
+                        minDistance = distance ;
+                        segmentation[x + y * width] = (bim::uint32)region;
+                    }
+                }
+            }
+        } // x
+    } // y
+}
+
+/** @brief elimination of small regions in tiles
+** @param tile tile size, a multiple of @a regionSize.
+** @param regionSize nominal size of the regions the labels were computed with.
+**
+** Gives the same result as ::slic_eliminate_small_regions with memory proportional
+** to the tile size and to the pixels of small regions. Labels come from the global
+** grid of regions and a pixel can only take one of its 2 x 2 neighbour regions, so
+** a connected segment spans less than two regions in each direction. Tiles flood the
+** segments of a window extended by a halo of four regions in parallel, every segment
+** starting inside the tile and its neighbours are seen complete. For each small
+** segment the tile records its pixels and the neighbour the whole image scan would
+** take the new label from. Chains of small segments are then resolved in the scan
+** order, where the neighbour is always resolved first, and tiles write the new labels.
+**/
+
+struct slic_small_segment {
+    bim::int64 first;         // image index of the first pixel
+    bim::int64 target;        // first pixel of the neighbour giving the label or -1
+    bim::uint32 label;
+    bim::uint32 target_label;
+    bool operator<(const slic_small_segment &o) const { return first < o.first; }
+};
+
+inline void slic_eliminate_small_regions_tiled (bim::uint32 *segmentation,
+    bim::uint64 width,
+    bim::uint64 height,
+    bim::uint64 regionSize,
+    bim::uint64 minRegionSize,
+    bim::uint64 tile)
+{
+    if (minRegionSize < 2) return;
+    bim::uint64 halo = regionSize * 4 + 2;
+    bim::int64 tilesX = (bim::int64) ceil((double) width / tile);
+    bim::int64 tilesY = (bim::int64) ceil((double) height / tile);
+    std::vector< std::vector<slic_small_segment> > small(tilesX*tilesY);
+    std::vector< std::vector< std::pair<bim::uint64, bim::uint32> > > pixels(tilesX*tilesY); // pixel, small segment of the tile
+    bim::int64 dx [] = {+1, -1,  0,  0} ;
+    bim::int64 dy [] = { 0,  0, +1, -1} ;
+
+    #pragma omp parallel for default(shared) schedule(dynamic)
+    for (bim::int64 t=0; t<tilesX*tilesY; ++t) {
+        bim::uint64 x0 = (t % tilesX) * tile;
+        bim::uint64 y0 = (t / tilesX) * tile;
+        bim::uint64 x1 = bim::min<bim::uint64>(x0+tile, width);
+        bim::uint64 y1 = bim::min<bim::uint64>(y0+tile, height);
+        bim::uint64 wx0 = x0 > halo ? x0 - halo : 0;
+        bim::uint64 wy0 = y0 > halo ? y0 - halo : 0;
+        bim::uint64 ww = bim::min<bim::uint64>(x1 + halo, width) - wx0;
+        bim::uint64 wh = bim::min<bim::uint64>(y1 + halo, height) - wy0;
+
+        // segments of the window in the order of the whole image scan
+        std::vector<bim::int32> segment(ww*wh, -1);
+        std::vector<bim::uint32> open;
+        std::vector<bim::uint32> labels;
+        std::vector<bim::int64> first;
+        std::vector<bim::uint64> sizes;
+        std::vector<bool> complete; // segment does not continue outside of the window
+        for (bim::uint64 p=0; p<ww*wh; ++p) {
+            if (segment[p] >= 0) continue;
+            bim::int32 id = (bim::int32) labels.size();
+            bim::uint32 label = segmentation[(wx0 + p % ww) + (wy0 + p / ww) * width];
+            bool whole = true;
+            open.clear();
+            open.push_back((bim::uint32) p);
+            segment[p] = id;
+            for (size_t i=0; i<open.size(); ++i) {
+                bim::int64 x = open[i] % ww;
+                bim::int64 y = open[i] / ww;
+                for (int direction = 0 ; direction < 4 ; ++direction) {
+                    bim::int64 xp = x + dx[direction] ;
+                    bim::int64 yp = y + dy[direction] ;
+                    bim::int64 ix = wx0 + xp;
+                    bim::int64 iy = wy0 + yp;
+                    if (ix < 0 || ix >= (bim::int64)width || iy < 0 || iy >= (bim::int64)height) continue;
+                    if (segmentation[ix + iy * width] != label) continue;
+                    if (xp < 0 || xp >= (bim::int64)ww || yp < 0 || yp >= (bim::int64)wh) { whole = false; continue; }
+                    bim::int64 neighbor = xp + yp * ww;
+                    if (segment[neighbor] >= 0) continue;
+                    segment[neighbor] = id;
+                    open.push_back((bim::uint32) neighbor);
+                }
+            }
+            labels.push_back(label);
+            first.push_back((bim::int64) ((wx0 + p % ww) + (wy0 + p / ww) * width));
+            sizes.push_back(open.size());
+            complete.push_back(whole);
+        }
+
+        // small segments starting in this tile, the label comes from the last neighbour
+        // of the first pixel that the whole image scan has already passed
+        std::vector<bim::int32> owned(labels.size(), -1);
+        for (size_t c=0; c<labels.size(); ++c) {
+            if (!complete[c] || sizes[c] >= minRegionSize) continue;
+            bim::int64 fx = first[c] % width;
+            bim::int64 fy = first[c] / width;
+            if (fx < (bim::int64)x0 || fx >= (bim::int64)x1 || fy < (bim::int64)y0 || fy >= (bim::int64)y1) continue;
+            slic_small_segment r;
+            r.first = first[c];
+            r.target = -1;
+            r.label = labels[c];
+            r.target_label = labels[c];
+            for (int direction = 0 ; direction < 4 ; ++direction) {
+                bim::int64 xp = fx - (bim::int64)wx0 + dx[direction] ;
+                bim::int64 yp = fy - (bim::int64)wy0 + dy[direction] ;
+                if (xp < 0 || xp >= (bim::int64)ww || yp < 0 || yp >= (bim::int64)wh) continue;
+                bim::int32 n = segment[xp + yp * ww];
+                if (first[n] < first[c]) { r.target = first[n]; r.target_label = labels[n]; }
+            }
+            owned[c] = (bim::int32) small[t].size();
+            small[t].push_back(r);
+        }
+        for (bim::uint64 p=0; p<ww*wh; ++p) {
+            bim::int32 c = owned[segment[p]];
+            if (c >= 0) pixels[t].push_back(std::make_pair((wx0 + p % ww) + (wy0 + p / ww) * width, (bim::uint32) c));
+        }
+    }
+
+    // resolve chains in the scan order, a small neighbour passes on its own new label
+    std::vector<slic_small_segment> order;
+    for (size_t t=0; t<small.size(); ++t)
+        order.insert(order.end(), small[t].begin(), small[t].end());
+    std::sort(order.begin(), order.end());
+    std::vector<bim::uint32> cleaned(order.size());
+    for (size_t i=0; i<order.size(); ++i) {
+        cleaned[i] = order[i].target_label;
+        if (order[i].target < 0) continue;
+        slic_small_segment key;
+        key.first = order[i].target;
+        std::vector<slic_small_segment>::const_iterator n = std::lower_bound(order.begin(), order.begin() + i, key);
+        if (n != order.begin() + i && n->first == order[i].target) cleaned[i] = cleaned[n - order.begin()];
+    }
+
+    #pragma omp parallel for default(shared) schedule(dynamic)
+    for (bim::int64 t=0; t<tilesX*tilesY; ++t) {
+        std::vector<bim::uint32> label(small[t].size());
+        for (size_t c=0; c<small[t].size(); ++c) {
+            std::vector<slic_small_segment>::const_iterator n = std::lower_bound(order.begin(), order.end(), small[t][c]);
+            label[c] = cleaned[n - order.begin()];
+        }
+        for (size_t i=0; i<pixels[t].size(); ++i)
+            segmentation[pixels[t][i].first] = label[pixels[t][i].second];
+    }
+}
+
+/** @brief tiled SLIC superpixel segmentation
+** @param tileSize nominal tile size, rounded up to a multiple of @a regionSize.
+**
+** Images fitting into a single tile are segmented exactly by ::slic_segment.
+** Larger images are split into tiles overlapping by two regions and their
+** k-means labels are computed independently in parallel by ::slic_segment_window.
+** Labels are indices of the global grid of regions, same as produced by
+** ::slic_segment, tile seams are reconciled by ::slic_reconcile_seams and small
+** regions are eliminated in tiles by ::slic_eliminate_small_regions_tiled.
+** Working memory is proportional to the tile size times the number of threads
+** plus the pixels of small regions, labels along seams may differ from the
+** untiled segmentation.
+**/
+
+template <typename T, typename Tw>
+void slic_segment_tiled (bim::uint32 *segmentation,
+    const bim::Image *image,
+    bim::uint64 width,
+    bim::uint64 height,
+    bim::uint64 numChannels,
+    bim::uint64 regionSize,
+    float regularization,
+    bim::uint64 minRegionSize,
+    bim::uint64 tileSize)
+{
+    if (!segmentation) return;
+    if (!image) return;
+    if (width<1) return;
+    if (height<1) return;
+    if (numChannels<1) return;
+    if (regionSize<1) return;
+    if (regularization<0) return;
+
+    bim::uint64 tile = bim::max<bim::uint64>((tileSize + regionSize - 1) / regionSize, 1) * regionSize;
+    bim::uint64 margin = regionSize * 2;
+    bim::int64 tilesX = (bim::int64) ceil((double) width / tile);
+    bim::int64 tilesY = (bim::int64) ceil((double) height / tile);
+    if (tilesX*tilesY == 1) {
+        slic_segment<T, Tw>(segmentation, image, width, height, numChannels, regionSize, regularization, minRegionSize);
+        return;
+    }
+
+    #pragma omp parallel for default(shared) schedule(dynamic)
+    for (bim::int64 t=0; t<tilesX*tilesY; ++t) {
+        bim::uint64 x0 = (t % tilesX) * tile;
+        bim::uint64 y0 = (t / tilesX) * tile;
+        slic_segment_window<T, Tw>(segmentation, image, width, height, numChannels, regionSize, regularization,
+            x0, y0, bim::min<bim::uint64>(x0+tile, width), bim::min<bim::uint64>(y0+tile, height), margin);
+    }
+
+    slic_reconcile_seams<T, Tw>(segmentation, image, width, height, numChannels, regionSize, regularization, tile);
+    slic_eliminate_small_regions_tiled(segmentation, width, height, regionSize, minRegionSize, tile);
 }
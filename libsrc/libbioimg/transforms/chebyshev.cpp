@@ -29,8 +29,16 @@
 
 #include <cstdlib>
 #include <cmath>
+#include <map>
+#include <vector>
+#include <memory>
+
+#ifdef BIM_USE_EIGEN
+#include <Eigen/Dense>
+#endif //BIM_USE_EIGEN
 
 #include "xtypes.h"
+#include "chebyshev.h"
 
 void TNx(double *x, double *out, int N, int height) {
     double *temp = new double[N*height];
@@ -69,64 +77,129 @@ void TNx(double *x, double *out, int N, int height) {
             delete [] temp;
 }
 
-void getChCoeff1D(double *f,double *out,double *Tj,int N,int width) {
-    double *tj = new double[width];
-    for (int jj = 0; jj < N; jj++) {
-        int jx = jj;
-        for (int a = 0; a < width; a++)
-            tj[a] = Tj[a*N+jj];
-        if (!jx) {
-            for (int a = 0; a < width; a++)
-                tj[a] = tj[a]/(double)width;
-        } else {
-            for (int a = 0; a < width; a++)
-                tj[a] = tj[a]*2/(double)width;
-        }
-        out[jj] = 0;
-        for (int a = 0; a < width; a++)
-            out[jj] += f[a]*tj[a]/2;
+//---------------------------------------------------------------------------
+// Cached Chebyshev basis
+// For a signal of "length" samples the N coefficients are c = f * C, where C is
+// a length x N matrix C[a][j] = T_j(x_a) * (j ? 2 : 1) / (2*length). Feature
+// extraction runs the transform on many equally sized tiles, so C is computed
+// once per (N, length) and shared between calls, channels and threads.
+//---------------------------------------------------------------------------
+
+template <typename T>
+struct ChebyshevBasisCache {
+    typedef std::map< std::pair<unsigned int, unsigned int>, std::shared_ptr< const std::vector<T> > > map_type;
+    static const size_t max_entries = 64;
+    map_type entries;
+};
+
+template <typename T>
+std::shared_ptr< const std::vector<T> > chebyshev_basis(unsigned int N, unsigned int length) {
+    static ChebyshevBasisCache<T> cache;
+    std::pair<unsigned int, unsigned int> key(N, length);
+    std::shared_ptr< const std::vector<T> > basis;
+
+    #pragma omp critical(CHEBYSHEV_BASIS)
+    {
+        typename ChebyshevBasisCache<T>::map_type::const_iterator it = cache.entries.find(key);
+        if (it != cache.entries.end()) basis = it->second;
     }
-    delete [] tj;
-}
+    if (basis) return basis;
+
+    std::vector<double> x(length);
+    for (unsigned int a = 0; a < length; a++)
+        x[a] = 2*(double)(a+1) / (double)length -1;
+
+    std::vector<double> Tj(length*N);
+    TNx(&x[0], &Tj[0], N, length);
+
+    std::vector<T> *C = new std::vector<T>(length*N);
+    for (unsigned int a = 0; a < length; a++)
+        for (unsigned int j = 0; j < N; j++)
+            (*C)[a*N+j] = (T) (Tj[a*N+j] * (j ? 2.0 : 1.0) / (double)length / 2.0);
+    basis = std::shared_ptr< const std::vector<T> >(C);
 
-void getChCoeff(double *Im, double *out, double *Tj,int N,int width, int height) {
-    #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (height>BIM_OMP_FOR2)
-    for (int iy = 0; iy < height; iy++) {
-        getChCoeff1D(&(Im[iy*width]),&(out[iy*N]),Tj,N,width);
+    #pragma omp critical(CHEBYSHEV_BASIS)
+    {
+        if (cache.entries.size() >= ChebyshevBasisCache<T>::max_entries) cache.entries.clear();
+        cache.entries[key] = basis;
     }
+    return basis;
 }
 
-void Chebyshev2D(double *in, double *out, unsigned int N, unsigned int width, unsigned int height) {
-    double *TjIn = new double[width];
-    for (unsigned int a = 0; a < width; a++)
-        TjIn[a] = 2*(double)(a+1) / (double)width -1;
-
-    // Pre-compute Tj on x
-    double *Tj = new double[width*N];
-    TNx(TjIn,Tj,N,width);
-
-    getChCoeff(in, out, Tj, N, width, height);
-
-    // transpose the matrix "out" into "in"
-    for (unsigned int j = 0; j < N; j++)
-        for (unsigned int i = 0; i < height; i++)
-            in[j*height+i] = out[i*N+j];
-
-    // If the height is different, re-compute Tj
-    if (height != width) {
-        delete [] Tj;
-        delete [] TjIn;
-        TjIn = new double[height];
-        for (unsigned int a = 0; a < height; a++)
-            TjIn[a] = 2*(double)(a+1) / (double)height -1;
-        // Pre-compute Tj on y
-        Tj = new double[height*N];
-        TNx(TjIn,Tj,N,height);
+//---------------------------------------------------------------------------
+// projection: out (N x N) = C_w^T * in^T * C_h, computed as two matrix products
+//---------------------------------------------------------------------------
+
+#ifdef BIM_USE_EIGEN
+
+template <typename Ti, typename To>
+void chebyshev_project(const Ti *in, To *out, unsigned int N, unsigned int width, unsigned int height, const To *Cw, const To *Ch) {
+    typedef Eigen::Matrix<To, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> MatrixType;
+    Eigen::Map<const Eigen::Matrix<Ti, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> > A(in, height, width);
+    Eigen::Map<const MatrixType> Mw(Cw, width, N);
+    Eigen::Map<const MatrixType> Mh(Ch, height, N);
+    Eigen::Map<MatrixType> O(out, N, N);
+
+    MatrixType P = A.template cast<To>() * Mw;   // height x N, coefficients along x
+    O.noalias() = P.transpose() * Mh;             // N x N, coefficients along y
+}
+
+#else
+
+template <typename Ti, typename To>
+void chebyshev_project(const Ti *in, To *out, unsigned int N, unsigned int width, unsigned int height, const To *Cw, const To *Ch) {
+    std::vector<To> P(height*N, 0);
+    for (unsigned int iy = 0; iy < height; iy++) {
+        const Ti *f = in + iy*width;
+        To *p = &P[iy*N];
+        for (unsigned int a = 0; a < width; a++) {
+            const To v = (To) f[a];
+            const To *c = Cw + a*N;
+            for (unsigned int j = 0; j < N; j++)
+                p[j] += v*c[j];
+        }
+    }
+
+    for (unsigned int j = 0; j < N*N; j++) out[j] = 0;
+    for (unsigned int iy = 0; iy < height; iy++) {
+        const To *c = Ch + iy*N;
+        const To *p = &P[iy*N];
+        for (unsigned int j = 0; j < N; j++) {
+            const To v = p[j];
+            To *o = out + j*N;
+            for (unsigned int k = 0; k < N; k++)
+                o[k] += v*c[k];
+        }
     }
-    getChCoeff(in,out,Tj,N,height,N);
+}
+
+#endif //BIM_USE_EIGEN
+
+template <typename Ti, typename To>
+void Chebyshev2D_channels(To **outs, const Ti * const *ins, int channels, unsigned int N, unsigned int width, unsigned int height) {
+    std::shared_ptr< const std::vector<To> > Cw = chebyshev_basis<To>(N, width);
+    std::shared_ptr< const std::vector<To> > Ch = height != width ? chebyshev_basis<To>(N, height) : Cw;
 
-    delete [] TjIn;
-    delete [] Tj;
+    #pragma omp parallel for default(shared) schedule(dynamic) if (channels>1)
+    for (int c = 0; c < channels; c++)
+        chebyshev_project<Ti, To>(ins[c], outs[c], N, width, height, &(*Cw)[0], &(*Ch)[0]);
 }
 
+void Chebyshev2D(double *in, double *out, unsigned int N, unsigned int width, unsigned int height) {
+    Chebyshev2D_channels<double, double>(&out, &in, 1, N, width, height);
+}
 
+#define BIM_CHEBYSHEV_INSTANTIATE(Ti) \
+    template void Chebyshev2D_channels<Ti, float>(float **, const Ti * const *, int, unsigned int, unsigned int, unsigned int); \
+    template void Chebyshev2D_channels<Ti, double>(double **, const Ti * const *, int, unsigned int, unsigned int, unsigned int);
+
+BIM_CHEBYSHEV_INSTANTIATE(bim::uint8)
+BIM_CHEBYSHEV_INSTANTIATE(bim::uint16)
+BIM_CHEBYSHEV_INSTANTIATE(bim::uint32)
+BIM_CHEBYSHEV_INSTANTIATE(bim::uint64)
+BIM_CHEBYSHEV_INSTANTIATE(bim::int8)
+BIM_CHEBYSHEV_INSTANTIATE(bim::int16)
+BIM_CHEBYSHEV_INSTANTIATE(bim::int32)
+BIM_CHEBYSHEV_INSTANTIATE(bim::int64)
+BIM_CHEBYSHEV_INSTANTIATE(bim::float32)
+BIM_CHEBYSHEV_INSTANTIATE(bim::float64)
@@ -30,6 +30,14 @@
 #ifndef CHEBYSHEV_H
 #define CHEBYSHEV_H
 
+// In is a row-major width x height image, Out receives N x N coefficients
+// basis matrices are cached per (N, width, height) and shared by all calls
 void Chebyshev2D(double *In, double *Out, unsigned int N, unsigned int width, unsigned int height);
 
+// transforms several channels at once, channels are processed in parallel
+// ins - "channels" input planes in any of bim pixel types, read without conversion
+// outs - "channels" output buffers of N*N values, To is float or double and defines working precision
+template <typename Ti, typename To>
+void Chebyshev2D_channels(To **outs, const Ti * const *ins, int channels, unsigned int N, unsigned int width, unsigned int height);
+
 #endif //CHEBYSHEV_H
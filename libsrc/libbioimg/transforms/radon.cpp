@@ -4,80 +4,124 @@
 
 #include <cmath>
 #include <math.h>
+#include <vector>
+#include <algorithm>
 #include "radon.h"
 
 #include "xtypes.h"
 
 //---------------------------------------------------------------------------
 /*
-pPtr -array of double- output column. a pre-allocated vector of the size 2*ceil(norm(size(I)-floor((size(I)-1)/2)-1))+3
-iPtr -double *- input pixels
+pPtrs -array of pointers to output- one per channel, each a pre-allocated and zeroed array of numAngles columns of rSize
+   where rSize is 2*ceil(norm(size(I)-floor((size(I)-1)/2)-1))+3
+iPtrs -array of pointers to input pixels- one per channel
 thetaPtr -array of double- array of the size numAngles (degrees)
 numAngles -int- the number of theta angles to compute
+
+Every (channel, angle) pair is an independent task: a thread fills its own
+cos/sin tables and accumulates the projection in a private column that is
+written out once, so the whole image needs a single parallel region.
 */
-void radon(double *pPtr, double *iPtr, double *thetaPtr, int M, int N,
-           int xOrigin, int yOrigin, int numAngles, int rFirst, int rSize)
+template <typename Ti, typename To>
+void radon_channels(To **pPtrs, const Ti * const *iPtrs, int channels, const double *thetaPtr, int M, int N,
+                    int xOrigin, int yOrigin, int numAngles, int rFirst, int rSize)
 {
-    // Allocate space for the lookup tables
-    double *yTable = new double[2*M]; // x- and y-coordinate tables
-    double *xTable = new double[2*N];
-    double *xCosTable = new double[2*N]; //tables for x*cos(angle) and y*sin(angle)
-    double *ySinTable = new double[2*M];
+    // x- and y-coordinate tables are shared by all angles
+    std::vector<To> yTable(2*M);
+    std::vector<To> xTable(2*N);
 
     /* x- and y-coordinates are offset from pixel locations by 0.25 */
     /* spaced by intervals of 0.5. */
 
     /* We want bottom-to-top to be the positive y direction */
-    yTable[2*M-1] = -yOrigin - 0.25;
-    for (int k = 2*M-2; k >=0; k--)       
-        yTable[k] = yTable[k+1] + 0.5;
+    yTable[2*M-1] = (To) (-yOrigin - 0.25);
+    for (int k = 2*M-2; k >=0; k--)
+        yTable[k] = yTable[k+1] + (To) 0.5;
 
-    xTable[0] = -xOrigin - 0.25;
+    xTable[0] = (To) (-xOrigin - 0.25);
     for (int k = 1; k < 2*N; k++)
-        xTable[k] = xTable[k-1] + 0.5;
-
-    for (int k = 0; k < numAngles; k++) {
-        double angle = thetaPtr[k]; // radian angle value
-        angle = (angle*M_PI)/180;
-        double *pr = pPtr + k*rSize;  // pointer to the top of the output column - points inside output array
-        double cosine = cos(angle); //cosine and sine of current angle
-        double sine = sin(angle);   
-
-        /* Radon impulse response locus:  R = X*cos(angle) + Y*sin(angle) */
-        /* Fill the X*cos table and the Y*sin table.  Incorporate the */
-        /* origin offset into the X*cos table to save some adds later. */
-        for (int p = 0; p < 2*N; p++)
-            xCosTable[p] = xTable[p] * cosine - rFirst;
-        for (int p = 0; p < 2*M; p++)
-            ySinTable[p] = yTable[p] * sine;
-
-        /* Remember that n and m will each change twice as fast as the */
-        /* pixel pointer should change. */
-        #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (2*N>BIM_OMP_FOR2)
-        for (int n = 0; n < 2*N; n++) {
-            double *pixelPtr = iPtr + (n/2)*M; // points inside input array
-            for (int m=0; m<2*M; m++) {
-                double pixel = *pixelPtr; // current pixel value
-                if (pixel) {
-                    pixel *= 0.25;                         // 1 flop/pixel
-                    double rIdx = (xCosTable[n] + ySinTable[m]);  // 1 flop/pixel - r value offset from initial array element
-                    int rLow = (int) rIdx;                     // 1 flop/pixel 
-                    double pixelLow = pixel*(1 - rIdx + rLow);    // 3 flops/pixel - amount of pixel's mass to be assigned to 
-                    pr[rLow++] += pixelLow;                // 1 flop/pixel 
-                    pr[rLow] += pixel - pixelLow;          // 2 flops/pixel
+        xTable[k] = xTable[k-1] + (To) 0.5;
+
+    int tasks = channels*numAngles;
+    #pragma omp parallel default(shared) if (tasks>1)
+    {
+        std::vector<To> xCosTable(2*N); //tables for x*cos(angle) and y*sin(angle)
+        std::vector<To> ySinTable(2*M);
+        std::vector<To> acc(rSize);      // per-thread projection accumulator
+
+        #pragma omp for schedule(dynamic)
+        for (int t = 0; t < tasks; t++) {
+            int c = t / numAngles;
+            int k = t % numAngles;
+            const Ti *iPtr = iPtrs[c];
+            To *pr = pPtrs[c] + k*rSize;  // pointer to the top of the output column - points inside output array
+
+            double angle = (thetaPtr[k]*M_PI)/180; // radian angle value
+            To cosine = (To) cos(angle); //cosine and sine of current angle
+            To sine = (To) sin(angle);
+
+            /* Radon impulse response locus:  R = X*cos(angle) + Y*sin(angle) */
+            /* Fill the X*cos table and the Y*sin table.  Incorporate the */
+            /* origin offset into the X*cos table to save some adds later. */
+            for (int p = 0; p < 2*N; p++)
+                xCosTable[p] = xTable[p] * cosine - rFirst;
+            for (int p = 0; p < 2*M; p++)
+                ySinTable[p] = yTable[p] * sine;
+
+            std::fill(acc.begin(), acc.end(), (To) 0);
+            To *a = &acc[0];
+
+            /* Remember that n and m will each change twice as fast as the */
+            /* pixel pointer should change. */
+            for (int n = 0; n < 2*N; n++) {
+                const Ti *pixelPtr = iPtr + (n/2)*M; // points inside input array
+                const To xc = xCosTable[n];
+                for (int m=0; m<2*M; m++) {
+                    To pixel = (To) pixelPtr[m/2]; // current pixel value
+                    if (pixel) {
+                        pixel *= (To) 0.25;
+                        To rIdx = (xc + ySinTable[m]);   // r value offset from initial array element
+                        int rLow = (int) rIdx;
+                        To pixelLow = pixel*(1 - rIdx + rLow); // amount of pixel's mass to be assigned to
+                        a[rLow++] += pixelLow;
+                        a[rLow] += pixel - pixelLow;
+                    }
                 }
-                if (m%2)
-                    pixelPtr++;   
             }
+
+            for (int r = 0; r < rSize; r++)
+                pr[r] += acc[r];
         }
     }
+}
+
+void radon(double *pPtr, double *iPtr, double *thetaPtr, int M, int N,
+           int xOrigin, int yOrigin, int numAngles, int rFirst, int rSize)
+{
+    radon_channels<double, double>(&pPtr, &iPtr, 1, thetaPtr, M, N, xOrigin, yOrigin, numAngles, rFirst, rSize);
+}
 
-    delete [] yTable;
-    delete [] xTable;
-    delete [] xCosTable;
-    delete [] ySinTable;
+void radon(float *pPtr, float *iPtr, double *thetaPtr, int M, int N,
+           int xOrigin, int yOrigin, int numAngles, int rFirst, int rSize)
+{
+    radon_channels<float, float>(&pPtr, &iPtr, 1, thetaPtr, M, N, xOrigin, yOrigin, numAngles, rFirst, rSize);
 }
 
+#define BIM_RADON_INSTANTIATE(Ti) \
+    template void radon_channels<Ti, float>(float **, const Ti * const *, int, const double *, int, int, int, int, int, int, int); \
+    template void radon_channels<Ti, double>(double **, const Ti * const *, int, const double *, int, int, int, int, int, int, int);
+
+BIM_RADON_INSTANTIATE(bim::uint8)
+BIM_RADON_INSTANTIATE(bim::uint16)
+BIM_RADON_INSTANTIATE(bim::uint32)
+BIM_RADON_INSTANTIATE(bim::uint64)
+BIM_RADON_INSTANTIATE(bim::int8)
+BIM_RADON_INSTANTIATE(bim::int16)
+BIM_RADON_INSTANTIATE(bim::int32)
+BIM_RADON_INSTANTIATE(bim::int64)
+BIM_RADON_INSTANTIATE(bim::float32)
+BIM_RADON_INSTANTIATE(bim::float64)
+
 /* vd_RadonTextures
 just change the order of the vector
 vec -pointer to double- a pre-allocated vector with 12 enteries.
@@ -6,6 +6,19 @@
 void radon(double *pPtr, double *iPtr, double *thetaPtr, int M, int N,
            int xOrigin, int yOrigin, int numAngles, int rFirst, int rSize);
 
+// single precision version of the above
+void radon(float *pPtr, float *iPtr, double *thetaPtr, int M, int N,
+           int xOrigin, int yOrigin, int numAngles, int rFirst, int rSize);
+
+// computes radon projections of several channels at once, angles and channels are
+// processed in parallel, each projection is accumulated by one thread only
+// pPtrs - array of "channels" output buffers of numAngles*rSize values each, pre-zeroed
+// iPtrs - array of "channels" input buffers, pixels are read directly in their storage type
+// Ti - any of bim pixel types, To - float or double, defines the working precision
+template <typename Ti, typename To>
+void radon_channels(To **pPtrs, const Ti * const *iPtrs, int channels, const double *thetaPtr, int M, int N,
+                    int xOrigin, int yOrigin, int numAngles, int rFirst, int rSize);
+
 void vd_RadonTextures(double *vec);
 
 #endif
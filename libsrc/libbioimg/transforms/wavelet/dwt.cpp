@@ -0,0 +1,349 @@
+/* Multi-level discrete wavelet decomposition of images and volumes
+ *
+ * Arithmetic is the one of downsampling_convolution in MODE_ZEROPAD with
+ * step 2: output k of a line of n values is the sum over valid filter taps j
+ * of filter[j]*input[2k+1-j], where input is zero outside of [0, n).
+ * Filtering along y and z is done over strips of whole lines so the inner
+ * loop runs over contiguous memory, filtering along x is done per line.
+ */
+
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "xtypes.h"
+#include "Wavelet.h"
+#include "convolution.h"
+#include "dwt.h"
+
+// number of values of a line processed at once when filtering across lines,
+// FilterLen input strips plus two output strips stay in the first level cache
+static const int dwt_block = 256;
+
+inline int dwt_length(int n, int filter_len) {
+    return dwt_buffer_length(n, filter_len, MODE_ZEROPAD);
+}
+
+//------------------------------------------------------------------------------
+// kernels
+//------------------------------------------------------------------------------
+
+// lines stored at a constant distance
+template <typename T>
+struct DwtStridedLines {
+    const T *p;
+    size_t stride;
+    DwtStridedLines(const T *p, size_t stride): p(p), stride(stride) {}
+    inline const T *operator[](int i) const { return p + (size_t)i*stride; }
+};
+
+// lines given by a table of pointers, used for input planes
+template <typename T>
+struct DwtTableLines {
+    const T * const *p;
+    DwtTableLines(const T * const *p): p(p) {}
+    inline const T *operator[](int i) const { return p[i]; }
+};
+
+// decomposes a contiguous line of n values into approximation a and detail d
+template <typename T>
+inline void dwt_line(const T *in, int n, const T *lo, const T *hi, int F, T *a, T *d) {
+    const int m = dwt_length(n, F);
+    for (int k=0; k<m; ++k) {
+        const int i = 2*k+1;
+        const int j0 = std::max(0, i-(n-1));
+        const int j1 = std::min(F-1, i);
+        T sa = 0, sd = 0;
+        for (int j=j0; j<=j1; ++j) {
+            T v = in[i-j];
+            sa += lo[j]*v;
+            sd += hi[j]*v;
+        }
+        a[k] = sa;
+        d[k] = sd;
+    }
+}
+
+// computes output line k of a decomposition across n lines, only values [x0, x1) of the lines
+template <typename L, typename T>
+inline void dwt_across(const L &in, int n, int k, size_t x0, size_t x1, const T *lo, const T *hi, int F, T *a, T *d) {
+    const size_t len = x1-x0;
+    a += x0;
+    d += x0;
+    for (size_t x=0; x<len; ++x) {
+        a[x] = 0;
+        d[x] = 0;
+    }
+
+    const int i = 2*k+1;
+    const int j0 = std::max(0, i-(n-1));
+    const int j1 = std::min(F-1, i);
+    for (int j=j0; j<=j1; ++j) {
+        const T fl = lo[j];
+        const T fh = hi[j];
+        const auto *r = in[i-j] + x0;
+        for (size_t x=0; x<len; ++x) {
+            T v = (T) r[x];
+            a[x] += fl*v;
+            d[x] += fh*v;
+        }
+    }
+}
+
+// writes n values into the output plane at (x, y), values outside of the plane are dropped
+template <typename T>
+inline void dwt_put(const T *v, int n, T *plane, int w, int h, int x, int y) {
+    if (y>=h || x>=w) return;
+    n = std::min(n, w-x);
+    memcpy(plane + (size_t)y*w + x, v, n*sizeof(T));
+}
+
+template <typename T>
+void dwt_filters(const Wavelet *w, std::vector<T> &lo, std::vector<T> &hi) {
+    lo.resize(w->dec_len);
+    hi.resize(w->dec_len);
+    for (int j=0; j<w->dec_len; ++j) {
+        lo[j] = (T) w->analysisLow->coeff[j];
+        hi[j] = (T) w->analysisHigh->coeff[j];
+    }
+}
+
+//------------------------------------------------------------------------------
+// sizes
+//------------------------------------------------------------------------------
+
+int dwt_levels(const Wavelet *w, int levels, int width, int height, int depth) {
+    int n = std::min(width, height);
+    if (depth > 0) n = std::min(n, depth);
+    int max_levels = std::max(1, dwt_max_level(n, w->dec_len));
+    return std::max(1, std::min(levels, max_levels));
+}
+
+void dwt_layout_size(const Wavelet *w, int levels, int width, int height, int depth,
+                     int *out_width, int *out_height, int *out_depth) {
+    int lx=0, ly=0, lz=0;
+    for (int level=0; level<levels; ++level) {
+        width  = dwt_length(width, w->dec_len);
+        height = dwt_length(height, w->dec_len);
+        lx += width;
+        ly += height;
+        if (depth > 0) {
+            depth = dwt_length(depth, w->dec_len);
+            lz += depth;
+        }
+    }
+    *out_width  = lx + width;
+    *out_height = ly + height;
+    *out_depth  = depth > 0 ? lz + depth : 0;
+}
+
+//------------------------------------------------------------------------------
+// 2D
+//
+// placement of a level starting at (ox, oy) with band size X x Y is the one
+// of Wavelet::transform2D: DD at (ox, oy), AxDy at (ox, oy+Y), DxAy at (ox+X, oy)
+// and the next level or the last approximation at (ox+X, oy+Y)
+//------------------------------------------------------------------------------
+
+template <typename Ti, typename T>
+void dwt2D_channels(T **outs, const Ti * const *ins, int channels, int width, int height,
+                    const Wavelet *w, int levels, int ow, int oh) {
+    const int F = w->dec_len;
+    std::vector<T> lo, hi;
+    dwt_filters(w, lo, hi);
+
+    for (int c=0; c<channels; ++c)
+        memset(outs[c], 0, (size_t)ow*oh*sizeof(T));
+
+    std::vector< std::vector<T> > approx(channels), low(channels), high(channels);
+    int xs=width, ys=height, ox=0, oy=0;
+    for (int level=0; level<levels; ++level) {
+        const int X = dwt_length(xs, F);
+        const int Y = dwt_length(ys, F);
+        const bool last = level == levels-1;
+        for (int c=0; c<channels; ++c) {
+            low[c].resize((size_t)xs*Y);
+            high[c].resize((size_t)xs*Y);
+        }
+
+        // along y: one task per channel, output row and strip of columns
+        const int strips = (xs + dwt_block - 1) / dwt_block;
+        const int tasks = channels*Y*strips;
+        #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (tasks>BIM_OMP_FOR2)
+        for (int t=0; t<tasks; ++t) {
+            const int c = t / (Y*strips);
+            const int k = (t / strips) % Y;
+            const size_t x0 = (size_t)(t % strips) * dwt_block;
+            const size_t x1 = std::min<size_t>(x0 + dwt_block, xs);
+            T *a = &low[c][(size_t)k*xs];
+            T *d = &high[c][(size_t)k*xs];
+            if (level == 0)
+                dwt_across(DwtStridedLines<Ti>(ins[c], xs), ys, k, x0, x1, &lo[0], &hi[0], F, a, d);
+            else
+                dwt_across(DwtStridedLines<T>(&approx[c][0], xs), ys, k, x0, x1, &lo[0], &hi[0], F, a, d);
+        }
+
+        // the approximation is only read by the pass along y, reuse it for the next level
+        if (!last)
+            for (int c=0; c<channels; ++c)
+                approx[c].resize((size_t)X*Y);
+
+        // along x: one task per channel and row of the low or the high band
+        const int rows = channels*Y*2;
+        #pragma omp parallel default(shared) if (rows>BIM_OMP_FOR2)
+        {
+            std::vector<T> a(X), d(X);
+            #pragma omp for BIM_OMP_SCHEDULE
+            for (int t=0; t<rows; ++t) {
+                const int c = t / (2*Y);
+                const int k = (t/2) % Y;
+                if (t % 2) {
+                    dwt_line(&high[c][(size_t)k*xs], xs, &lo[0], &hi[0], F, &a[0], &d[0]);
+                    dwt_put(&d[0], X, outs[c], ow, oh, ox, oy+k);
+                    dwt_put(&a[0], X, outs[c], ow, oh, ox, oy+Y+k);
+                } else {
+                    dwt_line(&low[c][(size_t)k*xs], xs, &lo[0], &hi[0], F, &a[0], &d[0]);
+                    dwt_put(&d[0], X, outs[c], ow, oh, ox+X, oy+k);
+                    if (last)
+                        dwt_put(&a[0], X, outs[c], ow, oh, ox+X, oy+Y+k);
+                    else
+                        memcpy(&approx[c][(size_t)k*X], &a[0], X*sizeof(T));
+                }
+            }
+        }
+
+        ox += X;
+        oy += Y;
+        xs = X;
+        ys = Y;
+    } // level
+}
+
+//------------------------------------------------------------------------------
+// 3D
+//
+// band with filters (bx, by, bz), 0 for approximation and 1 for detail, of a
+// level starting at (ox, oy, oz) with band size X x Y x Z is placed at
+// (ox + (1-bx)*X, oy + (1-bz)*Y, oz + (1-by)*Z), same as Wavelet::transform3D
+//------------------------------------------------------------------------------
+
+template <typename Ti, typename T>
+void dwt3D_channels(T **outs, const Ti * const *ins, int channels, int width, int height, int depth,
+                    const Wavelet *w, int levels, int ow, int oh, int od) {
+    const int F = w->dec_len;
+    std::vector<T> lo, hi;
+    dwt_filters(w, lo, hi);
+
+    for (int i=0; i<channels*od; ++i)
+        memset(outs[i], 0, (size_t)ow*oh*sizeof(T));
+
+    // zb: approximation and detail along z, yb: four bands along y and z
+    std::vector< std::vector<T> > approx(channels), zb(channels), yb(channels);
+    int xs=width, ys=height, zs=depth, ox=0, oy=0, oz=0;
+    for (int level=0; level<levels; ++level) {
+        const int X = dwt_length(xs, F);
+        const int Y = dwt_length(ys, F);
+        const int Z = dwt_length(zs, F);
+        const size_t plane = (size_t)xs*ys;
+        const size_t yplane = (size_t)xs*Y;
+        const bool last = level == levels-1;
+        for (int c=0; c<channels; ++c) {
+            zb[c].resize(2*plane*Z);
+            yb[c].resize(4*yplane*Z);
+        }
+
+        // along z: one task per channel, output plane and strip of the plane
+        int strips = (int) ((plane + dwt_block - 1) / dwt_block);
+        int tasks = channels*Z*strips;
+        #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (tasks>BIM_OMP_FOR2)
+        for (int t=0; t<tasks; ++t) {
+            const int c = t / (Z*strips);
+            const int k = (t / strips) % Z;
+            const size_t x0 = (size_t)(t % strips) * dwt_block;
+            const size_t x1 = std::min<size_t>(x0 + dwt_block, plane);
+            T *a = &zb[c][k*plane];
+            T *d = &zb[c][(Z+k)*plane];
+            if (level == 0)
+                dwt_across(DwtTableLines<Ti>(ins + (size_t)c*depth), zs, k, x0, x1, &lo[0], &hi[0], F, a, d);
+            else
+                dwt_across(DwtStridedLines<T>(&approx[c][0], plane), zs, k, x0, x1, &lo[0], &hi[0], F, a, d);
+        }
+
+        // along y: one task per channel, z band, plane, output row and strip of columns
+        // band b of yb holds filters (by, bz) = (b%2, b/2)
+        strips = (xs + dwt_block - 1) / dwt_block;
+        tasks = channels*2*Z*Y*strips;
+        #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (tasks>BIM_OMP_FOR2)
+        for (int t=0; t<tasks; ++t) {
+            const int c  = t / (2*Z*Y*strips);
+            const int bz = (t / (Z*Y*strips)) % 2;
+            const int z  = (t / (Y*strips)) % Z;
+            const int k  = (t / strips) % Y;
+            const size_t x0 = (size_t)(t % strips) * dwt_block;
+            const size_t x1 = std::min<size_t>(x0 + dwt_block, xs);
+            const T *in = &zb[c][(bz*Z + z)*plane];
+            T *a = &yb[c][((2*bz+0)*Z + z)*yplane + (size_t)k*xs];
+            T *d = &yb[c][((2*bz+1)*Z + z)*yplane + (size_t)k*xs];
+            dwt_across(DwtStridedLines<T>(in, xs), ys, k, x0, x1, &lo[0], &hi[0], F, a, d);
+        }
+
+        if (!last)
+            for (int c=0; c<channels; ++c)
+                approx[c].resize((size_t)X*Y*Z);
+
+        // along x: one task per channel, band and row
+        const int rows = channels*4*Z*Y;
+        #pragma omp parallel default(shared) if (rows>BIM_OMP_FOR2)
+        {
+            std::vector<T> a(X), d(X);
+            #pragma omp for BIM_OMP_SCHEDULE
+            for (int t=0; t<rows; ++t) {
+                const int c = t / (4*Z*Y);
+                const int b = (t / (Z*Y)) % 4;
+                const int z = (t / Y) % Z;
+                const int k = t % Y;
+                const int by = b % 2;
+                const int bz = b / 2;
+                dwt_line(&yb[c][(b*Z + z)*yplane + (size_t)k*xs], xs, &lo[0], &hi[0], F, &a[0], &d[0]);
+
+                const int y = oy + (1-bz)*Y + k;
+                const int zo = oz + (1-by)*Z + z;
+                if (b == 0 && !last) {
+                    memcpy(&approx[c][((size_t)z*Y + k)*X], &a[0], X*sizeof(T));
+                } else if (zo < od) {
+                    dwt_put(&a[0], X, outs[(size_t)c*od + zo], ow, oh, ox+X, y);
+                }
+                if (zo < od)
+                    dwt_put(&d[0], X, outs[(size_t)c*od + zo], ow, oh, ox, y);
+            }
+        }
+
+        ox += X;
+        oy += Y;
+        oz += Z;
+        xs = X;
+        ys = Y;
+        zs = Z;
+    } // level
+}
+
+//------------------------------------------------------------------------------
+// instantiations for all bim pixel types
+//------------------------------------------------------------------------------
+
+#define BIM_DWT_INSTANTIATE(Ti) \
+    template void dwt2D_channels<Ti, float>(float **, const Ti * const *, int, int, int, const Wavelet *, int, int, int); \
+    template void dwt2D_channels<Ti, double>(double **, const Ti * const *, int, int, int, const Wavelet *, int, int, int); \
+    template void dwt3D_channels<Ti, float>(float **, const Ti * const *, int, int, int, int, const Wavelet *, int, int, int, int); \
+    template void dwt3D_channels<Ti, double>(double **, const Ti * const *, int, int, int, int, const Wavelet *, int, int, int, int);
+
+BIM_DWT_INSTANTIATE(bim::uint8)
+BIM_DWT_INSTANTIATE(bim::uint16)
+BIM_DWT_INSTANTIATE(bim::uint32)
+BIM_DWT_INSTANTIATE(bim::uint64)
+BIM_DWT_INSTANTIATE(bim::int8)
+BIM_DWT_INSTANTIATE(bim::int16)
+BIM_DWT_INSTANTIATE(bim::int32)
+BIM_DWT_INSTANTIATE(bim::int64)
+BIM_DWT_INSTANTIATE(bim::float32)
+BIM_DWT_INSTANTIATE(bim::float64)
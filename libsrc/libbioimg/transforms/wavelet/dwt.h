@@ -0,0 +1,40 @@
+/* Multi-level discrete wavelet decomposition of images and volumes
+ *
+ * Computes the same zero padded decomposition as Wavelet::transform2D and
+ * Wavelet::transform3D and packs coefficients in exactly the same layout,
+ * but works directly on pixel planes: no DataGrid copies, passes along y
+ * and z run over cache sized strips of whole lines, passes along x run
+ * line by line, and all channels of a level are processed in one parallel
+ * loop. To is float or double and defines the working precision, Ti is any
+ * of bim pixel types and is read without conversion.
+ */
+
+#ifndef DWT_H_
+#define DWT_H_
+
+class Wavelet;
+
+// number of levels actually computed for the requested one, at least 1 and
+// at most the number of levels the smallest dimension can be decomposed into
+int dwt_levels(const Wavelet *w, int levels, int width, int height, int depth = 0);
+
+// size of the packed coefficient layout produced by "levels" decomposition levels,
+// for 2D decompositions use depth = 0, *out_depth is then set to 0
+void dwt_layout_size(const Wavelet *w, int levels, int width, int height, int depth,
+                     int *out_width, int *out_height, int *out_depth);
+
+// 2D decomposition of several channels
+// ins - "channels" row-major width x height planes
+// outs - "channels" row-major out_width x out_height planes, coefficients
+//        outside of the output size are dropped and uncovered areas are zeroed
+template <typename Ti, typename To>
+void dwt2D_channels(To **outs, const Ti * const *ins, int channels, int width, int height,
+                    const Wavelet *w, int levels, int out_width, int out_height);
+
+// 3D decomposition of several channels stored as planes, plane z of channel c
+// is ins[c*depth + z] and outs[c*out_depth + z] respectively
+template <typename Ti, typename To>
+void dwt3D_channels(To **outs, const Ti * const *ins, int channels, int width, int height, int depth,
+                    const Wavelet *w, int levels, int out_width, int out_height, int out_depth);
+
+#endif /*DWT_H_*/
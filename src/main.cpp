@@ -79,6 +79,10 @@
   -projectmin - combines by MIN all inout frames into one
   -negative - returns negative of input image
 
+  [-timing-json file]
+  -timing-json - writes wall-clock times, bytes and pixels of open, metadata, decode,
+                 every operation, encode and flush into a JSON file, ex: -timing-json timing.json
+
   ------------------------------------------------------------------------------
   Encoder specific options
 
@@ -106,6 +110,13 @@
                          now support only for 12 bit -> 16 bit conversion
    2010-01-25 18:55:54 - support for floating point images throughout the app
    2010-01-29 11:25:38 - preserve all metadata and correctly transform it
+   2026-10-19 12:00:00 - wall-clock timing report
+   2026-10-19 12:00:00 - decode only channels kept by a leading -remap
+   2026-10-19 12:00:00 - single pass -render of display images
+   2026-10-19 12:00:00 - streaming parallel -tile export
+   2026-10-19 12:00:00 - streaming parallel -mosaic into tiled TIFF
+   2026-10-19 12:00:00 - arbitrary -rotate angles and -transform_geometry
+   2026-10-19 12:00:00 - out-of-core -rearrange3d in memory-bounded passes
                 
 *******************************************************************************/
 
@@ -241,6 +252,7 @@ public:
   bool project;
   bool project_min;
   ImageStack::RearrangeDimensions rearrange3d;
+  bim::uint64 rearrange3d_memory;
 
   bool negative;
   double threshold;
@@ -284,6 +296,8 @@ public:
   std::string o_histogram_file;
   std::string o_histogram_format;
 
+  std::string timing_file;
+
 public:
   virtual void cureParams();
   void curePagesArray( const int &num_pages );
@@ -364,14 +378,25 @@ void DConf::init() {
   tmp += "    SZ: defines the size of the tile in pixels with width equal to height\n";
   tmp += "    NX - number of tile images in X direction";
   tmp += "    NY - number of tile images in Y direction";
+  tmp += "\n  TIFF output with encoder option tiles is written tile by tile while the mosaic is assembled, so it may be\n";
+  tmp += "  larger than memory, the output tile size and pyramid are set by encoder options, ex: -options \"tiles 512 pyramid subdirs\"\n";
+  tmp += "  Input tiles in TIFF, JPEG, PNG, JPEG-2000 or WebP sharing the extension of the first one are decoded in parallel";
   appendArgumentDefinition("-mosaic", 1, tmp);
 
   tmp = "extract a specified pyramidal level, ex: -res-level 4\n";
   tmp += "    L - is a resolution level, L=0 is native resolution, L=1 is 2X smaller, L=2 is 4X smaller, and so on";
   appendArgumentDefinition("-res-level", 1, tmp);
 
-  appendArgumentDefinition( "-rotate", 1, 
-    "rotates the image by deg degrees, only accepted valueas now are: 90, -90, 180, guess\nguess will extract suggested rotation from EXIF" );
+  tmp = "rotates the image clockwise by deg degrees, ex: -rotate 90 or -rotate 12.5,BC\n";
+  tmp += "    90, -90 and 180 are exact, other angles expand the image to fit and are interpolated\n";
+  tmp += "    using NN, BL (default) or BC, guess will extract suggested rotation from EXIF";
+  appendArgumentDefinition( "-rotate", 1, tmp );
+
+  tmp = "warps the image by a matrix mapping input pixel coordinates into output ones, ex: -transform_geometry 1,0.1,0,0,1,0,BL\n";
+  tmp += "    6 values define an affine transform: x'=m0*x+m1*y+m2, y'=m3*x+m4*y+m5\n";
+  tmp += "    9 values define a projective transform where x' and y' are divided by m6*x+m7*y+m8\n";
+  tmp += "    an optional interpolation NN, BL (default) or BC may follow, output keeps the input size";
+  appendArgumentDefinition( "-transform_geometry", 1, tmp );
   
   appendArgumentDefinition( "-remap", 1, 
     "Changes order and number of channels in the output, channel numbers are separated by comma (0 means empty channel), ex: -remap 1,2,3" );
@@ -401,16 +426,25 @@ void DConf::init() {
   tmp += "Here ch1 will go to red, ch2 to cyan, ch3 not rendered and ch4 to blue\n";
   appendArgumentDefinition( "-fusergb", 1, tmp );
 
+  tmp = "Renders 8 bit RGB display image from N channels in a single pass, for each channel an RGB weight\n";
+  tmp += "and optionally display range and gamma are given, an empty range uses the data range of the channel\n";
+  tmp += "Values are separated by comma and channels are separated by semicolon: r,g,b[,min,max[,gamma]]\n";
+  tmp += "with \"meta\" channel colors are taken from metadata, contributions are added unless -fusemethod is given\n";
+  tmp += "ex: -render 255,0,0,100,4000;0,255,0,0,0,0.8;0;0,0,255\n";
+  appendArgumentDefinition( "-render", 1, tmp );
+
   tmp = "Defines fusion method, ex: -fusemethod a\n";
   tmp += "  should be followed by comma and [a|m]\n";
   tmp += "    a - Average\n";
   tmp += "    m - Maximum\n";
   appendArgumentDefinition( "-fusemethod", 1, tmp );
 
-  tmp = "Re-arranges dimensions of a 3D image, ex: -rearrange3d xzy\n";
-  tmp += "  should be followed by comma and [xzy|yzx]\n";
+  tmp = "Re-arranges dimensions of a 3D image, ex: -rearrange3d xzy or -rearrange3d yzx,512\n";
+  tmp += "  should be followed by [xzy|yzx] and optionally by comma and memory limit in MB, default 1024\n";
   tmp += "    xzy - rearranges XYZ -> XZY\n";
   tmp += "    yzx - rearranges XYZ -> YZX\n";
+  tmp += "  a single input file is read sequentially several times, each pass writes the band of output\n";
+  tmp += "  planes fitting into the memory limit, so the volume may be larger than memory\n";
   appendArgumentDefinition( "-rearrange3d", 1, tmp );
 
   appendArgumentDefinition( "-create", 1, 
@@ -448,6 +482,10 @@ void DConf::init() {
   tmp += "  where: 1 is the light info output, 2 is full output\n";
   appendArgumentDefinition( "-verbose", 1, tmp );
 
+  tmp = "writes wall-clock times, bytes and pixels of open, metadata, decode, every operation,\n";
+  tmp += "  encode and flush into a JSON file, ex: -timing-json timing.json\n";
+  appendArgumentDefinition( "-timing-json", 1, tmp );
+
   tmp = "Skips frames that overlap with the previous non-overlapping frame, ex: -no-overlap 5\n";
   tmp += "  argument defines maximum allowed overlap in %, in the example it is 5%\n";
   appendArgumentDefinition( "-no-overlap", 1, tmp );
@@ -574,10 +612,11 @@ void DConf::init() {
   appendArgumentDefinition( "-deinterlace", 1, tmp );
 
   tmp = "transforms input image, ex: -transform fft\n";
-  tmp += "    chebyshev - outputs a transformed image in double precision\n";
+  tmp += "    chebyshev - outputs a transformed image in double precision, use chebyshev,32 for single precision\n";
   tmp += "    fft - outputs a transformed image in double precision\n";
-  tmp += "    radon - outputs a transformed image in double precision\n";
-  tmp += "    wavelet - outputs a transformed image in double precision";
+  tmp += "    radon - outputs a transformed image in double precision, use radon,32 for single precision\n";
+  tmp += "    wavelet - outputs a transformed image in double precision, use wavelet,32 for single precision\n";
+  tmp += "      and wavelet,64,3 or wavelet,32,3 for 3 decomposition levels, default is 1";
   appendArgumentDefinition( "-transform", 1, tmp );
 
   tmp = "transforms input image 3 channel image in color space, ex: -transform_color rgb2hsv\n";
@@ -597,10 +636,11 @@ void DConf::init() {
   tmp += "    ycbcrHDTV2rgb - converts YcBcR -> RGB (for HDTV range)\n";
   appendArgumentDefinition( "-transform_color", 1, tmp );
 
-  tmp = "Segments image using SLIC superpixel method, takes region size and regularization, ex: -superpixels 16,0.2[,0.7]\n";
+  tmp = "Segments image using SLIC superpixel method, takes region size and regularization, ex: -superpixels 16,0.2[,0.7[,2048]]\n";
   tmp += "    region size is in pixels\n";
-  tmp += "    regularization - [0-1], where 0 means shape is least regular";
-  tmp += "    minimum size - [0-1], is optional and defines the minimum region size computed from region size, 1 will ensure minimum size at region size. Default value is 0.7";
+  tmp += "    regularization - [0-1], where 0 means shape is least regular\n";
+  tmp += "    minimum size - [0-1], is optional and defines the minimum region size computed from region size, 1 will ensure minimum size at region size. Default value is 0.7\n";
+  tmp += "    tile size - in pixels, is optional and bounds working memory, images larger than a tile are segmented in tiles. Default is 2048 or 8 regions whichever is larger";
   appendArgumentDefinition( "-superpixels", 1, tmp );
 
   tmp = "filters input image, ex: -filter edge\n";
@@ -749,6 +789,7 @@ void DConf::init() {
   project = false;
   project_min = false;
   rearrange3d = ImageStack::adNone;
+  rearrange3d_memory = 1024;
 
   negative = false;
   threshold = 0;
@@ -886,9 +927,11 @@ void DConf::processArguments() {
   if (keyExists( "-projectmin")) { project = true; project_min = true; }   
 
   if (keyExists( "-rearrange3d" )) { 
-      xstring str = getValue("-rearrange3d");
+      std::vector<xstring> strl = getValue("-rearrange3d").split(",");
+      xstring str = strl.size()>0 ? strl[0] : xstring();
       if (str.toLowerCase() == "xzy") this->rearrange3d = ImageStack::adXZY;
       if (str.toLowerCase() == "yzx") this->rearrange3d = ImageStack::adYZX;
+      if (strl.size()>1 && strl[1].toInt(0)>0) this->rearrange3d_memory = strl[1].toInt(0);
   }
 
   sample_frames          = getValueInt("-sampleframes", 0);
@@ -967,15 +1010,14 @@ void DConf::processArguments() {
   if (keyExists( "-verbose" ))
     verbose = getValueInt("-verbose", 1);
 
+  timing_file = getValue( "-timing-json" );
+
   if (keyExists( "-rotate" )) {
       if (getValue("-rotate").toLowerCase() == "guess")
           rotate_guess = true;
       else {
-          rotate_angle = getValueDouble( "-rotate", 0 );
-          if ( rotate_angle!=0 && rotate_angle!=90 && rotate_angle!=-90 && rotate_angle!=180 ) { 
-              std::cout << "This rotation angle value is not yet supported..." << std::endl;
-            exit(0);
-          }
+          std::vector<double> vals = splitValueDouble( "-rotate", 0.0 );
+          rotate_angle = vals.size()>0 ? vals[0] : 0;
       }
   }
 
@@ -1405,6 +1447,90 @@ void printMetaRaw(MetaFormatManager *fm) {
 // Tiles
 //------------------------------------------------------------------------------
 
+// band of rows of one pyramid level, coarser levels are accumulated from the bands of finer ones
+struct TileLevel {
+    TileLevel(bim::uint64 w=0, bim::uint64 h=0): width(w), height(h), y(0), rows(0) {}
+    bim::uint64 width;
+    bim::uint64 height;
+    bim::uint64 y;    // first level row held in the band
+    bim::uint64 rows; // number of rows held in the band
+    Image band;
+};
+
+// encodes and writes all tiles of a band, in parallel for writers safe to run concurrently, tiles
+// are cut and released outside of the parallel region since image memory references are shared
+bool writeBandTiles(const Image &band, int level, bim::uint64 y, DConf *c) {
+    bim::uint64 tile_size = c->tile_size;
+    std::vector<Image> tiles;
+    std::vector<xstring> names;
+    for (bim::uint64 ty=0; ty<band.height(); ty+=tile_size) {
+        for (bim::uint64 x=0; x<band.width(); x+=tile_size) {
+            tiles.push_back( band.ROI( x, ty, tile_size, tile_size ) );
+            xstring ofname = c->o_name;
+            ofname.insertAfterLast( ".", xstring::xprintf("_%.3d_%.3d_%.3d", level, (int) (x/tile_size), (int) ((y+ty)/tile_size)) );
+            names.push_back( ofname );
+        }
+    }
+
+    bool ok = true;
+    bool concurrent = FormatManager::isConcurrentFormat(c->o_fmt);
+    #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (concurrent)
+    for (bim::int64 i=0; i<(bim::int64)tiles.size(); ++i) {
+        MetaFormatManager fm;
+        if (fm.writeImage( (const bim::Filename) names[i].c_str(), tiles[i], c->o_fmt.c_str(), c->options.c_str() ) != 0) {
+            #pragma omp critical (tile_errors)
+            {
+                ok = false;
+                c->error( xstring::xprintf("Could not write tile: %s", names[i].c_str()) );
+            }
+        }
+    }
+    return ok;
+}
+
+// appends rows to the band of level l, a complete band is written and its downsampled rows
+// are appended to the next level
+bool appendLevelRows(std::vector<TileLevel> &levels, size_t l, const Image &rows, bim::uint64 band_size, DConf *c) {
+    if (rows.height() == 0 || rows.width() == 0) return true;
+    TileLevel &lv = levels[l];
+    if (lv.band.width() == 0) {
+        bim::uint64 h = bim::min<bim::uint64>(band_size, lv.height);
+        ImageInfo info = ((Image &) rows).imageBitmap()->i;
+        if (lv.band.alloc( lv.width, h, rows.samples(), rows.depth(), rows.pixelType() ) != 0) return false;
+        lv.band.imageBitmap()->i = info;
+        lv.band.imageBitmap()->i.width = lv.width;
+        lv.band.imageBitmap()->i.height = h;
+    }
+    lv.band.setROI( 0, lv.rows, rows );
+    lv.rows += rows.height();
+    if (lv.rows < band_size && lv.y + lv.rows < lv.height) return true;
+
+    c->print( xstring::xprintf("Level: %d rows %llu-%llu", (int) l, (unsigned long long) lv.y, (unsigned long long) (lv.y + lv.rows)), 2 );
+    Image band = lv.band.ROI( 0, 0, lv.width, lv.rows );
+    if (!writeBandTiles( band, (int) l, lv.y, c )) return false;
+    lv.y += lv.rows;
+    lv.rows = 0;
+
+    if (l+1 < levels.size())
+        return appendLevelRows( levels, l+1, band.downSampleBy2x(), band_size, c );
+    return true;
+}
+
+// reads rows y to y+n-1 of the first level, only the band is decoded unless the whole image is given
+bool readTileBand(ImageProxy &proxy, const Image &full, int page, bim::uint64 width, bim::uint64 y, bim::uint64 n, Image &band) {
+    if (full.width() > 0) {
+        band = full.ROI( 0, y, width, n );
+    } else {
+        if (!proxy.readRegion( band, page, 0, y, width-1, y+n-1, 0 )) return false;
+        band = band.ensureTypedDepth();
+        band = band.ensureColorSpace();
+    }
+    return band.width() == width && band.height() == n;
+}
+
+// Tiles of all pyramid levels are produced in bands of tile rows: bands of the first level are
+// decoded from the file, coarser levels are downsampled from the bands of the finer one, so only
+// one band per level is kept in memory. Formats unable to read regions are decoded whole.
 int extractTiles(DConf *c) {
     xstring input_filename = c->i_names[0];
     xstring output_path = c->o_name;
@@ -1415,41 +1541,83 @@ int extractTiles(DConf *c) {
         return IMGCNV_ERROR_NO_OUTPUT_FILE; 
     }
  
-    ImagePyramid ip;
-    ip.setMinImageSize( tile_size );
-
     // read requested page, only the first page will be used !!!!
     int page = 0;
     if (c->page.size()>0) {
         page = c->page[0];
     }
-    
-    if (!ip.fromFile(input_filename, page)) {
+
+    MetaFormatManager fm;
+    if (fm.sessionStartRead( (const bim::Filename) input_filename.c_str() ) != 0) {
         c->error("Input format is not supported");
         return IMGCNV_ERROR_READING_FILE;
     }
+    fm.sessionParseMetaData( page );
+    bim::uint64 width = fm.get_metadata_tag_int( bim::IMAGE_NUM_X, 0 );
+    bim::uint64 height = fm.get_metadata_tag_int( bim::IMAGE_NUM_Y, 0 );
+    ImageInfo info = fm.sessionGetInfo();
+    ImageProxy proxy(&fm);
+
+    // bands of even height downsample exactly as the whole level does
+    bim::uint64 band_size = tile_size % 2 == 0 ? tile_size : tile_size*2;
+
+    Image full;
+    Image band;
+    bool regions = fm.sessionCanReadRegion() || (info.number_levels > 0 && info.tileWidth > 0);
+    if (!regions || width == 0 || height == 0 || 
+        !readTileBand( proxy, full, page, width, 0, bim::min<bim::uint64>(band_size, height), band )) {
+        if (fm.sessionReadImage( full.imageBitmap(), page ) != 0) {
+            c->error("Input format is not supported");
+            return IMGCNV_ERROR_READING_FILE;
+        }
+        full = full.ensureTypedDepth();
+        full = full.ensureColorSpace();
+        width = full.width();
+        height = full.height();
+        band = full.ROI( 0, 0, width, bim::min<bim::uint64>(band_size, height) );
+    }
 
-    for (int l=0; l<ip.numberLevels(); ++l) {
-        Image *level_img = ip.imageAt(l);
-        unsigned int i=0;
-        c->print( xstring::xprintf("Level: %d", l), 2 );
-        for (int y=0; y<level_img->height(); y+=tile_size) {
-            unsigned int j=0;
-            for (int x=0; x<level_img->width(); x+=tile_size) {
-                Image tile = level_img->ROI( x, y, tile_size, tile_size );
-                xstring ofname = output_path;
-                ofname.insertAfterLast( ".", xstring::xprintf("_%.3d_%.3d_%.3d", l, j, i) );
-                if (!tile.toFile(ofname, c->o_fmt, c->options )) return IMGCNV_ERROR_WRITING_FILE;
-                ++j;
-            } // j
-            ++i;
-        } // i
-    } // l
-
-    if (c->o_histogram_file.size()>0) {
-        ImageHistogram h( *ip.imageAt(0) );
-        h.to( c->o_histogram_file );
+    std::vector<TileLevel> levels(1, TileLevel(width, height));
+    while (bim::max<bim::uint64>( levels.back().width, levels.back().height ) > (bim::uint64) tile_size && 
+           levels.back().width > 1 && levels.back().height > 1)
+        levels.push_back( TileLevel(levels.back().width/2, levels.back().height/2) );
+
+    // histograms of integer images up to 16 bits accumulate while bands go by
+    bool histogram = c->o_histogram_file.size()>0;
+    bool histogram_direct = band.depth() <= 16 && band.pixelType() != FMT_FLOAT;
+    ImageHistogram hist( band.samples(), band.depth(), band.pixelType() );
+
+    for (bim::uint64 y=0; y<height; y+=band_size) {
+        bim::uint64 n = bim::min<bim::uint64>(band_size, height-y);
+        if (y>0 && !readTileBand( proxy, full, page, width, y, n, band )) {
+            c->error("Input image region could not be read");
+            return IMGCNV_ERROR_READING_FILE;
+        }
+        if (histogram && histogram_direct)
+            for (unsigned int s=0; s<band.samples(); ++s)
+                hist[s]->addData( band.bits(s), (unsigned int) band.numPixels() );
+        if (!appendLevelRows( levels, 0, band, band_size, c )) 
+            return IMGCNV_ERROR_WRITING_FILE;
+    } // y
+
+    // wider types need the data range before binning, two more passes over the bands
+    if (histogram && !histogram_direct) {
+        for (int pass=0; pass<2; ++pass) {
+            for (bim::uint64 y=0; y<height; y+=band_size) {
+                if (!readTileBand( proxy, full, page, width, y, bim::min<bim::uint64>(band_size, height-y), band )) 
+                    return IMGCNV_ERROR_READING_FILE;
+                for (unsigned int s=0; s<band.samples(); ++s) {
+                    if (pass == 0)
+                        hist[s]->updateStats( band.bits(s), (unsigned int) band.numPixels() );
+                    else
+                        hist[s]->addData( band.bits(s), (unsigned int) band.numPixels() );
+                }
+            } // y
+        } // pass
     }
+
+    if (histogram)
+        hist.to( c->o_histogram_file );
     return IMGCNV_ERROR_NONE;
 }
 
@@ -1457,6 +1625,109 @@ int extractTiles(DConf *c) {
 // Compositing a mosaic from a set of aligned and non overlapping tiles
 //------------------------------------------------------------------------------
 
+// input tiles are decoded concurrently only if the first one is in a format safe for it
+// and all others share its extension, any other set of inputs is decoded one by one
+bool isConcurrentMosaic(DConf *c) {
+    MetaFormatManager fm;
+    if (fm.sessionStartRead((const bim::Filename) c->i_names[0].c_str()) != 0) return false;
+    bool concurrent = fm.sessionIsConcurrent();
+    fm.sessionEnd();
+
+    xstring first = c->i_names[0];
+    std::string::size_type p = first.rfind('.');
+    xstring ext = p == std::string::npos ? xstring() : xstring(first.substr(p)).toLowerCase();
+    for (size_t n=1; n<c->i_names.size() && concurrent; ++n)
+        concurrent = ext.size() > 0 && c->i_names[n].toLowerCase().endsWith(ext);
+    return concurrent;
+}
+
+// decodes one row of input tiles, in parallel if concurrent, images are created and processed
+// outside of the parallel region since image memory references are shared between threads
+void readMosaicRow(DConf *c, int j, std::vector<Image> &row, bool concurrent) {
+    int num_x = c->mosaic_num_x;
+    row.clear();
+    for (int i=0; i<num_x; ++i)
+        row.push_back(Image());
+
+    std::vector<int> ok(num_x, 0);
+    #pragma omp parallel for default(shared) BIM_OMP_SCHEDULE if (concurrent)
+    for (int i=0; i<num_x; ++i) {
+        size_t n = (size_t) j*num_x + i;
+        if (n >= c->i_names.size()) continue;
+        MetaFormatManager fm;
+        if (fm.sessionStartRead((const bim::Filename) c->i_names[n].c_str()) == 0)
+            ok[i] = fm.sessionReadImage(row[i].imageBitmap(), 0) == 0;
+        fm.sessionEnd();
+    }
+
+    for (int i=0; i<num_x; ++i) {
+        size_t n = (size_t) j*num_x + i;
+        if (ok[i] && !row[i].isEmpty()) {
+            c->error(xstring::xprintf("%d,%d for %s\n", i*c->tile_size, j*c->tile_size, c->i_names[n].c_str()));
+            row[i].process(c->getOperations(), 0, c);
+        } else {
+            c->error("Tile could not be loaded");
+            row[i] = Image();
+        }
+    }
+}
+
+// tile size of the output image requested by the "tiles" encoder option, 0 if not requested
+bim::uint64 mosaicOutputTileSize(DConf *c) {
+    std::vector<xstring> options = xstring(c->options).split(" ");
+    for (size_t i=0; i+1<options.size(); ++i)
+        if (options[i] == "tiles" && options[i+1].toInt(0) > 0)
+            return options[i+1].toInt(0);
+    return 0;
+}
+
+// assembles the mosaic one row of output tiles at a time and streams those tiles to the writer,
+// only the row being assembled and the row of input tiles it is cut from are kept in memory
+int streamMosaicTiles(DConf *c, MetaFormatManager &fm, Image &first, bool concurrent) {
+    bim::uint64 tile_size = c->tile_size;
+    bim::uint64 ots = mosaicOutputTileSize(c);
+
+    bim::ImageInfo info = first.imageBitmap()->i;
+    info.width = c->mosaic_num_x*tile_size;
+    info.height = c->mosaic_num_y*tile_size;
+    info.tileWidth = ots;
+    info.tileHeight = ots;
+
+    Image band;
+    Image out(ots, ots, info.depth, info.samples, info.pixelType);
+    std::vector<Image> row;
+    int row_j = -1;
+    for (bim::uint64 by=0; by<info.height; by+=ots) {
+        bim::uint64 bh = bim::min<bim::uint64>(ots, info.height-by);
+        if (band.height() != bh)
+            band.alloc(info.width, bh, info.samples, info.depth, info.pixelType);
+        band.fill(0);
+
+        for (int j=(int) (by/tile_size); j<=(int) ((by+bh-1)/tile_size); ++j) {
+            if (j != row_j) {
+                readMosaicRow(c, j, row, concurrent);
+                row_j = j;
+            }
+            bim::uint64 ty = j*tile_size;
+            bim::uint64 y0 = bim::max<bim::uint64>(by, ty);
+            bim::uint64 y1 = bim::min<bim::uint64>(by+bh, ty+tile_size);
+            for (size_t i=0; i<row.size(); ++i)
+                if (!row[i].isEmpty() && y0-ty < row[i].height())
+                    band.setROI(i*tile_size, y0-by, row[i].ROI(0, y0-ty, tile_size, y1-y0));
+        }
+
+        for (bim::uint64 x=0; x<info.width; x+=ots) {
+            if (x+ots > info.width || bh < ots) out.fill(0);
+            out.setROI(0, 0, band.ROI(x, 0, bim::min<bim::uint64>(ots, info.width-x), bh));
+            bim::ImageBitmap tile = *out.imageBitmap();
+            tile.i = info;
+            if (fm.sessionWriteTile(&tile, 0, x/ots, by/ots, 0) != 0)
+                return by == 0 && x == 0 ? IMGCNV_ERROR_WRITING_NOT_SUPPORTED : IMGCNV_ERROR_WRITING_FILE;
+        }
+    }
+    return IMGCNV_ERROR_NONE;
+}
+
 int mosaicTiles(DConf *c) {
     int tile_size = c->tile_size;
     int num_x = c->mosaic_num_x;
@@ -1467,25 +1738,35 @@ int mosaicTiles(DConf *c) {
         return IMGCNV_ERROR_NO_OUTPUT_FILE;
     }
 
+    // the first tile defines the pixel format of the mosaic
     Image tile(c->i_names[0]);
     if (tile.isEmpty()) return IMGCNV_ERROR_READING_FILE;
+    tile.process(c->getOperations(), 0, c);
+    bool concurrent = isConcurrentMosaic(c);
+
+    // formats written tile by tile receive the mosaic as it is assembled when tiles are requested
+    if (mosaicOutputTileSize(c) > 0) {
+        MetaFormatManager fm;
+        if (fm.sessionStartWrite((const bim::Filename) c->o_name.c_str(), c->o_fmt.c_str(), c->options.c_str()) != 0)
+            return IMGCNV_ERROR_WRITING_FILE;
+        if (fm.sessionCanWriteTiles()) {
+            c->print("Streaming output image", 2);
+            int res = streamMosaicTiles(c, fm, tile, concurrent);
+            fm.sessionEnd();
+            if (res != IMGCNV_ERROR_WRITING_NOT_SUPPORTED) return res;
+        }
+    }
+
     Image img(num_x*tile_size, num_y*tile_size, tile.depth(), tile.samples(), tile.pixelType());
     img.fill(0);
 
-    int i = 0;
-    for (int y = 0; y<img.height(); y += tile_size) {
-        for (int x = 0; x<img.width(); x += tile_size) {
-            c->error(xstring::xprintf("%d,%d for %s\n", x, y, c->i_names[i].c_str()));
-            Image tile(c->i_names[i]);
-            if (!tile.isEmpty()) {
-                tile.process(c->getOperations(), 0, c);
-                img.setROI(x, y, tile);
-            } else {
-                c->error("Tile could not be loaded");
-            }
-            ++i;
-        } // j
-    } // i
+    std::vector<Image> row;
+    for (int j = 0; j<num_y; ++j) {
+        readMosaicRow(c, j, row, concurrent);
+        for (int i = 0; i<num_x; ++i)
+            if (!row[i].isEmpty())
+                img.setROI(i*tile_size, j*tile_size, row[i]);
+    } // j
 
     c->print("Writing output image", 2);
     if (!img.toFile(c->o_name, c->o_fmt, c->options))
@@ -1570,6 +1851,17 @@ int rearrangeDimensions(DConf *c) {
     xoperations before = ops.left("-rearrange3d");
     xoperations after = ops.right("-rearrange3d");
 
+    // a single file is resliced in passes over its pages without keeping the volume in memory
+    if (c->i_names.size()==1 && after.size()==0) {
+        ImageStack stack;
+        if (!stack.rearrange3DFileToFile( c->rearrange3d, c->i_names[0].c_str(), c->o_name.c_str(), c->o_fmt.c_str(), 
+                                          c->options.c_str(), c->rearrange3d_memory*1024*1024, &before )) {
+            c->error(xstring::xprintf("Cannot rearrange %s into: %s\n", c->i_names[0].c_str(), c->o_name.c_str()));
+            return IMGCNV_ERROR_WRITING_FILE;
+        }
+        return IMGCNV_ERROR_NONE;
+    }
+
     ImageStack stack(c->i_names, c->c, &before);
     if (stack.isEmpty()) return IMGCNV_ERROR_READING_FILE;
     stack.ensureTypedDepth();
@@ -1670,6 +1962,29 @@ bool read_session_pixels(MetaFormatManager *fm, Image *img, unsigned int plane,
     }
 }
 
+//------------------------------------------------------------------------------
+// TimingReport - collects timing of the whole run and writes it on destruction
+//------------------------------------------------------------------------------
+
+class TimingReport {
+public:
+  TimingReport( const std::string &fileName ): file_name(fileName) {
+    if (file_name.size() < 1) return;
+    Timing::clear();
+    Timing::enable();
+  }
+
+  ~TimingReport() {
+    if (file_name.size() < 1) return;
+    if (!Timing::toFile(file_name))
+      std::cerr << "Could not write timing report into " << file_name << std::endl;
+    Timing::enable(false);
+  }
+
+private:
+  std::string file_name;
+};
+
 //------------------------------------------------------------------------------
 // MAIN
 //------------------------------------------------------------------------------
@@ -1686,6 +2001,9 @@ int main( int argc, char** argv ) {
       return IMGCNV_ERROR_NONE; 
   }
 
+  // declared before the format managers so their closing and flushing is included
+  TimingReport timing(conf.timing_file);
+
   MetaFormatManager fm; // input format manager
   MetaFormatManager ofm; // output format manager
   Image img;
@@ -1891,6 +2209,24 @@ int main( int argc, char** argv ) {
   }
 
 
+  // a leading -remap keeps only the listed channels, readers storing channels
+  // separately then decode only those and the operation is already applied
+  xoperations operations = conf.getOperations();
+  std::vector<int> decode_channels;
+  unsigned int file_samples = fm.sessionGetInfo().samples;
+  if (!conf.create && !conf.raw && conf.i_names.size() == 1 && conf.c_names.size() == 0 &&
+      operations.size() > 0 && operations[0].first == "-remap") {
+    decode_channels = operations[0].second.splitInt(",");
+    for (unsigned int i=0; i<decode_channels.size(); ++i) {
+      decode_channels[i] = decode_channels[i] - 1;
+      if (decode_channels[i] < 0) { // empty channels are created by the operation
+        decode_channels.clear();
+        break;
+      }
+    }
+    fm.sessionSetChannels(decode_channels);
+  }
+
   // WRITE IMAGES
   for (page=0; page<num_pages; ++page) {
 
@@ -1953,6 +2289,13 @@ int main( int argc, char** argv ) {
     }
     img.set_metadata(fm.get_metadata());
 
+    xoperations page_operations = operations;
+    if (decode_channels.size() > 0 && fm.sessionChannelsRead() && img.samples() == decode_channels.size()) {
+      img.remapChannelMetadata(file_samples, decode_channels);
+      page_operations.erase(page_operations.begin());
+      hist.clear();
+    }
+
     // ------------------------------------------------------------------
 
     // update image's geometry
@@ -2027,7 +2370,7 @@ int main( int argc, char** argv ) {
     // BEGIN OPS - operations are now applied according to the position in the command line
     //======================================================================================
 
-    img.process(conf.getOperations(), &hist, &conf);
+    img.process(page_operations, &hist, &conf);
 
     //======================================================================================
     // END OPS - operations are now applied according to the position in the command line
@@ -2078,8 +2421,8 @@ int main( int argc, char** argv ) {
     conf.print( "About to write", 2 );
     if (!conf.project && ofname.size()>0) {
 
-      if ( img.get_metadata().size()>0 ) 
-          ofm.sessionWriteSetMetadata( img.get_metadata() );
+      if ( img.meta()->size()>0 ) 
+          ofm.sessionWriteSetMetadata( *img.meta() );
       if (conf.omexml.size()>0)
           ofm.sessionWriteSetOMEXML(conf.omexml);
 
@@ -2089,7 +2432,7 @@ int main( int argc, char** argv ) {
         if (num_pages > 1)
           ofname.insertAfterLast( ".", xstring::xprintf("_%.6d", real_frame+1) );
 
-        fm.writeImage((const bim::Filename)ofname.c_str(), img.imageBitmap(), conf.o_fmt.c_str(), conf.options.c_str(), (TagMap *)img.meta());
+        fm.writeImage((const bim::Filename)ofname.c_str(), img.imageBitmap(), conf.o_fmt.c_str(), conf.options.c_str(), img.edit_metadata());
       } // if not multipage
     } // if not projecting
 
@@ -0,0 +1,256 @@
+/*****************************************************************************
+ K-d tree for exact nearest neighbour search of feature vectors
+
+ Feature vectors are stored as columns of a reg::Matrix (1-based, as produced
+ by getfeatures) and distances are L1, same as the window differences used
+ in matchfeatures.
+
+ A k-d tree can't prune in hundreds of dimensions, so the tree is built over
+ a reduced vector: full dimensions are partitioned into groups and each
+ reduced value is the sum of its group. By the triangle inequality the L1
+ distance of reduced vectors never exceeds the full L1 distance, so it is a
+ lower bound used both to prune cells and to skip leaf candidates before
+ they are verified with the full distance. The tree is balanced by median
+ splits along the reduced dimension of largest spread, leaves hold small
+ buckets of points.
+
+ Search is exact: full distances are abandoned as soon as the partial sum
+ exceeds the current best and ties are resolved towards the smaller feature
+ index, so the result is identical to a linear scan. Distances are summed in
+ double and rounded once, so a summation order changed by the compiler
+ (-ffast-math) can't change the value.
+
+ Memory is linear in the number of features: one contiguous copy of the
+ full and of the reduced feature vectors plus the node array.
+
+ History:
+   10/19/2026 12:00:00 - First creation
+   10/19/2026 12:00:00 - Index over group sums, candidates verified with full distance
+   10/19/2026 12:00:00 - Distances accumulated in double, same values with -ffast-math
+
+ Ver : 3
+*****************************************************************************/
+
+#ifndef REG_KDTREE_H
+#define REG_KDTREE_H
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+namespace reg {
+
+template <typename T>
+class FeatureTree {
+public:
+  static const int bucket_size = 8;
+
+public:
+  // builds a tree over "cols" features of "dims" values stored column-wise in a 1-based matrix,
+  // groups[d] gives the reduced dimension of full dimension d, by default nothing is reduced
+  FeatureTree(T **m, int dims, int cols, const std::vector<int> &groups = std::vector<int>());
+
+  int dimensions() const { return dims; }
+  int reducedDimensions() const { return rdims; }
+  int size() const { return n; }
+
+  // groups of a ws x ws window stored row by row, split into blocks x blocks spatial blocks,
+  // trailing dimensions (rotation parameters) get a group of their own
+  static std::vector<int> windowGroups(int dims, int ws, int blocks);
+
+  // returns 0-based index of the closest feature and its L1 distance
+  int nearest(const T *q, T *dist) const;
+
+  // L1 distance from q to feature i, abandoned once larger than limit
+  inline T distance(const T *q, int i, const T &limit) const;
+
+protected:
+  struct Node {
+    int dim;       // split reduced dimension, -1 for leaves
+    double split;  // split value
+    int first;     // leaf: first position in perm
+    int last;      // leaf: one past last position in perm
+    int left;
+    int right;
+  };
+
+  int n;
+  int dims;
+  int rdims;
+  std::vector<int> groups;
+  std::vector<T>   data;     // features copied row-wise: data[i*dims + d]
+  std::vector<double> rdata; // reduced features: rdata[i*rdims + r]
+  std::vector<int> perm;     // feature indices ordered by tree leaves
+  std::vector<Node> nodes;
+
+  int  build(int first, int last);
+  void reduce(const T *v, double *r) const;
+  void search(int node, const T *q, const double *rq, std::vector<double> &off, double bound, int *best, T *best_dist) const;
+
+  static inline bool beyond(double bound, const T &best) { return bound > (double) best * (1.0+1e-4) + 1e-12; }
+};
+
+//****************************************************************************
+// implementation
+//****************************************************************************
+
+template <typename T>
+std::vector<int> FeatureTree<T>::windowGroups(int dims, int ws, int blocks) {
+  std::vector<int> g(dims);
+  blocks = std::max(1, std::min(blocks, ws));
+  for (int d=0; d<dims; ++d) {
+    if (d < ws*ws)
+      g[d] = ((d/ws)*blocks/ws)*blocks + (d%ws)*blocks/ws;
+    else
+      g[d] = blocks*blocks + d - ws*ws;
+  }
+  return g;
+}
+
+template <typename T>
+FeatureTree<T>::FeatureTree(T **m, int dims, int cols, const std::vector<int> &groups): n(cols), dims(dims), groups(groups) {
+  if ((int) this->groups.size() != dims) {
+    this->groups.resize(dims);
+    for (int d=0; d<dims; ++d) this->groups[d] = d;
+  }
+  this->rdims = dims>0 ? *std::max_element(this->groups.begin(), this->groups.end()) + 1 : 0;
+
+  this->data.resize((size_t)n*dims);
+  for (int d=0; d<dims; ++d) {
+    const T *row = m[d+1];
+    for (int i=0; i<n; ++i)
+      this->data[(size_t)i*dims + d] = row[i+1];
+  }
+
+  this->rdata.resize((size_t)n*this->rdims);
+  for (int i=0; i<n; ++i)
+    this->reduce(&this->data[(size_t)i*dims], &this->rdata[(size_t)i*this->rdims]);
+
+  this->perm.resize(n);
+  for (int i=0; i<n; ++i) this->perm[i] = i;
+
+  this->nodes.reserve( 2*(n/bucket_size+1) );
+  if (n>0) this->build(0, n);
+}
+
+template <typename T>
+int FeatureTree<T>::build(int first, int last) {
+  int id = (int) this->nodes.size();
+  this->nodes.push_back( Node() );
+  Node node;
+  node.dim = -1; node.split = 0;
+  node.first = first; node.last = last;
+  node.left = -1; node.right = -1;
+
+  if (last-first > bucket_size) {
+    // split along the reduced dimension of largest spread
+    int best_dim = 0;
+    double best_spread = -1;
+    for (int d=0; d<this->rdims; ++d) {
+      double lo = this->rdata[(size_t)this->perm[first]*this->rdims + d];
+      double hi = lo;
+      for (int i=first+1; i<last; ++i) {
+        double v = this->rdata[(size_t)this->perm[i]*this->rdims + d];
+        if (v<lo) lo = v;
+        if (v>hi) hi = v;
+      }
+      if (hi-lo > best_spread) { best_spread = hi-lo; best_dim = d; }
+    }
+
+    if (best_spread > 0) {
+      int mid = first + (last-first)/2;
+      const std::vector<double> &data = this->rdata;
+      const int dims = this->rdims;
+      std::nth_element( this->perm.begin()+first, this->perm.begin()+mid, this->perm.begin()+last,
+        [&data, dims, best_dim](int a, int b) { return data[(size_t)a*dims+best_dim] < data[(size_t)b*dims+best_dim]; } );
+
+      node.dim = best_dim;
+      node.split = this->rdata[(size_t)this->perm[mid]*this->rdims + best_dim];
+      node.left = this->build(first, mid);
+      node.right = this->build(mid, last);
+    }
+  }
+
+  this->nodes[id] = node;
+  return id;
+}
+
+template <typename T>
+inline T FeatureTree<T>::distance(const T *q, int i, const T &limit) const {
+  const T *p = &this->data[(size_t)i*this->dims];
+  double d = 0;
+  int k = 0;
+  // partial sums only grow, so a rounded partial sum above the limit can't become a tie, checked every 16 values
+  for (; k+16<=this->dims; k+=16) {
+    for (int j=k; j<k+16; ++j)
+      d += fabs((double) q[j] - (double) p[j]);
+    if ((T) d > limit) return (T) d;
+  }
+  for (; k<this->dims; ++k)
+    d += fabs((double) q[k] - (double) p[k]);
+  return (T) d;
+}
+
+template <typename T>
+void FeatureTree<T>::reduce(const T *v, double *r) const {
+  for (int k=0; k<this->rdims; ++k) r[k] = 0;
+  for (int d=0; d<this->dims; ++d) r[this->groups[d]] += (double) v[d];
+}
+
+template <typename T>
+void FeatureTree<T>::search(int id, const T *q, const double *rq, std::vector<double> &off, double bound, int *best, T *best_dist) const {
+  const Node &node = this->nodes[id];
+
+  if (node.dim < 0) {
+    for (int k=node.first; k<node.last; ++k) {
+      int i = this->perm[k];
+      if (this->rdims < this->dims) {
+        // lower bound from group sums, the slack keeps rounding from dropping ties
+        const double *rp = &this->rdata[(size_t)i*this->rdims];
+        double lb = 0;
+        for (int r=0; r<this->rdims; ++r) lb += fabs(rq[r]-rp[r]);
+        if (beyond(lb, *best_dist)) continue;
+      }
+      T d = this->distance(q, i, *best_dist);
+      if (d < *best_dist || (d == *best_dist && i < *best)) {
+        *best_dist = d;
+        *best = i;
+      }
+    }
+    return;
+  }
+
+  double diff = rq[node.dim] - node.split;
+  int near_node = diff < 0 ? node.left : node.right;
+  int far_node  = diff < 0 ? node.right : node.left;
+
+  this->search(near_node, q, rq, off, bound, best, best_dist);
+
+  // incremental L1 bound of the far cell in the reduced space
+  double old_off = off[node.dim];
+  double far_bound = bound - old_off + fabs(diff);
+  if (beyond(far_bound, *best_dist)) return;
+
+  off[node.dim] = fabs(diff);
+  this->search(far_node, q, rq, off, far_bound, best, best_dist);
+  off[node.dim] = old_off;
+}
+
+template <typename T>
+int FeatureTree<T>::nearest(const T *q, T *dist) const {
+  int best = -1;
+  T best_dist = std::numeric_limits<T>::max();
+  if (this->n>0) {
+    std::vector<double> rq(this->rdims);
+    this->reduce(q, &rq[0]);
+    std::vector<double> off(this->rdims, 0.0);
+    this->search(0, q, &rq[0], off, 0.0, &best, &best_dist);
+  }
+  if (dist) *dist = best_dist;
+  return best;
+}
+
+} // namespace reg
+
+#endif // REG_KDTREE_H
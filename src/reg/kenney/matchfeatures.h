@@ -15,15 +15,25 @@ OUTPUT:
    07/24/2001 18:40:30 - First creation
    08/10/2001 15:06:32 - use of TPointA
    10/02/2001 19:12:00 - GCC warnings and Linux treatment
+   10/19/2026 12:00:00 - k-d tree matcher, linear memory, dense version kept as reference
+   10/19/2026 12:00:00 - k-d trees index window block sums
+   10/19/2026 12:00:00 - window differences summed in double like the k-d tree
 
- Ver : 3
+ Ver : 6
 *****************************************************************************/
 
 #ifndef REG_MATCH_FEATURES
 #define REG_MATCH_FEATURES
 
+#include <vector>
+#include <algorithm>
+
+#include "../kdtree.h"
+
+// Reference implementation: builds the full cw x cW distance matrix,
+// quadratic in memory, kept for validation and benchmarking
 template< typename Timg, typename Tpoint >
-int matchfeatures(const reg::Matrix<Timg> *Matw, const reg::Matrix<Timg> *MatW, 
+int matchfeatures_dense(const reg::Matrix<Timg> *Matw, const reg::Matrix<Timg> *MatW, 
                   const std::deque< reg::Point<Tpoint> > *candidates1, 
                   const std::deque< reg::Point<Tpoint> > *candidates2, 
                   int numpoints, 
@@ -48,9 +58,11 @@ int matchfeatures(const reg::Matrix<Timg> *Matw, const reg::Matrix<Timg> *MatW,
   #pragma omp parallel for default(shared)
   for (int k=1; k<=cw; k++)
   for (int j=1; j<=cw; j++) {
-    dk[k][j] = 0;
+    // summed in double and rounded once, same value as reg::FeatureTree::distance
+    double d = 0;
     for (int i=1; i<=rw; i++)
-      dk[k][j] += (Timg) fabs( w[i][k]-W[i][j] );
+      d += fabs( (double) w[i][k] - (double) W[i][j] );
+    dk[k][j] = (Timg) d;
   }
 
   #pragma omp parallel for default(shared)
@@ -105,4 +117,95 @@ int matchfeatures(const reg::Matrix<Timg> *Matw, const reg::Matrix<Timg> *MatW,
   return 0;
 }
 
+template< typename Timg >
+struct FeatureDistanceLess {
+  const std::vector<Timg> *d;
+  explicit FeatureDistanceLess(const std::vector<Timg> *d): d(d) {}
+  bool operator()(int a, int b) const { return (*d)[a] < (*d)[b]; }
+};
+
+template< typename Timg, typename Tpoint >
+int matchfeatures(const reg::Matrix<Timg> *Matw, const reg::Matrix<Timg> *MatW, 
+                  const std::deque< reg::Point<Tpoint> > *candidates1, 
+                  const std::deque< reg::Point<Tpoint> > *candidates2, 
+                  int numpoints, 
+                  std::deque< reg::Point<Tpoint> > *points1,
+                  std::deque< reg::Point<Tpoint> > *points2 )
+// same mutual best match as matchfeatures_dense, but nearest neighbours are
+// found with k-d trees over both feature sets: memory is linear and only
+// the candidates whose block sums can beat the current best are verified
+{  
+  int rw = Matw->rows-2; // -2 ignore rotation parameters
+  int cw = Matw->cols;
+  int cW = MatW->cols;
+  if (cw<1 || cW<1 || rw<1) return 0;
+
+  // square windows are indexed by sums over spatial blocks, smooth windows keep most
+  // of their variation in these sums which makes them a tight bound of the full distance
+  std::vector<int> groups;
+  int ws = (int) floor(sqrt((double) rw) + 0.5);
+  const int blocks = 5;
+  if (ws*ws == rw && ws >= blocks)
+    groups = reg::FeatureTree<Timg>::windowGroups(rw, ws, blocks);
+  reg::FeatureTree<Timg> tw((Timg **)Matw->data, rw, cw, groups);
+  reg::FeatureTree<Timg> tW((Timg **)MatW->data, rw, cW, groups);
+
+  // for each feature in w find the closest one in W and vice versa, 0-based
+  std::vector<int> kKmin(cw);
+  std::vector<int> Kkmin(cW);
+  std::vector<Timg> mdk(cw);
+
+  #pragma omp parallel default(shared)
+  {
+    std::vector<Timg> q(rw);
+
+    #pragma omp for schedule(dynamic, 16)
+    for (int k=0; k<cw; k++) {
+      for (int i=0; i<rw; i++) q[i] = Matw->data[i+1][k+1];
+      kKmin[k] = tW.nearest(&q[0], &mdk[k]);
+    }
+
+    #pragma omp for schedule(dynamic, 16)
+    for (int K=0; K<cW; K++) {
+      for (int i=0; i<rw; i++) q[i] = MatW->data[i+1][K+1];
+      Kkmin[K] = tw.nearest(&q[0], 0);
+    }
+  }
+
+  numpoints = (int) std::min<size_t>( numpoints, std::min<size_t>(candidates1->size(), candidates2->size()) );
+
+  // visit features of w from the best match to the worst, stable for equal distances
+  std::vector<int> iii(cw);
+  for (int i=0; i<cw; i++) iii[i] = i;
+  std::stable_sort(iii.begin(), iii.end(), FeatureDistanceLess<Timg>(&mdk));
+
+  int numnum=0;
+  for (int i=0; i<cw; i++) {
+    int k=iii[i];
+    int K=kKmin[k];
+    if (Kkmin[K]==k) {
+      numnum=numnum+1;
+      points1->push_back( (*candidates1)[k] );
+      points2->push_back( (*candidates2)[K] );
+      if (numnum==numpoints) break;
+    }
+  }
+
+  // check to make sure we got enough points
+  // if not the reduce the match requirements
+  if (numnum<numpoints/2) {
+    numnum=0;
+    for (int i=0; i<cw; i++) {
+     int k=iii[i];
+     int K=kKmin[k];
+     numnum=numnum+1;
+     points1->push_back( (*candidates1)[k] );
+     points2->push_back( (*candidates2)[K] );
+     if (numnum==numpoints) break;
+    }
+  }
+
+  return 0;
+}
+
 #endif // REG_MATCH_FEATURES
@@ -7,32 +7,197 @@ Author: Dima Fedorov Levit <dimin@dimin.net> <http://www.dimin.net/>
 
 History:
 2008-01-01 17:02 - First creation
+2026-10-19 12:00 - Native parallel rasterization of planes bucketed by Z, label output
+2026-10-19 12:00 - Closed shapes are outlined as before unless fill is requested
 
-ver: 2
+ver: 4
 
 *******************************************************************************/
 
 #include <cmath>
+#include <vector>
+#include <algorithm>
 
 #include <QtCore>
 #include <QtGui>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include <BioImageCore>
 #include <BioImage>
 #include <BioImageFormats>
 
 #include "gobjects_masks.h"
 #include "gobjects.h"
-#include "gobjects_render_qt.h"
+#include "gobjects_render_raster.h"
 
 #ifdef BIM_USE_PROGRESS
 #include <d_progress_widget.h>
 #endif
 
+//---------------------------------------------------------------------------------
+// Gobjects into raster shapes bucketed by Z plane
+//---------------------------------------------------------------------------------
+
+enum DMaskMode { mmColor=0, mmMask=1, mmLabels=2 };
+
+class DMaskShapes {
+public:
+  DMaskShapes( int _l, DMaskMode m, bool f, const DGObjectRenderingOptions &o ): l(_l), mode(m), fill(f), opt(o), labels(0) {
+    planes.resize(l);
+  }
+
+  void walk( const QList< QSharedPointer<DGObject> > &l );
+
+  int l;
+  DMaskMode mode;
+  bool fill;
+  const DGObjectRenderingOptions &opt;
+  unsigned int labels;
+
+  DRasterShapes shapes;              // each shape is stored once
+  std::vector< std::vector<int> > planes; // shapes painted in each plane, in object order
+
+protected:
+  void add( const DGObject &o );
+  bool add_plane_shape( const DGObject &o, DRasterShape::Type type, int z, const std::vector<double> &values, double lw );
+  void push( const DRasterShape &s, int z );
+};
+
+// vertices without Z are visible in every plane, T is fixed to the first time point
+static inline bool vertex_in_plane( const DVertex5D<float> &v, int z ) {
+  if (v.hasT() && fabs(v.getT()) >= 0.5) return false;
+  return z<0 || !v.hasZ() || fabs(v.getZ()-z) < 0.5;
+}
+
+void DMaskShapes::push( const DRasterShape &s, int z ) {
+  int idx = (int) shapes.size();
+  shapes.push_back(s);
+  if (z >= 0) {
+    planes[z].push_back(idx);
+  } else {
+    for (int i=0; i<l; ++i)
+      planes[i].push_back(idx);
+  }
+}
+
+// z<0 builds the shape visible in all planes
+bool DMaskShapes::add_plane_shape( const DGObject &o, DRasterShape::Type type, int z, const std::vector<double> &values, double lw ) {
+  int required = 1;
+  if (type == DRasterShape::Rectangle || type == DRasterShape::Circle) required = 2;
+  if (type == DRasterShape::Ellipse) required = 3;
+  bool filter = type == DRasterShape::Polyline || type == DRasterShape::Polygon;
+
+  DRasterShape s(type);
+  s.values = values;
+  s.line_width = lw;
+  s.filled = fill;
+  for (int i=0; i<o.vertices.size(); ++i) {
+    const DVertex5D<float> &v = o.vertices[i];
+    if (!vertex_in_plane(v, z)) {
+      if (!filter && i<required) return false;
+      continue;
+    }
+    s.x.push_back( v.getX() );
+    s.y.push_back( v.getY() );
+  }
+  if ((int) s.x.size() < required) return false;
+  push(s, z);
+
+  // vertex decorations are only drawn into color renderings
+  if (mode != mmColor || !filter || opt.getPolyHideVertices()) return true;
+  if (QVariant(o.tags.value("freehand", "false")).toBool()) return true;
+  for (unsigned int i=0; i<s.x.size(); ++i) {
+    DRasterShape pt(DRasterShape::Point);
+    pt.values = values;
+    pt.line_width = lw;
+    pt.x.push_back( s.x[i] );
+    pt.y.push_back( s.y[i] );
+    push(pt, z);
+  }
+  return true;
+}
+
+void DMaskShapes::add( const DGObject &o ) {
+  DRasterShape::Type type;
+  QString t = o.getType();
+  if (t == "point") type = DRasterShape::Point;
+  else if (t == "polyline") type = DRasterShape::Polyline;
+  else if (t == "polygon") type = DRasterShape::Polygon;
+  else if (t == "rectangle" || t == "square") type = DRasterShape::Rectangle;
+  else if (t == "ellipse") type = DRasterShape::Ellipse;
+  else if (t == "circle") type = DRasterShape::Circle;
+  else return;
+
+  std::vector<double> values;
+  double lw = 1.0;
+  if (mode == mmColor) {
+    QColor c = opt.getGObjectColor(o);
+    if (c.alpha()==0) return;
+    values.push_back( c.red() );
+    values.push_back( c.green() );
+    values.push_back( c.blue() );
+    lw = opt.getGObjectLineWidth(o);
+  } else if (mode == mmMask) {
+    values.push_back( 255 );
+  } else {
+    values.push_back( ++labels );
+  }
+
+  // planes touched by vertices with Z, objects without any Z are in all planes
+  std::vector<int> zs;
+  for (int i=0; i<o.vertices.size(); ++i)
+    if (o.vertices[i].hasZ()) {
+      int z = (int) floor(o.vertices[i].getZ() + 0.5);
+      if (z>=0 && z<l) zs.push_back(z);
+    }
+
+  if (zs.size()==0) {
+    bool has_z = false;
+    for (int i=0; i<o.vertices.size(); ++i)
+      has_z = has_z || o.vertices[i].hasZ();
+    if (!has_z) add_plane_shape(o, type, -1, values, lw);
+    return;
+  }
+
+  std::sort( zs.begin(), zs.end() );
+  zs.erase( std::unique(zs.begin(), zs.end()), zs.end() );
+  for (unsigned int i=0; i<zs.size(); ++i)
+    add_plane_shape(o, type, zs[i], values, lw);
+}
+
+void DMaskShapes::walk( const QList< QSharedPointer<DGObject> > &objects ) {
+  for (int i=0; i<objects.size(); ++i) {
+    const DGObject *o = objects.at(i).data();
+    if (!o->isVisible() || !opt.isGObjectVisible(o)) continue;
+    walk( o->children );
+    if (o->hasVertices()) add( *o );
+  }
+}
+
 //---------------------------------------------------------------------------------
 // Masks into files
 //---------------------------------------------------------------------------------
 
+// planes are allocated and rasterized in parallel, image memory references are guarded
+// by a mutex and each plane only paints its own shapes
+static void render_planes( const DMaskShapes &ms, int z0, int n, std::vector<bim::Image> &planes, 
+                           int w, int h, int depth, int samples ) {
+  planes.clear();
+  planes.resize( std::max<int>(0, std::min<int>(z0+n, ms.l) - z0) );
+
+  #pragma omp parallel for default(shared) schedule(dynamic)
+  for (int i=0; i<(int)planes.size(); ++i) {
+    planes[i] = bim::Image(w, h, depth, samples, bim::FMT_UNSIGNED);
+    planes[i].fill(0);
+    const std::vector<int> &idx = ms.planes[z0+i];
+    for (unsigned int j=0; j<idx.size(); ++j)
+      rasterizeShape( planes[i], ms.shapes[idx[j]] );
+  } // for planes
+}
+
 void renderGObjectsToImage( const QString &name, const QString &format, 
                        DGObjects &gobjects, int w, int h, int l,
                        DProgressWidget *progress, 
@@ -43,39 +208,35 @@ void renderGObjectsToImage( const QString &name, const QString &format,
   if (progress) progress->startNow(true);
   #endif
 
-  gobjects.setRenderProc( "point", gobject_render_point_qt );
-  gobjects.setRenderProc( "polyline", gobject_render_polyline_qt );
-  gobjects.setRenderProc( "polygon", gobject_render_polygon_qt );
-  //gobjects.setRenderProc( "rectangle", gobject_render_rectangle_qt );
-  //gobjects.setRenderProc( "square", gobject_render_rectangle_qt );
-  //gobjects.setRenderProc( "ellipse", gobject_render_ellipse_qt );
-  //gobjects.setRenderProc( "circle", gobject_render_circle_qt );
-  //gobjects.setRenderProc( "label", gobject_render_label_qt );
+  DMaskMode mode = mmColor;
+  if (args.contains("mask-mode")) mode = mmMask;
+  if (args.contains("label-mode")) mode = mmLabels;
 
-  QImage plane( w, h, QImage::Format_ARGB32 );
-  QPainter p(&plane);
+  DMaskShapes ms( l, mode, args.contains("fill"), rend_opts );
+  ms.walk( gobjects );
 
-  DGObjectRenderingOptionsQt opt;
-  //= rend_opts;
-  opt.setPainter(&p);
-  if (args.contains("mask-mode")) opt.setMaskOutput(true);
+  // labels are stored in the smallest depth able to hold all of them
+  int samples = mode == mmColor ? 3 : 1;
+  int depth = 8;
+  if (mode == mmLabels && ms.labels > 255) depth = 16;
+  if (mode == mmLabels && ms.labels > 65535) depth = 32;
+
+  int batch = 2;
+  #ifdef _OPENMP
+  batch = omp_get_max_threads()*2;
+  #endif
+  std::vector<bim::Image> planes;
 
   if (!args.contains("interpolate-empty")) {
-    TMetaFormatManager fm;
+    bim::MetaFormatManager fm;
     if (fm.isFormatSupportsWMP( format.toStdString().c_str() ) == false) return;
     if (fm.sessionStartWrite(name.toStdString().c_str(),  format.toStdString().c_str()) == 0) {
-      for (int z=0; z<l; ++z) {
-        plane.fill(0);
-        opt.setCurrentZ(z);
-        gobjects.render(&opt);
-
-        TDimImage img;
-        img.fromQImage( plane );
-        if (opt.getMaskOutput()) img.extractChannel(0);
-
-        fm.sessionWriteImage( img.imageBitmap(), z );
+      for (int z0=0; z0<l; z0+=batch) {
+        render_planes( ms, z0, batch, planes, w, h, depth, samples );
+        for (unsigned int i=0; i<planes.size(); ++i)
+          fm.sessionWriteImage( planes[i].imageBitmap(), z0+i );
         #ifdef BIM_USE_PROGRESS
-        if (progress) progress->doProgress( "Creating gobject mask", z, l-1 );
+        if (progress) progress->doProgress( "Creating gobject mask", z0+planes.size()-1, l-1 );
         #endif
       } // for z
     }
@@ -83,28 +244,22 @@ void renderGObjectsToImage( const QString &name, const QString &format,
   } // if no interpolation
 
   if (args.contains("interpolate-empty")) {
-    DImageStack stk;
+    bim::ImageStack stk;
     // create stack first
-    for (int z=0; z<l; ++z) {
-      plane.fill(0);
-
-      opt.setCurrentZ(z);
-      gobjects.render(&opt);
-
-      TDimImage img;
-      img.fromQImage( plane );
-      if (opt.getMaskOutput()) img.extractChannel(0);
-
-      stk.append(img);
+    for (int z0=0; z0<l; z0+=batch) {
+      render_planes( ms, z0, batch, planes, w, h, depth, samples );
+      for (unsigned int i=0; i<planes.size(); ++i)
+        stk.append( planes[i] );
       #ifdef BIM_USE_PROGRESS
-      if (progress) progress->doProgress( "Creating gobject mask", z, l-1 );
+      if (progress) progress->doProgress( "Creating gobject mask", z0+planes.size()-1, l-1 );
       #endif
     } // for z
+    planes.clear();
    
     // now interpolate all empty fields
     std::vector<int> empty;
     for (int z=l-1; z>=0; --z) {
-      DImageHistogram h( *stk[z] );
+      bim::ImageHistogram h( *stk[z] );
       
       double m = h[0]->num_unique();
       for (int c=1; c<h.channels(); ++c)
@@ -117,10 +272,10 @@ void renderGObjectsToImage( const QString &name, const QString &format,
           int beg = std::max<int>(0, empty.back()-1);
           int end = std::min<int>(empty.front()+1, l-1);
           
-          DImageStack stktmp;
+          bim::ImageStack stktmp;
           stktmp.append(stk[beg]->deepCopy());
           stktmp.append(stk[end]->deepCopy()); 
-          stktmp.resize(0, 0, end-beg+1, TDimImage::szBiCubic);
+          stktmp.resize(0, 0, end-beg+1, bim::Image::szBiCubic);
 
           for (int p=0; p<stktmp.size(); ++p) 
             *stk[beg+p] = *stktmp[p];
@@ -140,4 +295,3 @@ void renderGObjectsToImage( const QString &name, const QString &format,
   #endif
 }
 
-
@@ -7,8 +7,10 @@ Author: Dima Fedorov Levit <dimin@dimin.net> <http://www.dimin.net/>
 
 History:
 2008-01-01 17:02 - First creation
+2026-10-19 12:00 - Label output
+2026-10-19 12:00 - Optional filling of closed shapes
 
-ver: 1
+ver: 3
 
 *******************************************************************************/
 
@@ -28,6 +30,13 @@ class DProgressWidget;
 // rendering functions
 //---------------------------------------------------------------------------------
 
+// writes one plane per Z into a multi-page file, args may contain:
+//   mask-mode - 8 bit single channel mask, objects are 255
+//   label-mode - single channel image where each object is painted with its index starting at 1,
+//                depth is the smallest of 8, 16 or 32 bits able to hold all labels
+//   fill - polygons, rectangles, ellipses and circles are filled, otherwise only outlined
+//   interpolate-empty - empty planes are interpolated from their non-empty neighbours
+// otherwise objects are painted in their colors into an 8 bit RGB image
 void renderGObjectsToImage( const QString &name, const QString &format, 
                        DGObjects &gobjects, int w, int h, int l,
                        DProgressWidget *progress = 0, 
@@ -0,0 +1,271 @@
+/*******************************************************************************
+
+5D GObjects native rasterization
+
+Scanline rasterization of graphical primitives directly into image planes of
+any pixel format, without Qt. Pixels are painted if their centers are covered
+by the shape, no antialiasing is done so written values are exact labels.
+
+Author: Dima Fedorov Levit <dimin@dimin.net> <http://www.dimin.net/>
+        Center for Bio-image Informatics, UCSB
+
+History:
+2026-10-19 12:00 - First creation
+2026-10-19 12:00 - Closed shapes are outlined unless filled is set
+
+ver: 2
+
+*******************************************************************************/
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <BioImageCore>
+#include <BioImage>
+
+#include "gobjects_render_raster.h"
+
+//---------------------------------------------------------------------------------
+// span writer: fills pixels with centers inside [x1, x2) of the row y
+//---------------------------------------------------------------------------------
+
+template <typename T>
+class DRasterSpans {
+public:
+  DRasterSpans( bim::Image &img, const std::vector<double> &values ): plane(img) {
+    width  = (int) img.width();
+    height = (int) img.height();
+    for (unsigned int s=0; s<img.samples(); ++s)
+      v.push_back( values.size()>0 ? (T) values[std::min<size_t>(s, values.size()-1)] : (T) 0 );
+  }
+
+  inline int rows() const { return height; }
+
+  void operator()( int y, double x1, double x2 ) {
+    if (y<0 || y>=height) return;
+    double a = std::max<double>( ceil(x1-0.5), 0 );
+    double b = std::min<double>( ceil(x2-0.5), width );
+    if (a >= b) return;
+    for (unsigned int s=0; s<v.size(); ++s) {
+      T *p = (T *) plane.scanLine(s, y);
+      std::fill( p+(int)a, p+(int)b, v[s] );
+    }
+  }
+
+private:
+  bim::Image &plane;
+  int width, height;
+  std::vector<T> v;
+};
+
+//---------------------------------------------------------------------------------
+// primitives
+//---------------------------------------------------------------------------------
+
+class DRasterEdge {
+public:
+  double y1, y2; // y1 < y2, edge covers [y1, y2)
+  double x;      // x at y1
+  double dxdy;
+  int dir;
+  inline bool operator<(const DRasterEdge &o) const { return y1 < o.y1; }
+};
+
+// closed polygon filled with non-zero winding, edge table with an active edge list
+template <typename W>
+void raster_fill_polygon( W &span, const double *x, const double *y, int n ) {
+  std::vector<DRasterEdge> edges;
+  for (int i=0; i<n; ++i) {
+    int j = (i+1)%n;
+    if (y[i] == y[j]) continue;
+    DRasterEdge e;
+    e.dir  = y[j] > y[i] ? 1 : -1;
+    int a  = e.dir > 0 ? i : j;
+    int b  = e.dir > 0 ? j : i;
+    e.y1   = y[a];
+    e.y2   = y[b];
+    e.x    = x[a];
+    e.dxdy = (x[b]-x[a]) / (y[b]-y[a]);
+    edges.push_back(e);
+  }
+  if (edges.size()<2) return;
+  std::sort( edges.begin(), edges.end() );
+
+  double ymax = edges[0].y2;
+  for (size_t i=1; i<edges.size(); ++i)
+    ymax = std::max<double>(ymax, edges[i].y2);
+  int r1 = (int) std::max<double>( ceil(edges[0].y1-0.5), 0 );
+  int r2 = (int) std::min<double>( ceil(ymax-0.5)-1, span.rows()-1 );
+
+  std::vector<size_t> active;
+  std::vector< std::pair<double, int> > xs;
+  size_t next = 0;
+  for (int r=r1; r<=r2; ++r) {
+    double yc = r + 0.5;
+    while (next<edges.size() && edges[next].y1 <= yc)
+      active.push_back(next++);
+
+    size_t k = 0;
+    xs.clear();
+    for (size_t i=0; i<active.size(); ++i) {
+      const DRasterEdge &e = edges[active[i]];
+      if (e.y2 <= yc) continue;
+      active[k++] = active[i];
+      xs.push_back( std::make_pair(e.x + (yc-e.y1)*e.dxdy, e.dir) );
+    }
+    active.resize(k);
+    std::sort( xs.begin(), xs.end() );
+
+    int winding = 0;
+    double start = 0;
+    for (size_t i=0; i<xs.size(); ++i) {
+      int prev = winding;
+      winding += xs[i].second;
+      if (prev == 0 && winding != 0) start = xs[i].first;
+      else if (prev != 0 && winding == 0) span( r, start, xs[i].first );
+    }
+  } // r
+}
+
+template <typename W>
+void raster_fill_ellipse( W &span, double cx, double cy, double rx, double ry ) {
+  if (rx<=0 || ry<=0) return;
+  int r1 = (int) std::max<double>( ceil(cy-ry-0.5), 0 );
+  int r2 = (int) std::min<double>( floor(cy+ry-0.5), span.rows()-1 );
+  for (int r=r1; r<=r2; ++r) {
+    double dy = (r + 0.5 - cy) / ry;
+    double t = 1.0 - dy*dy;
+    if (t < 0) continue;
+    double dx = rx * sqrt(t);
+    span( r, cx-dx, cx+dx );
+  }
+}
+
+// ring of width w centered on the ellipse, the inner ellipse is left unpainted
+template <typename W>
+void raster_stroke_ellipse( W &span, double cx, double cy, double rx, double ry, double w ) {
+  double hw = std::max<double>(w, 1.0) / 2.0;
+  double ox = rx+hw, oy = ry+hw;
+  double ix = rx-hw, iy = ry-hw;
+  if (ix<=0 || iy<=0) {
+    raster_fill_ellipse( span, cx, cy, ox, oy );
+    return;
+  }
+  int r1 = (int) std::max<double>( ceil(cy-oy-0.5), 0 );
+  int r2 = (int) std::min<double>( floor(cy+oy-0.5), span.rows()-1 );
+  for (int r=r1; r<=r2; ++r) {
+    double yc = r + 0.5 - cy;
+    double to = 1.0 - (yc/oy)*(yc/oy);
+    if (to < 0) continue;
+    double dxo = ox * sqrt(to);
+    double ti = 1.0 - (yc/iy)*(yc/iy);
+    if (ti <= 0) {
+      span( r, cx-dxo, cx+dxo );
+      continue;
+    }
+    double dxi = ix * sqrt(ti);
+    span( r, cx-dxo, cx-dxi );
+    span( r, cx+dxi, cx+dxo );
+  }
+}
+
+// stroke of width w with round caps and joins, each segment is filled separately
+// so that overlapping segments of opposite orientation can't cancel each other
+template <typename W>
+void raster_stroke( W &span, const double *x, const double *y, int n, double w, bool closed ) {
+  double hw = std::max<double>(w, 1.0) / 2.0;
+  int segments = closed && n>2 ? n : n-1;
+  for (int i=0; i<segments; ++i) {
+    int j = (i+1)%n;
+    double dx = x[j]-x[i];
+    double dy = y[j]-y[i];
+    double len = sqrt(dx*dx + dy*dy);
+    if (len <= 0) continue;
+    double nx = -dy/len*hw;
+    double ny =  dx/len*hw;
+    double qx[4] = { x[i]+nx, x[j]+nx, x[j]-nx, x[i]-nx };
+    double qy[4] = { y[i]+ny, y[j]+ny, y[j]-ny, y[i]-ny };
+    raster_fill_polygon( span, qx, qy, 4 );
+  }
+  for (int i=0; i<n; ++i)
+    raster_fill_ellipse( span, x[i], y[i], hw, hw );
+}
+
+//---------------------------------------------------------------------------------
+// shapes
+//---------------------------------------------------------------------------------
+
+template <typename T>
+void rasterize_shape( bim::Image &plane, const DRasterShape &shape ) {
+  int n = (int) std::min<size_t>( shape.x.size(), shape.y.size() );
+  if (n<1) return;
+  DRasterSpans<T> span( plane, shape.values );
+  const double *x = &shape.x[0];
+  const double *y = &shape.y[0];
+  double lw = shape.line_width;
+
+  if (shape.type == DRasterShape::Point) {
+    raster_fill_ellipse( span, x[0], y[0], lw*2.5, lw*2.5 );
+  } else
+  if (shape.type == DRasterShape::Polyline) {
+    raster_stroke( span, x, y, n, lw, false );
+  } else
+  if (shape.type == DRasterShape::Polygon) {
+    if (shape.filled && n>2) raster_fill_polygon( span, x, y, n );
+    raster_stroke( span, x, y, n, lw, true );
+  } else
+  if (shape.type == DRasterShape::Rectangle && n>=2) {
+    double rx[4] = { x[0], x[1], x[1], x[0] };
+    double ry[4] = { y[0], y[0], y[1], y[1] };
+    if (shape.filled) raster_fill_polygon( span, rx, ry, 4 );
+    raster_stroke( span, rx, ry, 4, lw, true );
+  } else
+  if (shape.type == DRasterShape::Ellipse && n>=3) {
+    double ra = fabs(std::max<double>(x[1], x[2]) - x[0]);
+    double rb = fabs(std::max<double>(y[1], y[2]) - y[0]);
+    if (shape.filled)
+      raster_fill_ellipse( span, x[0], y[0], ra+lw/2.0, rb+lw/2.0 );
+    else
+      raster_stroke_ellipse( span, x[0], y[0], ra, rb, lw );
+  } else
+  if (shape.type == DRasterShape::Circle && n>=2) {
+    double r = fabs(std::max<double>(x[1]-x[0], y[1]-y[0]));
+    if (shape.filled)
+      raster_fill_ellipse( span, x[0], y[0], r+lw/2.0, r+lw/2.0 );
+    else
+      raster_stroke_ellipse( span, x[0], y[0], r, r, lw );
+  }
+}
+
+void rasterizeShape( bim::Image &plane, const DRasterShape &shape ) {
+  if (plane.isEmpty()) return;
+  if (plane.depth()==8 && plane.pixelType()==bim::FMT_UNSIGNED)
+    rasterize_shape<bim::uint8>( plane, shape );
+  else
+  if (plane.depth()==16 && plane.pixelType()==bim::FMT_UNSIGNED)
+    rasterize_shape<bim::uint16>( plane, shape );
+  else
+  if (plane.depth()==32 && plane.pixelType()==bim::FMT_UNSIGNED)
+    rasterize_shape<bim::uint32>( plane, shape );
+  else
+  if (plane.depth()==8 && plane.pixelType()==bim::FMT_SIGNED)
+    rasterize_shape<bim::int8>( plane, shape );
+  else
+  if (plane.depth()==16 && plane.pixelType()==bim::FMT_SIGNED)
+    rasterize_shape<bim::int16>( plane, shape );
+  else
+  if (plane.depth()==32 && plane.pixelType()==bim::FMT_SIGNED)
+    rasterize_shape<bim::int32>( plane, shape );
+  else
+  if (plane.depth()==32 && plane.pixelType()==bim::FMT_FLOAT)
+    rasterize_shape<bim::float32>( plane, shape );
+  else
+  if (plane.depth()==64 && plane.pixelType()==bim::FMT_FLOAT)
+    rasterize_shape<bim::float64>( plane, shape );
+}
+
+void rasterizeShapes( bim::Image &plane, const DRasterShapes &shapes ) {
+  for (size_t i=0; i<shapes.size(); ++i)
+    rasterizeShape( plane, shapes[i] );
+}
@@ -0,0 +1,58 @@
+/*******************************************************************************
+
+5D GObjects native rasterization
+
+Author: Dima Fedorov Levit <dimin@dimin.net> <http://www.dimin.net/>
+        Center for Bio-image Informatics, UCSB
+
+History:
+2026-10-19 12:00 - First creation
+2026-10-19 12:00 - Closed shapes are outlined unless filled is set
+
+ver: 2
+
+*******************************************************************************/
+
+#ifndef DIM_GOBJECTS_RENDER_RASTER_H
+#define DIM_GOBJECTS_RENDER_RASTER_H
+
+#include <vector>
+
+namespace bim {
+  class Image;
+}
+
+//---------------------------------------------------------------------------------
+// graphical primitive in pixel coordinates of one plane
+//---------------------------------------------------------------------------------
+
+class DRasterShape {
+public:
+  enum Type { Point=0, Polyline=1, Polygon=2, Rectangle=3, Ellipse=4, Circle=5 };
+
+public:
+  DRasterShape( Type t = Polygon ): type(t), line_width(1.0), filled(false) {}
+
+  Type type;
+  std::vector<double> x, y;   // vertices, same meaning as in the gobject of the same type
+  double line_width;          // width of polylines and outlines, points are 5 widths wide
+  bool filled;                // closed shapes are filled together with their outline
+  std::vector<double> values; // value written into each sample, the last one is used for extra samples
+};
+
+typedef std::vector<DRasterShape> DRasterShapes;
+
+//---------------------------------------------------------------------------------
+// rendering functions
+//---------------------------------------------------------------------------------
+
+// paints a shape into the plane by sampling pixel centers, polygons, rectangles,
+// ellipses and circles are outlined, or filled with non-zero winding together with
+// their outline if filled is set, points are filled disks and polylines are strokes
+// with round caps and joins
+void rasterizeShape( bim::Image &plane, const DRasterShape &shape );
+
+// paints shapes in the given order, later shapes overwrite earlier ones
+void rasterizeShapes( bim::Image &plane, const DRasterShapes &shapes );
+
+#endif // DIM_GOBJECTS_RENDER_RASTER_H
@@ -255,11 +255,13 @@ INCLUDEPATH += $$DN_GENS
 
 HEADERS += $$DN_SRC/gobjects.h\
            $$DN_SRC/gobjects_render_qt.h\
+           $$DN_SRC/gobjects_render_raster.h\
            $$DN_SRC/gobjects_masks.h
 
 SOURCES += $$DN_SRC/main_gobjects.cpp\
            $$DN_SRC/gobjects.cpp\
            $$DN_SRC/gobjects_render_qt.cpp\
+           $$DN_SRC/gobjects_render_raster.cpp\
            $$DN_SRC/gobjects_masks.cpp
                 
 
@@ -0,0 +1,72 @@
+/*******************************************************************************
+ Benchmark: Chebyshev transform over feature extraction tile sizes
+
+ For every tile size reports the time of the first call, which builds and
+ caches the basis matrices, and the average time of subsequent tiles in
+ double and single precision for a 1 and a 3 channel 16 bit tile.
+
+ Run arguments: [tile_size ...], defaults to 64 128 256 512
+
+ History:
+   10/19/2026 12:00:00 - First creation
+
+ Ver : 1
+*******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include <random>
+
+#include <BioImageCore>
+#include <BioImage>
+
+#include <transforms/chebyshev.h>
+
+template <typename F>
+double time_it(F f, int reps=1) {
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for (int i=0; i<reps; ++i) f();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() / reps;
+}
+
+bim::Image make_tile(unsigned int size, unsigned int channels, std::mt19937 &rng) {
+  bim::Image img(size, size, 16, channels, bim::FMT_UNSIGNED);
+  std::uniform_int_distribution<int> d(0, 4095);
+  for (unsigned int c=0; c<channels; ++c) {
+    bim::uint16 *p = (bim::uint16 *) img.bits(c);
+    for (bim::uint64 i=0; i<img.numPixels(); ++i) p[i] = (bim::uint16) d(rng);
+  }
+  return img;
+}
+
+int main(int argc, char **argv) {
+  std::vector<unsigned int> sizes;
+  for (int i=1; i<argc; ++i) sizes.push_back(atoi(argv[i]));
+  if (sizes.size() == 0) { sizes.push_back(64); sizes.push_back(128); sizes.push_back(256); sizes.push_back(512); }
+
+  std::mt19937 rng(42);
+  printf("%6s %12s %12s %12s %14s %14s\n", "tile", "cold (ms)", "f64 (ms)", "f32 (ms)", "3ch f64 (ms)", "3ch f32 (ms)");
+  for (size_t s=0; s<sizes.size(); ++s) {
+    unsigned int n = sizes[s];
+    int reps = std::max<int>(2, (int) (4096*64 / (n*n)));
+    bim::Image tile = make_tile(n, 1, rng);
+    bim::Image tile3 = make_tile(n, 3, rng);
+
+    std::vector<double> out(n*n);
+    std::vector<float> outf(n*n);
+    const bim::uint16 *in = (const bim::uint16 *) tile.bits(0);
+    double *po = &out[0];
+    float *pf = &outf[0];
+
+    double cold = time_it([&]() { Chebyshev2D_channels<bim::uint16, double>(&po, &in, 1, n, n, n); });
+    double warm = time_it([&]() { Chebyshev2D_channels<bim::uint16, double>(&po, &in, 1, n, n, n); }, reps);
+    double warmf = time_it([&]() { Chebyshev2D_channels<bim::uint16, float>(&pf, &in, 1, n, n, n); }, reps);
+    double multi = time_it([&]() { tile3.transform(bim::Image::tmChebyshev, 64); }, reps);
+    double multif = time_it([&]() { tile3.transform(bim::Image::tmChebyshev, 32); }, reps);
+
+    printf("%6u %12.3f %12.3f %12.3f %14.3f %14.3f\n", n, cold*1000, warm*1000, warmf*1000, multi*1000, multif*1000);
+  }
+  return 0;
+}
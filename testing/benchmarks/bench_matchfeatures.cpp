@@ -0,0 +1,120 @@
+/*******************************************************************************
+ Benchmark: registration feature matching, dense matrix vs k-d tree
+
+ Generates synthetic rotated-window features (same layout as getfeatures:
+ 21x21 window stacked in rows plus 2 rotation rows) for the sensed image and
+ a perturbed, shuffled copy for the base image, then runs both matchers and
+ verifies they select the same tie points.
+
+ Run arguments: [number_of_points ...], defaults to 200 2000 20000
+ The dense matcher is skipped when its distance matrix would exceed 2GB.
+
+ History:
+   10/19/2026 12:00:00 - First creation
+
+ Ver : 1
+*******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include "../../src/reg/registration.h"
+#include "../../src/reg/algebra_array.h"
+#include "../../src/reg/kenney/matchfeatures.h"
+
+typedef float Timg;
+typedef float Tpoint;
+
+static const int wind = 10;
+static const int basis = 12;
+
+// normalized windows are smooth, represent them as a mix of a few smooth patterns plus noise
+void make_features(int n, std::mt19937 &rng, reg::Matrix<Timg> *w, std::deque< reg::Point<Tpoint> > *pts) {
+  int ws = 2*wind+1;
+  int dims = ws*ws;
+  std::normal_distribution<float> g(0.0f, 1.0f);
+  std::vector< std::vector<float> > b(basis, std::vector<float>(dims));
+  for (int k=0; k<basis; ++k) {
+    float fx = 0.2f + 0.1f*k, fy = 0.35f - 0.02f*k;
+    for (int i=0; i<dims; ++i)
+      b[k][i] = (float) sin(fx*(i/ws) + fy*(i%ws) + k);
+  }
+
+  w->init(dims+2, n);
+  for (int p=1; p<=n; ++p) {
+    std::vector<float> c(basis);
+    for (int k=0; k<basis; ++k) c[k] = g(rng);
+    for (int i=0; i<dims; ++i) {
+      float v = 0.1f*g(rng);
+      for (int k=0; k<basis; ++k) v += c[k]*b[k][i];
+      w->data[i+1][p] = v;
+    }
+    float a = (float) (g(rng)*REG_PI);
+    w->data[dims+1][p] = cos(a);
+    w->data[dims+2][p] = sin(a);
+    pts->push_back( reg::Point<Tpoint>((Tpoint)p, (Tpoint)(n-p)) );
+  }
+}
+
+void perturb_features(const reg::Matrix<Timg> &w, const std::deque< reg::Point<Tpoint> > &pts, std::mt19937 &rng,
+                      reg::Matrix<Timg> *W, std::deque< reg::Point<Tpoint> > *PTS) {
+  int n = w.cols;
+  std::vector<int> order(n);
+  for (int i=0; i<n; ++i) order[i] = i;
+  std::shuffle(order.begin(), order.end(), rng);
+  std::normal_distribution<float> g(0.0f, 0.05f);
+
+  W->init(w.rows, n);
+  for (int p=0; p<n; ++p) {
+    int src = order[p];
+    for (int i=1; i<=w.rows; ++i)
+      W->data[i][p+1] = w.data[i][src+1] + g(rng);
+    PTS->push_back( pts[src] );
+  }
+}
+
+template <typename F>
+double time_it(F f) {
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char **argv) {
+  std::vector<int> sizes;
+  for (int i=1; i<argc; ++i) sizes.push_back(atoi(argv[i]));
+  if (sizes.size() == 0) { sizes.push_back(200); sizes.push_back(2000); sizes.push_back(20000); }
+
+  printf("%10s %14s %14s %10s %8s\n", "points", "dense (s)", "kdtree (s)", "speedup", "equal");
+  for (size_t s=0; s<sizes.size(); ++s) {
+    int n = sizes[s];
+    std::mt19937 rng(1234 + n);
+    reg::Matrix<Timg> w, W;
+    std::deque< reg::Point<Tpoint> > c1, c2;
+    make_features(n, rng, &w, &c1);
+    perturb_features(w, c1, rng, &W, &c2);
+
+    int numpoints = n;
+    std::deque< reg::Point<Tpoint> > d1, d2, t1, t2;
+
+    double dense_bytes = 2.0 * n * (double) n * sizeof(Timg);
+    bool run_dense = dense_bytes < 2.0 * 1024 * 1024 * 1024;
+    double td = 0;
+    if (run_dense)
+      td = time_it([&]() { matchfeatures_dense(&w, &W, &c1, &c2, numpoints, &d1, &d2); });
+    double tk = time_it([&]() { matchfeatures(&w, &W, &c1, &c2, numpoints, &t1, &t2); });
+
+    if (run_dense) {
+      bool same = d1 == t1 && d2 == t2;
+      printf("%10d %14.4f %14.4f %9.2fx %8s\n", n, td, tk, td/tk, same ? "yes" : "NO");
+    } else {
+      printf("%10d %14s %14.4f %10s %8s\n", n, "skipped", tk, "-", "-");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,350 @@
+/*******************************************************************************
+ Benchmark suite: codecs and core image operations on synthetic data
+
+ Generates deterministic synthetic images locally for all pixel types and
+ 1 to 8 channels, writes them as striped, tiled and pyramidal TIFF, OME-TIFF,
+ JPEG, PNG, JPEG-2000 and NRRD raw volumes and times encode, decode, level
+ and tile reads. In-memory images are used to time resize, downsample,
+ histogram, convertToDepth and fuse.
+
+ Every case is run several times and the median is reported together with
+ the throughput in MB/s of uncompressed pixels. The report is written as
+ JSON with one case per line, giving a previous report as baseline prints
+ the speedup of every case, which makes runs comparable across commits.
+
+ Run arguments: [work_dir [report.json [baseline.json]]]
+   work_dir      - directory for generated files, defaults to the current one
+   report.json   - report file, defaults to bench_suite.json
+   baseline.json - report of a previous run to compare against
+
+ Environment: BIM_BENCH_SIZE image size in pixels, defaults to 2048
+              BIM_BENCH_REPS repetitions per case, defaults to 5
+
+ History:
+   10/19/2026 12:00:00 - First creation
+   10/19/2026 12:00:00 - Chain of pointwise modifiers
+   10/19/2026 12:00:00 - Display rendering
+
+ Ver : 3
+*******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include <BioImageCore>
+#include <BioImage>
+#include <BioImageFormats>
+
+// median time of reps runs of f in seconds
+template <typename F>
+double time_median(F f, int reps) {
+  std::vector<double> t(reps);
+  for (int i=0; i<reps; ++i) {
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    f();
+    t[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  }
+  std::sort(t.begin(), t.end());
+  return t[reps/2];
+}
+
+//------------------------------------------------------------------------------
+// synthetic data
+//------------------------------------------------------------------------------
+
+struct PixelType {
+  const char *name;
+  int depth;
+  bim::DataFormat format;
+};
+
+static const PixelType pixel_types[] = {
+  { "uint8",   8,  bim::FMT_UNSIGNED },
+  { "int8",    8,  bim::FMT_SIGNED },
+  { "uint16",  16, bim::FMT_UNSIGNED },
+  { "int16",   16, bim::FMT_SIGNED },
+  { "uint32",  32, bim::FMT_UNSIGNED },
+  { "int32",   32, bim::FMT_SIGNED },
+  { "float32", 32, bim::FMT_FLOAT },
+  { "float64", 64, bim::FMT_FLOAT }
+};
+
+// smooth structure plus noise, compresses like real microscopy data would
+template <typename T>
+void fill_plane(T *p, bim::uint64 w, bim::uint64 h, int c, double range, std::mt19937 &rng) {
+  std::normal_distribution<double> noise(0.0, 0.02);
+  double fx = 0.01 * (c+1), fy = 0.013 * (c+2);
+  for (bim::uint64 y=0; y<h; ++y) {
+    for (bim::uint64 x=0; x<w; ++x) {
+      double v = 0.5 + 0.25*sin(x*fx) + 0.2*cos(y*fy) + noise(rng);
+      p[y*w + x] = (T) (bim::trim<double>(v, 0.0, 1.0) * range);
+    }
+  }
+}
+
+bim::Image make_image(bim::uint64 w, bim::uint64 h, int channels, const PixelType &pt) {
+  bim::Image img(w, h, pt.depth, channels, pt.format);
+  std::mt19937 rng(42);
+  for (int c=0; c<channels; ++c) {
+    void *p = img.bits(c);
+    if (pt.format == bim::FMT_FLOAT && pt.depth == 32) fill_plane<bim::float32>((bim::float32*) p, w, h, c, 1.0, rng);
+    else if (pt.format == bim::FMT_FLOAT)              fill_plane<bim::float64>((bim::float64*) p, w, h, c, 1.0, rng);
+    else if (pt.depth == 8  && pt.format == bim::FMT_SIGNED) fill_plane<bim::int8>((bim::int8*) p, w, h, c, 127, rng);
+    else if (pt.depth == 8)                                  fill_plane<bim::uint8>((bim::uint8*) p, w, h, c, 255, rng);
+    else if (pt.depth == 16 && pt.format == bim::FMT_SIGNED) fill_plane<bim::int16>((bim::int16*) p, w, h, c, 32767, rng);
+    else if (pt.depth == 16)                                 fill_plane<bim::uint16>((bim::uint16*) p, w, h, c, 4095, rng);
+    else if (pt.format == bim::FMT_SIGNED)                   fill_plane<bim::int32>((bim::int32*) p, w, h, c, 1e6, rng);
+    else                                                     fill_plane<bim::uint32>((bim::uint32*) p, w, h, c, 1e6, rng);
+  }
+  return img;
+}
+
+double image_mb(const bim::Image &img) {
+  return img.bytesPerChan() * img.samples() / (1024.0 * 1024.0);
+}
+
+//------------------------------------------------------------------------------
+// report
+//------------------------------------------------------------------------------
+
+class Report {
+public:
+  Report(int reps): reps(reps) {}
+
+  template <typename F>
+  void run(const std::string &name, double mb, F f) {
+    double s = time_median(f, reps);
+    names.push_back(name);
+    seconds[name] = s;
+    throughput[name] = s > 0 ? mb / s : 0;
+    printf("%-44s %12.2f %12.1f", name.c_str(), s*1000.0, throughput[name]);
+    if (baseline.count(name) > 0 && s > 0)
+      printf(" %9.2fx", baseline[name] / s);
+    printf("\n");
+    fflush(stdout);
+  }
+
+  void error(const std::string &name, const std::string &msg) {
+    printf("%-44s %s\n", name.c_str(), msg.c_str());
+  }
+
+  bool write(const std::string &fileName) const {
+    std::ofstream f(fileName.c_str());
+    if (!f.is_open()) return false;
+    f << "{\n  \"reps\": " << reps << ",\n  \"cases\": {\n";
+    for (size_t i=0; i<names.size(); ++i) {
+      const std::string &n = names[i];
+      f << bim::xstring::xprintf("    \"%s\": { \"seconds\": %.6f, \"mb_per_second\": %.3f }%s\n",
+             n.c_str(), seconds.at(n), throughput.at(n), i+1<names.size() ? "," : "");
+    }
+    f << "  }\n}\n";
+    return true;
+  }
+
+  // reads a report written by write(), one case per line
+  bool readBaseline(const std::string &fileName) {
+    std::ifstream f(fileName.c_str());
+    if (!f.is_open()) return false;
+    std::string line;
+    while (std::getline(f, line)) {
+      size_t q1 = line.find('"');
+      size_t q2 = line.find('"', q1+1);
+      size_t s = line.find("\"seconds\":");
+      if (q1 == std::string::npos || q2 == std::string::npos || s == std::string::npos) continue;
+      baseline[line.substr(q1+1, q2-q1-1)] = atof(line.c_str() + s + 10);
+    }
+    return true;
+  }
+
+  void header() const {
+    printf("%-44s %12s %12s%s\n", "case", "median (ms)", "MB/s", baseline.size()>0 ? "   speedup" : "");
+  }
+
+private:
+  int reps;
+  std::vector<std::string> names;
+  std::map<std::string, double> seconds;
+  std::map<std::string, double> throughput;
+  std::map<std::string, double> baseline;
+};
+
+//------------------------------------------------------------------------------
+// cases
+//------------------------------------------------------------------------------
+
+void bench_codec(Report &r, const std::string &dir, const std::string &name, bim::Image &img,
+                 const char *fmt, const char *ext, const char *options) {
+  std::string fn = dir + "/bench_" + name + "." + ext;
+  double mb = image_mb(img);
+  bool ok = true;
+  r.run("encode/" + name, mb, [&]() { ok = ok && img.toFile(fn.c_str(), fmt, options); });
+  if (!ok) { r.error("encode/" + name, "FAILED"); return; }
+  r.run("decode/" + name, mb, [&]() { bim::Image o; ok = ok && o.fromFile(fn); });
+  if (!ok) r.error("decode/" + name, "FAILED");
+}
+
+void bench_pyramid(Report &r, const std::string &dir, const std::string &name, bim::Image &img,
+                   const char *fmt, const char *ext, const char *options, int tile) {
+  std::string fn = dir + "/bench_" + name + "." + ext;
+  if (!img.toFile(fn.c_str(), fmt, options)) { r.error("encode/" + name, "FAILED"); return; }
+
+  bim::ImageProxy proxy(fn);
+  if (!proxy.isReady()) { r.error("open/" + name, "FAILED"); return; }
+
+  bim::Image o;
+  r.run("level2/" + name, image_mb(img) / 16.0, [&]() { proxy.readLevel(o, 0, 2); });
+
+  // every tile of level 1 in raster order
+  int nx = (int) ceil(img.width() / 2.0 / tile);
+  int ny = (int) ceil(img.height() / 2.0 / tile);
+  r.run("tiles-l1/" + name, image_mb(img) / 4.0, [&]() {
+    for (int y=0; y<ny; ++y)
+      for (int x=0; x<nx; ++x)
+        proxy.readTile(o, 0, x, y, 1, tile);
+  });
+
+  // unaligned regions crossing stored tile boundaries
+  r.run("regions-l0/" + name, 16.0 * tile * tile * img.depth()/8 * img.samples() / (1024.0*1024.0), [&]() {
+    for (int i=0; i<16; ++i) {
+      bim::uint64 x = (i * 997) % (img.width() - tile);
+      bim::uint64 y = (i * 631) % (img.height() - tile);
+      proxy.readRegion(o, 0, x, y, x + tile - 1, y + tile - 1, 0);
+    }
+  });
+}
+
+void bench_volume(Report &r, const std::string &dir, bim::uint64 size, int z) {
+  bim::Image plane = make_image(size, size, 1, pixel_types[2]);
+  plane.updateGeometry(z, 1);
+  std::string fn = dir + "/bench_volume.nrrd";
+  std::string name = bim::xstring::xprintf("nrrd-uint16-%dx%dx%d", (int) size, (int) size, z);
+  double mb = image_mb(plane) * z;
+  bool ok = true;
+  r.run("encode/" + name, mb, [&]() {
+    bim::MetaFormatManager fm;
+    ok = ok && fm.sessionStartWrite((const bim::Filename) fn.c_str(), "NRRD") == 0;
+    for (int i=0; ok && i<z; ++i)
+      ok = fm.sessionWriteImage(plane.imageBitmap(), i) == 0;
+    fm.sessionEnd();
+  });
+  if (!ok) { r.error("encode/" + name, "FAILED"); return; }
+  r.run("decode/" + name, mb, [&]() {
+    bim::MetaFormatManager fm;
+    bim::Image o;
+    ok = ok && fm.sessionStartRead((const bim::Filename) fn.c_str()) == 0;
+    int pages = fm.sessionGetNumberOfPages();
+    for (int i=0; ok && i<pages; ++i)
+      ok = fm.sessionReadImage(o.imageBitmap(), i) == 0;
+    fm.sessionEnd();
+  });
+  if (!ok) r.error("decode/" + name, "FAILED");
+}
+
+void bench_operations(Report &r, bim::uint64 size) {
+  // negative first, later modifiers of the chain work in place
+  bim::xoperations pointwise;
+  pointwise.push_back(bim::xoperation("-negative", ""));
+  pointwise.push_back(bim::xoperation("-levels", "0,0,0.8"));
+  pointwise.push_back(bim::xoperation("-brightnesscontrast", "10,20"));
+  pointwise.push_back(bim::xoperation("-stretch", ""));
+
+  for (int t=0; t<8; ++t) {
+    const PixelType &pt = pixel_types[t];
+    bim::Image img = make_image(size, size, 3, pt);
+    std::string s = bim::xstring::xprintf("%s-3ch", pt.name);
+    double mb = image_mb(img);
+
+    r.run("histogram/" + s, mb, [&]() { bim::ImageHistogram h(img); });
+    r.run("downsample2x/" + s, mb, [&]() { bim::Image o = img.downSampleBy2x(); });
+    r.run("resize-nn-half/" + s, mb, [&]() { bim::Image o = img.resize(size/2, size/2, bim::Image::szNearestNeighbor); });
+    r.run("resize-bl-0.3/" + s, mb, [&]() { bim::Image o = img.resize(size*3/10, size*3/10, bim::Image::szBiLinear); });
+    r.run("resize-bc-0.3/" + s, mb, [&]() { bim::Image o = img.resize(size*3/10, size*3/10, bim::Image::szBiCubic); });
+    if (pt.depth != 8 || pt.format != bim::FMT_UNSIGNED)
+      r.run("convert-to-8bit/" + s, mb, [&]() { bim::Image o = img.convertToDepth(8, bim::Lut::ltLinearDataRange); });
+    r.run("pointwise-chain/" + s, mb, [&]() { bim::Image o = img; o.process(pointwise); });
+  }
+
+  // channel fusion of 2, 5 and 8 channel images into RGB
+  const int channels[] = { 2, 5, 8 };
+  for (int i=0; i<3; ++i) {
+    int c = channels[i];
+    bim::Image img = make_image(size, size, c, pixel_types[2]);
+    std::string s = bim::xstring::xprintf("uint16-%dch", c);
+    std::vector< std::set<int> > mapping(3);
+    std::vector<bim::DisplayColor> colors(c);
+    for (int j=0; j<c; ++j) {
+      mapping[j%3].insert(j);
+      colors[j] = bim::DisplayColor(j%3==0 ? 255 : 0, j%3==1 ? 255 : 0, j%3==2 ? 255 : 0);
+    }
+    r.run("fuse-max-rgb/" + s, image_mb(img), [&]() { bim::Image o = img.fuse(mapping); });
+    r.run("fuse-rgb/" + s, image_mb(img), [&]() { bim::Image o = img.fuseToRGB(colors); });
+    r.run("fuse-rgb-8bit/" + s, image_mb(img), [&]() { bim::Image o = img.fuseToRGB(colors).convertToDepth(8, bim::Lut::ltLinearDataRange); });
+    r.run("render-rgb/" + s, image_mb(img), [&]() { bim::Image o = img.renderToRGB(colors); });
+  }
+}
+
+//------------------------------------------------------------------------------
+// main
+//------------------------------------------------------------------------------
+
+int main(int argc, char **argv) {
+  std::string dir = argc > 1 ? argv[1] : ".";
+  std::string report_file = argc > 2 ? argv[2] : "bench_suite.json";
+  bim::uint64 size = getenv("BIM_BENCH_SIZE") ? atoi(getenv("BIM_BENCH_SIZE")) : 2048;
+  int reps = getenv("BIM_BENCH_REPS") ? bim::max<int>(1, atoi(getenv("BIM_BENCH_REPS"))) : 5;
+
+  Report r(reps);
+  if (argc > 3 && !r.readBaseline(argv[3]))
+    printf("Could not read baseline %s\n", argv[3]);
+
+  printf("image %llux%llu, %d repetitions, files in %s\n\n", (unsigned long long) size, (unsigned long long) size, reps, dir.c_str());
+  r.header();
+
+  // lossless TIFF over all pixel types, 1 and 3 channels
+  for (int t=0; t<8; ++t) {
+    for (int c=1; c<=3; c+=2) {
+      bim::Image img = make_image(size, size, c, pixel_types[t]);
+      std::string s = bim::xstring::xprintf("%s-%dch", pixel_types[t].name, c);
+      bench_codec(r, dir, "tiff-strip-none-" + s, img, "TIFF", "tif", "compression none");
+      bench_codec(r, dir, "tiff-strip-lzw-" + s, img, "TIFF", "tif", "compression lzw");
+    }
+  }
+
+  bim::Image rgb8 = make_image(size, size, 3, pixel_types[0]);
+  bim::Image gray16 = make_image(size, size, 1, pixel_types[2]);
+  bench_codec(r, dir, "tiff-tiled-zip-uint8-3ch", rgb8, "TIFF", "tif", "compression zip tiles 512");
+  bench_codec(r, dir, "tiff-tiled-jpeg-uint8-3ch", rgb8, "TIFF", "tif", "compression jpeg tiles 512");
+  bench_codec(r, dir, "jpeg-uint8-3ch", rgb8, "JPEG", "jpg", "quality 90");
+  bench_codec(r, dir, "png-uint8-3ch", rgb8, "PNG", "png", NULL);
+  bench_codec(r, dir, "png-uint16-1ch", gray16, "PNG", "png", NULL);
+  bench_codec(r, dir, "jp2-uint8-3ch", rgb8, "JP2", "jp2", NULL);
+
+  bim::Image multi16 = make_image(size, size, 8, pixel_types[2]);
+  bench_codec(r, dir, "ome-tiff-uint16-8ch", multi16, "OME-TIFF", "ome.tif", "compression lzw");
+
+  // pyramidal files: level, tile and region reads
+  bench_pyramid(r, dir, "tiff-pyramid-uint8-3ch", rgb8, "TIFF", "tif", "compression lzw tiles 256 pyramid subdirs", 256);
+  bench_pyramid(r, dir, "tiff-pyramid-uint16-1ch", gray16, "TIFF", "tif", "compression lzw tiles 256 pyramid subdirs", 256);
+  bench_pyramid(r, dir, "jp2-tiled-uint8-3ch", rgb8, "JP2", "jp2", "tiles 256", 256);
+
+  bench_volume(r, dir, size/4, 64);
+
+  bench_operations(r, size);
+
+  if (!r.write(report_file)) {
+    printf("\nCould not write report %s\n", report_file.c_str());
+    return 1;
+  }
+  printf("\nReport written to %s\n", report_file.c_str());
+  return 0;
+}
@@ -506,6 +506,151 @@ def test_image_commands( extra, filename, meta_test  ):
         print_passed('reading command info')
 
     print
+    return out_name
+
+
+def test_image_tiles( filename, tile_size, format='tiff' ):
+
+    print
+    print '---------------------------------------'
+    print '-tile %s - %s'%(tile_size, filename)
+    print '---------------------------------------'
+
+    out_name = 'tests/_test_tiles_%s.%s'%(filename, format)
+    filename = 'images/%s'%(filename)
+
+    # export all tiles of all levels
+    command = [IMGCNV, '-i', filename, '-o', out_name, '-t', format, '-tile', str(tile_size)]
+    r = Popen (command, stdout=PIPE).communicate()[0]
+
+    command = [IMGCNV, '-i', filename, '-info']
+    r = Popen (command, stdout=PIPE).communicate()[0]
+    info_org = parse_imgcnv_info(r)
+    if r is None or 'width' not in info_org:
+        print_failed('loading input info', filename)
+        return
+
+    # levels are halved until they fit into a tile, every tile has to be present with its own size
+    w = int(info_org['width'])
+    h = int(info_org['height'])
+    levels = [(w, h)]
+    while max(w, h) > tile_size and w > 1 and h > 1:
+        w = w / 2
+        h = h / 2
+        levels.append((w, h))
+
+    base, ext = os.path.splitext(out_name)
+    for l, (w, h) in enumerate(levels):
+        for ty in range(0, (h + tile_size - 1) / tile_size):
+            for tx in range(0, (w + tile_size - 1) / tile_size):
+                tile_name = '%s_%.3d_%.3d_%.3d%s'%(base, l, tx, ty, ext)
+                command = [IMGCNV, '-i', tile_name, '-info']
+                r = Popen (command, stdout=PIPE).communicate()[0]
+                info_tile = parse_imgcnv_info(r)
+                test = { 'width': min(tile_size, w - tx*tile_size), 'height': min(tile_size, h - ty*tile_size), 'channels': info_org['channels'] }
+                if r is None or len(info_tile)<=0:
+                    print_failed('loading tile %s'%tile_name, filename)
+                    return
+                if compare_info(info_tile, test)!=True:
+                    return
+    print_passed('all %d levels of tiles'%len(levels))
+
+    # tiles of the first level are regions of the image, same as when extracted one by one
+    w, h = levels[0]
+    last_x = (w + tile_size - 1) / tile_size - 1
+    last_y = (h + tile_size - 1) / tile_size - 1
+    for tx, ty in [(0, 0), (last_x / 2, last_y / 2), (last_x, last_y)]:
+        tile_name = '%s_%.3d_%.3d_%.3d%s'%(base, 0, tx, ty, ext)
+        test_image_pixels( '-tile %s export'%tile_size, tile_name, [], filename, ['-tile', '%s,%s,%s,0'%(tile_size, tx, ty)] )
+
+    print
+
+
+def test_image_pixels( title, filename_a, extra_a, filename_b, extra_b, env_a=None, env_b=None ):
+
+    print
+    print '---------------------------------------'
+    print '%s - %s %s - %s %s'%(title, filename_a, extra_a, filename_b, extra_b)
+    print '---------------------------------------'
+
+    if filename_a is None or filename_b is None:
+        print_failed('missing input for pixel comparison', title)
+        return
+
+    # decode both inputs into raw pixels and compare them byte by byte
+    pixels = []
+    for n, (filename, extra, env) in enumerate([(filename_a, extra_a, env_a), (filename_b, extra_b, env_b)]):
+        extra = [str(i) for i in extra]
+        name = '%s_%s_%s'%(os.path.basename(filename), '_'.join(extra), n)
+        out_name = 'tests/_test_pixels_%s.raw'%(''.join(c if c.isalnum() or c in '._-' else '_' for c in name))
+        if os.path.exists(out_name):
+            os.remove(out_name)
+
+        command = [IMGCNV, '-i', filename, '-o', out_name, '-t', 'raw']
+        command.extend(extra)
+        environment = None
+        if env is not None:
+            environment = dict(os.environ)
+            environment.update(env)
+        r = Popen (command, stdout=PIPE, env=environment).communicate()[0]
+
+        if not os.path.exists(out_name) or os.path.getsize(out_name)<1:
+            print_failed('writing raw pixels for %s %s'%(filename, extra), title)
+            return
+        with open(out_name, 'rb') as f:
+            pixels.append(f.read())
+
+    if pixels[0] != pixels[1]:
+        print_failed('pixels differ', title)
+        return
+    print_passed('identical pixels')
+
+    print
+
+
+def test_image_mosaic( filename, tile_size, num_x, num_y, options, meta_test=None ):
+
+    print
+    print '---------------------------------------'
+    print '-mosaic %s,%s,%s - %s - %s'%(tile_size, num_x, num_y, filename, options)
+    print '---------------------------------------'
+
+    # split the image into lossless tiles of the native resolution level
+    base = 'tests/_test_mosaic_%s'%(filename)
+    command = [IMGCNV, '-i', 'images/%s'%(filename), '-o', '%s.png'%(base), '-t', 'png', '-tile', str(tile_size)]
+    r = Popen (command, stdout=PIPE).communicate()[0]
+
+    command = [IMGCNV, '-mosaic', '%s,%s,%s'%(tile_size, num_x, num_y)]
+    for ty in range(0, num_y):
+        for tx in range(0, num_x):
+            command.extend(['-i', '%s_000_%.3d_%.3d.png'%(base, tx, ty)])
+
+    # streamed when tiles are requested, composed in memory and written at once otherwise
+    out_name = '%s_%s.tif'%(base, options.replace(' ', '_'))
+    if os.path.exists(out_name):
+        os.remove(out_name)
+    command.extend(['-o', out_name, '-t', 'tiff'])
+    if len(options)>0:
+        command.extend(['-options', options])
+    r = Popen (command, stdout=PIPE).communicate()[0]
+
+    if not os.path.exists(out_name):
+        print_failed('writing mosaic', filename)
+        return
+    print_passed('writing mosaic')
+
+    if meta_test is not None:
+        command = [IMGCNV, '-i', out_name, '-meta-parsed']
+        r = Popen (command, stdout=PIPE).communicate()[0]
+        info_cnv = parse_imgcnv_info(r)
+        if r is None or len(info_cnv)<=0:
+            print_failed('loading mosaic info', filename)
+            return
+        if compare_info(info_cnv, meta_test)==True:
+            print_passed('reading mosaic info')
+
+    print
+    return out_name
 
 
 ###############################################################
@@ -2067,6 +2212,25 @@ if 'all' in mode or 'commands' in mode:
     meta_test['image_pixel_depth'] = 8
     test_image_commands( ['-rotate', 'guess'], "IMG_1003.JPG", meta_test )
 
+    # arbitrary angles are interpolated into the bounding box of the rotated image
+    meta_test = {}
+    meta_test['image_num_c'] = 3
+    meta_test['image_num_x'] = 1166
+    meta_test['image_num_y'] = 972
+    meta_test['image_pixel_depth'] = 8
+    test_image_commands( ['-rotate', '12.5,BC'], 'flowers_24bit_nointr.png', meta_test )
+    test_image_pixels( '-rotate close to exact', 'images/flowers_24bit_nointr.png', ['-rotate', '90.00000001,BC'], 'images/flowers_24bit_nointr.png', ['-rotate', 90] )
+
+    # geometric transforms keep the size of the input
+    meta_test = {}
+    meta_test['image_num_c'] = 3
+    meta_test['image_num_x'] = 1024
+    meta_test['image_num_y'] = 768
+    meta_test['image_pixel_depth'] = 8
+    test_image_commands( ['-transform_geometry', '0.9,0.1,12,0.1,0.9,7.5,BL'], 'flowers_24bit_nointr.png', meta_test )
+    test_image_commands( ['-transform_geometry', '1,0.1,0,0,1,0,0.0001,0,1,BC'], 'flowers_24bit_nointr.png', meta_test )
+    test_image_pixels( '-transform_geometry identity', 'images/flowers_24bit_nointr.png', [], 'images/flowers_24bit_nointr.png', ['-transform_geometry', '1,0,0,0,1,0,NN'] )
+
     meta_test = {}
     meta_test['image_num_c'] = 1
     meta_test['image_num_x'] = 1024
@@ -2081,6 +2245,11 @@ if 'all' in mode or 'commands' in mode:
     meta_test['image_pixel_depth'] = 32
     test_image_commands( ['-superpixels', 16], 'flowers_24bit_nointr.png', meta_test )
 
+    # superpixels have to be identical on any number of threads, exact below 2048 pixels and tiled above
+    single = { 'OMP_NUM_THREADS': '1' }
+    test_image_pixels( '-superpixels exact', 'images/flowers_24bit_nointr.png', ['-superpixels', 16], 'images/flowers_24bit_nointr.png', ['-superpixels', 16], single, None )
+    test_image_pixels( '-superpixels tiled', 'images/IMG_0562.JPG', ['-superpixels', 16], 'images/IMG_0562.JPG', ['-superpixels', 16], single, None )
+
     meta_test = {}
     meta_test['image_num_c'] = 2
     meta_test['image_num_x'] = 256
@@ -2130,7 +2299,51 @@ if 'all' in mode or 'commands' in mode:
     meta_test['pixel_resolution_unit_t'] = 'seconds'
     meta_test['channel_0_name'] = 'FITC'
     meta_test['channel_1_name'] = 'Cy3'
-    test_image_commands( ['-t', 'ome-tiff', '-rearrange3d', 'yzx'], 'cells.ome.tif', meta_test )
+    yzx_name = test_image_commands( ['-t', 'ome-tiff', '-rearrange3d', 'yzx'], 'cells.ome.tif', meta_test )
+
+    # a 1MB budget reslices in many passes over the input and has to give the same pixels
+    yzx_small_name = test_image_commands( ['-t', 'ome-tiff', '-rearrange3d', 'yzx,1'], 'cells.ome.tif', meta_test )
+    test_image_pixels( '-rearrange3d yzx in passes', yzx_name, [], yzx_small_name, [] )
+
+    # runs of pointwise modifiers are fused into a single lookup table, "-rotate 0" is a
+    # no-op that breaks the run, so modifiers run one by one and have to give the same pixels
+    fused = [
+        ('flowers_8bit_gray.png', '10,200,1.2', 'unsigned integer'),
+        ('Tile_19491580_0_1.mrc', '100,3000,0.8', 'unsigned integer'),
+        ('golgi.mrc', '-50,100,1.2', 'signed integer'),
+        ('10', '-1000,2000,0.8', 'signed integer'),
+    ]
+    for filename, levels, pixel_format in fused:
+        together = ['-levels', levels, '-brightnesscontrast', '10,20', '-depth', '8,d']
+        separate = ['-levels', levels, '-rotate', 0, '-brightnesscontrast', '10,20', '-rotate', 0, '-depth', '8,d']
+        meta_test = {}
+        meta_test['image_pixel_depth'] = 8
+        test_image_commands( together, filename, meta_test )
+        test_image_pixels( 'fused pointwise modifiers %s'%pixel_format, 'images/%s'%filename, together, 'images/%s'%filename, separate )
+
+    # a leading -remap decodes only the kept channels, "-remap 2,0 -remap 1" keeps the same
+    # channel but the empty channel disables decoding a subset, both have to produce the same image
+    meta_test = {}
+    meta_test['image_num_c'] = 1
+    test_image_commands( ['-remap', 2], 'combinedsubtractions.lsm', meta_test )
+    test_image_commands( ['-remap', '2,0', '-remap', 1], 'combinedsubtractions.lsm', meta_test )
+    test_image_pixels( 'planar TIFF -remap', 'images/combinedsubtractions.lsm', ['-remap', 2], 'images/combinedsubtractions.lsm', ['-remap', '2,0', '-remap', 1] )
+
+    meta_test = {}
+    meta_test['image_num_c'] = 1
+    meta_test['image_num_z'] = 13
+    meta_test['image_pixel_depth'] = 16
+    meta_test['channel_0_name'] = 'Cy3'
+    test_image_commands( ['-t', 'ome-tiff', '-remap', 2], 'cells.ome.tif', meta_test )
+    test_image_commands( ['-t', 'ome-tiff', '-remap', '2,0', '-remap', 1], 'cells.ome.tif', meta_test )
+    test_image_pixels( 'OME-TIFF -remap', 'images/cells.ome.tif', ['-remap', 2], 'images/cells.ome.tif', ['-remap', '2,0', '-remap', 1] )
+
+    meta_test = {}
+    meta_test['image_num_c'] = 1
+    meta_test['channel_0_name'] = 'TRITC'
+    test_image_commands( ['-t', 'ome-tiff', '-remap', 2], '23D3HA-cy3 psd-gfp-488 Homer-647 DIV 14 - 3.zvi', meta_test )
+    test_image_commands( ['-t', 'ome-tiff', '-remap', '2,0', '-remap', 1], '23D3HA-cy3 psd-gfp-488 Homer-647 DIV 14 - 3.zvi', meta_test )
+    test_image_pixels( 'ZVI -remap', 'images/23D3HA-cy3 psd-gfp-488 Homer-647 DIV 14 - 3.zvi', ['-remap', 2], 'images/23D3HA-cy3 psd-gfp-488 Homer-647 DIV 14 - 3.zvi', ['-remap', '2,0', '-remap', 1] )
 
 
 if 'all' in mode or 'pyramids' in mode:
@@ -2409,6 +2622,59 @@ if 'all' in mode or 'pyramids' in mode:
 
     # testing tile size different from stored is not required for flat structure
 
+    # full tile export of an image not a multiple of the tile size
+    test_image_tiles( 'IMG_0562.JPG', 256 )
+
+    # mosaic composed in memory and streamed tile by tile with spooled sub-resolution levels,
+    # every level has to match the same image written at once
+    out_name = test_image_mosaic( 'flowers_24bit_nointr.png', 256, 4, 3, '' )
+    test_image_pixels( '-mosaic in memory', 'images/flowers_24bit_nointr.png', [], out_name, [] )
+
+    meta_test = {}
+    meta_test['image_num_x'] = 1024
+    meta_test['image_num_y'] = 768
+    meta_test['image_num_c'] = 3
+    meta_test['image_pixel_depth'] = 8
+    meta_test['tile_num_x'] = 256
+    meta_test['tile_num_y'] = 256
+    meta_test['image_num_resolution_levels'] = 4
+    ref_name = test_image_commands( ['-t', 'tiff', '-options', 'tiles 256 pyramid subdirs'], 'flowers_24bit_nointr.png', meta_test )
+    out_name = test_image_mosaic( 'flowers_24bit_nointr.png', 256, 4, 3, 'tiles 256 pyramid subdirs', meta_test )
+    for l in range(0, 4):
+        test_image_pixels( '-mosaic streamed level %s'%(l), ref_name, ['-res-level', l], out_name, ['-res-level', l] )
+
+    # tiled writing, lossless round trip of images not a multiple of the tile size
+    meta_test = {}
+    meta_test['image_num_x'] = 1024
+    meta_test['image_num_y'] = 768
+    meta_test['image_num_c'] = 3
+    meta_test['image_num_z'] = 1
+    meta_test['image_num_t'] = 1
+    meta_test['image_pixel_depth'] = 8
+    meta_test['image_pixel_format'] = 'unsigned integer'
+    meta_test['tile_num_x'] = 512
+    meta_test['tile_num_y'] = 512
+    meta_test['image_num_resolution_levels'] = 6
+    meta_test['image_resolution_level_structure'] = 'flat'
+    out_name = test_image_commands( ['-t', 'jp2', '-options', 'tiles 512 quality 100'], 'flowers_24bit_nointr.png', meta_test )
+    test_image_pixels( 'JPEG-2000 512px tiles', 'images/flowers_24bit_nointr.png', [], out_name, [] )
+
+    meta_test = {}
+    meta_test['image_num_x'] = 5472
+    meta_test['image_num_y'] = 3648
+    meta_test['image_num_c'] = 3
+    meta_test['image_num_z'] = 1
+    meta_test['image_num_t'] = 1
+    meta_test['image_pixel_depth'] = 16
+    meta_test['image_pixel_format'] = 'unsigned integer'
+    meta_test['tile_num_x'] = 512
+    meta_test['tile_num_y'] = 512
+    meta_test['image_num_resolution_levels'] = 6
+    meta_test['image_resolution_level_structure'] = 'flat'
+    meta_test['ColorProfile/color_space'] = 'RGB'
+    out_name = test_image_commands( ['-t', 'jp2', '-options', 'tiles 512 quality 100'], 'IMG_1913_16bit_prophoto_q90.jxr', meta_test )
+    test_image_pixels( 'JPEG-2000 512px tiles 16 bit', 'images/IMG_1913_16bit_prophoto_q90.jxr', [], out_name, [] )
+
 
 end = time.time()
 elapsed= end - start
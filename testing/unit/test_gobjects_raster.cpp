@@ -0,0 +1,132 @@
+/*******************************************************************************
+ Test: native gobject rasterization
+
+ Closed shapes have to be outlined by default and filled only when requested,
+ outlines have to lie inside the filled shape, rectangles have to match the
+ equivalent polygon, polylines are never filled and values are written
+ exactly into wider pixel types as used by label output.
+
+ Returns 0 if all cases pass.
+
+ History:
+   10/19/2026 12:00:00 - First creation
+
+ Ver : 1
+*******************************************************************************/
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+
+#include <BioImageCore>
+#include <BioImage>
+
+#include "../../src_gobjects/gobjects_render_raster.h"
+
+static const int size = 100;
+
+bim::Image render(const DRasterShape &s, int depth = 8) {
+  bim::Image img(size, size, depth, 1, bim::FMT_UNSIGNED);
+  img.fill(0);
+  rasterizeShape(img, s);
+  return img;
+}
+
+double pixel(bim::Image &img, int x, int y) {
+  if (img.depth() == 16) return ((bim::uint16 *) img.scanLine(0, y))[x];
+  return ((bim::uint8 *) img.scanLine(0, y))[x];
+}
+
+int count(bim::Image &img) {
+  int n = 0;
+  for (int y=0; y<size; ++y)
+    for (int x=0; x<size; ++x)
+      if (pixel(img, x, y) != 0) ++n;
+  return n;
+}
+
+bool contains(bim::Image &outer, bim::Image &inner) {
+  for (int y=0; y<size; ++y)
+    for (int x=0; x<size; ++x)
+      if (pixel(inner, x, y) != 0 && pixel(outer, x, y) == 0) return false;
+  return true;
+}
+
+bool same(bim::Image &a, bim::Image &b) {
+  return contains(a, b) && contains(b, a);
+}
+
+// number of painted runs crossing the row
+int runs(bim::Image &img, int y) {
+  int n = 0;
+  for (int x=0; x<size; ++x)
+    if (pixel(img, x, y) != 0 && (x == 0 || pixel(img, x-1, y) == 0)) ++n;
+  return n;
+}
+
+DRasterShape shape(DRasterShape::Type t, const double *xy, int n, bool filled) {
+  DRasterShape s(t);
+  for (int i=0; i<n; ++i) {
+    s.x.push_back(xy[i*2]);
+    s.y.push_back(xy[i*2+1]);
+  }
+  s.values.push_back(255);
+  s.filled = filled;
+  return s;
+}
+
+int failures = 0;
+
+void check(const char *name, bool ok) {
+  printf("%-50s %s\n", name, ok ? "ok" : "FAILED");
+  if (!ok) ++failures;
+}
+
+int main() {
+  const double square[] = { 10,10, 30,10, 30,30, 10,30 };
+  const double corners[] = { 10,10, 30,30 };
+  const double circle[] = { 50,50, 60,50 };
+  const double ellipse[] = { 50,50, 70,50, 50,60 };
+  const double vee[] = { 10,60, 30,90, 50,60 };
+
+  // polygons
+  bim::Image po = render(shape(DRasterShape::Polygon, square, 4, false));
+  bim::Image pf = render(shape(DRasterShape::Polygon, square, 4, true));
+  check("polygon outline leaves the inside empty", pixel(po, 20, 20) == 0 && runs(po, 20) == 2);
+  check("polygon fill covers the inside", pixel(pf, 20, 20) == 255 && runs(pf, 20) == 1);
+  check("polygon outline lies within the fill", contains(pf, po) && count(pf) > count(po));
+  check("polygon fill covers the vertex bounding box", count(pf) >= 20*20);
+
+  // rectangles are polygons given by two corners
+  bim::Image ro = render(shape(DRasterShape::Rectangle, corners, 2, false));
+  bim::Image rf = render(shape(DRasterShape::Rectangle, corners, 2, true));
+  check("rectangle outline matches polygon outline", same(ro, po));
+  check("rectangle fill matches polygon fill", same(rf, pf));
+
+  // circles and ellipses
+  bim::Image co = render(shape(DRasterShape::Circle, circle, 2, false));
+  bim::Image cf = render(shape(DRasterShape::Circle, circle, 2, true));
+  double area = 3.14159265358979 * 10.5 * 10.5;
+  check("circle outline leaves the inside empty", pixel(co, 50, 50) == 0 && runs(co, 50) == 2);
+  check("circle fill has the area of the disk", fabs(count(cf) - area) < area*0.05);
+  check("circle outline lies within the fill", contains(cf, co));
+
+  bim::Image eo = render(shape(DRasterShape::Ellipse, ellipse, 3, false));
+  bim::Image ef = render(shape(DRasterShape::Ellipse, ellipse, 3, true));
+  check("ellipse outline leaves the inside empty", pixel(eo, 50, 50) == 0 && runs(eo, 50) == 2);
+  check("ellipse fill is wider than high", pixel(ef, 50, 50) == 255 && pixel(ef, 68, 50) != 0 && pixel(ef, 50, 68) == 0);
+  check("ellipse outline lies within the fill", contains(ef, eo));
+
+  // polylines are open strokes even if filling is requested
+  bim::Image lo = render(shape(DRasterShape::Polyline, vee, 3, false));
+  bim::Image lf = render(shape(DRasterShape::Polyline, vee, 3, true));
+  check("polyline is never filled", same(lo, lf) && pixel(lf, 30, 65) == 0);
+
+  // labels are written exactly into wider types
+  DRasterShape label = shape(DRasterShape::Polygon, square, 4, true);
+  label.values[0] = 1000;
+  bim::Image lb = render(label, 16);
+  check("16 bit label value is exact", pixel(lb, 20, 20) == 1000 && count(lb) == count(pf));
+
+  return failures == 0 ? 0 : 1;
+}
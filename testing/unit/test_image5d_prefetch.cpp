@@ -0,0 +1,156 @@
+/*******************************************************************************
+ Test: Image5D time point prefetch
+
+ Writes a multi-T OME-TIFF where every pixel encodes its time point, Z plane
+ and position, then scrubs it forward, backward, across the time loop and by
+ random jumps with prefetch disabled and enabled, with a cache holding only a
+ few time points so stacks are constantly evicted and prefetched again. Every
+ served stack has to hold exactly the pixels of its time point and the stacks
+ served with and without prefetch have to be identical. Files in formats
+ not safe for concurrent sessions must not be prefetched. Build with the
+ BIC_ENABLE_TSAN option to check the prefetch thread for data races.
+
+ Returns 0 if all cases pass.
+
+ History:
+   10/19/2026 12:00:00 - First creation
+
+ Ver : 1
+*******************************************************************************/
+
+#include <cstdio>
+#include <vector>
+#include <random>
+
+#include <BioImageCore>
+#include <BioImage>
+#include <BioImageFormats>
+
+#include <bim_image_5d.h>
+
+static const char *file_name = "_test_image5d_prefetch.ome.tif";
+static const char *bmp_name = "_test_image5d_prefetch.bmp";
+static const unsigned int width = 64;
+static const unsigned int height = 48;
+static const unsigned int nz = 3;
+static const unsigned int nt = 8;
+
+inline bim::uint16 value(unsigned int t, unsigned int z, unsigned int x, unsigned int y) {
+  return (bim::uint16) (t*1000 + z*100 + (x*7 + y*13) % 100);
+}
+
+bool write_file() {
+  bim::MetaFormatManager fm;
+  if (fm.sessionStartWrite((bim::Filename) file_name, "ome-tiff", "") != 0) return false;
+  bool ok = true;
+  for (unsigned int t=0; t<nt && ok; ++t) {
+    for (unsigned int z=0; z<nz && ok; ++z) {
+      bim::Image img(width, height, 16, 1, bim::FMT_UNSIGNED);
+      for (unsigned int y=0; y<height; ++y) {
+        bim::uint16 *p = (bim::uint16 *) img.scanLine(0, y);
+        for (unsigned int x=0; x<width; ++x)
+          p[x] = value(t, z, x, y);
+      }
+      img.imageBitmap()->i.number_z = nz;
+      img.imageBitmap()->i.number_t = nt;
+      ok = fm.sessionWriteImage(img.imageBitmap(), t*nz + z) == 0;
+    }
+  }
+  fm.sessionEnd();
+  return ok;
+}
+
+// checksum of a served stack, -1 if any pixel does not belong to time point t
+double check_stack(bim::ImageStack *stk, unsigned int t) {
+  if (!stk || stk->size() != (int) nz) return -1;
+  double sum = 0;
+  for (unsigned int z=0; z<nz; ++z) {
+    bim::Image *img = stk->imageAt(z);
+    if (!img || img->width() != width || img->height() != height) return -1;
+    for (unsigned int y=0; y<height; ++y) {
+      const bim::uint16 *p = (const bim::uint16 *) img->scanLine(0, y);
+      for (unsigned int x=0; x<width; ++x) {
+        if (p[x] != value(t, z, x, y)) return -1;
+        sum += p[x] * (x+1.0);
+      }
+    }
+  }
+  return sum;
+}
+
+std::vector<unsigned int> scrub_order() {
+  std::vector<unsigned int> order;
+  for (int r=0; r<3; ++r) {
+    for (unsigned int t=0; t<nt; ++t) order.push_back(t);       // forward
+    for (int t=nt-1; t>=0; --t) order.push_back(t);             // backward
+    for (unsigned int t=0; t<nt; ++t) order.push_back((t+5)%nt); // forward across the loop
+    for (unsigned int t=0; t<nt; ++t) order.push_back((nt+2-t)%nt); // backward across the loop
+  }
+  std::mt19937 rng(5);
+  for (int i=0; i<50; ++i) order.push_back(rng() % nt); // random jumps
+  return order;
+}
+
+int failures = 0;
+
+void check(const char *name, bool ok) {
+  printf("%-55s %s\n", name, ok ? "ok" : "FAILED");
+  if (!ok) ++failures;
+}
+
+// returns checksums of stacks in the order they were served, empty if any stack was wrong
+std::vector<double> scrub(unsigned int range, const std::vector<unsigned int> &order) {
+  std::vector<double> sums;
+  bim::Image5D img;
+  if (!img.fromFile(std::string(file_name))) return sums;
+  if (img.numberT() != nt || img.numberZ() != nz) return sums;
+  if (!img.setPrefetchRange(range) || img.getPrefetchRange() != range) return sums;
+  // three time points fit into the cache, prefetch may use two of them
+  double stack_bytes = (double) width*height*2*nz;
+  img.setMaximumCacheSize(stack_bytes*3.5);
+  img.setMaximumPrefetchSize(stack_bytes*2.5);
+  for (size_t i=0; i<order.size(); ++i) {
+    double s = check_stack(img.stackAt(order[i]), order[i]);
+    if (s < 0) return std::vector<double>();
+    sums.push_back(s);
+  }
+  return sums;
+}
+
+int main() {
+  check("writing multi-T OME-TIFF", write_file());
+
+  bim::Image5D probe;
+  check("prefetch is supported in every build", bim::Image5D::isPrefetchSupported());
+  check("prefetch is enabled by default", probe.getPrefetchRange() == 1);
+  check("prefetch range can be set", probe.setPrefetchRange(2) && probe.getPrefetchRange() == 2);
+  check("prefetch can always be disabled", probe.setPrefetchRange(0) && probe.getPrefetchRange() == 0);
+
+  // BMP is not safe for concurrent sessions, the requested range comes back with the next file
+  bim::Image bmp(width, height, 8, 1, bim::FMT_UNSIGNED);
+  bmp.fill(0);
+  bool written = bmp.toFile(bmp_name, "bmp");
+  bim::Image5D serial;
+  serial.setPrefetchRange(2);
+  check("no prefetch for formats unsafe for concurrent sessions",
+        written && serial.fromFile(std::string(bmp_name)) && serial.getPrefetchRange() == 0 &&
+        !serial.setPrefetchRange(2) && serial.getPrefetchRange() == 0 && serial.stackAt(0) != 0);
+  check("requested range is restored for concurrent formats",
+        serial.fromFile(std::string(file_name)) && serial.getPrefetchRange() == 2);
+  serial.clear();
+  std::remove(bmp_name);
+
+  std::vector<unsigned int> order = scrub_order();
+  std::vector<double> reference = scrub(0, order);
+  check("scrubbing without prefetch", reference.size() == order.size());
+  unsigned int ranges[] = { 1, 2, nt };
+  for (int r=0; r<3; ++r) {
+    char name[256];
+    sprintf(name, "scrubbing with prefetch range %d", ranges[r]);
+    std::vector<double> sums = scrub(ranges[r], order);
+    check(name, sums.size() == order.size() && sums == reference);
+  }
+
+  std::remove(file_name);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+/*******************************************************************************
+ Test: registration feature matching, k-d tree vs dense reference
+
+ The k-d tree matcher must select exactly the same tie points as the dense
+ distance matrix matcher. Features follow the getfeatures layout: 21x21
+ window stacked in rows plus 2 rotation rows. Smooth, noisy, quantized
+ (many equal distances) and duplicated features are checked.
+
+ Returns 0 if all cases pass.
+
+ History:
+   10/19/2026 12:00:00 - First creation
+
+ Ver : 1
+*******************************************************************************/
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <deque>
+#include <random>
+#include <algorithm>
+
+#include "../../src/reg/registration.h"
+#include "../../src/reg/algebra_array.h"
+#include "../../src/reg/kenney/matchfeatures.h"
+
+typedef float Timg;
+typedef float Tpoint;
+
+static const int wind = 10;
+
+enum FeatureKind { fkSmooth=0, fkNoise=1, fkQuantized=2, fkDuplicated=3 };
+
+void make_features(int n, FeatureKind kind, std::mt19937 &rng, reg::Matrix<Timg> *w, std::deque< reg::Point<Tpoint> > *pts) {
+  int ws = 2*wind+1;
+  int dims = ws*ws;
+  std::normal_distribution<float> g(0.0f, 1.0f);
+  w->init(dims+2, n);
+  for (int p=1; p<=n; ++p) {
+    float c1 = g(rng), c2 = g(rng), c3 = g(rng);
+    for (int i=0; i<dims; ++i) {
+      float v = 0;
+      if (kind == fkNoise)
+        v = g(rng);
+      else
+        v = c1*(float)sin(0.2f*(i/ws) + c3) + c2*(float)cos(0.3f*(i%ws)) + 0.1f*g(rng);
+      if (kind == fkQuantized) v = (float) floor(v*2.0f);
+      w->data[i+1][p] = v;
+    }
+    if (kind == fkDuplicated && p>1 && p%3==0)
+      for (int i=1; i<=dims; ++i) w->data[i][p] = w->data[i][p-1];
+    w->data[dims+1][p] = 1;
+    w->data[dims+2][p] = 0;
+    pts->push_back( reg::Point<Tpoint>((Tpoint)p, (Tpoint)(n-p)) );
+  }
+}
+
+void perturb_features(const reg::Matrix<Timg> &w, const std::deque< reg::Point<Tpoint> > &pts, FeatureKind kind, std::mt19937 &rng,
+                      reg::Matrix<Timg> *W, std::deque< reg::Point<Tpoint> > *PTS) {
+  int n = w.cols;
+  std::vector<int> order(n);
+  for (int i=0; i<n; ++i) order[i] = i;
+  std::shuffle(order.begin(), order.end(), rng);
+  std::normal_distribution<float> g(0.0f, 0.05f);
+  W->init(w.rows, n);
+  for (int p=0; p<n; ++p) {
+    int src = order[p];
+    for (int i=1; i<=w.rows; ++i)
+      W->data[i][p+1] = kind == fkQuantized || kind == fkDuplicated ? w.data[i][src+1] : w.data[i][src+1] + g(rng);
+    PTS->push_back( pts[src] );
+  }
+}
+
+int main() {
+  const char *names[] = { "smooth", "noise", "quantized", "duplicated" };
+  int sizes[] = { 1, 7, 60, 400, 1500 };
+  int failures = 0;
+  for (int kind=fkSmooth; kind<=fkDuplicated; ++kind) {
+    for (size_t s=0; s<sizeof(sizes)/sizeof(int); ++s) {
+      int n = sizes[s];
+      std::mt19937 rng(77 + n*4 + kind);
+      reg::Matrix<Timg> w, W;
+      std::deque< reg::Point<Tpoint> > c1, c2;
+      make_features(n, (FeatureKind) kind, rng, &w, &c1);
+      perturb_features(w, c1, (FeatureKind) kind, rng, &W, &c2);
+
+      int requested[] = { n/4+1, n };
+      for (int r=0; r<2; ++r) {
+        int numpoints = requested[r];
+        std::deque< reg::Point<Tpoint> > d1, d2, t1, t2;
+        matchfeatures_dense(&w, &W, &c1, &c2, numpoints, &d1, &d2);
+        matchfeatures(&w, &W, &c1, &c2, numpoints, &t1, &t2);
+        bool same = d1 == t1 && d2 == t2;
+        printf("%-10s %6d points %6d requested: %s\n", names[kind], n, numpoints, same ? "ok" : "FAILED");
+        if (!same) ++failures;
+      }
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
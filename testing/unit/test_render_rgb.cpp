@@ -0,0 +1,132 @@
+/*******************************************************************************
+ Test: single pass display rendering against the multi-pass path
+
+ Uses a 5 channel 8 bit image of odd size where every channel spans the
+ full 0-255 range. renderToRGB with max, sum and average fusion has to match
+ the same rendering done in passes: channels converted to 8 bits over their
+ data range, weighted full size planes accumulated per output component and
+ then scaled and clamped. Max fusion of unit colours also has to match
+ fuseToRGB followed by an 8 bit conversion, and the interleaved buffer
+ overload has to hold the same pixels as the planar image.
+
+ Returns 0 if all cases pass.
+
+ History:
+   10/19/2026 12:00:00 - First creation
+
+ Ver : 1
+*******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+#include <BioImageCore>
+#include <BioImage>
+
+static const int width = 131;
+static const int height = 77;
+static const int channels = 5;
+
+int failures = 0;
+
+void check(const char *name, bool ok) {
+  printf("%-55s %s\n", name, ok ? "ok" : "FAILED");
+  if (!ok) ++failures;
+}
+
+inline int pixel(const bim::Image &img, int c, int x, int y) {
+  return ((bim::uint8 *) img.scanLine(c, y))[x];
+}
+
+// channels go through 8 bit conversion, weighted planes and final scaling as separate passes
+bim::Image render_passes(const bim::Image &img, const std::vector<bim::DisplayColor> &colors, bim::Image::FuseMethod method) {
+  bim::Image in = img.convertToDepth(8, bim::Lut::ltLinearDataRange);
+
+  double max_contribution = 0;
+  for (size_t i=0; i<colors.size(); ++i)
+    max_contribution = std::max<double>(max_contribution, std::max<double>(colors[i].r, std::max<double>(colors[i].g, colors[i].b)));
+
+  bim::Image out(width, height, 8, 3, bim::FMT_UNSIGNED);
+  for (int k=0; k<3; ++k) {
+    std::vector<double> plane(width*height, 0.0);
+    int num = 0;
+    for (int c=0; c<channels; ++c) {
+      double weight = (k==0 ? colors[c].r : k==1 ? colors[c].g : colors[c].b) / max_contribution;
+      if (weight <= 0) continue;
+      ++num;
+      for (int y=0; y<height; ++y)
+        for (int x=0; x<width; ++x) {
+          double v = pixel(in, c, x, y) * weight;
+          double &p = plane[x + y*width];
+          p = method == bim::Image::fmMax ? std::max<double>(p, v) : p + v;
+        }
+    }
+    if (method != bim::Image::fmAverage || num == 0) num = 1;
+    for (int y=0; y<height; ++y)
+      for (int x=0; x<width; ++x)
+        ((bim::uint8 *) out.scanLine(k, y))[x] = bim::trim<bim::uint8, double>(plane[x + y*width] / num, 0, 255);
+  }
+  return out;
+}
+
+int compare(const bim::Image &a, const bim::Image &b) {
+  if (a.width() != b.width() || a.height() != b.height() || a.samples() != 3 || b.samples() != 3) return -1;
+  int diff = 0;
+  for (int k=0; k<3; ++k)
+    for (int y=0; y<height; ++y)
+      for (int x=0; x<width; ++x)
+        diff = std::max<int>(diff, abs(pixel(a, k, x, y) - pixel(b, k, x, y)));
+  return diff;
+}
+
+int main() {
+  bim::Image img(width, height, 8, channels, bim::FMT_UNSIGNED);
+  srand(7);
+  for (int c=0; c<channels; ++c)
+    for (int y=0; y<height; ++y)
+      for (int x=0; x<width; ++x)
+        ((bim::uint8 *) img.scanLine(c, y))[x] = (bim::uint8) (rand() % 256);
+  // first pixel black and second white in every channel, data range is the full range
+  for (int c=0; c<channels; ++c) {
+    ((bim::uint8 *) img.scanLine(c, 0))[0] = 0;
+    ((bim::uint8 *) img.scanLine(c, 0))[1] = 255;
+  }
+
+  std::vector<bim::DisplayColor> colors;
+  colors.push_back(bim::DisplayColor(255, 0, 0));
+  colors.push_back(bim::DisplayColor(0, 255, 0));
+  colors.push_back(bim::DisplayColor(0, 0, 255));
+  colors.push_back(bim::DisplayColor(255, 255, 0));
+  colors.push_back(bim::DisplayColor(128, 0, 128));
+
+  const bim::Image::FuseMethod methods[] = { bim::Image::fmMax, bim::Image::fmAdd, bim::Image::fmAverage };
+  const char *names[] = { "max", "sum", "average" };
+  char name[256];
+  for (int m=0; m<3; ++m) {
+    bim::Image rendered = img.renderToRGB(colors, std::vector<bim::DisplayRange>(), methods[m]);
+    bim::Image passes = render_passes(img, colors, methods[m]);
+    sprintf(name, "%s fusion matches the multi-pass rendering", names[m]);
+    check(name, compare(rendered, passes) == 0);
+
+    std::vector<unsigned char> rgb(width*3*height + 5);
+    bool done = img.renderToRGB(&rgb[0], width*3 + 1, colors, std::vector<bim::DisplayRange>(), methods[m]);
+    bool same = done;
+    for (int y=0; y<height && same; ++y)
+      for (int x=0; x<width && same; ++x)
+        for (int k=0; k<3; ++k)
+          if (rgb[y*(width*3 + 1) + x*3 + k] != pixel(rendered, k, x, y)) same = false;
+    sprintf(name, "%s fusion into an interleaved buffer", names[m]);
+    check(name, same);
+  }
+
+  // unit colours only, the fused maximum spans the whole 8 bit range
+  std::vector<bim::DisplayColor> unit(colors.begin(), colors.begin() + 4);
+  unit.push_back(bim::DisplayColor(0, 0, 0));
+  bim::Image fused = img.fuseToRGB(unit, bim::Image::fmMax).convertToDepth(8, bim::Lut::ltLinearDataRange);
+  bim::Image rendered = img.renderToRGB(unit, std::vector<bim::DisplayRange>(), bim::Image::fmMax);
+  check("max fusion matches fuseToRGB and 8 bit conversion", compare(rendered, fused) == 0);
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+/*******************************************************************************
+ Test: arbitrary rotation and affine/projective warps
+
+ Uses a 9x5 image with pixel values 10*x+y. Rotations by angles close to
+ the exact ones have to match the exact rotation with every interpolation,
+ a sub-pixel translation has to produce the bilinear values, identity
+ matrices have to keep the image and singular matrices have to fail.
+
+ Returns 0 if all cases pass.
+
+ History:
+   10/19/2026 12:00:00 - First creation
+
+ Ver : 1
+*******************************************************************************/
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+
+#include <BioImageCore>
+#include <BioImage>
+
+static const int width = 9;
+static const int height = 5;
+
+inline int pixel(const bim::Image &img, int x, int y) {
+  return ((bim::uint8 *) img.scanLine(0, y))[x];
+}
+
+bool same(const bim::Image &a, const bim::Image &b) {
+  if (a.width() != b.width() || a.height() != b.height()) return false;
+  for (int y=0; y<(int)a.height(); ++y)
+    for (int x=0; x<(int)a.width(); ++x)
+      if (pixel(a, x, y) != pixel(b, x, y)) return false;
+  return true;
+}
+
+std::vector<double> matrix(const double *v, int n) {
+  return std::vector<double>(v, v+n);
+}
+
+int failures = 0;
+
+void check(const char *name, bool ok) {
+  printf("%-55s %s\n", name, ok ? "ok" : "FAILED");
+  if (!ok) ++failures;
+}
+
+int main() {
+  bim::Image img(width, height, 8, 1, bim::FMT_UNSIGNED);
+  for (int y=0; y<height; ++y)
+    for (int x=0; x<width; ++x)
+      ((bim::uint8 *) img.scanLine(0, y))[x] = (bim::uint8) (x*10+y);
+
+  const char *methods[] = { "nearest neighbour", "bilinear", "bicubic" };
+  char name[256];
+
+  // angles close to the exact ones are interpolated but land on pixel centers
+  bim::Image r90 = img.rotate(90);
+  bim::Image r180 = img.rotate(180);
+  check("exact 90 degree rotation swaps the size", r90.width() == height && r90.height() == width);
+  check("exact 180 degree rotation reverses pixels", pixel(r180, 0, 0) == pixel(img, width-1, height-1));
+  for (int m=bim::Image::szNearestNeighbor; m<=bim::Image::szBiCubic; ++m) {
+    sprintf(name, "90.0000001 degrees %s matches exact 90", methods[m]);
+    check(name, same(img.rotate(90.0000001, (bim::Image::ResizeMethod) m), r90));
+    sprintf(name, "-179.9999999 degrees %s matches exact 180", methods[m]);
+    check(name, same(img.rotate(-179.9999999, (bim::Image::ResizeMethod) m), r180));
+  }
+
+  // other angles go into the bounding box of the rotated image
+  double a = 12.5 * 3.14159265358979 / 180.0;
+  bim::Image r12 = img.rotate(12.5, bim::Image::szBiCubic);
+  check("12.5 degrees covers the rotated bounding box",
+        r12.width() >= floor(width*cos(a) + height*sin(a)) && r12.width() <= ceil(width*cos(a) + height*sin(a)) + 1 &&
+        r12.height() >= floor(width*sin(a) + height*cos(a)) && r12.height() <= ceil(width*sin(a) + height*cos(a)) + 1);
+
+  // identities
+  const double identity_affine[] = { 1,0,0, 0,1,0 };
+  const double identity_projective[] = { 2,0,0, 0,2,0, 0,0,2 };
+  for (int m=bim::Image::szNearestNeighbor; m<=bim::Image::szBiCubic; ++m) {
+    sprintf(name, "affine identity %s keeps the image", methods[m]);
+    check(name, same(img.transform_geometry(matrix(identity_affine, 6), (bim::Image::ResizeMethod) m), img));
+    sprintf(name, "scaled projective identity %s keeps the image", methods[m]);
+    check(name, same(img.transform_geometry(matrix(identity_projective, 9), (bim::Image::ResizeMethod) m), img));
+  }
+
+  // sub-pixel translation, output x,y samples input x-2.5,y+1
+  const double translation[] = { 1,0,2.5, 0,1,-1 };
+  bim::Image t = img.transform_geometry(matrix(translation, 6), bim::Image::szBiLinear);
+  bool ok = t.width() == width && t.height() == height;
+  for (int y=0; y<height-1 && ok; ++y)
+    for (int x=3; x<width && ok; ++x)
+      ok = pixel(t, x, y) == (x*10-25) + (y+1);
+  check("sub-pixel translation gives bilinear values", ok);
+  check("pixels mapped outside of the input get the background", pixel(t, 0, 0) == 0 && pixel(t, 5, height-1) == 0);
+
+  // the output size may differ from the input
+  const double scale[] = { 2,0,0, 0,2,0 };
+  bim::Image s = img.transform_geometry(matrix(scale, 6), bim::Image::szNearestNeighbor, width*2, height*2);
+  check("2x scale into a larger output", s.width() == width*2 && s.height() == height*2 &&
+        pixel(s, 6, 4) == pixel(img, 3, 2) && pixel(s, 16, 8) == pixel(img, 8, 4));
+
+  const double singular[] = { 1,2,0, 2,4,0 };
+  check("singular matrix fails", img.transform_geometry(matrix(singular, 6)).isEmpty());
+
+  return failures == 0 ? 0 : 1;
+}